@@ -0,0 +1,153 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "apidata.h"
+#include "dto/service_predict.hpp"
+#include <benchmark/benchmark.h>
+#include <rapidjson/writer.h>
+
+using namespace dd;
+
+// predict call with n data items, as received by the server
+static std::string predict_request(const int &n)
+{
+  std::string jstr
+      = "{\"service\":\"imgserv\",\"parameters\":{\"input\":{\"width\":224,"
+        "\"height\":224,\"mean\":[128,128,128]},\"mllib\":{\"gpu\":true,"
+        "\"gpuid\":0,\"net\":{\"test_batch_size\":8}},\"output\":{\"best\":3,"
+        "\"confidence_threshold\":0.1,\"bbox\":true}},\"data\":[";
+  for (int i = 0; i < n; ++i)
+    {
+      if (i > 0)
+        jstr += ",";
+      jstr += "\"https://www.deepdetect.com/img/" + std::to_string(i)
+              + ".jpg\"";
+    }
+  return jstr + "]}";
+}
+
+// predict output with n predictions of 10 classes each
+static APIData predict_output(const int &n)
+{
+  std::vector<APIData> predictions;
+  for (int i = 0; i < n; ++i)
+    {
+      std::vector<APIData> classes;
+      for (int c = 0; c < 10; ++c)
+        {
+          APIData cad, bbox;
+          cad.add("cat", std::to_string(c));
+          cad.add("prob", 1.0 / (c + 2));
+          bbox.add("xmin", 10.0 * c);
+          bbox.add("ymin", 12.0 * c);
+          bbox.add("xmax", 10.0 * c + 50.0);
+          bbox.add("ymax", 12.0 * c + 80.0);
+          cad.add("bbox", bbox);
+          classes.push_back(cad);
+        }
+      APIData pad;
+      pad.add("uri", std::to_string(i));
+      pad.add("classes", classes);
+      predictions.push_back(pad);
+    }
+  APIData out;
+  out.add("predictions", predictions);
+  return out;
+}
+
+static void json_to_apidata(benchmark::State &state)
+{
+  std::string jstr = predict_request(state.range(0));
+  for (auto _ : state)
+    {
+      rapidjson::Document d;
+      d.Parse<rapidjson::kParseNanAndInfFlag>(jstr.c_str());
+      APIData ad;
+      ad.fromRapidJson(d);
+      benchmark::DoNotOptimize(ad);
+    }
+  state.SetBytesProcessed(state.iterations() * jstr.size());
+}
+BENCHMARK(json_to_apidata)->Arg(1)->Arg(64);
+
+static void json_to_dto(benchmark::State &state)
+{
+  std::string jstr = predict_request(state.range(0));
+  const auto &mapper = oatpp_utils::getDDMapper();
+  for (auto _ : state)
+    {
+      auto dto = mapper->readFromString<oatpp::Object<DTO::ServicePredict>>(
+          jstr.c_str());
+      benchmark::DoNotOptimize(dto);
+    }
+  state.SetBytesProcessed(state.iterations() * jstr.size());
+}
+BENCHMARK(json_to_dto)->Arg(1)->Arg(64);
+
+static void apidata_to_dto(benchmark::State &state)
+{
+  rapidjson::Document d;
+  d.Parse<rapidjson::kParseNanAndInfFlag>(
+      predict_request(state.range(0)).c_str());
+  APIData ad;
+  ad.fromRapidJson(d);
+  for (auto _ : state)
+    {
+      auto dto = ad.createSharedDTO<DTO::ServicePredict>();
+      benchmark::DoNotOptimize(dto);
+    }
+}
+BENCHMARK(apidata_to_dto)->Arg(1)->Arg(64);
+
+static void dto_to_apidata(benchmark::State &state)
+{
+  auto dto = oatpp_utils::getDDMapper()
+                 ->readFromString<oatpp::Object<DTO::ServicePredict>>(
+                     predict_request(state.range(0)).c_str());
+  for (auto _ : state)
+    {
+      APIData ad = APIData::fromDTO<DTO::ServicePredict>(dto);
+      benchmark::DoNotOptimize(ad);
+    }
+}
+BENCHMARK(dto_to_apidata)->Arg(1)->Arg(64);
+
+static void apidata_to_json(benchmark::State &state)
+{
+  APIData out = predict_output(state.range(0));
+  size_t bytes = 0;
+  for (auto _ : state)
+    {
+      JDoc jd;
+      jd.SetObject();
+      out.toJDoc(jd);
+      rapidjson::StringBuffer buffer;
+      rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>,
+                        rapidjson::UTF8<>, rapidjson::CrtAllocator,
+                        rapidjson::kWriteNanAndInfFlag>
+          writer(buffer);
+      jd.Accept(writer);
+      bytes += buffer.GetSize();
+    }
+  state.SetBytesProcessed(bytes);
+}
+BENCHMARK(apidata_to_json)->Arg(1)->Arg(64);
+
+BENCHMARK_MAIN();
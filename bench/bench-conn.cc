@@ -0,0 +1,247 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "imginputfileconn.h"
+#include "csvinputfileconn.h"
+#include "txtinputfileconn.h"
+#include "utils/db.hpp"
+#include "utils/fileops.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+
+using namespace dd;
+
+static std::shared_ptr<spdlog::logger> bench_logger()
+{
+  static std::shared_ptr<spdlog::logger> logger
+      = spdlog::stdout_logger_mt("bench");
+  return logger;
+}
+
+// synthetic jpeg, smooth enough to compress like a photograph
+static std::string jpeg_image(const int &width, const int &height)
+{
+  cv::Mat src(height, width, CV_8UC3);
+  cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::GaussianBlur(src, src, cv::Size(31, 31), 0);
+  std::vector<unsigned char> jpg;
+  cv::imencode(".jpg", src, jpg);
+  return std::string(jpg.begin(), jpg.end());
+}
+
+/*- images -*/
+
+// args: image width, height, reduced decoding
+static void ddimg_decode(benchmark::State &state)
+{
+  std::string jpg = jpeg_image(state.range(0), state.range(1));
+  for (auto _ : state)
+    {
+      DDImg dimg;
+      dimg._logger = bench_logger();
+      dimg._reduced_decode = state.range(2);
+      dimg.read_mem(jpg);
+      benchmark::DoNotOptimize(dimg._imgs);
+    }
+  state.SetBytesProcessed(state.iterations() * jpg.size());
+}
+BENCHMARK(ddimg_decode)
+    ->Args({ 640, 480, 0 })
+    ->Args({ 1920, 1080, 0 })
+    ->Args({ 1920, 1080, 1 })
+    ->Unit(benchmark::kMicrosecond);
+
+// args: image width, height
+static void ddimg_prepare(benchmark::State &state)
+{
+  cv::Mat src(state.range(1), state.range(0), CV_8UC3);
+  cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+  DDImg dimg;
+  dimg._logger = bench_logger();
+  for (auto _ : state)
+    {
+      cv::Mat dst;
+      dimg.prepare(src, dst, "bench");
+      benchmark::DoNotOptimize(dst);
+    }
+}
+BENCHMARK(ddimg_prepare)
+    ->Args({ 640, 480 })
+    ->Args({ 1920, 1080 })
+    ->Unit(benchmark::kMicrosecond);
+
+/*- CSV -*/
+
+// arg: number of lines of 50 columns, in prediction mode
+static void csv_transform(benchmark::State &state)
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> dist(0.0, 1000.0);
+  std::vector<std::string> lines;
+  size_t bytes = 0;
+  for (int l = 0; l < state.range(0); ++l)
+    {
+      std::string line;
+      for (int c = 0; c < 50; ++c)
+        {
+          if (c > 0)
+            line += ",";
+          line += std::to_string(dist(gen));
+        }
+      bytes += line.size();
+      lines.push_back(line);
+    }
+  APIData ad;
+  ad.add("data", lines);
+  for (auto _ : state)
+    {
+      CSVInputFileConn cifc;
+      cifc._logger = bench_logger();
+      cifc._train = false;
+      cifc.transform(ad);
+      benchmark::DoNotOptimize(cifc._csvdata);
+    }
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(csv_transform)->Arg(1)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+/*- text -*/
+
+// arg: number of words of the document, bag of words parsing with
+// vocabulary construction
+static void txt_parse(benchmark::State &state)
+{
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0, 5000);
+  std::string content;
+  for (int w = 0; w < state.range(0); ++w)
+    content += "word" + std::to_string(dist(gen)) + (w % 20 ? " " : ".\n");
+  for (auto _ : state)
+    {
+      TxtInputFileConn tifc;
+      tifc._logger = bench_logger();
+      tifc._train = true;
+      tifc.parse_content(content, 1);
+      benchmark::DoNotOptimize(tifc._vocab);
+    }
+  state.SetBytesProcessed(state.iterations() * content.size());
+}
+BENCHMARK(txt_parse)->Arg(100)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+/*- LMDB -*/
+
+class LMDBFixture : public benchmark::Fixture
+{
+public:
+  void SetUp(const benchmark::State &) override
+  {
+    if (_db)
+      return;
+    char tmpl[] = "/tmp/dd_bench_XXXXXX";
+    _dir = mkdtemp(tmpl);
+    std::unique_ptr<db::DB> wdb(db::GetDB("lmdb"));
+    wdb->Open(_dir + "/bench.lmdb", db::NEW);
+    std::unique_ptr<db::Transaction> txn(wdb->NewTransaction());
+    std::string value(_value_size, 'x');
+    for (int i = 0; i < _nrecords; ++i)
+      {
+        txn->Put(key(i), value);
+        if (i % 1000 == 999)
+          {
+            txn->Commit();
+            txn.reset(wdb->NewTransaction());
+          }
+      }
+    txn->Commit();
+    wdb->Close();
+
+    _db.reset(db::GetDB("lmdb"));
+    _db->Open(_dir + "/bench.lmdb", db::READ);
+  }
+
+  ~LMDBFixture()
+  {
+    if (_db)
+      {
+        _db->Close();
+        fileops::remove_dir(_dir);
+      }
+  }
+
+  static std::string key(const int &i)
+  {
+    char k[16];
+    snprintf(k, sizeof(k), "%08d", i);
+    return k;
+  }
+
+  std::unique_ptr<db::DB> _db;
+  std::string _dir;
+  const int _nrecords = 5000;
+  const int _value_size = 3 * 64 * 64;
+};
+
+// random single record reads
+BENCHMARK_F(LMDBFixture, lmdb_get)(benchmark::State &state)
+{
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0, _nrecords - 1);
+  std::string value;
+  for (auto _ : state)
+    {
+      _db->Get(key(dist(gen)), value);
+      benchmark::DoNotOptimize(value);
+    }
+  state.SetBytesProcessed(state.iterations() * _value_size);
+}
+
+// random batches of 32 records, read in a single transaction
+BENCHMARK_F(LMDBFixture, lmdb_get_batch)(benchmark::State &state)
+{
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> dist(0, _nrecords - 1);
+  std::vector<std::string> keys(32);
+  std::vector<std::string> values;
+  for (auto _ : state)
+    {
+      for (std::string &k : keys)
+        k = key(dist(gen));
+      _db->Get(keys, values);
+      benchmark::DoNotOptimize(values);
+    }
+  state.SetBytesProcessed(state.iterations() * keys.size() * _value_size);
+}
+
+// sequential scan
+BENCHMARK_F(LMDBFixture, lmdb_cursor)(benchmark::State &state)
+{
+  std::unique_ptr<db::Cursor> cursor(_db->NewCursor());
+  for (auto _ : state)
+    {
+      if (!cursor->valid())
+        cursor->SeekToFirst();
+      std::string value = cursor->value();
+      benchmark::DoNotOptimize(value);
+      cursor->Next();
+    }
+  state.SetBytesProcessed(state.iterations() * _value_size);
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,184 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "outputconnectorstrategy.h"
+#include "utils/bbox.hpp"
+#include "utils/topk.hpp"
+#include <benchmark/benchmark.h>
+#include <random>
+
+using namespace dd;
+
+// raw classification results of a batch, as added by the ML libraries
+static std::vector<APIData> classification_results(const int &batch_size,
+                                                   const int &nclasses)
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> dist(0.0, 1.0);
+  std::vector<std::string> cats;
+  for (int c = 0; c < nclasses; ++c)
+    cats.push_back("class_" + std::to_string(c));
+  std::vector<APIData> vrad;
+  for (int b = 0; b < batch_size; ++b)
+    {
+      std::vector<double> probs;
+      for (int c = 0; c < nclasses; ++c)
+        probs.push_back(dist(gen));
+      APIData rad;
+      rad.add("uri", std::to_string(b));
+      rad.add("loss", 0.0);
+      rad.add("probs", probs);
+      rad.add("cats", cats);
+      vrad.push_back(rad);
+    }
+  return vrad;
+}
+
+// args: batch size, number of classes
+static void supervised_best_cats(benchmark::State &state)
+{
+  int nclasses = state.range(1);
+  SupervisedOutput so;
+  so.add_results(classification_results(state.range(0), nclasses));
+  for (auto _ : state)
+    {
+      SupervisedOutput bcats;
+      so.best_cats(bcats, 3, nclasses, false, false, false);
+      benchmark::DoNotOptimize(bcats._vvcats);
+    }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(supervised_best_cats)
+    ->Args({ 1, 1000 })
+    ->Args({ 64, 10 })
+    ->Args({ 64, 1000 })
+    ->Unit(benchmark::kMicrosecond);
+
+// args: batch size, number of classes, from raw results to the API output
+static void supervised_finalize(benchmark::State &state)
+{
+  int nclasses = state.range(1);
+  std::vector<APIData> vrad
+      = classification_results(state.range(0), nclasses);
+  auto output_params = DTO::OutputConnector::createShared();
+  output_params->best = 3;
+  for (auto _ : state)
+    {
+      SupervisedOutput so;
+      so.add_results(vrad);
+      APIData ad_out;
+      ad_out.add("nclasses", nclasses);
+      so.finalize(output_params, ad_out, nullptr);
+      benchmark::DoNotOptimize(ad_out);
+    }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(supervised_finalize)
+    ->Args({ 1, 1000 })
+    ->Args({ 64, 1000 })
+    ->Unit(benchmark::kMicrosecond);
+
+// arg: number of test samples, 10 classes
+static void supervised_measure(benchmark::State &state)
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> dist(0.01, 1.0);
+  const int nclasses = 10;
+  APIData ad_res;
+  ad_res.add("nclasses", nclasses);
+  ad_res.add("batch_size", static_cast<int>(state.range(0)));
+  for (int i = 0; i < state.range(0); ++i)
+    {
+      std::vector<double> pred;
+      double sum = 0.0;
+      for (int c = 0; c < nclasses; ++c)
+        {
+          pred.push_back(dist(gen));
+          sum += pred.back();
+        }
+      for (double &p : pred)
+        p /= sum;
+      APIData bad;
+      bad.add("pred", pred);
+      bad.add("target", static_cast<double>(i % nclasses));
+      ad_res.add(std::to_string(i), std::vector<APIData>{ bad });
+    }
+  APIData ad_out;
+  ad_out.add("measure",
+             std::vector<std::string>{ "acc", "mcll", "f1", "cmdiag" });
+  for (auto _ : state)
+    {
+      APIData out;
+      SupervisedOutput::measure(ad_res, ad_out, out);
+      benchmark::DoNotOptimize(out);
+    }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(supervised_measure)
+    ->Arg(100)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
+
+// arg: number of classes, best 5 of a single sample
+static void top_k_selection(benchmark::State &state)
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(0.0, 1.0);
+  std::vector<float> probs(state.range(0));
+  for (float &p : probs)
+    p = dist(gen);
+  std::vector<size_t> idx;
+  for (auto _ : state)
+    {
+      dd_utils::top_k(probs.data(), probs.size(), 5, 0.0f, idx);
+      benchmark::DoNotOptimize(idx);
+    }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(top_k_selection)
+    ->Arg(1000)
+    ->Arg(21843)
+    ->Unit(benchmark::kMicrosecond);
+
+// arg: number of detections, sorted by decreasing confidence
+static void nms_boxes(benchmark::State &state)
+{
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> pos(0.0, 600.0);
+  std::uniform_real_distribution<double> size(10.0, 100.0);
+  std::vector<double> boxes;
+  for (int i = 0; i < state.range(0); ++i)
+    {
+      double x = pos(gen);
+      double y = pos(gen);
+      boxes.insert(boxes.end(), { x, y, x + size(gen), y + size(gen) });
+    }
+  std::vector<size_t> picked;
+  for (auto _ : state)
+    {
+      bbox_utils::nms_sorted_boxes(boxes.data(), state.range(0), picked,
+                                   0.45);
+      benchmark::DoNotOptimize(picked);
+    }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(nms_boxes)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,157 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "deepdetect.h"
+#include "jsonapi.h"
+#include "utils/fileops.hpp"
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+using namespace dd;
+
+static const int nfeatures = 16;
+
+/**
+ * \brief in-process service with a small MLP, trained for a few iterations
+ * on synthetic data, so that predictions need no downloaded model
+ */
+class BenchService
+{
+public:
+  BenchService()
+  {
+    char tmpl[] = "/tmp/dd_bench_XXXXXX";
+    _repo = mkdtemp(tmpl);
+    std::string jstr
+        = "{\"mllib\":\"caffe\",\"description\":\"bench\",\"type\":"
+          "\"supervised\",\"model\":{\"repository\":\""
+          + _repo
+          + "\",\"templates\":\"../templates/caffe/\"},\"parameters\":{"
+            "\"input\":{\"connector\":\"csv\"},\"mllib\":{\"template\":"
+            "\"mlp\",\"nclasses\":2,\"layers\":[64,64]}}}";
+    check(_japi.service_create(_sname, jstr), 201);
+
+    std::mt19937 gen(42);
+    std::string data = "\"id";
+    for (int f = 0; f < nfeatures; ++f)
+      data += ",f" + std::to_string(f);
+    data += ",label\"";
+    for (int i = 0; i < 1000; ++i)
+      {
+        std::string line = sample(gen);
+        data += ",\"" + std::to_string(i) + "," + line + ","
+                + (line[0] >= '5' ? "1" : "0") + "\"";
+      }
+    std::string jtrainstr
+        = "{\"service\":\"" + _sname
+          + "\",\"async\":false,\"parameters\":{\"input\":{\"label\":"
+            "\"label\",\"id\":\"id\"},\"mllib\":{\"solver\":{\"iterations\":"
+            "50},\"net\":{\"batch_size\":100}}},\"data\":["
+          + data + "]}";
+    check(_japi.service_train(jtrainstr), 201);
+  }
+
+  ~BenchService()
+  {
+    _japi.service_delete(_sname, "{\"clear\":\"full\"}");
+    fileops::remove_dir(_repo);
+  }
+
+  /**
+   * \brief predict call on batch_size samples, omitting header and id
+   */
+  std::string predict_request(const int &batch_size)
+  {
+    std::mt19937 gen(batch_size);
+    std::string jstr
+        = "{\"service\":\"" + _sname
+          + "\",\"parameters\":{\"input\":{\"connector\":\"csv\"},"
+            "\"output\":{\"best\":1}},\"data\":[";
+    for (int i = 0; i < batch_size; ++i)
+      jstr += std::string(i > 0 ? "," : "") + "\"" + sample(gen) + "\"";
+    return jstr + "]}";
+  }
+
+  static std::string sample(std::mt19937 &gen)
+  {
+    std::uniform_int_distribution<int> dist(0, 9);
+    std::string line;
+    for (int f = 0; f < nfeatures; ++f)
+      line += std::string(f > 0 ? "," : "") + std::to_string(dist(gen));
+    return line;
+  }
+
+  static void check(const JDoc &jd, const int &code)
+  {
+    int status = jd.HasMember("status") ? jd["status"]["code"].GetInt() : 0;
+    if (status != code)
+      throw std::runtime_error("bench service call failed with status "
+                               + std::to_string(status));
+  }
+
+  JsonAPI _japi;
+  std::string _sname = "bench";
+  std::string _repo;
+};
+
+static BenchService &bench_service()
+{
+  static BenchService service;
+  return service;
+}
+
+// arg: batch size, reports throughput and latency percentiles in ms
+static void service_predict(benchmark::State &state)
+{
+  BenchService &service = bench_service();
+  std::string jstr = service.predict_request(state.range(0));
+  std::vector<double> latencies;
+  for (auto _ : state)
+    {
+      auto start = std::chrono::steady_clock::now();
+      JDoc jd = service._japi.service_predict(jstr);
+      latencies.push_back(std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - start)
+                              .count());
+      if (jd["status"]["code"].GetInt() != 200)
+        {
+          state.SkipWithError("predict failed");
+          break;
+        }
+    }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  if (latencies.empty())
+    return;
+  std::sort(latencies.begin(), latencies.end());
+  for (int p : { 50, 90, 99 })
+    state.counters["p" + std::to_string(p) + "_ms"] = benchmark::Counter(
+        latencies[(latencies.size() - 1) * p / 100],
+        benchmark::Counter::kAvgThreads);
+}
+BENCHMARK(service_predict)
+    ->Arg(1)
+    ->Arg(32)
+    ->ThreadRange(1, 8)
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,455 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * dede-bench: load generator for a running DeepDetect server, or for an
+ * in-process JsonAPI, replaying recorded calls or synthetic predict calls.
+ *
+ * Closed-loop load (default): each client sends its next call as soon as
+ * the previous one returns.
+ * Open-loop load (--qps): calls are scheduled at a fixed rate whatever the
+ * response times, and latencies are measured from the scheduled start, so
+ * that a stalled server is not hidden by clients waiting on it
+ * (coordinated omission).
+ */
+
+#include "jsonapi.h"
+#include "utils/latency_histogram.hpp"
+#include <curlpp/cURLpp.hpp>
+#include <curlpp/Easy.hpp>
+#include <curlpp/Options.hpp>
+#include <curlpp/Infos.hpp>
+#include <gflags/gflags.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <thread>
+
+using namespace dd;
+
+DEFINE_string(url, "http://localhost:8080", "URL of the server");
+DEFINE_bool(inprocess, false,
+            "run calls against an in-process JsonAPI instead of a server");
+DEFINE_string(replay, "",
+              "file of calls to replay, one per line: "
+              "service_create;sname;JSON, service_predict;JSON or "
+              "chain;cname;JSON. service_create calls are run once before "
+              "the load, other calls are sent in turn");
+DEFINE_string(synthetic_service, "",
+              "service for synthetic predict calls, instead of --replay");
+DEFINE_string(synthetic_data, "",
+              "data item of synthetic predict calls, e.g. an image URI");
+DEFINE_int32(synthetic_batch, 1,
+             "number of data items per synthetic predict call");
+DEFINE_string(synthetic_parameters, "{}",
+              "JSON parameters of synthetic predict calls");
+DEFINE_int32(concurrency, 1, "number of concurrent clients");
+DEFINE_double(qps, 0.0,
+              "target rate of open-loop load in calls per second, 0 for "
+              "closed-loop load");
+DEFINE_double(duration, 10.0, "load duration in seconds");
+DEFINE_double(warmup, 0.0,
+              "seconds at the start of the load without latency recording");
+DEFINE_uint64(max_calls, 0, "max number of calls, 0 for no limit");
+DEFINE_int32(call_timeout, 60, "HTTP call timeout in seconds");
+DEFINE_string(histogram_out, "",
+              "CSV file for the latency histogram, in microseconds");
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * \brief an API call to send
+ */
+struct BenchCall
+{
+  std::string method; /**< service_create, service_predict or chain */
+  std::string name;   /**< service or chain name */
+  std::string body;
+};
+
+/**
+ * \brief sends calls, returns the call status code, 0 on transport error
+ */
+class BenchClient
+{
+public:
+  virtual ~BenchClient()
+  {
+  }
+  virtual int send(const BenchCall &call) = 0;
+};
+
+class HttpBenchClient : public BenchClient
+{
+public:
+  HttpBenchClient()
+  {
+    _request.setOpt(curlpp::options::WriteFunction(
+        [this](char *data, size_t size, size_t nmemb) {
+          _response.append(data, size * nmemb);
+          return size * nmemb;
+        }));
+    _request.setOpt(curlpp::options::HttpHeader(
+        std::list<std::string>{ "Content-Type: application/json" }));
+    _request.setOpt(curlpp::options::Timeout(FLAGS_call_timeout));
+  }
+
+  int send(const BenchCall &call) override
+  {
+    // the handle is reused, and so is its connection to the server
+    std::string path;
+    std::string verb = "POST";
+    if (call.method == "service_create")
+      {
+        path = "/services/" + call.name;
+        verb = "PUT";
+      }
+    else if (call.method == "chain")
+      path = "/chain/" + call.name;
+    else
+      path = "/predict";
+    _response.clear();
+    try
+      {
+        _request.setOpt(curlpp::options::Url(FLAGS_url + path));
+        _request.setOpt(curlpp::options::CustomRequest(verb));
+        _request.setOpt(curlpp::options::PostFields(call.body));
+        _request.setOpt(curlpp::options::PostFieldSize(call.body.size()));
+        _request.perform();
+        return curlpp::infos::ResponseCode::get(_request);
+      }
+    catch (std::exception &)
+      {
+        return 0;
+      }
+  }
+
+private:
+  curlpp::Easy _request;
+  std::string _response;
+};
+
+class InProcessBenchClient : public BenchClient
+{
+public:
+  InProcessBenchClient(JsonAPI &japi) : _japi(japi)
+  {
+  }
+
+  int send(const BenchCall &call) override
+  {
+    JDoc jd;
+    if (call.method == "service_create")
+      jd = _japi.service_create(call.name, call.body);
+    else if (call.method == "chain")
+      jd = _japi.service_chain(call.name, call.body);
+    else
+      jd = _japi.service_predict(call.body);
+    if (!jd.HasMember("status"))
+      return 0;
+    return jd["status"]["code"].GetInt();
+  }
+
+private:
+  JsonAPI &_japi;
+};
+
+/**
+ * \brief per client results, merged at the end of the load
+ */
+struct BenchResults
+{
+  dd_utils::LatencyHistogram latency; /**< from scheduled start, in us */
+  dd_utils::LatencyHistogram service; /**< from actual start, in us */
+  std::map<int, uint64_t> errors;     /**< per status code */
+  Clock::time_point last_end;
+
+  void merge(const BenchResults &r)
+  {
+    latency.merge(r.latency);
+    service.merge(r.service);
+    for (auto &e : r.errors)
+      errors[e.first] += e.second;
+    last_end = std::max(last_end, r.last_end);
+  }
+};
+
+static bool read_replay(const std::string &fname,
+                        std::vector<BenchCall> &setup,
+                        std::vector<BenchCall> &calls)
+{
+  std::ifstream in(fname);
+  if (!in.is_open())
+    {
+      std::cerr << "cannot open " << fname << std::endl;
+      return false;
+    }
+  std::string line;
+  int nline = 0;
+  while (std::getline(in, line))
+    {
+      ++nline;
+      if (line.empty() || line[0] == '#')
+        continue;
+      // JSON bodies may contain ';', split on the first ones only
+      BenchCall call;
+      size_t p = line.find(';');
+      call.method = line.substr(0, p);
+      if (p != std::string::npos
+          && (call.method == "service_create" || call.method == "chain"))
+        {
+          size_t q = line.find(';', p + 1);
+          if (q != std::string::npos)
+            {
+              call.name = line.substr(p + 1, q - p - 1);
+              call.body = line.substr(q + 1);
+            }
+        }
+      else if (p != std::string::npos && call.method == "service_predict")
+        call.body = line.substr(p + 1);
+      if (call.body.empty())
+        {
+          std::cerr << fname << " line " << nline << ": unknown call format"
+                    << std::endl;
+          return false;
+        }
+      if (call.method == "service_create")
+        setup.push_back(call);
+      else
+        calls.push_back(call);
+    }
+  return true;
+}
+
+static std::string json_escape(const std::string &s)
+{
+  std::string out;
+  for (char c : s)
+    {
+      if (c == '"' || c == '\\')
+        {
+          out += '\\';
+          out += c;
+        }
+      else if (static_cast<unsigned char>(c) < 0x20)
+        {
+          char esc[8];
+          snprintf(esc, sizeof(esc), "\\u%04x", c);
+          out += esc;
+        }
+      else
+        out += c;
+    }
+  return out;
+}
+
+static BenchCall synthetic_call()
+{
+  BenchCall call;
+  call.method = "service_predict";
+  call.body = "{\"service\":\"" + json_escape(FLAGS_synthetic_service)
+              + "\",\"parameters\":" + FLAGS_synthetic_parameters
+              + ",\"data\":[";
+  for (int i = 0; i < FLAGS_synthetic_batch; ++i)
+    call.body += std::string(i > 0 ? "," : "") + "\""
+                 + json_escape(FLAGS_synthetic_data) + "\"";
+  call.body += "]}";
+  return call;
+}
+
+static void print_latencies(const std::string &name,
+                            const dd_utils::LatencyHistogram &h)
+{
+  auto ms = [](const double &us) { return us / 1000.0; };
+  printf("%-14s %9s %9s %9s %9s %9s %9s %9s\n", name.c_str(), "min", "mean",
+         "p50", "p90", "p99", "p99.9", "max");
+  printf("%-14s %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n", "  (ms)",
+         ms(h.min()), ms(h.mean()), ms(h.percentile(50)),
+         ms(h.percentile(90)), ms(h.percentile(99)), ms(h.percentile(99.9)),
+         ms(h.max()));
+}
+
+int main(int argc, char *argv[])
+{
+  gflags::SetUsageMessage(
+      "load generator for DeepDetect, e.g.\n"
+      "  dede-bench --synthetic_service=imgserv "
+      "--synthetic_data=/data/cat.jpg --concurrency=8 --duration=30\n"
+      "  dede-bench --replay=calls.txt --qps=200 --concurrency=64");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::vector<BenchCall> setup, calls;
+  if (!FLAGS_replay.empty())
+    {
+      if (!read_replay(FLAGS_replay, setup, calls))
+        return 1;
+    }
+  else if (!FLAGS_synthetic_service.empty()
+           && !FLAGS_synthetic_data.empty())
+    calls.push_back(synthetic_call());
+  if (calls.empty())
+    {
+      std::cerr << "no call to send, use --replay, or --synthetic_service "
+                   "and --synthetic_data"
+                << std::endl;
+      return 1;
+    }
+  if (FLAGS_concurrency < 1 || FLAGS_duration <= FLAGS_warmup)
+    {
+      std::cerr << "--concurrency must be positive, and --duration larger "
+                   "than --warmup"
+                << std::endl;
+      return 1;
+    }
+
+  std::unique_ptr<JsonAPI> japi;
+  if (FLAGS_inprocess)
+    japi.reset(new JsonAPI());
+  auto make_client = [&japi]() -> std::unique_ptr<BenchClient> {
+    if (japi)
+      return std::unique_ptr<BenchClient>(new InProcessBenchClient(*japi));
+    return std::unique_ptr<BenchClient>(new HttpBenchClient());
+  };
+
+  curlpp::Cleanup curl_cleanup;
+  {
+    auto client = make_client();
+    for (const BenchCall &call : setup)
+      {
+        int status = client->send(call);
+        if (status != 201)
+          {
+            // a server may already host the service
+            std::cerr << "service_create " << call.name << " returned "
+                      << status << (japi ? "" : ", continuing") << std::endl;
+            if (japi)
+              return 1;
+          }
+      }
+  }
+
+  const bool open_loop = FLAGS_qps > 0.0;
+  const auto start = Clock::now();
+  const auto record_start
+      = start
+        + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(FLAGS_warmup));
+  const auto end = start
+                   + std::chrono::duration_cast<Clock::duration>(
+                       std::chrono::duration<double>(FLAGS_duration));
+  std::atomic<uint64_t> next(0);
+  std::vector<BenchResults> results(FLAGS_concurrency);
+
+  auto work = [&](BenchResults &res) {
+    auto client = make_client();
+    while (true)
+      {
+        uint64_t i = next++;
+        if (FLAGS_max_calls > 0 && i >= FLAGS_max_calls)
+          return;
+        Clock::time_point scheduled = Clock::now();
+        if (open_loop)
+          {
+            scheduled = start
+                        + std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::duration<double>(i / FLAGS_qps));
+            if (scheduled >= end)
+              return;
+            std::this_thread::sleep_until(scheduled);
+          }
+        else if (scheduled >= end)
+          return;
+
+        auto sent = Clock::now();
+        int status = client->send(calls[i % calls.size()]);
+        auto done = Clock::now();
+        if (scheduled < record_start)
+          continue;
+        res.last_end = done;
+        if (status != 200)
+          {
+            ++res.errors[status];
+            continue;
+          }
+        auto us = [](const Clock::duration &d) {
+          return std::chrono::duration_cast<std::chrono::microseconds>(d)
+              .count();
+        };
+        res.latency.record(us(done - scheduled));
+        res.service.record(us(done - sent));
+      }
+  };
+
+  std::vector<std::thread> threads;
+  for (BenchResults &res : results)
+    threads.emplace_back(work, std::ref(res));
+  for (std::thread &t : threads)
+    t.join();
+
+  BenchResults total;
+  total.last_end = record_start;
+  for (const BenchResults &res : results)
+    total.merge(res);
+  uint64_t nerrors = 0;
+  for (auto &e : total.errors)
+    nerrors += e.second;
+  double elapsed
+      = std::chrono::duration<double>(total.last_end - record_start).count();
+
+  printf("load:          %s, %d clients",
+         open_loop ? "open-loop" : "closed-loop", FLAGS_concurrency);
+  if (open_loop)
+    printf(", target %.1f calls/s", FLAGS_qps);
+  printf("\ncalls:         %lu ok, %lu errors\n",
+         static_cast<unsigned long>(total.latency.count()),
+         static_cast<unsigned long>(nerrors));
+  for (auto &e : total.errors)
+    printf("  status %d:    %lu\n", e.first,
+           static_cast<unsigned long>(e.second));
+  printf("throughput:    %.1f calls/s\n",
+         elapsed > 0.0 ? total.latency.count() / elapsed : 0.0);
+  print_latencies("latency", total.latency);
+  if (open_loop)
+    print_latencies("service time", total.service);
+
+  if (!FLAGS_histogram_out.empty())
+    {
+      std::ofstream out(FLAGS_histogram_out);
+      out << "lower_us,upper_us,count,cumulative\n";
+      uint64_t cumul = 0;
+      total.latency.for_each_bucket(
+          [&](uint64_t lower, uint64_t upper, uint64_t count) {
+            cumul += count;
+            out << lower << "," << upper << "," << count << ","
+                << static_cast<double>(cumul) / total.latency.count() << "\n";
+          });
+      if (!out)
+        {
+          std::cerr << "cannot write " << FLAGS_histogram_out << std::endl;
+          return 1;
+        }
+    }
+  return nerrors > 0 ? 2 : 0;
+}
@@ -290,34 +290,48 @@ namespace dd
      */
     template <typename T> inline oatpp::Object<T> createSharedDTO() const
     {
-      rapidjson::Document d;
-      d.SetObject();
-      toJDoc(reinterpret_cast<JDoc &>(d));
-
-      rapidjson::StringBuffer buffer;
-      rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>,
-                        rapidjson::UTF8<>, rapidjson::CrtAllocator,
-                        rapidjson::kWriteNanAndInfFlag>
-          writer(buffer);
-      bool done = d.Accept(writer);
+      // per-thread document pool and output buffer, reused across calls
+      static thread_local char pool_buffer[1 << 16];
+      static thread_local rapidjson::MemoryPoolAllocator<> pool(
+          pool_buffer, sizeof(pool_buffer));
+      static thread_local rapidjson::StringBuffer buffer;
+      pool.Clear();
+      buffer.Clear();
+      bool done = false;
+      {
+        JDoc d(&pool);
+        d.SetObject();
+        toJDoc(d);
+
+        rapidjson::Writer<rapidjson::StringBuffer, rapidjson::UTF8<>,
+                          rapidjson::UTF8<>, rapidjson::CrtAllocator,
+                          rapidjson::kWriteNanAndInfFlag>
+            writer(buffer);
+        done = d.Accept(writer);
+      }
+      pool.Clear(); // keeps pool_buffer only
       if (!done)
         throw DataConversionException("JSON rendering failed");
 
-      std::shared_ptr<oatpp::data::mapping::ObjectMapper> object_mapper
-          = dd::oatpp_utils::createDDMapper();
-      return object_mapper->readFromString<oatpp::Object<T>>(
-          buffer.GetString());
+      oatpp::String json(buffer.GetString(), buffer.GetSize());
+      if (buffer.GetSize() > (1 << 20))
+        {
+          // do not hold on large buffers
+          buffer.Clear();
+          buffer.ShrinkToFit();
+        }
+      return dd::oatpp_utils::getDDMapper()
+          ->readFromString<oatpp::Object<T>>(json);
     }
 
+    /**
+     * \brief converts oat++ DTO to APIData, without JSON rendering
+     */
     template <typename T> static APIData fromDTO(const oatpp::Void &dto)
     {
-      std::shared_ptr<oatpp::data::mapping::ObjectMapper> object_mapper
-          = dd::oatpp_utils::createDDMapper();
-
-      oatpp::String json = object_mapper->writeToString(dto);
       APIData ad;
-      rapidjson::Document d;
-      d.Parse<rapidjson::kParseNanAndInfFlag>(json->c_str());
+      JDoc d;
+      dd::oatpp_utils::dtoToJDoc(dto, d, true);
       ad.fromRapidJson(d);
       return ad;
     }
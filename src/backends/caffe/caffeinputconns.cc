@@ -25,8 +25,12 @@
 
 #include "caffeinputconns.h"
 #include "utils/utils.hpp"
+#include "utils/ordered_parallel.hpp"
 #include <boost/multi_array.hpp>
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <random>
 #ifdef USE_HDF5
 #include <H5Cpp.h>
@@ -112,7 +116,9 @@ namespace dd
     // test whether the train / test dbs are already in
     // since they may be long to build, we pass on them if there already
     // in the model repository.
-    if (fileops::file_exists(dbfullname))
+    if (fileops::file_exists(dbfullname)
+        && !fileops::file_exists(dbfullname + ".progress")
+        && !fileops::file_exists(testdbfullname + ".progress"))
       {
         _logger->warn("image db file {} already exists, bypassing creation "
                       "but checking on records",
@@ -326,9 +332,17 @@ namespace dd
       throw InputConnectorBadParamException(
           "no image data found in repository");
 
-    // write files to dbs (i.e. train and possibly test)
-    write_image_to_db(dbfullname, lfiles, backend, encoded, encode_type);
-    if (!test_lfiles.empty())
+    // write files to dbs (i.e. train and possibly test), the mean image is
+    // computed along the way. Complete dbs are kept when resuming.
+    if (!fileops::file_exists(dbfullname)
+        || fileops::file_exists(dbfullname + ".progress"))
+      write_image_to_db(dbfullname, lfiles, backend, encoded, encode_type,
+                        this->_unchanged_data
+                            ? ""
+                            : _model_repo + "/" + _meanfname);
+    if (!test_lfiles.empty()
+        && (!fileops::file_exists(testdbfullname)
+            || fileops::file_exists(testdbfullname + ".progress")))
       write_image_to_db(testdbfullname, test_lfiles, backend, encoded,
                         encode_type);
 
@@ -394,16 +408,146 @@ namespace dd
                                    encoded, encode_type);
   }
 
+  size_t ImgCaffeInputFileConn::images_list_hash(
+      const std::vector<std::pair<std::string, int>> &lfiles)
+  {
+    size_t list_hash = 0;
+    for (const std::pair<std::string, int> &lf : lfiles)
+      list_hash = list_hash * 31 + std::hash<std::string>()(lf.first)
+                  + std::hash<int>()(lf.second);
+    return list_hash;
+  }
+
+  size_t ImgCaffeInputFileConn::read_db_progress(
+      const std::string &dbfullname, const size_t &list_hash)
+  {
+    std::string progressfile = dbfullname + ".progress";
+    if (!fileops::file_exists(progressfile))
+      return 0;
+    std::ifstream in(progressfile);
+    size_t hash = 0;
+    size_t next_line = 0;
+    if (!(in >> hash >> next_line) || hash != list_hash
+        || !fileops::file_exists(dbfullname))
+      {
+        _logger->warn("db {} was interrupted with a different list of "
+                      "images, rebuilding it (set a seed to allow resuming "
+                      "shuffled datasets)",
+                      dbfullname);
+        fileops::clear_directory(dbfullname);
+        rmdir(dbfullname.c_str());
+        return 0;
+      }
+    _logger->info("resuming creation of db {} from image {}", dbfullname,
+                  next_line);
+    return next_line;
+  }
+
+  void ImgCaffeInputFileConn::write_db_progress(const std::string &dbfullname,
+                                                const size_t &list_hash,
+                                                const size_t &next_line)
+  {
+    std::string progressfile = dbfullname + ".progress";
+    std::ofstream out(progressfile + ".tmp");
+    out << list_hash << " " << next_line << std::endl;
+    out.close();
+    std::rename((progressfile + ".tmp").c_str(), progressfile.c_str());
+  }
+
+  void ImgCaffeInputFileConn::set_images_mean(BlobProto &sum_blob,
+                                              const int &count,
+                                              const std::string &meanfile)
+  {
+    for (int i = 0; i < sum_blob.data_size(); ++i)
+      {
+        sum_blob.set_data(i, sum_blob.data(i) / count);
+      }
+    // Write to disk
+    _logger->info("Write to {}", meanfile);
+    WriteProtoToBinaryFile(sum_blob, meanfile.c_str());
+
+    // let's store the simpler mean values in case of image
+    // size changes, e.g. cropping
+    const int channels = sum_blob.channels();
+    const int dim = sum_blob.height() * sum_blob.width();
+    _mean_values = std::vector<float>(channels, 0.0);
+    _logger->info("Number of channels: {}", channels);
+    for (int c = 0; c < channels; ++c)
+      {
+        for (int i = 0; i < dim; ++i)
+          {
+            _mean_values[c] += sum_blob.data(dim * c + i);
+          }
+        _logger->info("mean value channel [{}]:{}", c, _mean_values[c] / dim);
+        _mean_values[c] /= dim;
+      }
+  }
+
+  bool ImgCaffeInputFileConn::read_image_to_datum(const std::string &fname,
+                                                 const int &label,
+                                                 const std::string &enc,
+                                                 Datum &datum, cv::Mat &img)
+  {
+    img = cv::imread(fname, _unchanged_data ? CV_LOAD_IMAGE_UNCHANGED
+                                            : (_bw ? CV_LOAD_IMAGE_GRAYSCALE
+                                                   : CV_LOAD_IMAGE_COLOR));
+    if (img.empty())
+      {
+        _logger->error("Could not open or find file {}", fname);
+        return false;
+      }
+    bool resized = _height > 0 && _width > 0;
+    if (resized)
+      {
+        cv::Mat rimg;
+        cv::resize(img, rimg, cv::Size(_width, _height));
+        img = rimg;
+      }
+    if (enc.empty())
+      {
+        CVMatToDatum(img, &datum);
+        datum.set_label(label);
+        return true;
+      }
+
+    std::string ext = enc[0] == '.' ? enc : "." + enc;
+    if (!resized && ext == guess_encoding(fname))
+      {
+        // file is stored as is, like ReadImageToDatum does
+        return ReadFileToDatum(fname, label, &datum);
+      }
+    std::vector<uchar> buf;
+    cv::imencode(ext, img, buf);
+    datum.set_data(std::string(reinterpret_cast<char *>(buf.data()),
+                               buf.size()));
+    datum.set_label(label);
+    datum.set_encoded(true);
+    return true;
+  }
+
   void ImgCaffeInputFileConn::write_image_to_db(
       const std::string &dbfullname,
       const std::vector<std::pair<std::string, int>> &lfiles,
       const std::string &backend, const bool &encoded,
-      const std::string &encode_type)
+      const std::string &encode_type, const std::string &meanfile)
   {
-    // Create new DB
+    // resume an interrupted db creation with the same list of images
+    size_t list_hash = images_list_hash(lfiles);
+    size_t start_line = read_db_progress(dbfullname, list_hash);
+
     std::unique_ptr<db::DB> db(db::GetDB(backend));
-    db->Open(dbfullname.c_str(), db::NEW);
+    db->Open(dbfullname.c_str(), start_line > 0 ? db::WRITE : db::NEW);
     std::unique_ptr<db::Transaction> txn(db->NewTransaction());
+    write_db_progress(dbfullname, list_hash, start_line);
+
+    // per worker sums of decoded images, for the mean image, only when all
+    // images are processed in this pass
+    int nworkers = dd_utils::num_workers(_db_workers);
+    bool compute_mean = !meanfile.empty() && start_line == 0;
+    std::vector<std::vector<double>> mean_sums(nworkers);
+    std::vector<std::array<int, 3>> mean_shapes(
+        nworkers, std::array<int, 3>{ { 0, 0, 0 } });
+    std::atomic<bool> mean_valid(true);
 
     // Storing to db
     int count = 0;
@@ -411,62 +555,139 @@ namespace dd
     char key_cstr[kMaxKeyLength];
     bool key_overflow = false;
 
-    for (int line_id = 0; line_id < (int)lfiles.size(); ++line_id)
-      {
-        Datum datum;
-        bool status;
-        std::string enc = encode_type;
-        if (encoded && !enc.size())
-          {
-            enc = guess_encoding(lfiles[line_id].first);
-          }
-        else if (!encoded)
-          enc = "";
-
-        try
-          {
-            status = ReadImageToDatum(
-                lfiles[line_id].first, lfiles[line_id].second, _height, _width,
-                !_bw, enc, &datum, this->_unchanged_data);
-          }
-        catch (...)
-          {
-            throw InputConnectorBadParamException("Failed reading input image "
-                                                  + lfiles[line_id].first);
-          }
-        if (status == false)
-          continue;
-
-        // sequential
-        int length = snprintf(key_cstr, kMaxKeyLength, "%08d_%s", line_id,
-                              lfiles[line_id].first.c_str());
-        if (lfiles[line_id].first.size() > kMaxKeyLength)
-          key_overflow = true;
-
-        // put in db
-        std::string out;
-        if (!datum.SerializeToString(&out))
-          _logger->error("Failed serialization of datum for db storage");
-        txn->Put(string(key_cstr, length), out);
+    // images are read, resized and encoded by workers, and written in order
+    dd_utils::ordered_parallel_for<std::string>(
+        start_line, lfiles.size(),
+        [&](size_t line_id, int worker, std::string &out) {
+          Datum datum;
+          bool status;
+          std::string enc = encode_type;
+          if (encoded && !enc.size())
+            {
+              enc = guess_encoding(lfiles[line_id].first);
+            }
+          else if (!encoded)
+            enc = "";
+
+          // the mean image is accumulated from the decoded image, so that
+          // each image is decoded only once
+          bool with_mean = compute_mean && mean_valid;
+          cv::Mat img;
+          try
+            {
+              if (with_mean)
+                status = read_image_to_datum(lfiles[line_id].first,
+                                             lfiles[line_id].second, enc,
+                                             datum, img);
+              else
+                status = ReadImageToDatum(lfiles[line_id].first,
+                                          lfiles[line_id].second, _height,
+                                          _width, !_bw, enc, &datum,
+                                          this->_unchanged_data);
+            }
+          catch (...)
+            {
+              throw InputConnectorBadParamException(
+                  "Failed reading input image " + lfiles[line_id].first);
+            }
+          if (status == false)
+            return false;
+
+          if (with_mean)
+            {
+              std::array<int, 3> shape{ { img.channels(), img.rows,
+                                          img.cols } };
+              std::vector<double> &sum = mean_sums[worker];
+              if (sum.empty())
+                {
+                  sum.resize(shape[0] * shape[1] * shape[2], 0.0);
+                  mean_shapes[worker] = shape;
+                }
+              if (shape != mean_shapes[worker] || img.depth() != CV_8U)
+                mean_valid = false; // images of various sizes or types
+              else
+                {
+                  // same channel major layout as the datum
+                  const int channels = shape[0];
+                  const int dim = shape[1] * shape[2];
+                  for (int h = 0; h < img.rows; ++h)
+                    {
+                      const uchar *ptr = img.ptr<uchar>(h);
+                      for (int w = 0; w < img.cols; ++w)
+                        for (int c = 0; c < channels; ++c)
+                          sum[c * dim + h * img.cols + w]
+                              += ptr[w * channels + c];
+                    }
+                }
+            }
+
+          if (!datum.SerializeToString(&out))
+            _logger->error("Failed serialization of datum for db storage");
+          return true;
+        },
+        [&](size_t line_id, std::string &out) {
+          // sequential
+          int length = snprintf(key_cstr, kMaxKeyLength, "%08d_%s",
+                                static_cast<int>(line_id),
+                                lfiles[line_id].first.c_str());
+          if (lfiles[line_id].first.size() > kMaxKeyLength)
+            key_overflow = true;
+
+          // put in db
+          txn->Put(string(key_cstr, length), out);
+
+          if (++count % 1000 == 0)
+            {
+              // commit db
+              txn->Commit();
+              txn.reset(db->NewTransaction());
+              write_db_progress(dbfullname, list_hash, line_id + 1);
+              _logger->info("Processed {} files", count);
+            }
+        },
+        _db_workers);
 
-        if (++count % 1000 == 0)
-          {
-            // commit db
-            txn->Commit();
-            txn.reset(db->NewTransaction());
-            _logger->info("Processed {} files", count);
-          }
-      }
     // write the last batch
     if (count % 1000 != 0)
       {
         txn->Commit();
         _logger->info("Processed {} files", count);
       }
+    std::remove((dbfullname + ".progress").c_str());
     if (key_overflow)
       _logger->warn("Some of the keys in {} have been truncated to fit the "
                     "256 max key length requirement",
                     dbfullname);
+
+    // reduce workers sums into the mean image
+    if (compute_mean && mean_valid && count > 0)
+      {
+        std::array<int, 3> shape{ { 0, 0, 0 } };
+        std::vector<double> sum;
+        for (int w = 0; w < nworkers; ++w)
+          {
+            if (mean_sums[w].empty())
+              continue;
+            if (sum.empty())
+              {
+                sum = mean_sums[w];
+                shape = mean_shapes[w];
+              }
+            else if (mean_shapes[w] != shape)
+              return; // images of various sizes
+            else
+              for (size_t i = 0; i < sum.size(); ++i)
+                sum[i] += mean_sums[w][i];
+          }
+        BlobProto sum_blob;
+        sum_blob.set_num(1);
+        sum_blob.set_channels(shape[0]);
+        sum_blob.set_height(shape[1]);
+        sum_blob.set_width(shape[2]);
+        for (double v : sum)
+          sum_blob.add_data(v);
+        set_images_mean(sum_blob, count, meanfile);
+      }
   }
 
   void ImgCaffeInputFileConn::write_image_to_db_multilabel(
@@ -475,10 +696,16 @@ namespace dd
       const std::string &backend, const bool &encoded,
       const std::string &encode_type)
   {
-    // Create new DB
+    // resume an interrupted db creation with the same list of images
+    size_t list_hash = 0;
+    for (const std::pair<std::string, std::vector<float>> &lf : lfiles)
+      list_hash = list_hash * 31 + std::hash<std::string>()(lf.first);
+    size_t start_line = read_db_progress(dbfullname, list_hash);
+
     std::unique_ptr<db::DB> db(db::GetDB(backend));
-    db->Open(dbfullname.c_str(), db::NEW);
+    db->Open(dbfullname.c_str(), start_line > 0 ? db::WRITE : db::NEW);
     std::unique_ptr<db::Transaction> txn(db->NewTransaction());
+    write_db_progress(dbfullname, list_hash, start_line);
 
     // Storing to db
     int count = 0;
@@ -486,59 +713,67 @@ namespace dd
     char key_cstr[kMaxKeyLength];
     bool key_overflow = false;
 
-    for (int line_id = 0; line_id < (int)lfiles.size(); ++line_id)
-      {
-        Datum datum;
-        bool status;
-        std::string enc = encode_type;
-        if (encoded && !enc.size())
-          {
-            enc = guess_encoding(lfiles[line_id].first);
-          }
-        status = ReadImageToDatum(
-            lfiles[line_id].first, lfiles[line_id].second[0], _height, _width,
-            !_bw, // XXX: passing first label, fixing labels below
-            enc, &datum);
-        if (status == false)
-          {
-            _logger->error("failed reading image {}", lfiles[line_id].first);
-            continue;
-          }
-
-        // store multi labels into float_data in the datum (encoded image
-        // should be into data as bytes)
-        std::vector<float> labels = lfiles[line_id].second;
-        for (auto l : labels)
-          {
-            datum.add_float_data(l);
-          }
-
-        // sequential
-        int length = snprintf(key_cstr, kMaxKeyLength, "%08d_%s", line_id,
-                              lfiles[line_id].first.c_str());
-        if (lfiles[line_id].first.size() > kMaxKeyLength)
-          key_overflow = true;
-
-        // put in db
-        std::string out;
-        if (!datum.SerializeToString(&out))
-          _logger->error("Failed serialization of datum for db storage");
-        txn->Put(string(key_cstr, length), out);
+    dd_utils::ordered_parallel_for<std::string>(
+        start_line, lfiles.size(),
+        [&](size_t line_id, int, std::string &out) {
+          Datum datum;
+          bool status;
+          std::string enc = encode_type;
+          if (encoded && !enc.size())
+            {
+              enc = guess_encoding(lfiles[line_id].first);
+            }
+          status = ReadImageToDatum(
+              lfiles[line_id].first, lfiles[line_id].second[0], _height,
+              _width,
+              !_bw, // XXX: passing first label, fixing labels below
+              enc, &datum);
+          if (status == false)
+            {
+              _logger->error("failed reading image {}", lfiles[line_id].first);
+              return false;
+            }
+
+          // store multi labels into float_data in the datum (encoded image
+          // should be into data as bytes)
+          for (auto l : lfiles[line_id].second)
+            {
+              datum.add_float_data(l);
+            }
+
+          if (!datum.SerializeToString(&out))
+            _logger->error("Failed serialization of datum for db storage");
+          return true;
+        },
+        [&](size_t line_id, std::string &out) {
+          // sequential
+          int length = snprintf(key_cstr, kMaxKeyLength, "%08d_%s",
+                                static_cast<int>(line_id),
+                                lfiles[line_id].first.c_str());
+          if (lfiles[line_id].first.size() > kMaxKeyLength)
+            key_overflow = true;
+
+          // put in db
+          txn->Put(string(key_cstr, length), out);
+
+          if (++count % 1000 == 0)
+            {
+              // commit db
+              txn->Commit();
+              txn.reset(db->NewTransaction());
+              write_db_progress(dbfullname, list_hash, line_id + 1);
+              _logger->info("Processed {} files", count);
+            }
+        },
+        _db_workers);
 
-        if (++count % 1000 == 0)
-          {
-            // commit db
-            txn->Commit();
-            txn.reset(db->NewTransaction());
-            _logger->info("Processed {} files", count);
-          }
-      }
     // write the last batch
     if (count % 1000 != 0)
       {
         txn->Commit();
         _logger->info("Processed {} files", count);
       }
+    std::remove((dbfullname + ".progress").c_str());
     if (key_overflow)
       _logger->warn("Some of the keys in {} have been truncated to fit the "
                     "256 max key length requirement",
@@ -969,106 +1204,110 @@ namespace dd
     int count = 0;
     int data_size = 0;
     bool data_size_initialized = false;
+    std::mutex data_size_mutex;
     int min_dim = 0;
     int max_dim = 0;
     std::string label_type = "txt";
-    bool status = true;
     bool check_size = false; // check whether all datum have the same size
-    std::vector<float> meanv;
 
-    std::map<std::string, int> name_to_label;
     std::string enc = encode_type;
-
-    for (size_t line_id = 0; line_id < lines.size(); ++line_id)
-      {
-        AnnotatedDatum anno_datum;
-        Datum *datum = anno_datum.mutable_datum();
-        if (encoded && !enc.size())
-          {
-            // Guess the encoding type from the file name
-            string fn = lines[line_id].first;
-            size_t p = fn.rfind('.');
-            if (p == fn.npos)
-              _logger->warn("failed to guess the encoding of '{}", fn);
-            enc = fn.substr(p);
-            std::transform(enc.begin(), enc.end(), enc.begin(), ::tolower);
-            _logger->info("using encoding {}", enc);
-          }
-        std::string filename = lines[line_id].first;
-        std::string labelname = lines[line_id].second;
-        int width = db_width; // do not resize images is default
-        int height = db_height;
-        status = ReadRichImageToAnnotatedDatum(
-            filename, labelname, height, width, min_dim, max_dim, !_bw, enc,
-            type, label_type, name_to_label, &anno_datum);
-        anno_datum.set_type(AnnotatedDatum_AnnotationType_BBOX);
-        if (status == false)
-          {
-            _logger->error("failed to read {} or {}", lines[line_id].first,
-                           lines[line_id].second);
-            throw InputConnectorBadParamException(
-                "failed to read " + lines[line_id].first + " or "
-                + lines[line_id].second + " at line "
-                + std::to_string(line_id));
-          }
-        if (check_size)
-          {
-            if (!data_size_initialized)
-              {
-                data_size
-                    = datum->channels() * datum->height() * datum->width();
-                data_size_initialized = true;
-              }
-            else
-              {
-                const std::string &data = datum->data();
-                if (static_cast<int>(data.size()) != data_size)
-                  {
-                    _logger->error("incorrect data field size {}",
-                                   data.size());
-                    throw InputConnectorBadParamException(
-                        "incorrect data field size "
-                        + std::to_string(data.size()));
-                  }
-              }
-          }
-
-        // compute the mean
-        if (train)
-          {
-            if (_mean_values.empty())
-              _mean_values = std::vector<float>(datum->channels(), 0.0);
-            std::vector<float> lmeanv(datum->channels(), 0.0);
-            std::vector<cv::Mat> channels;
-            cv::Mat img = cv::imread(lines[line_id].first);
-            cv::split(img, channels);
-            for (int d = 0; d < datum->channels(); d++)
-              {
-                lmeanv[d] = cv::mean(channels[d])[0];
-                _mean_values[d] += lmeanv[d];
-              }
-          }
-
-        // sequential
-        string key_str
-            = caffe::format_int(line_id, 8) + "_" + lines[line_id].first;
-
-        // Put in db
-        string out;
-        CHECK(anno_datum.SerializeToString(&out));
-        if (!anno_datum.SerializeToString(&out))
-          _logger->error(
-              "Failed serialization of annotated datum for db storage");
-        txn->Put(key_str, out);
-
-        if (++count % 1000 == 0)
-          {
-            // Commit db
-            txn->Commit();
-            txn.reset(db->NewTransaction());
-            LOG(INFO) << "Processed " << count << " files.";
-          }
-      }
+    if (encoded && !enc.size() && !lines.empty())
+      {
+        // Guess the encoding type from the file name
+        string fn = lines[0].first;
+        size_t p = fn.rfind('.');
+        if (p == fn.npos)
+          _logger->warn("failed to guess the encoding of '{}", fn);
+        enc = fn.substr(p);
+        std::transform(enc.begin(), enc.end(), enc.begin(), ::tolower);
+        _logger->info("using encoding {}", enc);
+      }
+
+    // per worker sums of images mean values
+    int nworkers = dd_utils::num_workers(_db_workers);
+    std::vector<std::vector<float>> mean_sums(nworkers);
+
+    // images are read, resized and encoded by workers, and written in order
+    dd_utils::ordered_parallel_for<std::string>(
+        0, lines.size(),
+        [&](size_t line_id, int worker, std::string &out) {
+          AnnotatedDatum anno_datum;
+          Datum *datum = anno_datum.mutable_datum();
+          std::map<std::string, int> name_to_label;
+          std::string filename = lines[line_id].first;
+          std::string labelname = lines[line_id].second;
+          int width = db_width; // do not resize images is default
+          int height = db_height;
+          bool status = ReadRichImageToAnnotatedDatum(
+              filename, labelname, height, width, min_dim, max_dim, !_bw, enc,
+              type, label_type, name_to_label, &anno_datum);
+          anno_datum.set_type(AnnotatedDatum_AnnotationType_BBOX);
+          if (status == false)
+            {
+              _logger->error("failed to read {} or {}", lines[line_id].first,
+                             lines[line_id].second);
+              throw InputConnectorBadParamException(
+                  "failed to read " + lines[line_id].first + " or "
+                  + lines[line_id].second + " at line "
+                  + std::to_string(line_id));
+            }
+          if (check_size)
+            {
+              std::lock_guard<std::mutex> lock(data_size_mutex);
+              if (!data_size_initialized)
+                {
+                  data_size
+                      = datum->channels() * datum->height() * datum->width();
+                  data_size_initialized = true;
+                }
+              else
+                {
+                  const std::string &data = datum->data();
+                  if (static_cast<int>(data.size()) != data_size)
+                    {
+                      _logger->error("incorrect data field size {}",
+                                     data.size());
+                      throw InputConnectorBadParamException(
+                          "incorrect data field size "
+                          + std::to_string(data.size()));
+                    }
+                }
+            }
+
+          // compute the mean
+          if (train)
+            {
+              std::vector<float> &sum = mean_sums[worker];
+              if (sum.empty())
+                sum = std::vector<float>(datum->channels(), 0.0);
+              std::vector<cv::Mat> channels;
+              cv::Mat img = cv::imread(lines[line_id].first);
+              cv::split(img, channels);
+              for (int d = 0; d < datum->channels(); d++)
+                sum[d] += cv::mean(channels[d])[0];
+            }
+
+          // Put in db
+          if (!anno_datum.SerializeToString(&out))
+            _logger->error(
+                "Failed serialization of annotated datum for db storage");
+          return true;
+        },
+        [&](size_t line_id, std::string &out) {
+          // sequential
+          string key_str = caffe::format_int(line_id, 8) + "_"
+                           + lines[line_id].first;
+          txn->Put(key_str, out);
+
+          if (++count % 1000 == 0)
+            {
+              // Commit db
+              txn->Commit();
+              txn.reset(db->NewTransaction());
+              LOG(INFO) << "Processed " << count << " files.";
+            }
+        },
+        _db_workers);
 
     // write the last batch
     if (count % 1000 != 0)
@@ -1080,6 +1319,15 @@ namespace dd
     // average the mean
     if (train)
       {
+        for (const std::vector<float> &sum : mean_sums)
+          {
+            if (sum.empty())
+              continue;
+            if (_mean_values.empty())
+              _mean_values = std::vector<float>(sum.size(), 0.0);
+            for (size_t d = 0; d < sum.size() && d < _mean_values.size(); d++)
+              _mean_values[d] += sum[d];
+          }
         std::ofstream fout_mean(
             _model_repo
             + "/mean_values.txt"); // since images are of various sizes
@@ -1183,29 +1431,7 @@ namespace dd
       {
         _logger->info("Processed {} files", count);
       }
-    for (int i = 0; i < sum_blob.data_size(); ++i)
-      {
-        sum_blob.set_data(i, sum_blob.data(i) / count);
-      }
-    // Write to disk
-    _logger->info("Write to {}", meanfile);
-    WriteProtoToBinaryFile(sum_blob, meanfile.c_str());
-
-    // let's store the simpler mean values in case of image
-    // size changes, e.g. cropping
-    const int channels = sum_blob.channels();
-    const int dim = sum_blob.height() * sum_blob.width();
-    _mean_values = std::vector<float>(channels, 0.0);
-    _logger->info("Number of channels: {}", channels);
-    for (int c = 0; c < channels; ++c)
-      {
-        for (int i = 0; i < dim; ++i)
-          {
-            _mean_values[c] += sum_blob.data(dim * c + i);
-          }
-        _logger->info("mean value channel [{}]:{}", c, _mean_values[c] / dim);
-        _mean_values[c] /= dim;
-      }
+    set_images_mean(sum_blob, count, meanfile);
     return 0;
   }
 
@@ -1350,6 +1576,65 @@ namespace dd
     _test_db_cursor = std::unique_ptr<caffe::db::Cursor>();
     _test_db = std::unique_ptr<caffe::db::DB>();
     _dt_seg = 0;
+    _blob_pos = 0;
+  }
+
+  int ImgCaffeInputFileConn::get_blob_test(
+      const int &num, std::vector<float> &data, const float &scale,
+      const std::vector<float> &mean_values)
+  {
+    int n = std::min(static_cast<size_t>(num),
+                     _blob_images.size() - _blob_pos);
+    if (n <= 0)
+      return 0;
+    const int channels = this->channels();
+    const int height = this->height();
+    const int width = this->width();
+    const int size = channels * height * width;
+    data.resize(n * size);
+
+    // per channel mean, from connector and from input layer transform
+    const float *mean_img
+        = _data_mean.count() != 0 ? _data_mean.cpu_data() : nullptr;
+    if (mean_img && _data_mean.count() != size)
+      throw InputConnectorBadParamException(
+          "mean file size does not match input size");
+    std::vector<float> mean(channels, 0.0);
+    for (int c = 0; c < channels; ++c)
+      {
+        if (!mean_img && _has_mean_scalar)
+          mean[c] = _mean[c];
+        if (!mean_values.empty())
+          mean[c] += mean_values.size() == 1 ? mean_values[0]
+                                              : mean_values.at(c);
+      }
+
+    for (int i = 0; i < n; ++i)
+      {
+        const cv::Mat &img = _blob_images.at(_blob_pos + i);
+        if (img.depth() != CV_8U || img.channels() != channels
+            || img.rows != height || img.cols != width)
+          throw InputConnectorBadParamException(
+              "image " + this->_ids.at(_blob_pos + i)
+              + " does not match net input size");
+        // HWC bytes to CHW floats
+        float *dst = data.data() + static_cast<size_t>(i) * size;
+        for (int h = 0; h < height; ++h)
+          {
+            const uint8_t *row = img.ptr<uint8_t>(h);
+            for (int w = 0; w < width; ++w)
+              for (int c = 0; c < channels; ++c)
+                {
+                  int index = (c * height + h) * width + w;
+                  float v = static_cast<float>(row[w * channels + c]);
+                  if (mean_img)
+                    v -= mean_img[index];
+                  dst[index] = (v - mean[c]) * scale;
+                }
+          }
+      }
+    _blob_pos += n;
+    return n;
   }
 
   /*- DDCCsv -*/
@@ -1611,6 +1896,45 @@ namespace dd
     _dt_vit = _dv_test.begin();
     _test_db_cursor = std::unique_ptr<caffe::db::Cursor>();
     _test_db = std::unique_ptr<caffe::db::DB>();
+    _blob_pos = 0;
+  }
+
+  int CSVCaffeInputFileConn::get_blob_test(
+      const int &num, std::vector<float> &data, const float &scale,
+      const std::vector<float> &mean_values)
+  {
+    int n = std::min(static_cast<size_t>(num), _blob_rows.size() - _blob_pos);
+    if (n <= 0)
+      return 0;
+    data.clear();
+    size_t size = 0;
+    for (int i = 0; i < n; ++i)
+      {
+        // same columns as to_datum, labels and id excluded
+        const std::vector<double> &vf = _blob_rows.at(_blob_pos + i)._v;
+        int c = 0;
+        for (int j = 0; j < (int)vf.size(); ++j)
+          {
+            if (j == _id_pos
+                || std::find(_label_pos.begin(), _label_pos.end(), j)
+                       != _label_pos.end())
+              continue;
+            float mean = 0.0;
+            if (!mean_values.empty())
+              mean = mean_values.size() == 1 ? mean_values[0]
+                                             : mean_values.at(c);
+            data.push_back((static_cast<float>(vf[j]) - mean) * scale);
+            ++c;
+          }
+        if (i == 0)
+          size = data.size();
+        else if (data.size() != (i + 1) * size)
+          throw InputConnectorBadParamException(
+              "inconsistent number of columns in row "
+              + _blob_rows.at(_blob_pos + i)._str);
+      }
+    _blob_pos += n;
+    return n;
   }
 
   /*- TxtCaffeInputFileConn -*/
@@ -57,7 +57,8 @@ namespace dd
           _autoencoder(cii._autoencoder), _alphabet_size(cii._alphabet_size),
           _root_folder(cii._root_folder), _dbfullname(cii._dbfullname),
           _test_dbfullname(cii._test_dbfullname), _timesteps(cii._timesteps),
-          _datadim(cii._datadim), _ntargets(cii._ntargets)
+          _datadim(cii._datadim), _ntargets(cii._ntargets),
+          _direct_blob(cii._direct_blob)
     {
     }
 
@@ -90,6 +91,36 @@ namespace dd
     {
     }
 
+    /**
+     * \brief whether predict inputs can be written straight to the net input
+     * blob, without going through Datum
+     */
+    bool direct_blob_support() const
+    {
+      return false;
+    }
+
+    /**
+     * \brief writes the next batch of predict inputs to a float buffer laid
+     * out as the net input blob, with mean subtraction and scaling done in
+     * the same pass, as the Caffe data transformer would
+     * @param num max number of samples in the batch
+     * @param data output buffer, resized to the batch
+     * @param scale input layer transform scale
+     * @param mean_values input layer transform mean values, if any
+     * @return number of samples written, 0 once all samples are consumed
+     */
+    int get_blob_test(const int &num, std::vector<float> &data,
+                      const float &scale,
+                      const std::vector<float> &mean_values)
+    {
+      (void)num;
+      (void)data;
+      (void)scale;
+      (void)mean_values;
+      return 0;
+    }
+
     // write class weights to binary proto
     void write_class_weights(const std::string &model_repo,
                              const APIData &ad_mllib);
@@ -124,6 +155,9 @@ namespace dd
     int _timesteps = -1; // default length for csv timeseries
     int _datadim = -1;   // default size of vector data for timeseries
     int _ntargets = -1;  // number of outputs for timeseries
+    bool _direct_blob
+        = false; /**< whether predict inputs go straight to the input blob. */
+    size_t _blob_pos = 0; /**< next predict input for the input blob. */
   };
 
   /**
@@ -181,6 +215,8 @@ namespace dd
         return _db_testbatchsize;
       else if (!_dv_test.empty())
         return _dv_test.size();
+      else if (_direct_blob)
+        return _blob_images.size();
       else
         return ImgInputFileConn::test_batch_size();
     }
@@ -249,50 +285,65 @@ namespace dd
             {
               _test_dbfullname = _db_fname;
               _db = true;
+              _direct_blob = false;
               return; // done
             }
           else
             _db = false;
-          for (int i = 0; i < (int)this->_images.size(); i++)
+          if (_direct_blob)
             {
-              caffe::Datum datum;
-              caffe::CVMatToDatum(this->_images.at(i), &datum);
-              if (!_test_labels.empty())
-                datum.set_label(_test_labels.at(i));
-              if (_data_mean.count() != 0)
-                {
-                  int height = datum.height();
-                  int width = datum.width();
-                  for (int c = 0; c < datum.channels(); ++c)
-                    for (int h = 0; h < height; ++h)
-                      for (int w = 0; w < width; ++w)
-                        {
-                          int data_index = (c * height + h) * width + w;
-                          float datum_element = static_cast<float>(
-                              static_cast<uint8_t>(datum.data()[data_index]));
-                          datum.add_float_data(datum_element
-                                               - mean[data_index]);
-                        }
-                  datum.clear_data();
-                }
-              else if (_has_mean_scalar)
+              // images are written to the input blob batch by batch
+              _blob_images = this->_images;
+              for (int i = 0; i < (int)this->_images.size(); i++)
+                _imgs_size.insert(std::pair<std::string, std::pair<int, int>>(
+                    this->_ids.at(i), this->_images_size.at(i)));
+            }
+          else
+            {
+              for (int i = 0; i < (int)this->_images.size(); i++)
                 {
-                  int height = datum.height();
-                  int width = datum.width();
-                  for (int c = 0; c < datum.channels(); ++c)
-                    for (int h = 0; h < height; ++h)
-                      for (int w = 0; w < width; ++w)
-                        {
-                          int data_index = (c * height + h) * width + w;
-                          float datum_element = static_cast<float>(
-                              static_cast<uint8_t>(datum.data()[data_index]));
-                          datum.add_float_data(datum_element - _mean[c]);
-                        }
-                  datum.clear_data();
+                  caffe::Datum datum;
+                  caffe::CVMatToDatum(this->_images.at(i), &datum);
+                  if (!_test_labels.empty())
+                    datum.set_label(_test_labels.at(i));
+                  if (_data_mean.count() != 0)
+                    {
+                      int height = datum.height();
+                      int width = datum.width();
+                      for (int c = 0; c < datum.channels(); ++c)
+                        for (int h = 0; h < height; ++h)
+                          for (int w = 0; w < width; ++w)
+                            {
+                              int data_index = (c * height + h) * width + w;
+                              float datum_element
+                                  = static_cast<float>(static_cast<uint8_t>(
+                                      datum.data()[data_index]));
+                              datum.add_float_data(datum_element
+                                                   - mean[data_index]);
+                            }
+                      datum.clear_data();
+                    }
+                  else if (_has_mean_scalar)
+                    {
+                      int height = datum.height();
+                      int width = datum.width();
+                      for (int c = 0; c < datum.channels(); ++c)
+                        for (int h = 0; h < height; ++h)
+                          for (int w = 0; w < width; ++w)
+                            {
+                              int data_index = (c * height + h) * width + w;
+                              float datum_element
+                                  = static_cast<float>(static_cast<uint8_t>(
+                                      datum.data()[data_index]));
+                              datum.add_float_data(datum_element - _mean[c]);
+                            }
+                      datum.clear_data();
+                    }
+                  _dv_test.push_back(datum);
+                  _imgs_size.insert(
+                      std::pair<std::string, std::pair<int, int>>(
+                          this->_ids.at(i), this->_images_size.at(i)));
                 }
-              _dv_test.push_back(datum);
-              _imgs_size.insert(std::pair<std::string, std::pair<int, int>>(
-                  this->_ids.at(i), this->_images_size.at(i)));
             }
           if (!ad.has("chain"))
             {
@@ -327,6 +378,8 @@ namespace dd
                         = ad_input.get("root_folder").get<std::string>();
                   if (ad_input.has("align"))
                     _align = ad_input.get("align").get<bool>();
+                  if (ad_input.has("db_workers"))
+                    _db_workers = ad_input.get("db_workers").get<int>();
                   if (ad_input.has("db_height"))
                     db_height = ad_input.get("db_height").get<int>();
                   if (ad_input.has("db_width"))
@@ -542,7 +595,16 @@ namespace dd
 
     void reset_dv_test();
 
-  private:
+    bool direct_blob_support() const
+    {
+      return true;
+    }
+
+    int get_blob_test(const int &num, std::vector<float> &data,
+                      const float &scale,
+                      const std::vector<float> &mean_values);
+
+  protected:
     void create_test_db_for_imagedatalayer(
         const std::string &test_lst, const std::string &testdbname,
         const std::string &backend = "lmdb", // lmdb, leveldb
@@ -557,11 +619,17 @@ namespace dd
                      = true, // save the encoded image in datum
                      const std::string &encode_type = ""); // 'png', 'jpg', ...
 
+    /**
+     * \brief writes images to db, images are read and encoded in parallel
+     * @param meanfile if not empty, the mean image is computed along and
+     * written to meanfile
+     */
     void
     write_image_to_db(const std::string &dbfullname,
                       const std::vector<std::pair<std::string, int>> &lfiles,
                       const std::string &backend, const bool &encoded,
-                      const std::string &encode_type);
+                      const std::string &encode_type,
+                      const std::string &meanfile = "");
 
     void write_image_to_db_multilabel(
         const std::string &dbfullname,
@@ -599,6 +667,41 @@ namespace dd
                             const std::string &meanfile,
                             const std::string &backend = "lmdb");
 
+    /**
+     * \brief averages sum of images, writes it to meanfile and sets mean
+     * values
+     */
+    void set_images_mean(caffe::BlobProto &sum_blob, const int &count,
+                         const std::string &meanfile);
+
+    /**
+     * \brief hash of a list of images, identifies the db being created
+     */
+    static size_t
+    images_list_hash(const std::vector<std::pair<std::string, int>> &lfiles);
+
+    /**
+     * \brief number of images already committed to an interrupted db
+     * creation, 0 if none or if the list of images differs
+     */
+    size_t read_db_progress(const std::string &dbfullname,
+                            const size_t &list_hash);
+
+    /**
+     * \brief records db creation progress, for resuming
+     */
+    void write_db_progress(const std::string &dbfullname,
+                           const size_t &list_hash, const size_t &next_line);
+
+    /**
+     * \brief reads an image into datum, resized and encoded as with
+     * ReadImageToDatum, and also returns the decoded image, so that callers
+     * that need pixels don't decode the datum again
+     */
+    bool read_image_to_datum(const std::string &fname, const int &label,
+                             const std::string &enc, caffe::Datum &datum,
+                             cv::Mat &img);
+
     std::string guess_encoding(const std::string &file);
 
   public:
@@ -611,10 +714,13 @@ namespace dd
     std::string _meanfname = "mean.binaryproto";
     std::string _correspname = "corresp.txt";
     caffe::Blob<float> _data_mean; // mean binary image if available.
+    std::vector<cv::Mat>
+        _blob_images; /**< predict images, when written to input blob */
     std::vector<caffe::Datum>::const_iterator _dt_vit;
     std::vector<std::pair<std::string, std::string>> _segmentation_data_lines;
     int _dt_seg = 0;
     bool _align = false;
+    int _db_workers = 0; /**< number of db creation workers, 0 for all cores */
   };
 
   /**
@@ -698,6 +804,8 @@ namespace dd
     {
       if (_db_testbatchsize > 0)
         return _db_testbatchsize;
+      else if (_direct_blob)
+        return _blob_rows.size();
       else
         return _dv_test.size();
     }
@@ -774,10 +882,13 @@ namespace dd
                 {
                   _test_dbfullname = _db_fname;
                   _db = true;
+                  _direct_blob = false;
                   return; // done
                 }
               // MULTIPLE TEST SETS : we consider here only 1 test set
               _csvdata_tests.push_back(std::move(_csvdata));
+              if (_label.size() > 1)
+                _direct_blob = false; // labels are part of the input
             }
           else
             _csvdata.clear();
@@ -789,6 +900,14 @@ namespace dd
                   "multiple test sets not supported by caffe backend yet");
             }
 
+          if (!_train && _direct_blob)
+            {
+              // rows are written to the input blob batch by batch
+              for (const CSVline &line : _csvdata_tests[0])
+                this->_ids.push_back(line._str);
+              _blob_rows = std::move(_csvdata_tests[0]);
+              _csvdata_tests[0].clear();
+            }
           // MULTIPLE TEST SETS : we consider here only 1 test set
           auto hit = _csvdata_tests[0].begin();
           // MULTIPLE TEST SETS : we consider here only 1 test set
@@ -843,6 +962,15 @@ namespace dd
 
     void reset_dv_test();
 
+    bool direct_blob_support() const
+    {
+      return true;
+    }
+
+    int get_blob_test(const int &num, std::vector<float> &data,
+                      const float &scale,
+                      const std::vector<float> &mean_values);
+
     /**
      * \brief turns a vector of values into a Caffe Datum structure
      * @param vector of values
@@ -903,6 +1031,8 @@ namespace dd
     std::string _dbname = "train";
     std::string _test_dbname = "test";
     std::string _correspname = "corresp.txt";
+    std::vector<CSVline>
+        _blob_rows; /**< predict rows, when written to input blob */
 
   private:
     std::unique_ptr<caffe::db::Transaction> _txn;
@@ -29,6 +29,7 @@
 #include "utils/fileops.hpp"
 #include "utils/utils.hpp"
 #include "utils/apitools.h"
+#include "utils/topk.hpp"
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #include "caffe/sgd_solvers.hpp"
@@ -2874,6 +2875,9 @@ namespace dd
     std::string roi_layer;
     double confidence_threshold = 0.0;
     int best_bbox = -1;
+    int best = -1;
+    if (ad_output.has("best"))
+      best = ad_output.get("best").get<int>();
     if (ad_output.has("confidence_threshold"))
       {
         try
@@ -2999,6 +3003,25 @@ namespace dd
     if (ad.has("chain") && ad.get("chain").get<bool>())
       cad.add("chain", true);
 
+    // inputs are written straight to the input blob when the input layer
+    // transforms reduce to mean subtraction and scaling
+    float blob_scale = 1.0;
+    std::vector<float> blob_mean_values;
+    auto mdl = boost::dynamic_pointer_cast<caffe::MemoryDataLayer<float>>(
+        _net->layers()[0]);
+    if (mdl && !inputc._sparse && !inputc._timeserie
+        && inputc.direct_blob_support())
+      {
+        const caffe::TransformationParameter &tparam
+            = mdl->layer_param().transform_param();
+        inputc._direct_blob = tparam.crop_size() == 0 && !tparam.mirror()
+                              && !tparam.has_mean_file()
+                              && !tparam.force_color() && !tparam.force_gray();
+        blob_scale = tparam.scale();
+        blob_mean_values.assign(tparam.mean_value().begin(),
+                                tparam.mean_value().end());
+      }
+
     this->_stats.transform_start();
     inputc.transform(cad);
     this->_stats.transform_end();
@@ -3023,7 +3046,24 @@ namespace dd
       {
         try
           {
-            if (!inputc._sparse)
+            if (inputc._direct_blob)
+              {
+                batch_size = inputc.get_blob_test(
+                    batch_size, _blob_data, blob_scale, blob_mean_values);
+                if (batch_size == 0)
+                  break;
+                if (_blob_data.size()
+                    != static_cast<size_t>(batch_size) * mdl->channels()
+                           * mdl->height() * mdl->width())
+                  throw MLLibBadParamException(
+                      "input size does not match net input layer");
+                _blob_labels.resize(batch_size, 0.0);
+                mdl->set_batch_size(batch_size);
+                // the input blob points to _blob_data, no copy
+                mdl->Reset(_blob_data.data(), _blob_labels.data(),
+                           batch_size);
+              }
+            else if (!inputc._sparse)
               {
                 std::vector<Datum> dv
                     = inputc.get_dv_test(batch_size, has_mean_file);
@@ -3666,15 +3706,31 @@ namespace dd
                     rad.add("loss", static_cast<double>(loss));
                     std::vector<double> probs;
                     std::vector<std::string> cats;
-                    for (int i = 0; i < nclasses; i++)
+                    const float *sprobs
+                        = results[slot]->cpu_data() + j * scperel;
+                    if (best > 0 && best < nclasses && !_regression
+                        && !_autoencoder)
                       {
-                        double prob
-                            = results[slot]->cpu_data()[j * scperel + i];
-                        if (prob < confidence_threshold && !_regression)
-                          continue;
-                        probs.push_back(prob);
-                        cats.push_back(this->_mlmodel.get_hcorresp(i));
+                        // only the best classes reach the output
+                        std::vector<size_t> top;
+                        dd_utils::top_k(
+                            sprobs, nclasses, best,
+                            static_cast<float>(confidence_threshold), top);
+                        for (size_t i : top)
+                          {
+                            probs.push_back(sprobs[i]);
+                            cats.push_back(this->_mlmodel.get_hcorresp(i));
+                          }
                       }
+                    else
+                      for (int i = 0; i < nclasses; i++)
+                        {
+                          double prob = sprobs[i];
+                          if (prob < confidence_threshold && !_regression)
+                            continue;
+                          probs.push_back(prob);
+                          cats.push_back(this->_mlmodel.get_hcorresp(i));
+                        }
                     rad.add("probs", probs);
                     rad.add("cats", cats);
                     vrad.push_back(rad);
@@ -317,6 +317,9 @@ namespace dd
                             layers, storing here. */
     float _scale = 1.0; /**< scale is part of Caffe transforms in input layers,
                            storing here. */
+    std::vector<float> _blob_data; /**< predict input, set as the input blob
+                                      data, kept across calls. */
+    std::vector<float> _blob_labels; /**< dummy predict labels. */
 
     std::vector<std::string>
         _best_metrics;         /**< metric to use for saving best model */
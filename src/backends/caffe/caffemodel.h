@@ -51,6 +51,11 @@ namespace dd
                        const std::string &target_repo,
                        const std::shared_ptr<spdlog::logger> &logger);
 
+    std::vector<std::string> weights_files() const
+    {
+      return { _weights };
+    }
+
     std::string _def; /**< file name of the model definition in the form of a
                          protocol buffer message description. */
     std::string _trainf;  /**< file name of the training model definition. */
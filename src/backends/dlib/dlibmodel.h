@@ -50,6 +50,11 @@ namespace dd
     int read_from_repository(const std::string &repo,
                              const std::shared_ptr<spdlog::logger> &logger);
 
+    std::vector<std::string> weights_files() const
+    {
+      return { _modelName, _shapePredictorName };
+    }
+
     std::string _modelName; // Name of the graph
     std::string _modelRepo;
     bool _hasShapePredictor = false;
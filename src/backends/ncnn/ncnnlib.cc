@@ -94,7 +94,8 @@ namespace dd
   {
     _init_dto = ad.createSharedDTO<DTO::MLLib>();
 
-    bool use_fp32 = (_init_dto->datatype == "fp32");
+    bool use_fp32 = (_init_dto->datatype == nullptr
+                     || _init_dto->datatype == "fp32");
     _net->opt.use_fp16_packed = !use_fp32;
     _net->opt.use_fp16_storage = !use_fp32;
     _net->opt.use_fp16_arithmetic = !use_fp32;
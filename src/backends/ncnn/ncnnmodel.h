@@ -56,6 +56,11 @@ namespace dd
 
     int read_from_repository(const std::shared_ptr<spdlog::logger> &logger);
 
+    std::vector<std::string> weights_files() const
+    {
+      return { _weights };
+    }
+
   public:
     std::string _weights;
     std::string _params;
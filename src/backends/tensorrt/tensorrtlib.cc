@@ -938,6 +938,11 @@ namespace dd
                 std::vector<double> probs;
                 std::vector<std::string> cats;
                 std::vector<APIData> bboxes;
+                // detections kept, before nms: scores, labels, and boxes
+                // as contiguous xmin, ymin, xmax, ymax
+                std::vector<double> dprobs;
+                std::vector<int> dlabels;
+                std::vector<double> dboxes;
                 APIData rad;
                 std::string uri = inputc._ids.at(idoffset + j);
                 auto bit = inputc._imgs_size.find(uri);
@@ -960,7 +965,7 @@ namespace dd
                 while (true && k < top_k)
                   {
                     if (!_need_nms && output_params->best_bbox > 0
-                        && bboxes.size() >= static_cast<size_t>(
+                        && dprobs.size() >= static_cast<size_t>(
                                output_params->best_bbox))
                       break;
 
@@ -972,7 +977,7 @@ namespace dd
                         leave = true;
                         break;
                       }
-                    std::vector<float> detection(outr, outr + det_size);
+                    const float *detection = outr;
                     if (curi == -1)
                       curi = detection[0]; // first pass
                     else if (curi != detection[0])
@@ -984,32 +989,41 @@ namespace dd
                       continue;
 
                     // Fix border of bboxes
-                    detection[3]
-                        = std::max(((float)detection[3]), 0.0f) * (cols - 1);
-                    detection[4]
-                        = std::max(((float)detection[4]), 0.0f) * (rows - 1);
-                    detection[5]
-                        = std::min(((float)detection[5]), 1.0f) * (cols - 1);
-                    detection[6]
-                        = std::min(((float)detection[6]), 1.0f) * (rows - 1);
-
-                    probs.push_back(detection[2]);
-                    cats.push_back(this->_mlmodel.get_hcorresp(detection[1]));
-                    APIData ad_bbox;
-                    ad_bbox.add("xmin", static_cast<double>(detection[3]));
-                    ad_bbox.add("ymin", static_cast<double>(detection[4]));
-                    ad_bbox.add("xmax", static_cast<double>(detection[5]));
-                    ad_bbox.add("ymax", static_cast<double>(detection[6]));
-                    bboxes.push_back(ad_bbox);
+                    float xmin = std::max(detection[3], 0.0f) * (cols - 1);
+                    float ymin = std::max(detection[4], 0.0f) * (rows - 1);
+                    float xmax = std::min(detection[5], 1.0f) * (cols - 1);
+                    float ymax = std::min(detection[6], 1.0f) * (rows - 1);
+
+                    dprobs.push_back(detection[2]);
+                    dlabels.push_back(static_cast<int>(detection[1]));
+                    dboxes.insert(dboxes.end(), { xmin, ymin, xmax, ymax });
                   }
 
+                // only detections kept by nms are converted to the output
+                std::vector<size_t> picked;
                 if (_need_nms)
                   {
                     // We assume that bboxes are already sorted in model output
-                    bbox_utils::nms_sorted_bboxes(
-                        bboxes, probs, cats,
+                    int best_bbox = output_params->best_bbox;
+                    bbox_utils::nms_sorted_boxes(
+                        dboxes.data(), dprobs.size(), picked,
                         (double)output_params->nms_threshold,
-                        (int)output_params->best_bbox);
+                        static_cast<size_t>(std::max(best_bbox, 0)));
+                  }
+                else
+                  for (size_t d = 0; d < dprobs.size(); ++d)
+                    picked.push_back(d);
+
+                for (size_t d : picked)
+                  {
+                    probs.push_back(dprobs[d]);
+                    cats.push_back(this->_mlmodel.get_hcorresp(dlabels[d]));
+                    APIData ad_bbox;
+                    ad_bbox.add("xmin", dboxes[4 * d]);
+                    ad_bbox.add("ymin", dboxes[4 * d + 1]);
+                    ad_bbox.add("xmax", dboxes[4 * d + 2]);
+                    ad_bbox.add("ymax", dboxes[4 * d + 3]);
+                    bboxes.push_back(ad_bbox);
                   }
 
                 if (leave)
@@ -63,6 +63,11 @@ namespace dd
       return _source_type == "onnx";
     }
 
+    std::vector<std::string> weights_files() const
+    {
+      return { _weights };
+    }
+
     std::string _model;
     std::string _def;
     std::string _weights;
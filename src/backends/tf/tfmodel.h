@@ -57,6 +57,11 @@ namespace dd
         return _hcorresp[i];
     }
 
+    std::vector<std::string> weights_files() const
+    {
+      return { _graphName };
+    }
+
     std::string _graphName; // Name of the graph
     std::string _modelRepo;
     std::string _corresp; /**< file name of the class correspondences (e.g.
@@ -22,6 +22,8 @@
 #include "torchdataaug.h"
 #include "torchdataset.h"
 
+#include <atomic>
+
 namespace dd
 {
 
@@ -227,14 +229,22 @@ namespace dd
       applyCrop(tgt, _crop_params, crop_x, crop_y, false);
   }
 
+  std::default_random_engine &TorchImgRandAugCV::rnd_gen()
+  {
+    // one stream per thread, so that data loader workers do not serialize
+    // on a shared generator
+    static std::atomic<unsigned int> streams(0);
+    thread_local std::default_random_engine gen = []() {
+      std::seed_seq seq{ streams++ };
+      return std::default_random_engine(seq);
+    }();
+    return gen;
+  }
+
   bool TorchImgRandAugCV::roll_weighted_dice(const float &prob)
   {
     // Draw random between 0 and 1
-    float r1 = 0.0;
-#pragma omp critical
-    {
-      r1 = _uniform_real_1(_rnd_gen);
-    }
+    float r1 = _uniform_real_1(rnd_gen());
     if (r1 > prob)
       return false;
     else
@@ -248,13 +258,10 @@ namespace dd
       return false;
 
     bool mirror = false;
-#pragma omp critical
-    {
-      if (sample)
-        mirror = _bernouilli(_rnd_gen);
-      else
-        mirror = true;
-    }
+    if (sample)
+      mirror = _bernouilli(rnd_gen());
+    else
+      mirror = true;
     if (mirror)
       {
         cv::Mat dst;
@@ -281,11 +288,8 @@ namespace dd
     if (!_rotate)
       return -1;
 
-#pragma omp critical
-    {
-      if (sample)
-        rot = _uniform_int_rotate(_rnd_gen);
-    }
+    if (sample)
+      rot = _uniform_int_rotate(rnd_gen());
     if (rot == 0)
       return rot;
     else if (rot == 1) // 270
@@ -354,19 +358,21 @@ namespace dd
 
     if (sample)
       {
+        if (test)
+          {
+            // test crops are reproducible, drawn from a single seeded
+            // generator
 #pragma omp critical
-        {
-          if (test)
             {
               crop_x = cp._uniform_int_crop_x(_rnd_test_gen);
               crop_y = cp._uniform_int_crop_y(_rnd_test_gen);
             }
-          else
-            {
-              crop_x = cp._uniform_int_crop_x(_rnd_gen);
-              crop_y = cp._uniform_int_crop_y(_rnd_gen);
-            }
-        }
+          }
+        else
+          {
+            crop_x = cp._uniform_int_crop_x(rnd_gen());
+            crop_y = cp._uniform_int_crop_y(rnd_gen());
+          }
       }
     cv::Rect crop(crop_x, crop_y, cp._crop_size, cp._crop_size);
     cv::Mat dst = src(crop).clone();
@@ -421,45 +427,42 @@ namespace dd
     if (!roll_weighted_dice(cp._prob))
       return;
 
-#pragma omp critical
-    {
-      // get shape and area to erase
-      int w = 0, h = 0, rect_x = 0, rect_y = 0;
-      if (cp._w == 0 && cp._h == 0)
-        {
-          float s = cp._uniform_real_cutout_s(_rnd_gen) * cp._img_width
-                    * cp._img_height;                    // area
-          float r = cp._uniform_real_cutout_r(_rnd_gen); // aspect ratio
-
-          w = std::min(cp._img_width,
-                       static_cast<int>(std::floor(std::sqrt(s / r))));
-          h = std::min(cp._img_height,
-                       static_cast<int>(std::floor(std::sqrt(s * r))));
-          std::uniform_int_distribution<int> distx(0, cp._img_width - w);
-          std::uniform_int_distribution<int> disty(0, cp._img_height - h);
-          rect_x = distx(_rnd_gen);
-          rect_y = disty(_rnd_gen);
-        }
-
-      // erase
-      cv::Rect rect(rect_x, rect_y, w, h);
-      cv::Mat selected_area = src(rect);
-      if (selected_area.channels() == 3)
-        cv::randu(selected_area,
-                  cv::Scalar(cp._cutout_vl, cp._cutout_vl, cp._cutout_vl),
-                  cv::Scalar(cp._cutout_vh, cp._cutout_vh, cp._cutout_vh));
-      else
-        cv::randu(selected_area, cv::Scalar(cp._cutout_vl),
-                  cv::Scalar(cp._cutout_vh));
-
-      if (store_rparams)
-        {
-          cp._w = w;
-          cp._h = h;
-          cp._rect_x = rect_x;
-          cp._rect_y = rect_y;
-        }
-    }
+    // get shape and area to erase
+    int w = 0, h = 0, rect_x = 0, rect_y = 0;
+    if (cp._w == 0 && cp._h == 0)
+      {
+        float s = cp._uniform_real_cutout_s(rnd_gen()) * cp._img_width
+                  * cp._img_height;                     // area
+        float r = cp._uniform_real_cutout_r(rnd_gen()); // aspect ratio
+
+        w = std::min(cp._img_width,
+                     static_cast<int>(std::floor(std::sqrt(s / r))));
+        h = std::min(cp._img_height,
+                     static_cast<int>(std::floor(std::sqrt(s * r))));
+        std::uniform_int_distribution<int> distx(0, cp._img_width - w);
+        std::uniform_int_distribution<int> disty(0, cp._img_height - h);
+        rect_x = distx(rnd_gen());
+        rect_y = disty(rnd_gen());
+      }
+
+    // erase
+    cv::Rect rect(rect_x, rect_y, w, h);
+    cv::Mat selected_area = src(rect);
+    if (selected_area.channels() == 3)
+      cv::randu(selected_area,
+                cv::Scalar(cp._cutout_vl, cp._cutout_vl, cp._cutout_vl),
+                cv::Scalar(cp._cutout_vh, cp._cutout_vh, cp._cutout_vh));
+    else
+      cv::randu(selected_area, cv::Scalar(cp._cutout_vl),
+                cv::Scalar(cp._cutout_vh));
+
+    if (store_rparams)
+      {
+        cp._w = w;
+        cp._h = h;
+        cp._rect_x = rect_x;
+        cp._rect_y = rect_y;
+      }
   }
 
   void TorchImgRandAugCV::getEnlargedImage(const cv::Mat &in_img,
@@ -493,6 +496,7 @@ namespace dd
     // The 4 points that select quadilateral on the input , from top-left in
     // clockwise order These four pts are the sides of the rect box used as
     // input
+    std::default_random_engine &gen = rnd_gen();
     float x0, x1, y0, y1;
     x0 = cols;
     x1 = 2 * cols - 1;
@@ -504,7 +508,7 @@ namespace dd
         bool zoom_out = cp._geometry_zoom_out;
         if (cp._geometry_zoom_out && cp._geometry_zoom_in)
           {
-            if (_bernouilli(_rnd_gen))
+            if (_bernouilli(gen))
               zoom_in = false;
             else
               zoom_out = false;
@@ -532,9 +536,9 @@ namespace dd
             y0min = y0;
           }
 
-        x0 = ((x0max - x0min) * _uniform_real_1(_rnd_gen) + x0min);
+        x0 = ((x0max - x0min) * _uniform_real_1(gen) + x0min);
         x1 = 3 * cols - x0;
-        y0 = ((y0max - y0min) * _uniform_real_1(_rnd_gen) + y0min);
+        y0 = ((y0max - y0min) * _uniform_real_1(gen) + y0min);
         y1 = 3 * rows - y0;
       }
 
@@ -551,35 +555,35 @@ namespace dd
     outputQuad[3] = cv::Point2f(0, rows - 1);
     if (cp._geometry_persp_horizontal)
       {
-        if (_bernouilli(_rnd_gen))
+        if (_bernouilli(gen))
           {
             // seen from right
             outputQuad[0].y
-                = rows * cp._geometry_persp_factor * _uniform_real_1(_rnd_gen);
+                = rows * cp._geometry_persp_factor * _uniform_real_1(gen);
             outputQuad[3].y = rows - outputQuad[0].y;
           }
         else
           {
             // seen from left
             outputQuad[1].y
-                = rows * cp._geometry_persp_factor * _uniform_real_1(_rnd_gen);
+                = rows * cp._geometry_persp_factor * _uniform_real_1(gen);
             outputQuad[2].y = rows - outputQuad[1].y;
           }
       }
     if (cp._geometry_persp_vertical)
       {
-        if (_bernouilli(_rnd_gen))
+        if (_bernouilli(gen))
           {
             // seen from above
             outputQuad[3].x
-                = cols * cp._geometry_persp_factor * _uniform_real_1(_rnd_gen);
+                = cols * cp._geometry_persp_factor * _uniform_real_1(gen);
             outputQuad[2].x = cols - outputQuad[3].x;
           }
         else
           {
             // seen from below
             outputQuad[0].x
-                = cols * cp._geometry_persp_factor * _uniform_real_1(_rnd_gen);
+                = cols * cp._geometry_persp_factor * _uniform_real_1(gen);
             outputQuad[1].x = cols - outputQuad[0].x;
           }
       }
@@ -608,11 +612,8 @@ namespace dd
     cv::Point2f outputQuad[4];
 
     // get perpective matrix
-#pragma omp critical
-    {
-      if (sample)
-        getQuads(src.rows, src.cols, cp, inputQuad, outputQuad);
-    }
+    if (sample)
+      getQuads(src.rows, src.cols, cp, inputQuad, outputQuad);
 
     // warp perspective
     cv::Mat lambda
@@ -786,11 +787,7 @@ namespace dd
         src = bgr;
       }
 
-    float lprob;
-#pragma omp critical
-    {
-      lprob = _uniform_real_1(_rnd_gen);
-    }
+    float lprob = _uniform_real_1(rnd_gen());
     if (lprob > 0.5)
       {
         if (_distort_params._brightness)
@@ -912,10 +909,7 @@ namespace dd
     std::vector<uchar> buf;
     std::vector<int> params;
     params.push_back(cv::IMWRITE_JPEG_QUALITY);
-#pragma omp critical
-    {
-      params.push_back(_uniform_real_1(_rnd_gen) * 100.0);
-    }
+    params.push_back(_uniform_real_1(rnd_gen()) * 100.0);
     cv::imencode(".jpg", src, buf, params);
     src = cv::imdecode(buf, cv::IMREAD_COLOR);
   }
@@ -962,33 +956,28 @@ namespace dd
     const int noise_pixels_n
         = std::floor(_noise_params._saltpepper_fraction * src.cols * src.rows);
     const std::vector<uchar> val = { 0, 0, 0 };
+    std::default_random_engine &gen = rnd_gen();
     if (src.channels() == 1)
       {
-#pragma omp critical
-        {
-          for (int k = 0; k < noise_pixels_n; ++k)
-            {
-              const int i = _uniform_real_1(_rnd_gen) * src.cols;
-              const int j = _uniform_real_1(_rnd_gen) * src.rows;
-              uchar *ptr = src.ptr<uchar>(j);
-              ptr[i] = val[0];
-            }
-        }
+        for (int k = 0; k < noise_pixels_n; ++k)
+          {
+            const int i = _uniform_real_1(gen) * src.cols;
+            const int j = _uniform_real_1(gen) * src.rows;
+            uchar *ptr = src.ptr<uchar>(j);
+            ptr[i] = val[0];
+          }
       }
     else if (src.channels() == 3)
       { // color image
-#pragma omp critical
-        {
-          for (int k = 0; k < noise_pixels_n; ++k)
-            {
-              const int i = _uniform_real_1(_rnd_gen) * src.cols;
-              const int j = _uniform_real_1(_rnd_gen) * src.rows;
-              cv::Vec3b *ptr = src.ptr<cv::Vec3b>(j);
-              (ptr[i])[0] = val[0];
-              (ptr[i])[1] = val[1];
-              (ptr[i])[2] = val[2];
-            }
-        }
+        for (int k = 0; k < noise_pixels_n; ++k)
+          {
+            const int i = _uniform_real_1(gen) * src.cols;
+            const int j = _uniform_real_1(gen) * src.rows;
+            cv::Vec3b *ptr = src.ptr<cv::Vec3b>(j);
+            (ptr[i])[0] = val[0];
+            (ptr[i])[1] = val[1];
+            (ptr[i])[2] = val[2];
+          }
       }
   }
 
@@ -1018,11 +1007,7 @@ namespace dd
   {
     if (!roll_weighted_dice(_distort_params._prob))
       return;
-    float delta;
-#pragma omp critical
-    {
-      delta = _distort_params._uniform_real_brightness(_rnd_gen);
-    }
+    float delta = _distort_params._uniform_real_brightness(rnd_gen());
     if (delta > 0)
       {
         cv::Mat tmp;
@@ -1035,11 +1020,7 @@ namespace dd
   {
     if (!roll_weighted_dice(_distort_params._prob))
       return;
-    float delta;
-#pragma omp critical
-    {
-      delta = _distort_params._uniform_real_contrast(_rnd_gen);
-    }
+    float delta = _distort_params._uniform_real_contrast(rnd_gen());
     if (fabs(delta - 1.f) > 1e-3)
       {
         cv::Mat tmp;
@@ -1052,11 +1033,7 @@ namespace dd
   {
     if (!roll_weighted_dice(_distort_params._prob))
       return;
-    float delta;
-#pragma omp critical
-    {
-      delta = _distort_params._uniform_real_saturation(_rnd_gen);
-    }
+    float delta = _distort_params._uniform_real_saturation(rnd_gen());
     if (fabs(delta - 1.f) != 1e-3)
       {
         cv::Mat tmp;
@@ -1081,11 +1058,7 @@ namespace dd
   {
     if (!roll_weighted_dice(_distort_params._prob))
       return;
-    float delta;
-#pragma omp critical
-    {
-      delta = _distort_params._uniform_real_hue(_rnd_gen);
-    }
+    float delta = _distort_params._uniform_real_hue(rnd_gen());
     if (fabs(delta) > 0)
       {
         cv::Mat tmp;
@@ -305,6 +305,11 @@ namespace dd
     void augment_test_with_segmap(cv::Mat &src, cv::Mat &tgt);
 
   protected:
+    /**
+     * \brief random generator of the calling thread
+     */
+    static std::default_random_engine &rnd_gen();
+
     bool roll_weighted_dice(const float &prob);
     bool applyMirror(cv::Mat &src, const bool &sample = true);
     void applyMirrorBBox(std::vector<std::vector<float>> &bboxes,
@@ -367,8 +372,8 @@ namespace dd
     NoiseParams _noise_params;
     DistortParams _distort_params;
 
-    // random generators
-    std::default_random_engine _rnd_gen;
+    // random generators, training time draws use per thread generators,
+    // distributions hold no state and are shared
     std::default_random_engine
         _rnd_test_gen; /**< test time, seeded generator. */
     std::uniform_real_distribution<float>
@@ -23,6 +23,7 @@
 
 #include "torchdataset.h"
 #include "torchinputconns.h"
+#include "utils/ordered_parallel.hpp"
 
 namespace dd
 {
@@ -30,6 +31,17 @@ namespace dd
   {
     if (!_db)
       return;
+    if (shards())
+      {
+        if (_shard_writer)
+          {
+            _shard_writer->close();
+            _logger->info("Put {} records in db", _shard_writer->size());
+            _shard_writer.reset();
+          }
+        _current_index = 0;
+        return;
+      }
     if (_current_index % _batches_per_transaction != 0)
       {
         _txn->Commit();
@@ -47,6 +59,9 @@ namespace dd
   void TorchDataset::pop_db_elt(int64_t index, std::string &data,
                                 std::string &target)
   {
+    if (shards())
+      throw InputConnectorBadParamException(
+          "splitting an existing db requires the lmdb db format");
     if (_dbData == nullptr)
       {
         _dbData = std::shared_ptr<db::DB>(db::GetDB(_backend));
@@ -68,6 +83,9 @@ namespace dd
   void TorchDataset::add_db_elt(int64_t index, std::string data,
                                 std::string target)
   {
+    if (shards())
+      throw InputConnectorBadParamException(
+          "splitting an existing db requires the lmdb db format");
     if (_dbData == nullptr)
       {
         _dbData = std::shared_ptr<db::DB>(db::GetDB(_backend));
@@ -88,6 +106,18 @@ namespace dd
   void TorchDataset::write_tensors_to_db(const std::vector<at::Tensor> &data,
                                          const std::vector<at::Tensor> &target)
   {
+    if (shards())
+      {
+        // raw tensors, read back without deserialization
+        if (!_shard_writer)
+          _shard_writer = std::make_shared<RecordShardWriter>(_dbFullName);
+        _shard_writer->add(RecordShardTensors::serialize(data),
+                           RecordShardTensors::serialize(target));
+        if (++_current_index % 10000 == 0)
+          _logger->info("Put {} tensors in db", _current_index);
+        return;
+      }
+
     std::ostringstream dstream;
     torch::save(data, dstream);
     std::ostringstream tstream;
@@ -150,7 +180,7 @@ namespace dd
 
     // serialize target
     std::ostringstream tstream;
-    torch::save(target, tstream);
+    targets_to_stream(target, tstream);
 
     write_image_to_db(dstream, tstream, bgr.rows, bgr.cols);
   }
@@ -169,10 +199,32 @@ namespace dd
     write_image_to_db(dstream, tstream, bgr.rows, bgr.cols);
   }
 
+  void TorchDataset::targets_to_stream(const std::vector<at::Tensor> &target,
+                                       std::ostringstream &tstream)
+  {
+    if (shards())
+      tstream << RecordShardTensors::serialize(target);
+    else
+      torch::save(target, tstream);
+  }
+
   void TorchDataset::write_image_to_db(const std::ostringstream &dstream,
                                        const std::ostringstream &tstream,
                                        const int &height, const int &width)
   {
+    if (shards())
+      {
+        if (!_shard_writer)
+          {
+            _shard_writer = std::make_shared<RecordShardWriter>(_dbFullName);
+            _logger->info("Preparing db of {}x{} images", width, height);
+          }
+        _shard_writer->add(dstream.str(), tstream.str());
+        if (++_current_index % _batches_per_transaction == 0)
+          _logger->info("Put {} images in db", _current_index);
+        return;
+      }
+
     // check on db
     if (_dbData == nullptr)
       {
@@ -224,7 +276,37 @@ namespace dd
         std::stringstream targetstream(targets);
         torch::load(targett, targetstream);
       }
+    resize_image_from_db(bgr, targett, bw_target, width, height);
+  }
+
+  void TorchDataset::read_image_from_record(
+      const RecordShardReader::Record &rec, cv::Mat &bgr,
+      std::vector<torch::Tensor> &targett, cv::Mat &bw_target, const bool &bw,
+      const int &width, const int &height)
+  {
+    // decode straight from the mapped shard
+    cv::Mat img_data(1, rec.data_size, CV_8UC1,
+                     const_cast<char *>(rec.data));
+    bgr = cv::imdecode(img_data,
+                       bw ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR);
+
+    if (_segmentation)
+      {
+        cv::Mat img_target_data(1, rec.target_size, CV_8UC1,
+                                const_cast<char *>(rec.target));
+        bw_target = cv::imdecode(img_target_data, CV_LOAD_IMAGE_GRAYSCALE);
+      }
+    else // copied, since targets are modified by data augmentation
+      targett = RecordShardTensors::deserialize(rec.target, rec.target_size,
+                                                rec.holder, true);
+    resize_image_from_db(bgr, targett, bw_target, width, height);
+  }
 
+  void TorchDataset::resize_image_from_db(cv::Mat &bgr,
+                                          std::vector<torch::Tensor> &targett,
+                                          cv::Mat &bw_target,
+                                          const int &width, const int &height)
+  {
     if (bgr.cols != width || bgr.rows != height)
       {
         float w_ratio = static_cast<float>(width) / bgr.cols;
@@ -310,6 +392,15 @@ namespace dd
             data_size = _batches.size();
           }
       }
+    else if (shards())
+      {
+        if (dbmode != db::READ)
+          throw InputConnectorBadParamException(
+              "splitting an existing db requires the lmdb db format");
+        if (!_shard_reader)
+          _shard_reader = std::make_shared<RecordShardReader>(_dbFullName);
+        data_size = _shard_reader->size();
+      }
     else // below db case
       {
         if (!_dbData)
@@ -337,6 +428,16 @@ namespace dd
     if (!_db)
       return _batches[0].target[i].sizes().vec();
 
+    if (shards())
+      {
+        RecordShardReader::Record rec = _shard_reader->get(_indices.back());
+        return RecordShardTensors::deserialize(rec.target, rec.target_size,
+                                               rec.holder, false)
+            .at(i)
+            .sizes()
+            .vec();
+      }
+
     auto id = _indices.back();
     std::stringstream target_key;
     target_key << id << "_target";
@@ -354,6 +455,16 @@ namespace dd
     if (!_db)
       return _batches[0].data[i].sizes().vec();
 
+    if (shards())
+      {
+        RecordShardReader::Record rec = _shard_reader->get(_indices.back());
+        return RecordShardTensors::deserialize(rec.data, rec.data_size,
+                                               rec.holder, false)
+            .at(i)
+            .sizes()
+            .vec();
+      }
+
     auto id = _indices.back();
     std::stringstream data_key;
     data_key << id << "_data";
@@ -478,6 +589,7 @@ namespace dd
 
             std::string targets;
             std::string datas;
+            RecordShardReader::Record rec;
 
             {
               std::lock_guard<std::mutex> guard(_mutex);
@@ -486,27 +598,35 @@ namespace dd
                 // end of the dataset
                 break;
 
-              if (!_dbCursor->valid())
+              if (shards())
                 {
-                  delete _dbCursor;
-                  _dbCursor = _dbData->NewCursor();
+                  // random access, payloads are read outside the lock
+                  rec = _shard_reader->get(_indices.back());
                 }
-              std::string key = _dbCursor->key();
-              size_t pos = key.find("_data");
-              if (pos != std::string::npos)
-                {
-                  data_key << key;
-                  std::string sid = key.substr(0, pos);
-                  target_key << sid << "_target";
-                }
-              else // skip targets
+              else
                 {
+                  if (!_dbCursor->valid())
+                    {
+                      delete _dbCursor;
+                      _dbCursor = _dbData->NewCursor();
+                    }
+                  std::string key = _dbCursor->key();
+                  size_t pos = key.find("_data");
+                  if (pos != std::string::npos)
+                    {
+                      data_key << key;
+                      std::string sid = key.substr(0, pos);
+                      target_key << sid << "_target";
+                    }
+                  else // skip targets
+                    {
+                      _dbCursor->Next();
+                      continue;
+                    }
+                  _dbData->Get(data_key.str(), datas);
+                  _dbData->Get(target_key.str(), targets);
                   _dbCursor->Next();
-                  continue;
                 }
-              _dbData->Get(data_key.str(), datas);
-              _dbData->Get(target_key.str(), targets);
-              _dbCursor->Next();
 
               --count;
               _indices.pop_back();
@@ -520,10 +640,21 @@ namespace dd
 
             if (!_image)
               {
-                std::stringstream datastream(datas);
-                std::stringstream targetstream(targets);
-                torch::load(d, datastream);
-                torch::load(t, targetstream);
+                if (shards())
+                  {
+                    // views of the mapped shard, copied when batched
+                    d = RecordShardTensors::deserialize(
+                        rec.data, rec.data_size, rec.holder, false);
+                    t = RecordShardTensors::deserialize(
+                        rec.target, rec.target_size, rec.holder, false);
+                  }
+                else
+                  {
+                    std::stringstream datastream(datas);
+                    std::stringstream targetstream(targets);
+                    torch::load(d, datastream);
+                    torch::load(t, targetstream);
+                  }
 
                 for (unsigned int i = 0; i < d.size(); ++i)
                   {
@@ -544,9 +675,13 @@ namespace dd
                     = dynamic_cast<ImgTorchInputFileConn *>(_inputc);
 
                 cv::Mat bgr, bw_target;
-                read_image_from_db(datas, targets, bgr, t, bw_target,
-                                   inputc->_bw, inputc->width(),
-                                   inputc->height());
+                if (shards())
+                  read_image_from_record(rec, bgr, t, bw_target, inputc->_bw,
+                                         inputc->width(), inputc->height());
+                else
+                  read_image_from_db(datas, targets, bgr, t, bw_target,
+                                     inputc->_bw, inputc->width(),
+                                     inputc->height());
 
                 int samples = 1;
 
@@ -744,6 +879,45 @@ namespace dd
     return add_image_file(fname, { target_to_tensor(target) }, height, width);
   }
 
+  void TorchDataset::add_image_files(
+      const std::vector<std::pair<std::string, int>> &lfiles,
+      const int &height, const int &width)
+  {
+    if (!_db)
+      {
+        for (const std::pair<std::string, int> &lfile : lfiles)
+          add_image_file(lfile.first, lfile.second, height, width);
+        return;
+      }
+
+    // images are read and encoded by workers, and written in order
+    struct EncodedImage
+    {
+      std::ostringstream dstream;
+      std::ostringstream tstream;
+      int rows = 0;
+      int cols = 0;
+    };
+    dd_utils::ordered_parallel_for<EncodedImage>(
+        0, lfiles.size(),
+        [&](size_t i, int, EncodedImage &enc) {
+          cv::Mat img;
+          if (read_image_file(lfiles[i].first, img) != 0)
+            return false;
+          image_to_stringstream(img, enc.dstream, true);
+          std::vector<at::Tensor> target
+              = { target_to_tensor(lfiles[i].second) };
+          targets_to_stream(target, enc.tstream);
+          enc.rows = img.rows;
+          enc.cols = img.cols;
+          return true;
+        },
+        [&](size_t, EncodedImage &enc) {
+          write_image_to_db(enc.dstream, enc.tstream, enc.rows, enc.cols);
+        },
+        _db_workers);
+  }
+
   int TorchDataset::add_image_image_file(const std::string &fname,
                                          const std::string &fname_target,
                                          const int &height, const int &width)
@@ -898,7 +1072,7 @@ namespace dd
     at::TensorOptions options(at::ScalarType::Byte);
 
     at::Tensor imgt = torch::from_blob(bgr.data, at::IntList(sizes), options);
-    imgt = imgt.toType(at::kFloat).permute({ 2, 0, 1 });
+    imgt = imgt.permute({ 2, 0, 1 });
     size_t nchannels = imgt.size(0);
 
     if (!target)
@@ -911,27 +1085,40 @@ namespace dd
             nchannels = 3;
           }
 
-        if (inputc->_scale != 1.0)
-          imgt = imgt.mul(inputc->_scale);
-
         if (!inputc->_mean.empty() && inputc->_mean.size() != nchannels)
           throw InputConnectorBadParamException(
               "mean vector be of size the number of channels ("
               + std::to_string(nchannels) + ")");
 
-        for (size_t m = 0; m < inputc->_mean.size(); m++)
-          imgt[m] = imgt[m].sub_(inputc->_mean.at(m));
-
         if (!inputc->_std.empty() && inputc->_std.size() != nchannels)
           throw InputConnectorBadParamException(
               "std vector be of size the number of channels ("
               + std::to_string(nchannels) + ")");
 
-        for (size_t s = 0; s < inputc->_std.size(); s++)
-          imgt[s] = imgt[s].div_(inputc->_std.at(s));
+        if (inputc->_scale != 1.0 || !inputc->_mean.empty()
+            || !inputc->_std.empty())
+          {
+            // (x * scale - mean) / std, as a single multiply-add per
+            // channel, straight from the uint8 image
+            std::vector<float> alpha(nchannels, inputc->_scale);
+            std::vector<float> beta(nchannels, 0.0);
+            for (size_t c = 0; c < nchannels; ++c)
+              {
+                float sd = inputc->_std.empty() ? 1.0 : inputc->_std[c];
+                float mean = inputc->_mean.empty() ? 0.0 : inputc->_mean[c];
+                alpha[c] /= sd;
+                beta[c] = -mean / sd;
+              }
+            std::vector<int64_t> csizes{ static_cast<int64_t>(nchannels), 1,
+                                         1 };
+            at::Tensor alphat
+                = torch::from_blob(alpha.data(), csizes, at::kFloat);
+            at::Tensor betat = torch::from_blob(beta.data(), csizes, at::kFloat);
+            return imgt.mul(alphat).add_(betat);
+          }
       }
 
-    return imgt;
+    return imgt.toType(at::kFloat);
   }
 
   at::Tensor TorchDataset::target_to_tensor(const int &target)
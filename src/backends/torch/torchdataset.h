@@ -34,6 +34,7 @@
 
 #include "inputconnectorstrategy.h"
 #include "torchdataaug.h"
+#include "torchrecordshard.h"
 #include "torchutils.h"
 
 #include <opencv2/opencv.hpp>
@@ -59,11 +60,16 @@ namespace dd
     std::mt19937 _rng;
     int64_t _current_index
         = 0; /**< current index for batch parallel data extraction */
-    std::string _backend; /**< db backend (currently only lmdb supported= */
+    std::string _backend; /**< db backend, lmdb or shards */
     bool _db = false;     /**< is data in db ? */
     int32_t _batches_per_transaction
         = 10; /**< number of batches per db transaction */
+    int _db_workers = 0; /**< number of db creation workers, 0 for all cores */
     std::shared_ptr<db::Transaction> _txn;   /**< db transaction pointer */
+    std::shared_ptr<RecordShardWriter>
+        _shard_writer; /**< shards db writer, when creating db */
+    std::shared_ptr<RecordShardReader>
+        _shard_reader; /**< shards db reader, lock-free random access */
     std::shared_ptr<spdlog::logger> _logger; /**< dd logger */
 
     std::mutex _mutex; /**< lock to keep the dataset synchronized */
@@ -102,8 +108,11 @@ namespace dd
     TorchDataset(const TorchDataset &d)
         : _seed(d._seed), _rng(d._rng), _current_index(d._current_index),
           _backend(d._backend), _db(d._db),
-          _batches_per_transaction(d._batches_per_transaction), _txn(d._txn),
-          _logger(d._logger), _shuffle(d._shuffle), _dbData(d._dbData),
+          _batches_per_transaction(d._batches_per_transaction),
+          _db_workers(d._db_workers), _txn(d._txn),
+          _shard_writer(d._shard_writer), _shard_reader(d._shard_reader),
+          _logger(d._logger),
+          _shuffle(d._shuffle), _dbData(d._dbData),
           _indices(d._indices), _lfiles(d._lfiles), _batches(d._batches),
           _dbFullName(d._dbFullName), _inputc(d._inputc),
           _classification(d._classification), _image(d._image), _bbox(d._bbox),
@@ -230,6 +239,22 @@ namespace dd
       _batches_per_transaction = tsize;
     }
 
+    /**
+     *  \brief setter for number of db creation workers
+     */
+    void set_db_workers(int workers)
+    {
+      _db_workers = workers;
+    }
+
+    /**
+     * \brief whether db is in the memory mapped record shards format
+     */
+    bool shards() const
+    {
+      return _backend == "shards";
+    }
+
     /**
      * \brief commits final db transactions
      */
@@ -293,6 +318,16 @@ namespace dd
     int add_image_file(const std::string &fname, const int &target,
                        const int &height, const int &width);
 
+    /**
+     * \brief adds images from image filenames, with int targets. When
+     * writing to db, images are read and encoded in parallel and written in
+     * order.
+     * \param width of preprocessed image
+     * \param height of preprocessed image
+     */
+    void add_image_files(const std::vector<std::pair<std::string, int>> &lfiles,
+                         const int &height, const int &width);
+
     /**
      * \brief adds image from image filename, with a set of regression targets
      * \param width of preprocessed image
@@ -376,6 +411,13 @@ namespace dd
      */
     void write_image_to_db(const cv::Mat &bgr, const cv::Mat &bw_target);
 
+    /**
+     * \brief serializes targets, raw tensors for shards, torch::save
+     * otherwise
+     */
+    void targets_to_stream(const std::vector<at::Tensor> &target,
+                           std::ostringstream &tstream);
+
     /**
      * \brief write two stringstreams to db, as key and value.
      *        width and height are for logging purposes
@@ -392,6 +434,23 @@ namespace dd
                             std::vector<torch::Tensor> &targett,
                             cv::Mat &bw_target, const bool &bw,
                             const int &width, const int &height);
+
+    /**
+     * \brief reads an encoded image and its target from a shard record
+     */
+    void read_image_from_record(const RecordShardReader::Record &rec,
+                                cv::Mat &bgr,
+                                std::vector<torch::Tensor> &targett,
+                                cv::Mat &bw_target, const bool &bw,
+                                const int &width, const int &height);
+
+    /**
+     * \brief resizes image and target read from db to width x height
+     */
+    void resize_image_from_db(cv::Mat &bgr,
+                              std::vector<torch::Tensor> &targett,
+                              cv::Mat &bw_target, const int &width,
+                              const int &height);
   };
 
   /**
@@ -415,7 +474,7 @@ namespace dd
           _test(d._test), _db(d._db), _backend(d._backend),
           _dbPrefix(d._dbPrefix), _logger(d._logger),
           _batches_per_transaction(d._batches_per_transaction),
-          _datasets(d._datasets)
+          _db_workers(d._db_workers), _datasets(d._datasets)
     {
     }
 
@@ -446,6 +505,16 @@ namespace dd
       _batches_per_transaction = tsize;
     }
 
+    /**
+     * \brief set number of db creation workers on all datasets
+     */
+    void set_db_workers(int workers)
+    {
+      _db_workers = workers;
+      for (TorchDataset &d : _datasets)
+        d.set_db_workers(workers);
+    }
+
     /**
      * \brief sets image data augmenter across test datasets
      */
@@ -586,6 +655,7 @@ namespace dd
                                   _dbPrefix + "_" + std::to_string(id));
       _datasets[id].set_logger(_logger);
       _datasets[id].set_db_transaction_size(_batches_per_transaction);
+      _datasets[id].set_db_workers(_db_workers);
     }
 
   public:
@@ -606,6 +676,7 @@ namespace dd
     std::shared_ptr<spdlog::logger> _logger; /**< dd logger */
     int32_t _batches_per_transaction
         = 10; /**< number of batches per db transaction */
+    int _db_workers = 0; /**< number of db creation workers */
     std::vector<TorchDataset> _datasets;
   };
 }
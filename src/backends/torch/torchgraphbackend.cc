@@ -21,6 +21,8 @@
 
 #include "torchgraphbackend.h"
 #include "mllibstrategy.h"
+#include <algorithm>
+#include <array>
 
 namespace dd
 {
@@ -38,9 +40,13 @@ namespace dd
   {
     std::vector<int> dim(input.sizes().begin(), input.sizes().end());
     this->set_input_dim(dim);
-    _variables[_inputname] = input;
-    graph::BaseGraph::finalize();
-    allocate_modules();
+    // plan and modules only need an update when input dims change
+    if (!_finalized || !_plan_compiled)
+      {
+        graph::BaseGraph::finalize();
+        allocate_modules();
+      }
+    _slots[_input_slot] = input;
   }
 
   void TorchGraphBackend::finalize()
@@ -88,117 +94,172 @@ namespace dd
   torch::Tensor TorchGraphBackend::extract(torch::Tensor inputTensor,
                                            std::string extract_layer)
   {
+    auto slot = _slot_index.find(extract_layer);
+    if (slot == _slot_index.end())
+      throw TorchGraphException("could not extract layer, unknown layer "
+                                + extract_layer);
     set_input(inputTensor);
-    for (graph::Vertex o : _sortedOps)
-      {
-        std::vector<torch::Tensor> out = forward(o);
-        std::vector<graph::Vertex> outputVars = this->outputs(o);
-        for (unsigned int i = 0; i < outputVars.size(); ++i)
-          {
-            _variables[varname(outputVars[i])] = out[i];
-            if (varname(outputVars[i]) == extract_layer)
-              return out[i];
-          }
-      }
-    throw TorchGraphException(
-        "could not extract layer, extract layer could not be computed from "
-        "input please check graph structure");
+    bool computed = run_plan(slot->second);
+    torch::Tensor out = _slots[slot->second];
+    for (torch::Tensor &t : _slots)
+      t = torch::Tensor();
+    if (!computed)
+      throw TorchGraphException(
+          "could not extract layer, extract layer could not be computed from "
+          "input please check graph structure");
+    return out;
   }
 
   torch::Tensor TorchGraphBackend::forward(torch::Tensor inputTensor)
   {
     set_input(inputTensor);
-    bool output_computed = false;
-    for (graph::Vertex o : _sortedOps)
-      {
-        std::vector<torch::Tensor> out = forward(o);
-        std::vector<graph::Vertex> outputVars = this->outputs(o);
-        for (unsigned int i = 0; i < outputVars.size(); ++i)
-          {
-            if (varname(outputVars[i]) == _outputname)
-              output_computed = true;
-            _variables[varname(outputVars[i])] = out[i];
-          }
-      }
-    if (!output_computed)
+    if (_output_slot < 0 || !run_plan())
       throw TorchGraphException(
           "did not compute output, please check NN graph");
-    return _variables[_outputname];
+    // intermediate tensors are already released, do not keep output either
+    return std::move(_slots[_output_slot]);
   }
 
-  std::vector<torch::Tensor> TorchGraphBackend::forward(graph::Vertex v)
+  bool TorchGraphBackend::run_plan(int stop_slot)
   {
+    for (ExecStep &step : _plan)
+      {
+        (this->*step.run)(step);
+        if (stop_slot >= 0
+            && std::find(step.outputs.begin(), step.outputs.end(), stop_slot)
+                   != step.outputs.end())
+          return true;
+        for (int r : step.releases)
+          _slots[r] = torch::Tensor();
+      }
+    return stop_slot < 0 && _slots[_output_slot].defined();
+  }
 
-    std::vector<torch::Tensor> inputsTensor;
-    for (graph::Vertex vi : this->inputs(v))
+  void TorchGraphBackend::forward_lstm(ExecStep &step)
+  {
+    std::tuple<torch::Tensor, std::tuple<torch::Tensor, torch::Tensor>>
+        full_output;
+    if (_lstm_continuation && *step.rnn_has_memory)
       {
-        inputsTensor.push_back(_variables[varname(vi)]);
+        full_output
+            = step.module
+                  .forward<std::tuple<Tensor, std::tuple<Tensor, Tensor>>>(
+                      _slots[step.inputs[0]],
+                      torch::optional<std::tuple<torch::Tensor, torch::Tensor>>(
+                          *step.rnn_memory));
       }
+    else
+      full_output
+          = step.module
+                .forward<std::tuple<Tensor, std::tuple<Tensor, Tensor>>>(
+                    _slots[step.inputs[0]]);
+    _autoencoder_timesteps = std::get<0>(full_output).size(1);
 
-    auto opname_v = opname(v);
-    std::vector<torch::Tensor> output;
-    std::string optype = this->optype(v);
+    // all outputs, last hidden value, last memory / c value
+    std::array<torch::Tensor, 3> outputs
+        = { std::get<0>(full_output), std::get<0>(std::get<1>(full_output)),
+            std::get<1>(std::get<1>(full_output)) };
+    for (size_t i = 0; i < step.outputs.size() && i < outputs.size(); ++i)
+      _slots[step.outputs[i]] = outputs[i];
 
-    if (optype == "RNN")
+    if (_lstm_continuation)
       {
-        throw MLLibInternalException(
-            "RNN layer type not supported, use LSTM instead");
+        *step.rnn_memory = std::get<1>(full_output);
+        *step.rnn_has_memory = true;
       }
-    else if (optype == "LSTM")
+  }
+
+  void TorchGraphBackend::forward_module(ExecStep &step)
+  {
+    _slots[step.outputs[0]] = step.module.forward(_slots[step.inputs[0]]);
+  }
+
+  void TorchGraphBackend::forward_tile(ExecStep &step)
+  {
+    const graph::VertexProperty &vp = _graph[step.v];
+    torch::Tensor x = _slots[step.inputs[0]];
+    std::vector<long int> rssizes = x.sizes().vec();
+    rssizes.erase(rssizes.begin()); // remove first dim because it is
+    // 1 : num_layers * num_directions
+    rssizes.insert(rssizes.begin() + vp.axis, 1L);
+    torch::Tensor y = x.reshape(rssizes);
+    std::vector<long int> tiless(rssizes.size(), 1);
+    if (vp.outputsdims[0][vp.axis]
+        < 0) // to be autodetermined : autoencoder LSTM case only for now
+      tiless[vp.axis] = _autoencoder_timesteps;
+    else
+      tiless[vp.axis] = vp.outputsdims[0][vp.axis];
+    _slots[step.outputs[0]] = y.repeat(tiless);
+  }
+
+  void TorchGraphBackend::forward_unsupported(ExecStep &step)
+  {
+    if (step.type == "RNN")
+      throw MLLibInternalException(
+          "RNN layer type not supported, use LSTM instead");
+    throw TorchGraphException("unknown optype " + step.type + " for operator "
+                              + step.name);
+  }
+
+  void TorchGraphBackend::compile_plan()
+  {
+    _slot_index.clear();
+    for (graph::Vertex v : _sortedVars)
+      _slot_index.insert({ varname(v), static_cast<int>(_slot_index.size()) });
+    _slots.clear();
+    _slots.resize(_slot_index.size());
+
+    _input_slot = _slot_index.at(_inputname);
+    auto oslot = _slot_index.find(_outputname);
+    _output_slot = oslot == _slot_index.end() ? -1 : oslot->second;
+
+    _plan.clear();
+    _plan.reserve(_sortedOps.size());
+    for (graph::Vertex v : _sortedOps)
       {
-        std::tuple<torch::Tensor, std::tuple<torch::Tensor, torch::Tensor>>
-            full_output;
-        if (_lstm_continuation && _rnn_has_memories[opname_v])
+        ExecStep step;
+        step.v = v;
+        step.name = opname(v);
+        step.type = optype(v);
+        for (graph::Vertex vi : this->inputs(v))
+          step.inputs.push_back(_slot_index.at(varname(vi)));
+        for (graph::Vertex vo : this->outputs(v))
+          step.outputs.push_back(_slot_index.at(varname(vo)));
+
+        auto m = _modules.find(step.name);
+        if (m != _modules.end())
+          step.module = m->second;
+
+        if (step.type == "LSTM")
           {
-            full_output
-                = _modules[opname_v]
-                      .forward<std::tuple<Tensor, std::tuple<Tensor, Tensor>>>(
-                          inputsTensor[0],
-                          torch::optional<
-                              std::tuple<torch::Tensor, torch::Tensor>>(
-                              _rnn_memories[opname_v]));
+            step.run = &TorchGraphBackend::forward_lstm;
+            step.rnn_memory = &_rnn_memories[step.name];
+            step.rnn_has_memory = &_rnn_has_memories[step.name];
           }
+        else if (step.type == "InnerProduct" || step.type == "ReLU")
+          step.run = &TorchGraphBackend::forward_module;
+        else if (step.type == "Tile")
+          step.run = &TorchGraphBackend::forward_tile;
         else
-          full_output
-              = _modules[opname_v]
-                    .forward<std::tuple<Tensor, std::tuple<Tensor, Tensor>>>(
-                        inputsTensor[0]);
-        _autoencoder_timesteps = std::get<0>(full_output).size(1);
-        output.push_back(std::get<0>(full_output)); // all outputs
-        output.push_back(
-            std::get<0>(std::get<1>(full_output))); // last hidden value
-        output.push_back(
-            std::get<1>(std::get<1>(full_output))); // last memory / c  value
-        if (_lstm_continuation)
-          {
-            _rnn_memories[opname_v] = std::get<1>(full_output);
-            _rnn_has_memories[opname_v] = true;
-          }
+          step.run = &TorchGraphBackend::forward_unsupported;
+        _plan.push_back(step);
       }
-    else if (optype == "InnerProduct")
-      output.push_back(_modules[opname_v].forward(inputsTensor[0]));
-    else if (optype == "ReLU")
-      output.push_back(_modules[opname_v].forward(inputsTensor[0]));
-    else if (optype == "Tile")
+
+    // liveness: release each tensor after its last consumer, or right after
+    // its producer if it is never consumed. Output tensor is never released.
+    std::vector<int> last_use(_slots.size(), -1);
+    for (size_t i = 0; i < _plan.size(); ++i)
       {
-        torch::Tensor x = inputsTensor[0];
-        std::vector<long int> rssizes = x.sizes().vec();
-        rssizes.erase(rssizes.begin()); // remove first dim because it is
-        // 1 : num_layers * num_directions
-        rssizes.insert(rssizes.begin() + _graph[v].axis, 1L);
-        torch::Tensor y = x.reshape(rssizes);
-        std::vector<long int> tiless(rssizes.size(), 1);
-        if (_graph[v].outputsdims[0][_graph[v].axis]
-            < 0) // to be autodetermined : autoencoder LSTM case only for now
-          tiless[_graph[v].axis] = _autoencoder_timesteps;
-        else
-          tiless[_graph[v].axis] = _graph[v].outputsdims[0][_graph[v].axis];
-        output.push_back(y.repeat(tiless));
+        for (int o : _plan[i].outputs)
+          last_use[o] = std::max(last_use[o], static_cast<int>(i));
+        for (int in : _plan[i].inputs)
+          last_use[in] = static_cast<int>(i);
       }
-    else
-      throw TorchGraphException("unknown optype " + optype + " for operator "
-                                + opname_v);
-    return output;
+    for (size_t s = 0; s < last_use.size(); ++s)
+      if (last_use[s] >= 0 && static_cast<int>(s) != _output_slot)
+        _plan[last_use[s]].releases.push_back(s);
+
+    _plan_compiled = true;
   }
 
   void TorchGraphBackend::allocate_modules()
@@ -273,6 +334,9 @@ namespace dd
           }
       }
     to(_device, _dtype);
+    if (_allocation_done || !_plan_compiled
+        || _plan.size() != _sortedOps.size())
+      compile_plan();
   }
 
   void TorchGraphBackend::to(torch::Device device, torch::Dtype dtype,
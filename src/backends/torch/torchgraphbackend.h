@@ -200,17 +200,61 @@ namespace dd
      */
     void allocate_modules();
 
+    /**
+     * \brief step of the compiled execution plan: operator with pre-resolved
+     * module, forward function and tensor slots
+     */
+    struct ExecStep
+    {
+      graph::Vertex v;  /**< operator vertex */
+      std::string name; /**< operator name */
+      std::string type; /**< operator type */
+      void (TorchGraphBackend::*run)(ExecStep &); /**< forward function */
+      torch::nn::AnyModule module; /**< torch module, if any */
+      std::vector<int> inputs;     /**< slots of input tensors */
+      std::vector<int> outputs;    /**< slots of output tensors */
+      std::vector<int> releases;   /**< slots whose last use is this step */
+      std::tuple<torch::Tensor, torch::Tensor> *rnn_memory
+          = nullptr; /**< previous hidden state, lstm only */
+      bool *rnn_has_memory = nullptr; /**< true if rnn_memory is set */
+    };
+
     std::unordered_map<std::string, torch::nn::AnyModule>
         _modules; /**< torch modules, per name/id */
-    std::unordered_map<std::string, torch::Tensor>
-        _variables; /**< torch intermediate tensors / blobs  */
+
+    std::vector<ExecStep> _plan; /**< compiled execution plan, sorted */
+    std::vector<torch::Tensor>
+        _slots; /**< torch intermediate tensors / blobs, one slot per data
+                   vertex, released after their last consumer */
+    std::unordered_map<std::string, int>
+        _slot_index;       /**< slot of data vertex, per name */
+    int _input_slot = -1;  /**< slot of the input tensor */
+    int _output_slot = -1; /**< slot of the output tensor */
+    bool _plan_compiled
+        = false; /**< true if plan matches currently allocated modules */
+
+    /**
+     * \brief compile sorted operators into the flat execution plan: resolve
+     * modules and forward functions, number data vertices and compute their
+     * last use
+     */
+    void compile_plan();
+
+    /**
+     * \brief run plan steps until some slot is computed
+     * @param stop_slot slot to stop at, -1 to run the whole plan
+     * @return true if stop_slot was computed
+     */
+    bool run_plan(int stop_slot = -1);
 
     /**
-     * \brief internal forward on basegraph
-     * @param v vertex to forward
-     * @return all outpurs
+     * \brief operator forward functions, read inputs from and write outputs
+     * to step slots
      */
-    std::vector<torch::Tensor> forward(graph::Vertex v);
+    void forward_lstm(ExecStep &step);
+    void forward_module(ExecStep &step);
+    void forward_tile(ExecStep &step);
+    void forward_unsupported(ExecStep &step);
 
     /**
      * \brief internal set tensor input , used by forward
@@ -24,6 +24,7 @@
 
 #include "utils/utils.hpp"
 #include "utils/oatpp.hpp"
+#include <numeric>
 
 namespace dd
 {
@@ -367,9 +368,7 @@ namespace dd
                   }
 
                 // Read data
-                for (const std::pair<std::string, int> &lfile : lfiles)
-                  _dataset.add_image_file(lfile.first, lfile.second, _height,
-                                          _width);
+                _dataset.add_image_files(lfiles, _height, _width);
 
                 if (!_db)
                   // in case of db, test sets are already allocated in
@@ -399,10 +398,8 @@ namespace dd
                   }
 
                 for (size_t i = 0; i < tests_lfiles.size(); ++i)
-                  for (const std::pair<std::string, int> &lfile :
-                       tests_lfiles[i])
-                    _test_datasets[i].add_image_file(lfile.first, lfile.second,
-                                                     _height, _width);
+                  _test_datasets[i].add_image_files(tests_lfiles[i], _height,
+                                                    _width);
 
                 // Write corresp file
                 std::ofstream correspf(_model_repo + "/" + _correspname,
@@ -710,11 +707,12 @@ namespace dd
 
   // ===== TxtTorchInputFileConn
 
-  void TxtTorchInputFileConn::parse_content(const std::string &content,
-                                            const float &target, int test_id)
+  void TxtTorchInputFileConn::add_document(TxtDoc &doc,
+                                           std::vector<uint32_t> &terms,
+                                           int test_id)
   {
     _ndbed = 0;
-    TxtInputFileConn::parse_content(content, target, test_id);
+    TxtInputFileConn::add_document(doc, terms, test_id);
     if (_db)
       push_to_db(test_id);
   }
@@ -895,8 +893,7 @@ namespace dd
       {
         TxtOrderedWordsEntry *tow = static_cast<TxtOrderedWordsEntry *>(te);
         tow->reset();
-        std::string word;
-        double val;
+        int word_id = -1;
         std::vector<int64_t> ids;
 
         while (tow->has_elt())
@@ -904,12 +901,11 @@ namespace dd
             if (ids.size() >= _width)
               break;
 
-            tow->get_next_elt(word, val);
-            std::unordered_map<std::string, Word>::iterator it;
+            tow->get_next_elt(word_id);
 
-            if ((it = _vocab.find(word)) != _vocab.end())
+            if (word_id >= 0)
               {
-                ids.push_back(it->second._pos);
+                ids.push_back(word_id);
               }
             else if (_input_format == "bert")
               {
@@ -921,11 +917,10 @@ namespace dd
         int64_t last_token = 0;
         if (tow->has_elt())
           {
-            tow->get_next_elt(word, val);
-            std::unordered_map<std::string, Word>::iterator it;
+            tow->get_next_elt(word_id);
 
-            if ((it = _vocab.find(word)) != _vocab.end())
-              last_token = it->second._pos;
+            if (word_id >= 0)
+              last_token = word_id;
           }
 
         // Post-processing for each model
@@ -1192,46 +1187,47 @@ namespace dd
       }
   }
 
+  at::Tensor
+  CSVTSTorchInputFileConn::series_to_tensor(const std::vector<CSVline> &seq,
+                                            const std::vector<int> &cols)
+  {
+    at::Tensor series
+        = torch::empty({ static_cast<long int>(seq.size()),
+                         static_cast<long int>(cols.size()) },
+                       torch::kFloat32);
+    float *dst = series.data_ptr<float>();
+    for (const CSVline &line : seq)
+      for (int c : cols)
+        *dst++ = static_cast<float>(line._v[c]);
+    return series;
+  }
+
+  at::Tensor CSVTSTorchInputFileConn::series_window(
+      const at::Tensor &series, const TorchDataset &dataset,
+      const long int tstart, const long int len)
+  {
+    at::Tensor window = series.narrow(0, tstart, len);
+    // in memory windows share the series storage, db records need their own
+    return dataset._db ? window.clone() : window;
+  }
+
   void CSVTSTorchInputFileConn::add_data_instance_forecast(
       const unsigned long int tstart, const int vecindex,
-      TorchDataset &dataset, const std::vector<CSVline> &seq)
+      TorchDataset &dataset, const at::Tensor &series)
   {
-    std::vector<at::Tensor> data_sequence;
     if (_fnames.size() > static_cast<unsigned int>(vecindex))
       _ids.push_back(_fnames[vecindex] + " #" + std::to_string(tstart) + "_"
                      + std::to_string(tstart + _forecast_timesteps
                                       + _backcast_timesteps - 1));
-    for (size_t ti = tstart; ti < tstart + _backcast_timesteps; ++ti)
-      {
-        std::vector<double> datavec;
-        for (int di = 0; di < this->_datadim; ++di)
-          datavec.push_back(seq[ti]._v[di]);
-        at::Tensor data
-            = torch::from_blob(&datavec[0], at::IntList{ _datadim },
-                               torch::kFloat64)
-                  .clone()
-                  .to(torch::kFloat32);
-        data_sequence.push_back(data);
-      }
-    at::Tensor dst = torch::stack(data_sequence);
+    at::Tensor dst
+        = series_window(series, dataset, tstart, _backcast_timesteps);
 
-    if (seq.size() >= _backcast_timesteps + _forecast_timesteps + tstart)
+    if (static_cast<unsigned long int>(series.size(0))
+        >= _backcast_timesteps + _forecast_timesteps + tstart)
       {
-        std::vector<at::Tensor> pred_sequence;
-        for (size_t ti = tstart + _backcast_timesteps;
-             ti < tstart + _backcast_timesteps + _forecast_timesteps; ++ti)
-          {
-            std::vector<double> predvec;
-            for (int di = 0; di < this->_datadim; ++di)
-              predvec.push_back(seq[ti]._v[di]);
-            at::Tensor pred
-                = torch::from_blob(&predvec[0], at::IntList{ _datadim },
-                                   torch::kFloat64)
-                      .clone()
-                      .to(torch::kFloat32);
-            pred_sequence.push_back(pred);
-          }
-        at::Tensor pst = torch::stack(pred_sequence);
+        at::Tensor pst
+            = series_window(series, dataset, tstart + _backcast_timesteps,
+                            _forecast_timesteps);
         dataset.add_batch({ dst }, { pst });
       }
     else // we are in inference mode, not forecast available
@@ -1277,6 +1273,8 @@ namespace dd
       int test_id)
   {
     int vecindex = -1;
+    std::vector<int> cols(_datadim);
+    std::iota(cols.begin(), cols.end(), 0);
 
     for (const std::vector<CSVline> &seq : data)
       {
@@ -1293,78 +1291,30 @@ namespace dd
           {
             _tilogger->info("Add sequence of size {}", seq.size());
           }
+        // series is stored once, instances are windows over it
+        at::Tensor series = series_to_tensor(seq, cols);
         for (; tstart + timesteps < static_cast<long int>(seq.size());
              tstart += _offset)
           {
-            add_data_instance_forecast(tstart, vecindex, dataset, seq);
+            add_data_instance_forecast(tstart, vecindex, dataset, series);
           }
         if (tstart < static_cast<long int>(seq.size()) - 1)
           add_data_instance_forecast(seq.size() - timesteps, vecindex, dataset,
-                                     seq);
+                                     series);
       }
   }
 
-  void
-  CSVTSTorchInputFileConn::add_seq(const size_t ti,
-                                   const std::vector<CSVline> &seq,
-                                   std::vector<at::Tensor> &data_sequence,
-                                   std::vector<at::Tensor> &label_sequence)
-  {
-    std::vector<double> datavec;
-    std::vector<double> labelvec;
-    size_t label_size = _label_pos.size();
-    size_t data_size = _datadim - label_size;
-
-    for (size_t li = 0; li < label_size; ++li)
-      labelvec.push_back(seq[ti]._v[_label_pos[li]]);
-    for (int di = 0; di < this->_datadim; ++di)
-      if (std::find(_label_pos.begin(), _label_pos.end(), di)
-          == _label_pos.end())
-        datavec.push_back(seq[ti]._v[di]);
-
-    at::Tensor data
-        = torch::from_blob(&datavec[0],
-                           at::IntList{ static_cast<long int>(data_size) },
-                           torch::kFloat64)
-              .clone()
-              .to(torch::kFloat32);
-    at::Tensor label
-        = torch::from_blob(&labelvec[0],
-                           at::IntList{ static_cast<long int>(label_size) },
-                           torch::kFloat64)
-              .clone()
-              .to(torch::kFloat32);
-    data_sequence.push_back(data);
-    label_sequence.push_back(label);
-  }
-
   void CSVTSTorchInputFileConn::add_data_instance_labels(
       const unsigned long int tstart, const int vecindex,
-      TorchDataset &dataset, const std::vector<CSVline> &seq,
-      const size_t seq_len)
+      TorchDataset &dataset, const at::Tensor &data_series,
+      const at::Tensor &label_series, const size_t seq_len)
   {
-    unsigned int label_size = _label_pos.size();
-    if (static_cast<int>(label_size) >= _datadim)
-      {
-        std::string errmsg
-            = "label_size (output dim) " + std::to_string(label_size)
-              + " is larger than datadim " + std::to_string(_datadim)
-              + " leading to invalid input dim";
-        this->_logger->error(errmsg);
-        throw InputConnectorBadParamException(errmsg);
-      }
-    std::vector<at::Tensor> data_sequence;
-    std::vector<at::Tensor> label_sequence;
     if (_fnames.size() > static_cast<unsigned int>(vecindex))
       _ids.push_back(_fnames[vecindex] + " #" + std::to_string(tstart) + "_"
                      + std::to_string(tstart + seq_len - 1));
 
-    for (size_t ti = tstart;
-         ti < static_cast<unsigned long int>(tstart + seq_len); ++ti)
-      add_seq(ti, seq, data_sequence, label_sequence);
-
-    at::Tensor dst = torch::stack(data_sequence);
-    at::Tensor lst = torch::stack(label_sequence);
+    at::Tensor dst = series_window(data_series, dataset, tstart, seq_len);
+    at::Tensor lst = series_window(label_series, dataset, tstart, seq_len);
     dataset.add_batch({ dst }, { lst });
   }
 
@@ -1373,34 +1323,53 @@ namespace dd
       int test_id)
   {
     int vecindex = -1;
+    if (data.empty())
+      return;
 
-    if (_train)
+    unsigned int label_size = _label_pos.size();
+    if (static_cast<int>(label_size) >= _datadim)
       {
-        for (const std::vector<CSVline> &seq : data)
+        std::string errmsg
+            = "label_size (output dim) " + std::to_string(label_size)
+              + " is larger than datadim " + std::to_string(_datadim)
+              + " leading to invalid input dim";
+        this->_logger->error(errmsg);
+        throw InputConnectorBadParamException(errmsg);
+      }
+    std::vector<int> data_cols;
+    for (int di = 0; di < _datadim; ++di)
+      if (std::find(_label_pos.begin(), _label_pos.end(), di)
+          == _label_pos.end())
+        data_cols.push_back(di);
+
+    for (const std::vector<CSVline> &seq : data)
+      {
+        vecindex++;
+        long int tstart = 0;
+        if (_train && static_cast<long int>(seq.size()) < _timesteps)
           {
-            vecindex++;
-            long int tstart = 0;
-            if (static_cast<long int>(seq.size()) < _timesteps)
-              {
-                discard_warn(vecindex, seq.size(), test_id);
-                continue;
-              }
-            for (; tstart + _timesteps < static_cast<long int>(seq.size());
-                 tstart += _offset)
-              add_data_instance_labels(tstart, vecindex, dataset, seq,
-                                       static_cast<unsigned int>(_timesteps));
-            if (tstart < static_cast<long int>(seq.size()) - 1)
-              add_data_instance_labels(seq.size() - _timesteps, vecindex,
-                                       dataset, seq,
-                                       static_cast<unsigned int>(_timesteps));
+            discard_warn(vecindex, seq.size(), test_id);
+            continue;
+          }
+        // series are stored once, instances are windows over them
+        at::Tensor data_series = series_to_tensor(seq, data_cols);
+        at::Tensor label_series = series_to_tensor(seq, _label_pos);
+        if (!_train) // do not split
+          {
+            add_data_instance_labels(0, vecindex, dataset, data_series,
+                                     label_series, seq.size());
+            continue;
           }
+        for (; tstart + _timesteps < static_cast<long int>(seq.size());
+             tstart += _offset)
+          add_data_instance_labels(tstart, vecindex, dataset, data_series,
+                                   label_series,
+                                   static_cast<unsigned int>(_timesteps));
+        if (tstart < static_cast<long int>(seq.size()) - 1)
+          add_data_instance_labels(seq.size() - _timesteps, vecindex, dataset,
+                                   data_series, label_series,
+                                   static_cast<unsigned int>(_timesteps));
       }
-    else // do not split
-      for (const std::vector<CSVline> &seq : data)
-        {
-          vecindex++;
-          add_data_instance_labels(0, vecindex, dataset, seq, seq.size());
-        }
   }
 
   void CSVTSTorchInputFileConn::fill_dataset(
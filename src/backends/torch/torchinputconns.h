@@ -112,6 +112,18 @@ namespace dd
         _dataset.set_shuffle(ad_in.get("shuffle").get<bool>());
       if (ad_in.has("db"))
         _db = ad_in.get("db").get<bool>();
+      if (ad_in.has("db_workers"))
+        {
+          _dataset.set_db_workers(ad_in.get("db_workers").get<int>());
+          _test_datasets.set_db_workers(ad_in.get("db_workers").get<int>());
+        }
+      if (ad_in.has("db_format"))
+        {
+          _backend = ad_in.get("db_format").get<std::string>();
+          if (_backend != "lmdb" && _backend != "shards")
+            throw InputConnectorBadParamException("unknown db_format "
+                                                  + _backend);
+        }
       _dataset.set_db_params(_db, _backend, model_repo + "/train");
       _dataset.set_logger(logger);
       _test_datasets.set_db_params(_db, _backend, model_repo + "/test");
@@ -497,11 +509,11 @@ namespace dd
                       const std::vector<TxtEntry<double> *> &entries);
 
     /**
-     * \brief override txtinputconn parse content in order to put data in db on
+     * \brief override txtinputconn add document in order to put data in db on
      * the fly if needed
      */
-    void parse_content(const std::string &content, const float &target = -1,
-                       int test_id = -1) override;
+    void add_document(TxtDoc &doc, std::vector<uint32_t> &terms,
+                      int test_id) override;
 
   private:
     /**
@@ -732,18 +744,29 @@ namespace dd
                                int test_id);
     void add_data_instance_forecast(const unsigned long int tstart,
                                     const int vecindex, TorchDataset &dataset,
-                                    const std::vector<CSVline> &seq);
+                                    const at::Tensor &series);
     void fill_dataset_labels(TorchDataset &dataset,
                              const std::vector<std::vector<CSVline>> &data,
                              int test_id);
     void add_data_instance_labels(const unsigned long int tstart,
                                   const int vecindex, TorchDataset &dataset,
-                                  const std::vector<CSVline> &seq,
-                                  size_t seq_len);
+                                  const at::Tensor &data_series,
+                                  const at::Tensor &label_series,
+                                  const size_t seq_len);
 
-    void add_seq(const size_t ti, const std::vector<CSVline> &seq,
-                 std::vector<at::Tensor> &data_sequence,
-                 std::vector<at::Tensor> &label_sequence);
+    /**
+     * \brief contiguous [timesteps x cols] float tensor of a series
+     */
+    at::Tensor series_to_tensor(const std::vector<CSVline> &seq,
+                                const std::vector<int> &cols);
+
+    /**
+     * \brief len timesteps from tstart, as a view of series unless the
+     * dataset is a db
+     */
+    at::Tensor series_window(const at::Tensor &series,
+                             const TorchDataset &dataset,
+                             const long int tstart, const long int len);
 
     void discard_warn(int vecindex, unsigned int seq_size, int test_id);
 
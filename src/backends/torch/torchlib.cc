@@ -212,6 +212,7 @@ namespace dd
     std::string self_supervised = mllib_dto->self_supervised;
     int embedding_size = mllib_dto->embedding_size;
     bool freeze_traced = mllib_dto->freeze_traced;
+    bool prepared_cache = mllib_dto->prepared_cache;
     _finetuning = mllib_dto->finetuning;
     _loss = mllib_dto->loss;
 
@@ -226,7 +227,9 @@ namespace dd
       _template_params.add("timesteps",
                            static_cast<int>(mllib_dto->timesteps));
 
-    std::string dt = mllib_dto->datatype;
+    std::string dt = mllib_dto->datatype == nullptr
+                         ? std::string("fp32")
+                         : std::string(mllib_dto->datatype);
     if (dt == "fp32")
       {
         _dtype = torch::kFloat32;
@@ -488,6 +491,13 @@ namespace dd
     // Load weights
     _module.load(this->_mlmodel);
     _module.freeze_traced(freeze_traced);
+    if (prepared_cache)
+      {
+        if (_finetuning || _devices.size() > 1)
+          throw MLLibBadParamException(
+              "prepared_cache is for single device inference only");
+        _module.prepare_traced(this->_mlmodel);
+      }
 
     _best_metrics = { "map", "meaniou",  "mlacc", "delta_score_0.1", "bacc",
                       "f1",  "net_meas", "acc",   "L1_mean_error",   "eucll" };
@@ -500,7 +510,7 @@ namespace dd
                 TMLModel>::clear_mllib(__attribute__((unused))
                                        const APIData &ad)
   {
-    std::vector<std::string> extensions{ ".json", ".pt", ".ptw" };
+    std::vector<std::string> extensions{ ".json", ".pt", ".ptw", ".ptp" };
     fileops::remove_directory_files(this->_mlmodel._repo, extensions);
     this->_logger->info("Torchlib service cleared");
   }
@@ -521,7 +531,10 @@ namespace dd
             class TMLModel>
   void TorchLib<TInputConnectorStrategy, TOutputConnectorStrategy, TMLModel>::
       save_if_best(APIData &ad_out, int64_t elapsed_it, TorchSolver &tsolver,
-                   std::vector<int64_t> &best_iteration_numbers)
+                   std::vector<int64_t> &best_iteration_numbers,
+                   const std::deque<int64_t> &regular_snapshots,
+                   TorchModule *tested_module,
+                   const std::string *tested_solver_state)
   {
     for (size_t i = 0; i < best_iteration_numbers.size(); ++i)
       {
@@ -554,12 +567,20 @@ namespace dd
           {
             if (best_iteration_numbers[i] != -1
                 && dd_utils::unique(best_iteration_numbers[i],
-                                    best_iteration_numbers))
+                                    best_iteration_numbers)
+                && std::find(regular_snapshots.begin(),
+                             regular_snapshots.end(),
+                             best_iteration_numbers[i])
+                       == regular_snapshots.end())
               {
                 remove_model(best_iteration_numbers[i]);
               }
             _best_metric_values[i] = cur_meas;
-            this->snapshot(elapsed_it, tsolver);
+            if (tested_module && tested_solver_state)
+              this->snapshot(elapsed_it, *tested_module,
+                             *tested_solver_state);
+            else
+              this->snapshot(elapsed_it, tsolver);
             try
               {
                 std::ofstream bestfile;
@@ -603,18 +624,18 @@ namespace dd
                 TMLModel>::remove_model(int64_t elapsed_it)
   {
     this->_logger->info("Deleting superseeded model {} ", elapsed_it);
-    std::remove((this->_mlmodel._repo + "/solver-" + std::to_string(elapsed_it)
-                 + ".pt")
-                    .c_str());
-    std::remove((this->_mlmodel._repo + "/checkpoint-"
-                 + std::to_string(elapsed_it) + ".pt")
-                    .c_str());
-    std::remove((this->_mlmodel._repo + "/checkpoint-"
-                 + std::to_string(elapsed_it) + ".npt")
-                    .c_str());
-    std::remove((this->_mlmodel._repo + "/checkpoint-"
-                 + std::to_string(elapsed_it) + ".ptw")
-                    .c_str());
+    std::string checkpoint
+        = this->_mlmodel._repo + "/checkpoint-" + std::to_string(elapsed_it);
+    std::vector<std::string> files
+        = { this->_mlmodel._repo + "/solver-" + std::to_string(elapsed_it)
+                + ".pt",
+            checkpoint + ".pt", checkpoint + ".npt", checkpoint + ".ptw" };
+    // model may not be written yet
+    if (_snapshot_writer)
+      _snapshot_writer->remove(files);
+    else
+      for (const std::string &f : files)
+        std::remove(f.c_str());
   }
 
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy,
@@ -622,22 +643,53 @@ namespace dd
   void TorchLib<TInputConnectorStrategy, TOutputConnectorStrategy,
                 TMLModel>::snapshot(int64_t elapsed_it, TorchSolver &tsolver)
   {
-    this->_logger->info("Saving checkpoint after {} iterations", elapsed_it);
     // solver is allowed to modify net during eval()/train() => do this call
     // before saving net itself
     tsolver.eval();
-    this->_module.save_checkpoint(this->_mlmodel, std::to_string(elapsed_it));
-    tsolver.save(this->_mlmodel._repo + "/solver-" + std::to_string(elapsed_it)
-                 + ".pt");
+    std::ostringstream solver_state;
+    tsolver.save(solver_state);
+    snapshot(elapsed_it, this->_module, solver_state.str());
     tsolver.train();
   }
 
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy,
+            class TMLModel>
+  void TorchLib<TInputConnectorStrategy, TOutputConnectorStrategy,
+                TMLModel>::snapshot(int64_t elapsed_it, TorchModule &module,
+                                    const std::string &solver_state)
+  {
+    this->_logger->info("Saving checkpoint after {} iterations", elapsed_it);
+    std::string solver_file = this->_mlmodel._repo + "/solver-"
+                              + std::to_string(elapsed_it) + ".pt";
+    if (_snapshot_writer)
+      {
+        // copy states to memory, files are written in the background
+        TorchSnapshotWriter::SnapshotFiles files;
+        module.save_checkpoint(this->_mlmodel, std::to_string(elapsed_it),
+                               files);
+        files.emplace_back(solver_file, solver_state);
+        _snapshot_writer->write(std::move(files));
+      }
+    else
+      {
+        module.save_checkpoint(this->_mlmodel, std::to_string(elapsed_it));
+        std::ofstream out(solver_file, std::ios::out | std::ios::binary);
+        out.write(solver_state.data(), solver_state.size());
+        out.close();
+        if (!out)
+          throw MLLibInternalException("could not write " + solver_file);
+      }
+  }
+
   template <class TInputConnectorStrategy, class TOutputConnectorStrategy,
             class TMLModel>
   int TorchLib<TInputConnectorStrategy, TOutputConnectorStrategy,
                TMLModel>::train(const APIData &ad, APIData &out)
   {
     using namespace std::chrono;
+    if (_module._prepared)
+      throw MLLibBadParamException(
+          "cannot train a model prepared for inference (prepared_cache)");
     this->_tjob_running.store(true);
 
     TInputConnectorStrategy inputc(this->_inputc);
@@ -794,6 +846,9 @@ namespace dd
     int64_t iter_size = 1;
     int64_t test_interval = 1;
     int64_t save_period = 0;
+    bool snapshot_async = false;
+    int64_t snapshot_max_pending = 2;
+    int64_t snapshot_retain = 0;
 
     // loss specific to the model
     if (_module.has_model_loss())
@@ -824,12 +879,35 @@ namespace dd
           iter_size = ad_solver.get("iter_size").get<int>();
         if (ad_solver.has("snapshot"))
           save_period = ad_solver.get("snapshot").get<int>();
-      }
+        if (ad_solver.has("snapshot_async"))
+          snapshot_async = ad_solver.get("snapshot_async").get<bool>();
+        if (ad_solver.has("snapshot_max_pending"))
+          snapshot_max_pending
+              = ad_solver.get("snapshot_max_pending").get<int>();
+        if (ad_solver.has("snapshot_retain"))
+          snapshot_retain = ad_solver.get("snapshot_retain").get<int>();
+      }
+
+    if (snapshot_async)
+      _snapshot_writer.reset(
+          new TorchSnapshotWriter(this->_logger, snapshot_max_pending));
+    else
+      _snapshot_writer.reset();
 
     bool retain_graph = ad_mllib.has("retain_graph")
                             ? ad_mllib.get("retain_graph").get<bool>()
                             : false;
 
+    bool test_async = ad_mllib.has("test_async")
+                          ? ad_mllib.get("test_async").get<bool>()
+                          : false;
+    if (test_async && (_masked_lm || _module._graph))
+      {
+        this->_logger->warn("asynchronous test is not supported with masked "
+                            "lm or graph models, testing synchronously");
+        test_async = false;
+      }
+
     if (iter_size <= 0)
       iter_size = 1;
 
@@ -911,6 +989,7 @@ namespace dd
     std::unordered_map<std::string, double> sub_losses;
     double loss_divider = iter_size * gpu_count;
     auto data_it = dataloader->begin();
+    std::deque<int64_t> regular_snapshots; // for snapshot_retain
 
     if (data_it == dataloader->end())
       {
@@ -922,6 +1001,141 @@ namespace dd
     if (std::isnan(prev_elapsed_time_ms))
       prev_elapsed_time_ms = 0;
 
+    // gather test measures, log them and save best model
+    auto report_test = [&](APIData &meas_out, int64_t test_it,
+                           const std::unordered_map<std::string, double>
+                               &test_sub_losses,
+                           TorchModule *tested_module,
+                           const std::string *tested_solver_state) {
+      APIData meas_obj = meas_out.getobj("measure");
+      for (const auto &e : test_sub_losses)
+        meas_obj.add(e.first, e.second);
+      meas_out.add("measure", meas_obj);
+
+      save_if_best(meas_out, test_it, tsolver, best_iteration_numbers,
+                   regular_snapshots, tested_module, tested_solver_state);
+
+      // print metrics
+      for (size_t i = 0; i < eval_dataset.size() + 1; ++i)
+        {
+          if (i == 0)
+            {
+              meas_obj = meas_out.getobj("measure");
+              this->_logger->info("measures over all test sets");
+            }
+          else
+            {
+              size_t test_id = i - 1;
+              meas_obj = meas_out.getv("measures")[test_id];
+              this->_logger->info("measures on test set "
+                                  + std::to_string(test_id) + " : "
+                                  + eval_dataset.name(test_id));
+            }
+
+          std::vector<std::string> meas_names = meas_obj.list_keys();
+          for (auto name : meas_names)
+            {
+              std::string metric_name;
+              if (i == 0)
+                metric_name = name;
+              else
+                metric_name = name + "_test" + std::to_string(i - 1);
+
+              if (name != "cmdiag" && name != "cmfull" && name != "clacc"
+                  && name != "cliou" && name != "labels" && name != "test_id"
+                  && name != "test_name")
+                {
+                  double mval = meas_obj.get(name).get<double>();
+                  this->_logger->info("{}={}", metric_name, mval);
+                  this->add_meas(metric_name, mval);
+                  this->add_meas_per_iter(metric_name, mval);
+                }
+              else if (name == "cmdiag" || name == "clacc" || name == "cliou")
+                {
+                  std::vector<double> mdiag
+                      = meas_obj.get(name).get<std::vector<double>>();
+                  std::vector<std::string> cnames;
+                  std::string mdiag_str;
+                  for (size_t j = 0; j < mdiag.size(); j++)
+                    {
+                      mdiag_str += this->_mlmodel.get_hcorresp(j) + ":"
+                                   + std::to_string(mdiag.at(j)) + " ";
+                      this->add_meas_per_iter(
+                          metric_name + '_' + this->_mlmodel.get_hcorresp(j),
+                          mdiag.at(j));
+                      cnames.push_back(this->_mlmodel.get_hcorresp(j));
+                    }
+                  this->_logger->info("{}=[{}]", metric_name, mdiag_str);
+                  this->add_meas(metric_name, mdiag, cnames);
+                }
+            }
+        }
+
+      if (test_it == iterations)
+        {
+          out.add("measure", meas_out.getobj("measure"));
+          out.add("measures", meas_out.getv("measures"));
+        }
+    };
+
+    // asynchronous test: a copy of the weights is tested on cpu in a
+    // separate thread while training goes on. At most one test is in flight.
+    struct
+    {
+      std::shared_ptr<TorchModule> module;
+      std::string solver_state; // solver state when the weights were copied
+      APIData meas_out;
+      int64_t elapsed_it = -1;
+      double train_loss = 0;
+      std::unordered_map<std::string, double> sub_losses;
+      std::future<void> job; // last member, joined first on destruction
+    } async_test;
+    torch::Device cpu("cpu");
+
+    auto wait_async_test = [&]() {
+      if (!async_test.job.valid())
+        return;
+      async_test.job.get(); // rethrows test errors, if any
+
+      // measures were computed while training went on, fix the iteration
+      // and train loss they refer to
+      APIData &meas_out = async_test.meas_out;
+      std::vector<APIData> measures = meas_out.getv("measures");
+      for (APIData &m : measures)
+        {
+          m.add("iteration", static_cast<double>(async_test.elapsed_it));
+          m.add("train_loss", async_test.train_loss);
+        }
+      meas_out.add("measures", measures);
+      APIData meas_obj = meas_out.getobj("measure");
+      meas_obj.add("iteration", static_cast<double>(async_test.elapsed_it));
+      meas_obj.add("train_loss", async_test.train_loss);
+      meas_out.add("measure", meas_obj);
+
+      this->_logger->info("Asynchronous test of iteration {} done",
+                          async_test.elapsed_it);
+      report_test(meas_out, async_test.elapsed_it, async_test.sub_losses,
+                  async_test.module.get(), &async_test.solver_state);
+      async_test.module.reset();
+      async_test.solver_state.clear();
+    };
+
+    // on the final and interrupt paths, a failed asynchronous test must not
+    // prevent the current model from being tested and saved
+    auto wait_async_test_nothrow = [&]() {
+      try
+        {
+          wait_async_test();
+        }
+      catch (std::exception &e)
+        {
+          this->_logger->error("Asynchronous test of iteration {} failed: {}",
+                               async_test.elapsed_it, e.what());
+          async_test.module.reset();
+          async_test.solver_state.clear();
+        }
+    };
+
     // `it` is the iteration count (not epoch)
     while (it < iterations)
       {
@@ -1171,94 +1385,72 @@ namespace dd
               }
             last_it_time = 0;
 
+            // report asynchronous test results as soon as they are ready
+            if (async_test.job.valid()
+                && async_test.job.wait_for(std::chrono::seconds(0))
+                       == std::future_status::ready)
+              wait_async_test();
+
             if ((elapsed_it % test_interval == 0 && eval_dataset.size() != 0)
                 || elapsed_it == iterations)
               {
-                APIData meas_out;
-                this->_logger->info("Start test");
-                tstart = steady_clock::now();
-                tsolver.eval();
-                test(ad, inputc, eval_dataset, test_batch_size, meas_out);
-                tsolver.train();
-                last_test_time
-                    = duration_cast<milliseconds>(steady_clock::now() - tstart)
-                          .count();
-
-                APIData meas_obj = meas_out.getobj("measure");
-                for (const auto &e : sub_losses)
-                  meas_obj.add(e.first, e.second);
-                meas_out.add("measure", meas_obj);
-
-                save_if_best(meas_out, elapsed_it, tsolver,
-                             best_iteration_numbers);
-
-                // print metrics
-                for (size_t i = 0; i < eval_dataset.size() + 1; ++i)
+                if (async_test.job.valid())
                   {
-                    if (i == 0)
-                      {
-                        meas_obj = meas_out.getobj("measure");
-                        this->_logger->info("measures over all test sets");
-                      }
+                    this->_logger->info("Waiting for previous test to finish");
+                    if (elapsed_it == iterations)
+                      wait_async_test_nothrow();
                     else
-                      {
-                        size_t test_id = i - 1;
-                        meas_obj = meas_out.getv("measures")[test_id];
-                        this->_logger->info("measures on test set "
-                                            + std::to_string(test_id) + " : "
-                                            + eval_dataset.name(test_id));
-                      }
-
-                    std::vector<std::string> meas_names = meas_obj.list_keys();
-                    for (auto name : meas_names)
-                      {
-                        std::string metric_name;
-                        if (i == 0)
-                          metric_name = name;
-                        else
-                          metric_name = name + "_test" + std::to_string(i - 1);
-
-                        if (name != "cmdiag" && name != "cmfull"
-                            && name != "clacc" && name != "cliou"
-                            && name != "labels" && name != "test_id"
-                            && name != "test_name")
-                          {
-                            double mval = meas_obj.get(name).get<double>();
-                            this->_logger->info("{}={}", metric_name, mval);
-                            this->add_meas(metric_name, mval);
-                            this->add_meas_per_iter(metric_name, mval);
-                          }
-                        else if (name == "cmdiag" || name == "clacc"
-                                 || name == "cliou")
-                          {
-                            std::vector<double> mdiag
-                                = meas_obj.get(name)
-                                      .get<std::vector<double>>();
-                            std::vector<std::string> cnames;
-                            std::string mdiag_str;
-                            for (size_t j = 0; j < mdiag.size(); j++)
-                              {
-                                mdiag_str
-                                    += this->_mlmodel.get_hcorresp(j) + ":"
-                                       + std::to_string(mdiag.at(j)) + " ";
-                                this->add_meas_per_iter(
-                                    metric_name + '_'
-                                        + this->_mlmodel.get_hcorresp(j),
-                                    mdiag.at(j));
-                                cnames.push_back(
-                                    this->_mlmodel.get_hcorresp(j));
-                              }
-                            this->_logger->info("{}=[{}]", metric_name,
-                                                mdiag_str);
-                            this->add_meas(metric_name, mdiag, cnames);
-                          }
-                      }
+                      wait_async_test();
                   }
 
-                if (elapsed_it == iterations)
+                // last test is synchronous so that final measures are
+                // returned
+                if (test_async && elapsed_it != iterations)
+                  {
+                    this->_logger->info("Start asynchronous test");
+                    tstart = steady_clock::now();
+                    tsolver.eval();
+                    async_test.module = _module.clone(cpu);
+                    // a snapshot of the tested weights, if best, goes with
+                    // the solver state of the same iteration
+                    std::ostringstream solver_state;
+                    tsolver.save(solver_state);
+                    async_test.solver_state = solver_state.str();
+                    tsolver.train();
+                    async_test.meas_out = APIData();
+                    async_test.elapsed_it = elapsed_it;
+                    async_test.train_loss = train_loss;
+                    async_test.sub_losses = sub_losses;
+
+                    TorchModule *test_module = async_test.module.get();
+                    APIData *test_out = &async_test.meas_out;
+                    async_test.job = std::async(
+                        std::launch::async,
+                        [this, &ad, &inputc, &eval_dataset, test_batch_size,
+                         test_module, test_out, cpu]() {
+                          torch::NoGradGuard no_grad;
+                          test(ad, inputc, eval_dataset, test_batch_size,
+                               *test_out, *test_module, cpu);
+                        });
+                    last_test_time
+                        = duration_cast<milliseconds>(steady_clock::now()
+                                                      - tstart)
+                              .count();
+                  }
+                else
                   {
-                    out.add("measure", meas_out.getobj("measure"));
-                    out.add("measures", meas_out.getv("measures"));
+                    APIData meas_out;
+                    this->_logger->info("Start test");
+                    tstart = steady_clock::now();
+                    tsolver.eval();
+                    test(ad, inputc, eval_dataset, test_batch_size, meas_out);
+                    tsolver.train();
+                    last_test_time
+                        = duration_cast<milliseconds>(steady_clock::now()
+                                                      - tstart)
+                              .count();
+                    report_test(meas_out, elapsed_it, sub_losses, nullptr,
+                                nullptr);
                   }
               }
 
@@ -1268,22 +1460,26 @@ namespace dd
             if ((save_period != 0 && elapsed_it % save_period == 0)
                 || elapsed_it == iterations)
               {
-                bool snapshotted = false;
-                for (size_t i = 0; i < best_iteration_numbers.size(); ++i)
-                  {
-
-                    if (best_iteration_numbers[i] == elapsed_it)
-                      // current model already snapshoted as best model,
-                      // do not remove regular snapshot if it is  best
-                      // model
-                      {
-                        best_iteration_numbers[i] = -1;
-                        snapshotted = true;
-                      }
-                  }
-                if (!snapshotted)
+                // current model may already be snapshotted as best model,
+                // it is then also tracked as a regular snapshot, and removed
+                // once neither retained nor best
+                if (std::find(best_iteration_numbers.begin(),
+                              best_iteration_numbers.end(), elapsed_it)
+                    == best_iteration_numbers.end())
+                  snapshot(elapsed_it, tsolver);
+                regular_snapshots.push_back(elapsed_it);
+
+                // remove oldest regular snapshots, except best models
+                while (snapshot_retain > 0
+                       && static_cast<int64_t>(regular_snapshots.size())
+                              > snapshot_retain)
                   {
-                    snapshot(elapsed_it, tsolver);
+                    int64_t old_it = regular_snapshots.front();
+                    regular_snapshots.pop_front();
+                    if (std::find(best_iteration_numbers.begin(),
+                                  best_iteration_numbers.end(), old_it)
+                        == best_iteration_numbers.end())
+                      remove_model(old_it);
                   }
               }
             ++it;
@@ -1300,25 +1496,28 @@ namespace dd
         int64_t elapsed_it = it + 1;
         this->_logger->info("Training job interrupted at iteration {}",
                             elapsed_it);
-        bool snapshotted = false;
-        for (size_t i = 0; i < best_iteration_numbers.size(); ++i)
+        wait_async_test_nothrow();
+        // current model may already be snapshotted as best model
+        if (std::find(best_iteration_numbers.begin(),
+                      best_iteration_numbers.end(), elapsed_it)
+            == best_iteration_numbers.end())
+          snapshot(elapsed_it, tsolver);
+        if (_snapshot_writer)
           {
-
-            if (best_iteration_numbers[i] == elapsed_it)
-              // current model already snapshoted as best model,
-              // do not remove regular snapshot if it is  best
-              // model
-              {
-                best_iteration_numbers[i] = -1;
-                snapshotted = true;
-              }
+            _snapshot_writer->flush();
+            _snapshot_writer.reset();
           }
-        if (!snapshotted)
-          snapshot(elapsed_it, tsolver);
         torch_utils::empty_cuda_cache();
         return -1;
       }
 
+    if (_snapshot_writer)
+      {
+        this->_logger->info("Waiting for snapshots to be written");
+        _snapshot_writer->flush();
+        _snapshot_writer.reset();
+      }
+
     if (skip_training)
       test(ad, inputc, inputc._test_datasets, test_batch_size, out);
     torch_utils::empty_cuda_cache();
@@ -1382,8 +1581,13 @@ namespace dd
       extract_last = true;
     std::string forward_method = mllib_params->forward_method;
 
-    std::string dt = mllib_params->datatype;
-    if (dt == "fp32")
+    // a prepared model keeps the datatype it was built with by default
+    std::string dt;
+    if (mllib_params->datatype != nullptr)
+      dt = mllib_params->datatype;
+    if (dt.empty() && _module._prepared)
+      _dtype = _module._dtype;
+    else if (dt.empty() || dt == "fp32")
       _dtype = torch::kFloat32;
     else if (dt == "fp16")
       {
@@ -1396,6 +1600,15 @@ namespace dd
       _dtype = torch::kFloat64;
     else
       throw MLLibBadParamException("unknown datatype " + dt);
+    if (_module._prepared)
+      {
+        if (_dtype != _module._dtype)
+          throw MLLibBadParamException(
+              "datatype must match the one the model was prepared with");
+        if (!extract_layer.empty() || !forward_method.empty())
+          throw MLLibBadParamException(
+              "only forward is available on a prepared model");
+      }
 
     bool bbox = output_params->bbox;
     bool ctc = output_params->ctc;
@@ -1712,8 +1925,11 @@ namespace dd
               }
             else if (_classification)
               {
+                // partial selection when only the best classes are needed
                 std::tuple<Tensor, Tensor> sorted_output
-                    = output.sort(1, true);
+                    = best_count < output.size(1)
+                          ? output.topk(best_count, 1, true, true)
+                          : output.sort(1, true);
                 Tensor probsf = std::get<0>(sorted_output).to(torch::kFloat);
                 auto probs_acc = probsf.accessor<float, 2>();
                 auto indices_acc
@@ -1944,9 +2160,22 @@ namespace dd
                                TInputConnectorStrategy &inputc,
                                TorchMultipleDataset &testsets, int batch_size,
                                APIData &out)
+  {
+    return test(ad, inputc, testsets, batch_size, out, _module, _main_device);
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy,
+            class TMLModel>
+  int TorchLib<TInputConnectorStrategy, TOutputConnectorStrategy,
+               TMLModel>::test(const APIData &ad,
+                               TInputConnectorStrategy &inputc,
+                               TorchMultipleDataset &testsets, int batch_size,
+                               APIData &out, TorchModule &module,
+                               const torch::Device &device)
   {
     for (size_t i = 0; i < testsets.size(); ++i)
-      test(ad, inputc, testsets[i], batch_size, out, i, testsets.name(i));
+      test(ad, inputc, testsets[i], batch_size, out, module, device, i,
+           testsets.name(i));
 
     SupervisedOutput::aggregate_multiple_testsets(out);
     return 0;
@@ -1960,6 +2189,20 @@ namespace dd
                                TorchDataset &dataset, int batch_size,
                                APIData &out, size_t test_id,
                                const std::string &test_name)
+  {
+    return test(ad, inputc, dataset, batch_size, out, _module, _main_device,
+                test_id, test_name);
+  }
+
+  template <class TInputConnectorStrategy, class TOutputConnectorStrategy,
+            class TMLModel>
+  int TorchLib<TInputConnectorStrategy, TOutputConnectorStrategy,
+               TMLModel>::test(const APIData &ad,
+                               TInputConnectorStrategy &inputc,
+                               TorchDataset &dataset, int batch_size,
+                               APIData &out, TorchModule &module,
+                               const torch::Device &device, size_t test_id,
+                               const std::string &test_name)
   {
     APIData ad_res;
     APIData ad_bbox;
@@ -1985,7 +2228,7 @@ namespace dd
         dataset, data::DataLoaderOptions(batch_size));
     torch::Device cpu("cpu");
 
-    _module.eval();
+    module.eval();
     int entry_id = 0;
     for (TorchBatch batch : *dataloader)
       {
@@ -1995,13 +2238,13 @@ namespace dd
           }
         std::vector<c10::IValue> in_vals;
         for (Tensor tensor : batch.data)
-          in_vals.push_back(tensor.to(_main_device));
+          in_vals.push_back(tensor.to(device));
 
         Tensor output;
         c10::IValue out_ivalue;
         try
           {
-            out_ivalue = _module.forward(in_vals);
+            out_ivalue = module.forward(in_vals);
             if (!_bbox && !_segmentation)
               {
                 output = torch_utils::to_tensor_safe(out_ivalue);
@@ -2018,8 +2261,8 @@ namespace dd
         Tensor labels;
         if (_timeserie)
           {
-            if (_module._native != nullptr)
-              output = _module._native->cleanup_output(output);
+            if (module._native != nullptr)
+              output = module._native->cleanup_output(output);
             // iterate over data in batch
             labels = batch.target[0];
             output = output.to(cpu);
@@ -2257,7 +2500,7 @@ namespace dd
     ad_res.add("batch_size",
                entry_id); // here batch_size = tested entries count
     SupervisedOutput::measure(ad_res, ad_out, out, test_id, test_name);
-    _module.train();
+    module.train();
     return 0;
   }
 
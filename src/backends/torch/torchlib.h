@@ -24,6 +24,8 @@
 #define TORCHLIB_H
 
 #include <random>
+#include <deque>
+#include <future>
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -45,6 +47,7 @@
 #include "native/native_net.h"
 #include "torchmodule.h"
 #include "torchsolver.h"
+#include "torchsnapshot.h"
 
 namespace dd
 {
@@ -86,6 +89,19 @@ namespace dd
              TorchDataset &dataset, int batch_size, APIData &out,
              size_t test_id = 0, const std::string &test_name = "");
 
+    /**
+     * \brief test given module on given device, e.g. a snapshot of the
+     * weights evaluated asynchronously while training goes on
+     */
+    int test(const APIData &ad, TInputConnectorStrategy &inputc,
+             TorchMultipleDataset &datasets, int batch_size, APIData &out,
+             TorchModule &module, const torch::Device &device);
+
+    int test(const APIData &ad, TInputConnectorStrategy &inputc,
+             TorchDataset &dataset, int batch_size, APIData &out,
+             TorchModule &module, const torch::Device &device,
+             size_t test_id = 0, const std::string &test_name = "");
+
     std::vector<APIData> get_bbox_stats(const at::Tensor &targ_bboxes,
                                         const at::Tensor &targ_labels,
                                         const at::Tensor &bboxes_tensor,
@@ -136,17 +152,30 @@ namespace dd
     bool is_better(double v1, double v2, std::string metric_name);
 
     /**
-     * \brief generates a file containing best iteration so far
+     * \brief generates a file containing best iteration so far, a
+     * superseded best model is removed unless it is a retained regular
+     * snapshot
      */
     void save_if_best(APIData &ad_out, int64_t elapsed_it,
                       TorchSolver &tsolver,
-                      std::vector<int64_t> &best_iteration_numbers);
+                      std::vector<int64_t> &best_iteration_numbers,
+                      const std::deque<int64_t> &regular_snapshots,
+                      TorchModule *tested_module = nullptr,
+                      const std::string *tested_solver_state = nullptr);
 
     /**
      * snapshop current optimizer state
      */
     void snapshot(int64_t elapsed_it, TorchSolver &optimizer);
 
+    /**
+     * snapshot given module weights along with a serialized optimizer state,
+     * e.g. the weights and state captured for an asynchronous test. Files
+     * are written in the background if a snapshot writer is set.
+     */
+    void snapshot(int64_t elapsed_it, TorchModule &module,
+                  const std::string &solver_state);
+
     /**
      * delete superseeded model
      */
@@ -157,6 +186,10 @@ namespace dd
      */
     double unscale(double val, unsigned int k,
                    const TInputConnectorStrategy &inputc);
+
+    std::unique_ptr<TorchSnapshotWriter>
+        _snapshot_writer; /**< background snapshot writer during training, if
+                             snapshot_async is set */
   };
 }
 
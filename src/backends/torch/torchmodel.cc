@@ -39,6 +39,8 @@ namespace dd
     // we save solver states as solver-##.pt where ## is iteration number
     const std::string sstate = "solver-";
     const std::string proto = "proto";
+    // modules prepared for inference, see TorchModule::prepare_traced
+    const std::string prepared = ".ptp";
 
     std::unordered_set<std::string> files;
     int err = fileops::list_directory(_repo, true, false, false, files);
@@ -56,6 +58,8 @@ namespace dd
     for (const auto &file : files)
       {
         long int lm = fileops::file_last_modif(file);
+        if (file.find(prepared) != std::string::npos)
+          continue;
         if (file.find(sstate) != std::string::npos)
           {
             if (sstate_t < lm)
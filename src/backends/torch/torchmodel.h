@@ -71,6 +71,11 @@ namespace dd
         const std::string &target_repo,
         const std::shared_ptr<spdlog::logger> &logger);
 
+    std::vector<std::string> weights_files() const
+    {
+      return { _traced, _native, _head_weights };
+    }
+
   public:
     std::string _traced;       /**< path of the traced part of the net. */
     std::string _head_weights; /**< path of the weights of the finetuned head
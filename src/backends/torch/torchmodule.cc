@@ -24,6 +24,8 @@
 #include "graph/graph.h"
 #include "native/native.h"
 #include "torchutils.h"
+#include "utils/prepared_cache.hpp"
+#include <torch/version.h>
 
 namespace dd
 {
@@ -416,6 +418,57 @@ namespace dd
       }
   }
 
+  void TorchModule::prepare_traced(const TorchModel &model)
+  {
+    if (!_traced || _graph || _native || _linear_head || _crnn_head)
+      throw MLLibBadParamException(
+          "prepared_cache requires a traced model without head");
+
+    dd_utils::PreparedModelCache cache(model._repo, "prepared", ".ptp");
+    cache.add_file(model._traced);
+    cache.add_tag(TORCH_VERSION);
+    cache.add_tag(_device.str());
+    cache.add_tag(c10::toString(_dtype));
+    std::string entry = cache.path();
+
+    if (cache.exists())
+      {
+        _logger->info("loading prepared model " + entry);
+        try
+          {
+            _traced = std::make_shared<torch::jit::script::Module>(
+                torch::jit::load(entry, _device));
+            _prepared = true;
+            return;
+          }
+        catch (std::exception &e)
+          {
+            _logger->warn("unable to load prepared model {}: {}", entry,
+                          e.what());
+          }
+      }
+
+    _logger->info("preparing traced model for inference");
+    _traced->to(_device, _dtype);
+    _traced->eval();
+    auto prepared = std::make_shared<torch::jit::script::Module>(
+        torch::jit::optimize_for_inference(*_traced));
+    try
+      {
+        cache.store(
+            [&prepared](const std::string &tmp) { prepared->save(tmp); });
+        _logger->info("saved prepared model " + entry);
+      }
+    catch (std::exception &e)
+      {
+        // the prepared module is still used, only caching failed
+        _logger->warn("unable to save prepared model {}: {}", entry,
+                      e.what());
+      }
+    _traced = prepared;
+    _prepared = true;
+  }
+
   void TorchModule::setup_linear_head(int nclasses,
                                       std::vector<c10::IValue> input_example)
   {
@@ -482,6 +535,43 @@ namespace dd
       torch::save(_native, model._repo + "/checkpoint-" + name + ".npt");
   }
 
+  void TorchModule::save_checkpoint(
+      TorchModel &model, const std::string &name,
+      std::vector<std::pair<std::string, std::string>> &files)
+  {
+    std::string prefix = model._repo + "/checkpoint-" + name;
+    if (_traced)
+      {
+        std::ostringstream out;
+        _traced->save(out);
+        files.emplace_back(prefix + ".pt", out.str());
+      }
+    if (_linear_head)
+      {
+        std::ostringstream out;
+        torch::save(_linear_head, out);
+        files.emplace_back(prefix + ".ptw", out.str());
+      }
+    if (_crnn_head)
+      {
+        std::ostringstream out;
+        torch::save(_crnn_head, out);
+        files.emplace_back(prefix + ".ptw", out.str());
+      }
+    if (_graph)
+      {
+        std::ostringstream out;
+        torch::save(_graph, out);
+        files.emplace_back(prefix + ".pt", out.str());
+      }
+    if (_native)
+      {
+        std::ostringstream out;
+        torch::save(_native, out);
+        files.emplace_back(prefix + ".npt", out.str());
+      }
+  }
+
   void TorchModule::load(TorchModel &model)
   {
     if (!model._native.empty() && !model._proto.empty())
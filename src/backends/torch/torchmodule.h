@@ -85,6 +85,14 @@ namespace dd
      */
     void freeze_traced(bool freeze);
 
+    /**
+     * \brief replace the traced module by its frozen and optimized for
+     * inference version. The prepared module is cached in the model
+     * repository, and reused as long as the traced file, torch version,
+     * device and datatype are unchanged. Only forward is preserved.
+     */
+    void prepare_traced(const TorchModel &model);
+
     /**
      * \brief Add linear model at the end of module. Automatically detects size
      * of the last layer thanks to the provided example output.
@@ -112,6 +120,15 @@ namespace dd
      */
     void save_checkpoint(TorchModel &model, const std::string &name);
 
+    /**
+     * \brief Serialize checkpoint files in memory instead of writing them,
+     * e.g. for writing them in the background
+     * @param files (path, content) of each checkpoint file
+     */
+    void save_checkpoint(
+        TorchModel &model, const std::string &name,
+        std::vector<std::pair<std::string, std::string>> &files);
+
     /**
      * \brief Load traced module from .pt and custom parts weights from .ptw
      */
@@ -221,6 +238,8 @@ namespace dd
 
     unsigned int _nclasses = 0; /**< number of classes */
     bool _finetuning = false;
+    bool _prepared = false; /**< true if traced module is prepared for
+                               inference only */
 
     std::shared_ptr<spdlog::logger> _logger; /**< mllib logger. */
 
@@ -0,0 +1,288 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "torchrecordshard.h"
+#include "inputconnectorstrategy.h"
+#include "utils/fileops.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dd
+{
+  const uint64_t RecordShardReader::_magic;
+  const uint64_t RecordShardReader::_align;
+
+  static inline uint64_t align_up(const uint64_t &v)
+  {
+    return (v + RecordShardReader::_align - 1)
+           & ~(RecordShardReader::_align - 1);
+  }
+
+  /*- RecordShardTensors -*/
+
+  std::string
+  RecordShardTensors::serialize(const std::vector<at::Tensor> &tensors)
+  {
+    std::string payload;
+    auto append = [&payload](const void *src, size_t len) {
+      payload.append(static_cast<const char *>(src), len);
+    };
+    uint64_t ntensors = tensors.size();
+    append(&ntensors, sizeof(ntensors));
+    for (const at::Tensor &tensor : tensors)
+      {
+        at::Tensor t = tensor.to(torch::kCPU).contiguous();
+        int32_t dtype = static_cast<int32_t>(t.scalar_type());
+        int32_t ndim = t.dim();
+        uint64_t nbytes = t.numel() * t.element_size();
+        append(&dtype, sizeof(dtype));
+        append(&ndim, sizeof(ndim));
+        append(&nbytes, sizeof(nbytes));
+        for (int64_t s : t.sizes())
+          append(&s, sizeof(s));
+        payload.resize(align_up(payload.size()), '\0');
+        append(t.data_ptr(), nbytes);
+      }
+    return payload;
+  }
+
+  std::vector<at::Tensor>
+  RecordShardTensors::deserialize(const char *payload, const size_t &size,
+                                  const std::shared_ptr<void> &holder,
+                                  const bool &copy)
+  {
+    size_t pos = 0;
+    auto read = [&](void *dst, size_t len) {
+      if (pos + len > size)
+        throw InputConnectorInternalException("truncated tensor record");
+      std::memcpy(dst, payload + pos, len);
+      pos += len;
+    };
+    uint64_t ntensors = 0;
+    read(&ntensors, sizeof(ntensors));
+    std::vector<at::Tensor> tensors;
+    tensors.reserve(ntensors);
+    for (uint64_t i = 0; i < ntensors; ++i)
+      {
+        int32_t dtype = 0;
+        int32_t ndim = 0;
+        uint64_t nbytes = 0;
+        read(&dtype, sizeof(dtype));
+        read(&ndim, sizeof(ndim));
+        read(&nbytes, sizeof(nbytes));
+        std::vector<int64_t> sizes(ndim);
+        for (int32_t d = 0; d < ndim; ++d)
+          read(&sizes[d], sizeof(int64_t));
+        pos = align_up(pos);
+        if (pos + nbytes > size)
+          throw InputConnectorInternalException("truncated tensor record");
+        auto options = torch::TensorOptions().dtype(
+            static_cast<c10::ScalarType>(dtype));
+        void *data = const_cast<char *>(payload + pos);
+        at::Tensor t
+            = torch::from_blob(data, sizes, [holder](void *) {}, options);
+        tensors.push_back(copy ? t.clone() : t);
+        pos += nbytes;
+      }
+    return tensors;
+  }
+
+  /*- RecordShardWriter -*/
+
+  RecordShardWriter::RecordShardWriter(const std::string &dbname,
+                                       const uint64_t &max_shard_size)
+      : _dbname(dbname), _tmpname(tmp_name(dbname)),
+        _max_shard_size(max_shard_size)
+  {
+    // leftover of an interrupted creation
+    if (fileops::dir_exists(_tmpname))
+      {
+        fileops::clear_directory(_tmpname);
+        fileops::remove_dir(_tmpname);
+      }
+    if (mkdir(_tmpname.c_str(), 0755) != 0)
+      throw InputConnectorInternalException("could not create db "
+                                            + _tmpname);
+    open_shard();
+  }
+
+  RecordShardWriter::~RecordShardWriter()
+  {
+    if (!_closed)
+      _shard.close();
+  }
+
+  void RecordShardWriter::open_shard()
+  {
+    if (_shard.is_open())
+      _shard.close();
+    std::string shard_name
+        = RecordShardReader::shard_name(_tmpname, _nshards++);
+    _shard.open(shard_name, std::ios::out | std::ios::binary);
+    if (!_shard.is_open())
+      throw InputConnectorInternalException("could not create db shard "
+                                            + shard_name);
+    _shard_size = 0;
+  }
+
+  void RecordShardWriter::write_aligned(const std::string &payload,
+                                        uint64_t &offset)
+  {
+    uint64_t aligned = align_up(_shard_size);
+    if (aligned > _shard_size)
+      {
+        std::string pad(aligned - _shard_size, '\0');
+        _shard.write(pad.data(), pad.size());
+      }
+    offset = aligned;
+    _shard.write(payload.data(), payload.size());
+    _shard_size = aligned + payload.size();
+  }
+
+  void RecordShardWriter::add(const std::string &data,
+                              const std::string &target)
+  {
+    if (_shard_size >= _max_shard_size)
+      open_shard();
+    RecordShardEntry entry;
+    entry.shard = _nshards - 1;
+    write_aligned(data, entry.data_offset);
+    entry.data_size = data.size();
+    write_aligned(target, entry.target_offset);
+    entry.target_size = target.size();
+    if (!_shard)
+      throw InputConnectorInternalException("could not write to db "
+                                            + _dbname);
+    _entries.push_back(entry);
+  }
+
+  void RecordShardWriter::close()
+  {
+    if (_closed)
+      return;
+    _shard.close();
+    _closed = true;
+
+    std::string index_name = RecordShardReader::index_name(_tmpname);
+    std::ofstream index(index_name, std::ios::out | std::ios::binary);
+    uint64_t header[3] = { RecordShardReader::_magic, _entries.size(),
+                           _nshards };
+    index.write(reinterpret_cast<const char *>(header), sizeof(header));
+    index.write(reinterpret_cast<const char *>(_entries.data()),
+                _entries.size() * sizeof(RecordShardEntry));
+    index.close();
+    if (!index)
+      throw InputConnectorInternalException("could not write db index "
+                                            + index_name);
+    if (std::rename(_tmpname.c_str(), _dbname.c_str()) != 0)
+      throw InputConnectorInternalException("could not move db " + _tmpname
+                                            + " to " + _dbname + ": "
+                                            + std::strerror(errno));
+  }
+
+  /*- RecordShardReader -*/
+
+  std::string RecordShardReader::shard_name(const std::string &dbname,
+                                            const uint32_t &shard)
+  {
+    char name[32];
+    snprintf(name, sizeof(name), "/shard_%05u.bin", shard);
+    return dbname + name;
+  }
+
+  RecordShardReader::RecordShardReader(const std::string &dbname)
+  {
+    std::string index_name = RecordShardReader::index_name(dbname);
+    std::ifstream index(index_name, std::ios::in | std::ios::binary);
+    uint64_t header[3] = { 0, 0, 0 };
+    index.read(reinterpret_cast<char *>(header), sizeof(header));
+    if (!index || header[0] != _magic)
+      throw InputConnectorBadParamException(
+          "missing or invalid db index " + index_name
+          + ", db creation may have been interrupted");
+    _entries.resize(header[1]);
+    index.read(reinterpret_cast<char *>(_entries.data()),
+               _entries.size() * sizeof(RecordShardEntry));
+    if (!index)
+      throw InputConnectorBadParamException("truncated db index "
+                                            + index_name);
+
+    for (uint32_t s = 0; s < header[2]; ++s)
+      {
+        std::string sname = shard_name(dbname, s);
+        int fd = open(sname.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+          {
+            if (fd >= 0)
+              ::close(fd);
+            throw InputConnectorBadParamException("cannot open db shard "
+                                                  + sname);
+          }
+        size_t fsize = st.st_size;
+        void *addr = nullptr;
+        if (fsize > 0)
+          {
+            // copy on write, the db file is never modified
+            addr = mmap(nullptr, fsize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                        fd, 0);
+            if (addr == MAP_FAILED)
+              {
+                ::close(fd);
+                throw InputConnectorInternalException("cannot map db shard "
+                                                      + sname);
+              }
+            // records are sampled in random order
+            madvise(addr, fsize, MADV_RANDOM);
+          }
+        ::close(fd);
+        _shards.push_back(std::shared_ptr<void>(addr, [fsize](void *a) {
+          if (a)
+            munmap(a, fsize);
+        }));
+        _shard_sizes.push_back(fsize);
+      }
+
+    for (const RecordShardEntry &e : _entries)
+      if (e.shard >= _shards.size()
+          || e.data_offset + e.data_size > _shard_sizes[e.shard]
+          || e.target_offset + e.target_size > _shard_sizes[e.shard])
+        throw InputConnectorBadParamException("corrupted db " + dbname);
+  }
+
+  RecordShardReader::Record RecordShardReader::get(const size_t &i) const
+  {
+    const RecordShardEntry &e = _entries.at(i);
+    const char *base = static_cast<const char *>(_shards[e.shard].get());
+    Record rec;
+    rec.data = base + e.data_offset;
+    rec.data_size = e.data_size;
+    rec.target = base + e.target_offset;
+    rec.target_size = e.target_size;
+    rec.holder = _shards[e.shard];
+    return rec;
+  }
+}
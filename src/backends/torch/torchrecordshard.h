@@ -0,0 +1,189 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TORCH_RECORD_SHARD_H
+#define TORCH_RECORD_SHARD_H
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include <torch/torch.h>
+#pragma GCC diagnostic pop
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dd
+{
+  /**
+   * \brief on-disk dataset of records, each made of a data and a target
+   * payload. Records are appended to shard files, and an index file holds
+   * the offsets of every record, so that any record can be accessed
+   * directly from memory mapped shards.
+   *
+   * Layout of a db directory:
+   * - shard_NNNNN.bin: payloads, each starting on a 64 bytes boundary
+   * - index.bin: header (magic, number of records, number of shards), then
+   *   one RecordShardEntry per record. Written last, a db without index is
+   *   incomplete.
+   *
+   * A db is written to a temporary directory, renamed to its final name
+   * once complete, so that an interrupted creation does not leave a db
+   * that looks complete.
+   */
+  struct RecordShardEntry
+  {
+    uint32_t shard = 0;
+    uint32_t reserved = 0;
+    uint64_t data_offset = 0;
+    uint64_t data_size = 0;
+    uint64_t target_offset = 0;
+    uint64_t target_size = 0;
+  };
+
+  /**
+   * \brief raw tensors payload, for zero-copy reads. Layout: number of
+   * tensors, then for each tensor its dtype, dims, sizes and bytes, tensor
+   * bytes starting on a 64 bytes boundary from the payload start.
+   */
+  class RecordShardTensors
+  {
+  public:
+    /**
+     * \brief serialize tensors into a raw payload
+     */
+    static std::string serialize(const std::vector<at::Tensor> &tensors);
+
+    /**
+     * \brief tensors from a raw payload
+     * @param holder kept alive as long as the tensors, when not copied
+     * @param copy whether to copy data, otherwise tensors are read-only
+     * views of the payload
+     */
+    static std::vector<at::Tensor>
+    deserialize(const char *payload, const size_t &size,
+                const std::shared_ptr<void> &holder, const bool &copy);
+  };
+
+  /**
+   * \brief appends records to a shard db
+   */
+  class RecordShardWriter
+  {
+  public:
+    /**
+     * \brief creates db directory dbname, written as tmp_name(dbname)
+     * until closed
+     * @param max_shard_size shard size in bytes after which a new shard is
+     * started
+     */
+    RecordShardWriter(const std::string &dbname,
+                      const uint64_t &max_shard_size = 1ul << 30);
+
+    ~RecordShardWriter();
+
+    /**
+     * \brief append a record
+     */
+    void add(const std::string &data, const std::string &target);
+
+    /**
+     * \brief close last shard, write index and move db to its final name
+     */
+    void close();
+
+    static std::string tmp_name(const std::string &dbname)
+    {
+      return dbname + ".tmp";
+    }
+
+    size_t size() const
+    {
+      return _entries.size();
+    }
+
+  private:
+    void open_shard();
+    void write_aligned(const std::string &payload, uint64_t &offset);
+
+    std::string _dbname;
+    std::string _tmpname; /**< db directory until closed */
+    uint64_t _max_shard_size;
+    std::ofstream _shard;
+    uint32_t _nshards = 0;
+    uint64_t _shard_size = 0;
+    std::vector<RecordShardEntry> _entries;
+    bool _closed = false;
+  };
+
+  /**
+   * \brief read access to a shard db. Shards are memory mapped, and records
+   * can be read concurrently without locking. Mappings are private and
+   * writable, so that tensor views of records can be modified in place
+   * without changing the db, but such changes are seen by later reads of
+   * the record.
+   */
+  class RecordShardReader
+  {
+  public:
+    /**
+     * \brief record payloads, pointing to mapped shards
+     */
+    struct Record
+    {
+      const char *data = nullptr;
+      size_t data_size = 0;
+      const char *target = nullptr;
+      size_t target_size = 0;
+      std::shared_ptr<void> holder; /**< keeps shard mapped */
+    };
+
+    /**
+     * \brief open db, throws if index is missing or invalid
+     */
+    RecordShardReader(const std::string &dbname);
+
+    size_t size() const
+    {
+      return _entries.size();
+    }
+
+    Record get(const size_t &i) const;
+
+    static std::string shard_name(const std::string &dbname,
+                                  const uint32_t &shard);
+
+    static std::string index_name(const std::string &dbname)
+    {
+      return dbname + "/index.bin";
+    }
+
+    static const uint64_t _magic = 0x3144524148534444; // "DDSHARD1"
+    static const uint64_t _align = 64;
+
+  private:
+    std::vector<RecordShardEntry> _entries;
+    std::vector<std::shared_ptr<void>> _shards; /**< mappings */
+    std::vector<size_t> _shard_sizes;
+  };
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "torchsnapshot.h"
+#include "mllibstrategy.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace dd
+{
+  TorchSnapshotWriter::TorchSnapshotWriter(
+      std::shared_ptr<spdlog::logger> logger, size_t max_pending)
+      : _logger(logger), _max_pending(std::max(max_pending, size_t(1)))
+  {
+    _thread = std::thread(&TorchSnapshotWriter::run, this);
+  }
+
+  TorchSnapshotWriter::~TorchSnapshotWriter()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+    }
+    _job_cv.notify_all();
+    _thread.join();
+  }
+
+  void TorchSnapshotWriter::write(SnapshotFiles &&files)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_pending >= _max_pending)
+      {
+        _logger->info("waiting for {} pending snapshot(s) to be written",
+                      _pending);
+        _done_cv.wait(lock, [this]() { return _pending < _max_pending; });
+      }
+    Job job;
+    job.snapshot = true;
+    job.files = std::move(files);
+    _jobs.push_back(std::move(job));
+    ++_pending;
+    lock.unlock();
+    _job_cv.notify_one();
+  }
+
+  void TorchSnapshotWriter::remove(const std::vector<std::string> &files)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    Job job;
+    job.removals = files;
+    _jobs.push_back(std::move(job));
+    lock.unlock();
+    _job_cv.notify_one();
+  }
+
+  void TorchSnapshotWriter::flush()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done_cv.wait(lock, [this]() { return _jobs.empty() && !_busy; });
+    if (!_error.empty())
+      {
+        std::string error = _error;
+        _error.clear();
+        throw MLLibInternalException(error);
+      }
+  }
+
+  void TorchSnapshotWriter::run()
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+      {
+        _job_cv.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+        if (_jobs.empty())
+          break; // stopped and nothing left to write
+
+        Job job = std::move(_jobs.front());
+        _jobs.pop_front();
+        _busy = true;
+        lock.unlock();
+
+        std::string error;
+        for (auto &f : job.files)
+          {
+            std::string err = write_file(f.first, f.second);
+            if (!err.empty())
+              {
+                _logger->error(err);
+                error = err;
+              }
+            // release memory as soon as possible
+            std::string().swap(f.second);
+          }
+        for (const std::string &f : job.removals)
+          std::remove(f.c_str());
+
+        lock.lock();
+        if (job.snapshot)
+          --_pending;
+        if (!error.empty())
+          _error = error;
+        _busy = false;
+        _done_cv.notify_all();
+      }
+  }
+
+  std::string TorchSnapshotWriter::write_file(const std::string &path,
+                                              const std::string &content)
+  {
+    // temporary name must not be mistaken for a model file by
+    // TorchModel::read_from_repository
+    std::string dir = ".";
+    size_t pos = path.rfind('/');
+    if (pos != std::string::npos)
+      dir = path.substr(0, pos);
+    std::string tmp_path
+        = dir + "/.snapshot_" + std::to_string(_tmp_count++) + ".tmp";
+
+    std::ofstream out(tmp_path, std::ios::out | std::ios::binary);
+    if (!out.is_open())
+      return "could not open snapshot file " + tmp_path;
+    out.write(content.data(), content.size());
+    out.close();
+    if (!out)
+      {
+        std::remove(tmp_path.c_str());
+        return "could not write snapshot file " + path;
+      }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0)
+      {
+        std::remove(tmp_path.c_str());
+        return "could not rename snapshot file to " + path;
+      }
+    return "";
+  }
+}
@@ -0,0 +1,114 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TORCH_SNAPSHOT_H
+#define TORCH_SNAPSHOT_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "dd_spdlog.h"
+
+namespace dd
+{
+  /**
+   * \brief writes training snapshots from a background thread, so that
+   * training is not stalled by disk I/O. Snapshot files are serialized in
+   * memory by the caller, then written to a temporary file and renamed once
+   * complete. File removals are queued in order with writes.
+   */
+  class TorchSnapshotWriter
+  {
+  public:
+    /**
+     * \brief (path, content) of a snapshot file
+     */
+    typedef std::vector<std::pair<std::string, std::string>> SnapshotFiles;
+
+    /**
+     * \brief starts the writer thread
+     * @param max_pending max number of snapshots in memory waiting to be
+     * written, write() blocks when it is reached
+     */
+    TorchSnapshotWriter(std::shared_ptr<spdlog::logger> logger,
+                        size_t max_pending = 2);
+
+    /**
+     * \brief writes remaining snapshots and stops the writer thread
+     */
+    ~TorchSnapshotWriter();
+
+    /**
+     * \brief queue snapshot files for writing
+     */
+    void write(SnapshotFiles &&files);
+
+    /**
+     * \brief queue files for removal, after previously queued snapshots
+     */
+    void remove(const std::vector<std::string> &files);
+
+    /**
+     * \brief wait until all queued snapshots are written and removals done,
+     * throws if some write failed
+     */
+    void flush();
+
+  private:
+    struct Job
+    {
+      bool snapshot = false;             /**< true if this job is a snapshot */
+      SnapshotFiles files;               /**< files to write */
+      std::vector<std::string> removals; /**< files to remove */
+    };
+
+    /**
+     * \brief writer thread loop
+     */
+    void run();
+
+    /**
+     * \brief write file to a temporary file, then rename it
+     * @return empty string on success, error message otherwise
+     */
+    std::string write_file(const std::string &path,
+                           const std::string &content);
+
+    std::shared_ptr<spdlog::logger> _logger;
+    size_t _max_pending;   /**< max number of snapshots waiting */
+    std::deque<Job> _jobs; /**< queued jobs, in order */
+    size_t _pending = 0;   /**< number of snapshots queued or being written */
+    bool _busy = false;    /**< true while a job is being processed */
+    bool _stop = false;    /**< stop writer thread once queue is empty */
+    std::string _error;    /**< last write error, reported at flush */
+    uint64_t _tmp_count = 0; /**< temporary file counter */
+    std::mutex _mutex;
+    std::condition_variable _job_cv;  /**< signaled on new job or stop */
+    std::condition_variable _done_cv; /**< signaled on job completion */
+    std::thread _thread;
+  };
+}
+
+#endif
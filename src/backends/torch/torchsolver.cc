@@ -288,6 +288,11 @@ namespace dd
     torch::save(*_optimizer, sfile);
   }
 
+  void TorchSolver::save(std::ostream &out)
+  {
+    torch::save(*_optimizer, out);
+  }
+
   int TorchSolver::load(std::string sstate, torch::Device device)
   {
     if (!sstate.empty())
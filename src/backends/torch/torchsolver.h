@@ -70,6 +70,11 @@ namespace dd
      */
     void save(std::string sfile);
 
+    /**
+     * \brief dump solver state to stream
+     */
+    void save(std::ostream &out);
+
     /**
      * \brief restore solver state, checks solverstate presence  and returns
      * iteration number, best metric value and corresponding iteration number
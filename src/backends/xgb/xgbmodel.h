@@ -52,6 +52,11 @@ namespace dd
                      const std::shared_ptr<spdlog::logger> &logger);
 
     // TODO
+    std::vector<std::string> weights_files() const
+    {
+      return { _weights };
+    }
+
     std::string _weights; /**< file with model weights. */
   };
 
@@ -0,0 +1,451 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "cpu_placement.h"
+#include "mllibstrategy.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <linux/mempolicy.h>
+#include <omp.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace dd
+{
+  static std::string read_sysfs(const std::string &path)
+  {
+    std::ifstream in(path);
+    std::string line;
+    std::getline(in, line);
+    return line;
+  }
+
+  /*- CpuTopology -*/
+
+  CpuTopology CpuTopology::detect()
+  {
+    std::vector<int> allowed;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+      {
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+          if (CPU_ISSET(c, &mask))
+            allowed.push_back(c);
+      }
+    if (allowed.empty())
+      for (unsigned int c = 0;
+           c < std::max(std::thread::hardware_concurrency(), 1u); ++c)
+        allowed.push_back(c);
+
+    std::unordered_map<int, int> cpu_node;
+    std::string nodes = read_sysfs("/sys/devices/system/node/online");
+    try
+      {
+        for (int n : CpuScheduler::parse_cpu_list(nodes))
+          for (int c : CpuScheduler::parse_cpu_list(read_sysfs(
+                   "/sys/devices/system/node/node" + std::to_string(n)
+                   + "/cpulist")))
+            cpu_node[c] = n;
+      }
+    catch (std::invalid_argument &e)
+      {
+        cpu_node.clear();
+      }
+
+    CpuTopology topology;
+    for (int c : allowed)
+      {
+        Cpu cpu;
+        cpu.cpu = c;
+        auto nit = cpu_node.find(c);
+        cpu.node = nit != cpu_node.end() ? nit->second : 0;
+        cpu.core = c;
+        try
+          {
+            std::vector<int> siblings = CpuScheduler::parse_cpu_list(
+                read_sysfs("/sys/devices/system/cpu/cpu" + std::to_string(c)
+                           + "/topology/thread_siblings_list"));
+            if (!siblings.empty())
+              cpu.core = siblings.front();
+          }
+        catch (std::invalid_argument &e)
+          {
+          }
+        topology._cpus.push_back(cpu);
+      }
+    return topology;
+  }
+
+  /*- CpuPlacement -*/
+
+  CpuPlacement::~CpuPlacement()
+  {
+    if (_exclusive)
+      _scheduler->release(*this);
+  }
+
+  int CpuPlacement::size() const
+  {
+    return _scheduler->cpus(this).size();
+  }
+
+  APIData CpuPlacement::info() const
+  {
+    APIData ad;
+    ad.add("cpus", CpuScheduler::to_cpu_list(_scheduler->cpus(this)));
+    ad.add("exclusive", _exclusive);
+    if (_node >= 0)
+      ad.add("numa_node", _node);
+    return ad;
+  }
+
+  /*- CpuScheduler -*/
+
+  CpuScheduler::CpuScheduler(const CpuTopology &topology)
+      : _topology(topology)
+  {
+    std::sort(_topology._cpus.begin(), _topology._cpus.end(),
+              [](const CpuTopology::Cpu &a, const CpuTopology::Cpu &b) {
+                return a.cpu < b.cpu;
+              });
+    for (const CpuTopology::Cpu &cpu : _topology._cpus)
+      if (cpu.node != _topology._cpus.front().node)
+        _numa = true;
+  }
+
+  CpuScheduler &CpuScheduler::instance()
+  {
+    static CpuScheduler scheduler(CpuTopology::detect());
+    return scheduler;
+  }
+
+  std::shared_ptr<CpuPlacement>
+  CpuScheduler::reserve(const std::string &sname, const APIData &ad_model)
+  {
+    bool has_cpus = ad_model.has("cpus");
+    bool has_cores = ad_model.has("cores");
+    if (!has_cpus && !has_cores && !ad_model.has("numa_node"))
+      return nullptr;
+    if (has_cpus && has_cores)
+      throw MLLibBadParamException("cpus and cores cannot be used together");
+
+    int node = -1;
+    if (ad_model.has("numa_node"))
+      {
+        node = ad_model.get("numa_node").get<int>();
+        bool found = false;
+        for (const CpuTopology::Cpu &cpu : _topology._cpus)
+          found |= cpu.node == node;
+        if (!found)
+          throw MLLibBadParamException("no cpu available on numa node "
+                                       + std::to_string(node));
+      }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<int> cpus;
+    if (has_cpus)
+      {
+        std::string list = ad_model.get("cpus").get<std::string>();
+        try
+          {
+            cpus = parse_cpu_list(list);
+          }
+        catch (std::invalid_argument &e)
+          {
+            throw MLLibBadParamException(e.what());
+          }
+        if (cpus.empty())
+          throw MLLibBadParamException("empty cpu list");
+        for (int c : cpus)
+          {
+            auto cit = std::lower_bound(
+                _topology._cpus.begin(), _topology._cpus.end(), c,
+                [](const CpuTopology::Cpu &cpu, const int &v) {
+                  return cpu.cpu < v;
+                });
+            if (cit == _topology._cpus.end() || cit->cpu != c)
+              throw MLLibBadParamException("cpu " + std::to_string(c)
+                                           + " is not available");
+            if (node >= 0 && cit->node != node)
+              throw MLLibBadParamException("cpu " + std::to_string(c)
+                                           + " is not on numa node "
+                                           + std::to_string(node));
+            auto hit = _held.find(c);
+            if (hit != _held.end())
+              throw MLLibBadParamException("cpu " + std::to_string(c)
+                                           + " is held by service "
+                                           + hit->second->_sname);
+          }
+      }
+    else if (has_cores)
+      {
+        int ncores = ad_model.get("cores").get<int>();
+        if (ncores <= 0)
+          throw MLLibBadParamException("cores must be positive");
+        cpus = reserve_cores(ncores, node);
+      }
+
+    // nothing throws past this point, placement releases held cpus
+    auto placement = std::make_shared<CpuPlacement>(this, _next_id++, sname);
+    placement->_node = node;
+    if (!cpus.empty())
+      {
+        placement->_exclusive = true;
+        placement->_cpus = cpus;
+        for (int c : cpus)
+          _held[c] = placement.get();
+        ++_generation;
+      }
+    return placement;
+  }
+
+  std::vector<int> CpuScheduler::reserve_cores(const int &ncores,
+                                               const int &node) const
+  {
+    // a core is free when none of its hyperthreads is held
+    std::set<int> busy;
+    for (const CpuTopology::Cpu &cpu : _topology._cpus)
+      if (_held.count(cpu.cpu))
+        busy.insert(cpu.core);
+    std::map<int, std::vector<int>> free_cores; // node to cores
+    std::set<int> seen;
+    for (const CpuTopology::Cpu &cpu : _topology._cpus)
+      if (!busy.count(cpu.core) && seen.insert(cpu.core).second)
+        free_cores[cpu.node].push_back(cpu.core);
+
+    // a single node if possible, the one with most free cores, so that
+    // services spread across nodes
+    std::vector<int> nodes;
+    if (node >= 0)
+      nodes.push_back(node);
+    else
+      {
+        for (auto &fc : free_cores)
+          nodes.push_back(fc.first);
+        std::stable_sort(nodes.begin(), nodes.end(),
+                         [&free_cores](const int &a, const int &b) {
+                           return free_cores[a].size()
+                                  > free_cores[b].size();
+                         });
+      }
+
+    std::set<int> cores;
+    for (int n : nodes)
+      for (int core : free_cores[n])
+        if (static_cast<int>(cores.size()) < ncores)
+          cores.insert(core);
+    if (static_cast<int>(cores.size()) < ncores)
+      throw MLLibBadParamException(
+          "not enough free cores, requested " + std::to_string(ncores)
+          + ", free " + std::to_string(cores.size())
+          + (node >= 0 ? " on numa node " + std::to_string(node) : ""));
+
+    std::vector<int> cpus;
+    for (const CpuTopology::Cpu &cpu : _topology._cpus)
+      if (cores.count(cpu.core))
+        cpus.push_back(cpu.cpu);
+    return cpus;
+  }
+
+  void CpuScheduler::release(const CpuPlacement &placement)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (int c : placement._cpus)
+      {
+        auto hit = _held.find(c);
+        if (hit != _held.end() && hit->second == &placement)
+          _held.erase(hit);
+      }
+    ++_generation;
+  }
+
+  std::vector<int>
+  CpuScheduler::resolve(const CpuPlacement *placement) const
+  {
+    if (placement && placement->_exclusive)
+      return placement->_cpus;
+    int node = placement ? placement->_node : -1;
+    std::vector<int> cpus;
+    for (const CpuTopology::Cpu &cpu : _topology._cpus)
+      if ((node < 0 || cpu.node == node) && !_held.count(cpu.cpu))
+        cpus.push_back(cpu.cpu);
+    // every cpu is held, share them rather than not running
+    if (cpus.empty())
+      for (const CpuTopology::Cpu &cpu : _topology._cpus)
+        if (node < 0 || cpu.node == node)
+          cpus.push_back(cpu.cpu);
+    return cpus;
+  }
+
+  std::vector<int> CpuScheduler::cpus(const CpuPlacement *placement) const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return resolve(placement);
+  }
+
+  bool CpuScheduler::apply(const CpuPlacement *placement)
+  {
+    struct Applied
+    {
+      const CpuScheduler *scheduler = nullptr;
+      uint64_t id = 0;
+      uint64_t generation = 0;
+    };
+    thread_local Applied applied;
+
+    uint64_t id = placement ? placement->_id : 0;
+    uint64_t generation = _generation.load();
+    if (applied.scheduler == this && applied.id == id
+        && (applied.generation == generation
+            || (placement && placement->_exclusive)))
+      return true;
+    // nothing was ever held, threads run on every cpu
+    if (applied.scheduler == nullptr && id == 0 && generation == 0)
+      return true;
+
+    std::vector<int> cpus;
+    int node = -1;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      cpus = resolve(placement);
+      if (_numa)
+        for (const CpuTopology::Cpu &cpu : _topology._cpus)
+          if (std::binary_search(cpus.begin(), cpus.end(), cpu.cpu))
+            node = (node == -1 || node == cpu.node) ? cpu.node : -2;
+    }
+    applied.scheduler = this;
+    applied.id = id;
+    applied.generation = generation;
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int c : cpus)
+      if (c < CPU_SETSIZE)
+        CPU_SET(c, &mask);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) != 0)
+      return false;
+
+    // OpenMP team of this thread, used by backends and BLAS, threads
+    // created later inherit the mask
+    int nthreads = cpus.size();
+    omp_set_num_threads(nthreads);
+#pragma omp parallel num_threads(nthreads)
+    pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+
+    // allocations from the node of the placement, when on a single one
+    if (_numa)
+      {
+        unsigned long nodemask = 0;
+        if (node >= 0 && node < 63)
+          nodemask = 1ul << node;
+        if (nodemask)
+          syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodemask,
+                  sizeof(nodemask) * 8);
+        else
+          syscall(SYS_set_mempolicy, MPOL_DEFAULT, nullptr, 0);
+      }
+    return true;
+  }
+
+  APIData CpuScheduler::info() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<int> all;
+    std::map<int, std::pair<std::vector<int>, std::vector<int>>> nodes;
+    for (const CpuTopology::Cpu &cpu : _topology._cpus)
+      {
+        all.push_back(cpu.cpu);
+        nodes[cpu.node].first.push_back(cpu.cpu);
+        if (!_held.count(cpu.cpu))
+          nodes[cpu.node].second.push_back(cpu.cpu);
+      }
+    std::vector<APIData> vnodes;
+    for (auto &n : nodes)
+      {
+        APIData nad;
+        nad.add("node", n.first);
+        nad.add("cpus", to_cpu_list(n.second.first));
+        nad.add("free", to_cpu_list(n.second.second));
+        vnodes.push_back(nad);
+      }
+    APIData ad;
+    ad.add("cpus", to_cpu_list(all));
+    ad.add("free", to_cpu_list(resolve(nullptr)));
+    ad.add("nodes", vnodes);
+    return ad;
+  }
+
+  std::vector<int> CpuScheduler::parse_cpu_list(const std::string &list)
+  {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size() && list[pos] != '\n')
+      {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos)
+          end = list.size();
+        std::string range = list.substr(pos, end - pos);
+        while (!range.empty() && (range.back() == '\n' || range.back() == ' '))
+          range.pop_back();
+        size_t dash = range.find('-');
+        std::string first = range.substr(0, dash);
+        std::string last
+            = dash == std::string::npos ? first : range.substr(dash + 1);
+        auto is_number = [](const std::string &s) {
+          return !s.empty() && s.size() < 6
+                 && std::all_of(s.begin(), s.end(), ::isdigit);
+        };
+        if (!is_number(first) || !is_number(last)
+            || std::stoi(first) > std::stoi(last))
+          throw std::invalid_argument("invalid cpu list " + list);
+        for (int c = std::stoi(first); c <= std::stoi(last); ++c)
+          cpus.push_back(c);
+        pos = end + 1;
+      }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+  }
+
+  std::string CpuScheduler::to_cpu_list(const std::vector<int> &cpus)
+  {
+    std::string list;
+    for (size_t i = 0; i < cpus.size();)
+      {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+          ++j;
+        if (!list.empty())
+          list += ",";
+        list += std::to_string(cpus[i]);
+        if (j > i)
+          list += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+      }
+    return list;
+  }
+}
@@ -0,0 +1,170 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CPU_PLACEMENT_H
+#define CPU_PLACEMENT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "apidata.h"
+
+namespace dd
+{
+  /**
+   * \brief cpus a process may run on, with their NUMA node and physical
+   * core
+   */
+  struct CpuTopology
+  {
+    struct Cpu
+    {
+      int cpu = 0;
+      int node = 0;
+      int core = 0; /**< lowest cpu among the core hyperthreads */
+    };
+
+    /**
+     * \brief cpus of the process affinity mask, NUMA nodes and cores from
+     * sysfs, a single node of single-thread cores if sysfs is missing
+     */
+    static CpuTopology detect();
+
+    std::vector<Cpu> _cpus; /**< sorted by cpu */
+  };
+
+  class CpuScheduler;
+
+  /**
+   * \brief cpus a service runs on. Exclusive placements hold their cpus
+   * until destroyed, other placements restrict a service to the cpus of a
+   * NUMA node that are not held.
+   */
+  class CpuPlacement
+  {
+  public:
+    CpuPlacement(CpuScheduler *scheduler, const uint64_t &id,
+                 const std::string &sname)
+        : _scheduler(scheduler), _id(id), _sname(sname)
+    {
+    }
+
+    ~CpuPlacement();
+
+    CpuPlacement(const CpuPlacement &) = delete;
+    CpuPlacement &operator=(const CpuPlacement &) = delete;
+
+    /**
+     * \brief number of cpus the placement currently resolves to
+     */
+    int size() const;
+
+    APIData info() const;
+
+    CpuScheduler *_scheduler;
+    uint64_t _id;
+    std::string _sname;
+    bool _exclusive = false;
+    std::vector<int> _cpus; /**< exclusive cpus */
+    int _node = -1;         /**< node restriction, -1 for none */
+  };
+
+  /**
+   * \brief partitions the cpus of the server across services. Services
+   * ask for a number of physical cores, an explicit cpu list, and/or a
+   * NUMA node, with model parameters cores, cpus and numa_node. Cores and
+   * cpus are reserved for the service, and services without placement run
+   * on the cpus no service holds.
+   *
+   * Placements are applied to the threads that run service calls, so that
+   * a thread is pinned, along with its OpenMP team, to the cpus of the
+   * service it works for, and allocates memory from its node. Threads
+   * keep their placement between calls to the same service, and are only
+   * moved when they switch to a service with another placement.
+   */
+  class CpuScheduler
+  {
+  public:
+    CpuScheduler(const CpuTopology &topology);
+
+    /**
+     * \brief scheduler of the server cpus
+     */
+    static CpuScheduler &instance();
+
+    /**
+     * \brief placement requested by model parameters cpus, cores and
+     * numa_node, nullptr when none is requested. Throws
+     * MLLibBadParamException if requested cpus are unknown, held by
+     * another service, or not enough cores are free.
+     */
+    std::shared_ptr<CpuPlacement> reserve(const std::string &sname,
+                                          const APIData &ad_model);
+
+    /**
+     * \brief pins the calling thread to the cpus of placement, or to the
+     * cpus no service holds when placement is nullptr
+     * @return false if the thread could not be pinned
+     */
+    bool apply(const CpuPlacement *placement);
+
+    /**
+     * \brief cpus the placement currently resolves to
+     */
+    std::vector<int> cpus(const CpuPlacement *placement) const;
+
+    /**
+     * \brief topology, free cpus and cpus held by each service
+     */
+    APIData info() const;
+
+    /**
+     * \brief parses a cpu list such as "0-3,8,10-11"
+     */
+    static std::vector<int> parse_cpu_list(const std::string &list);
+
+    /**
+     * \brief formats sorted cpus as a cpu list
+     */
+    static std::string to_cpu_list(const std::vector<int> &cpus);
+
+  private:
+    friend class CpuPlacement;
+
+    void release(const CpuPlacement &placement);
+    std::vector<int> resolve(const CpuPlacement *placement) const;
+    std::vector<int> reserve_cores(const int &ncores, const int &node) const;
+
+    CpuTopology _topology;
+    mutable std::mutex _mutex;
+    std::unordered_map<int, const CpuPlacement *>
+        _held; /**< cpu to exclusive placement */
+    uint64_t _next_id = 1;
+    bool _numa = false; /**< whether cpus span several nodes */
+    std::atomic<uint64_t> _generation
+        = { 0 }; /**< incremented when held cpus change */
+  };
+}
+
+#endif
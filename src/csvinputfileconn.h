@@ -637,6 +637,7 @@ namespace dd
         }
       else // prediction mode
         {
+          std::shared_ptr<httpfetcher> fetcher = this->prefetch_uris();
           for (size_t i = 0; i < _uris.size(); i++)
             {
               if (i == 0 && !fileops::file_exists(_uris.at(0))
@@ -656,6 +657,8 @@ namespace dd
                 throw InputConnectorBadParamException("use of
                 categoricals_mapping requires a CSV header");*/
               DataEl<DDCsv> ddcsv(this->_input_timeout);
+              if (fetcher)
+                ddcsv.set_fetcher(fetcher, i);
               ddcsv._ctype._cifc = this;
               ddcsv._ctype._adconf = ad_input;
               ddcsv.read_element(_uris.at(i), this->_logger);
@@ -34,6 +34,15 @@ namespace dd
   {
 #include OATPP_CODEGEN_BEGIN(DTO) ///< Begin DTO codegen section
 
+    class ServiceCpuPlacement : public oatpp::DTO
+    {
+      DTO_INIT(ServiceCpuPlacement, DTO /* extends */)
+
+      DTO_FIELD(String, cpus);
+      DTO_FIELD(Boolean, exclusive);
+      DTO_FIELD(Int32, numa_node);
+    };
+
     class Service : public oatpp::DTO
     {
       DTO_INIT(Service, DTO /* extends */)
@@ -44,6 +53,25 @@ namespace dd
       DTO_FIELD(String, mltype);
       DTO_FIELD(Boolean, predict) = false;
       DTO_FIELD(Boolean, training) = false;
+      DTO_FIELD(Object<ServiceCpuPlacement>, cpu_placement);
+    };
+
+    class CpuNode : public oatpp::DTO
+    {
+      DTO_INIT(CpuNode, DTO /* extends */)
+
+      DTO_FIELD(Int32, node);
+      DTO_FIELD(String, cpus);
+      DTO_FIELD(String, free);
+    };
+
+    class CpuPlacementInfo : public oatpp::DTO
+    {
+      DTO_INIT(CpuPlacementInfo, DTO /* extends */)
+
+      DTO_FIELD(String, cpus);
+      DTO_FIELD(String, free); /**< cpus of services without placement */
+      DTO_FIELD(List<Object<CpuNode>>, nodes);
     };
 
     class InfoHead : public oatpp::DTO
@@ -59,6 +87,7 @@ namespace dd
       DTO_FIELD(String, compile_flags) = COMPILE_FLAGS;
       DTO_FIELD(String, deps_version) = DEPS_VERSION;
       DTO_FIELD(List<Object<Service>>, services);
+      DTO_FIELD(Object<CpuPlacementInfo>, cpu_placement);
     };
 
     class InfoBody : public oatpp::DTO
@@ -50,6 +50,20 @@ namespace dd
       }
       DTO_FIELD(Int32, timeout) = -1;
 
+      DTO_FIELD_INFO(max_fetches)
+      {
+        info->description = "max number of concurrent remote data "
+                            "retrievals";
+      }
+      DTO_FIELD(Int32, max_fetches) = 16;
+
+      DTO_FIELD_INFO(max_fetch_size)
+      {
+        info->description
+            = "max size of remote data in MB, 0 means no limit";
+      }
+      DTO_FIELD(Int32, max_fetch_size) = 0;
+
       // IMG Input Connector
       DTO_FIELD(Int32, width);
       DTO_FIELD(Int32, height);
@@ -71,6 +85,14 @@ namespace dd
       DTO_FIELD(Boolean, keep_orig);
       DTO_FIELD(String, interp);
 
+      DTO_FIELD_INFO(reduced_decode)
+      {
+        info->description
+            = "decode JPEG images at a reduced resolution (1/2, 1/4 or 1/8) "
+              "that remains larger than width and height";
+      }
+      DTO_FIELD(Boolean, reduced_decode);
+
       DTO_FIELD_INFO(bbox)
       {
         info->description = "[training] true if data contains a bbox dataset";
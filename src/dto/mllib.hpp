@@ -116,9 +116,11 @@ namespace dd
       DTO_FIELD_INFO(datatype)
       {
         info->description
-            = "Datatype used at prediction time. fp16 or fp32 or fp64 (torch)";
+            = "Datatype used at prediction time. fp16 or fp32 or fp64 "
+              "(torch). Defaults to fp32, or to the datatype a prepared "
+              "model was built with (torch, prepared_cache)";
       };
-      DTO_FIELD(String, datatype) = "fp32";
+      DTO_FIELD(String, datatype);
 
       DTO_FIELD_INFO(extract_layer)
       {
@@ -152,6 +154,14 @@ namespace dd
       };
       DTO_FIELD(Boolean, freeze_traced) = false;
 
+      DTO_FIELD_INFO(prepared_cache)
+      {
+        info->description
+            = "Freeze and optimize the traced net for inference, and cache "
+              "the result in the model repository for faster reloads";
+      };
+      DTO_FIELD(Boolean, prepared_cache) = false;
+
       DTO_FIELD_INFO(loss)
       {
         // TODO add other losses.
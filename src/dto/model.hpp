@@ -38,6 +38,10 @@ namespace dd
       DTO_FIELD(String, init);
       DTO_FIELD(Boolean, create_repository) = false;
       DTO_FIELD(Boolean, index_preload) = false;
+      DTO_FIELD(Boolean, lazy) = false;
+      DTO_FIELD(Int32, cores);
+      DTO_FIELD(String, cpus);
+      DTO_FIELD(Int32, numa_node);
     };
 
 #include OATPP_CODEGEN_END(DTO) ///< End DTO codegen section
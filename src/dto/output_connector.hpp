@@ -88,6 +88,14 @@ namespace dd
       }
       DTO_FIELD(Boolean, string_binarized) = false;
 
+      DTO_FIELD_INFO(vals_encoding)
+      {
+        info->description
+            = "Output values encoding: json for an array of numbers, float32, "
+              "float16 or int8 for a base64 string of little-endian values";
+      }
+      DTO_FIELD(String, vals_encoding) = "json";
+
       /* simsearch (unsupervised) */
       DTO_FIELD(Boolean, index) = false;
       DTO_FIELD(Boolean, build_index) = false;
@@ -99,6 +107,12 @@ namespace dd
       DTO_FIELD(String, index_type);
       DTO_FIELD(Int32, train_samples);
       DTO_FIELD(Boolean, ondisk);
+      DTO_FIELD_INFO(index_metadata_memory)
+      {
+        info->description
+            = "Serve search results metadata from an in-memory table";
+      }
+      DTO_FIELD(Boolean, index_metadata_memory);
       DTO_FIELD(Boolean, index_gpu) = false;
       DTO_FIELD(GpuIds, index_gpuid);
 
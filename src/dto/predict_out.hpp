@@ -121,6 +121,20 @@ namespace dd
                             "binarized double, booleans, binarized string";
       }
       DTO_FIELD(Any, vals);
+
+      DTO_FIELD_INFO(vals_encoding)
+      {
+        info->description = "[Unsupervised] Encoding of vals when it is a "
+                            "base64 string: float32, float16 or int8";
+      }
+      DTO_FIELD(String, vals_encoding);
+
+      DTO_FIELD_INFO(vals_scale)
+      {
+        info->description = "[Unsupervised] int8 encoding step, values are "
+                            "int8 values times vals_scale";
+      }
+      DTO_FIELD(Float32, vals_scale);
       DTO_FIELD(Object<Dimensions>, imgsize);
 
       DTO_FIELD_INFO(confidences)
@@ -18,12 +18,331 @@
  * You should have received a copy of the GNU Lesser General Public License
  * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
  */
+
 #include "access_log.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+
 namespace dd
 {
   namespace http
   {
-    thread_local AccessLogContext _context;
+    /** \brief bundle value, nullptr if unset */
+    template <typename TWrapper, typename TMessage>
+    static TWrapper bundle_data(const std::shared_ptr<TMessage> &message,
+                                const char *key)
+    {
+      // lookup without the exception thrown by getBundleData on missing keys
+      const auto &all = message->getBundle().getAll();
+      auto it = all.find(key);
+      if (it == all.end())
+        return nullptr;
+      return it->second.template cast<TWrapper>();
+    }
+
+    static int64_t steady_now_us()
+    {
+      return std::chrono::duration_cast<std::chrono::microseconds>(
+                 std::chrono::steady_clock::now().time_since_epoch())
+          .count();
+    }
+
+    template <size_t N>
+    static void copy_str(char (&dst)[N], const char *src, size_t len)
+    {
+      len = src ? std::min(len, N - 1) : 0;
+      if (len > 0)
+        std::memcpy(dst, src, len);
+      dst[len] = '\0';
+    }
+
+    template <size_t N, typename TLabel>
+    static void copy_label(char (&dst)[N], const TLabel &label)
+    {
+      copy_str(dst, static_cast<const char *>(label.getData()),
+               label.getData() ? label.getSize() : 0);
+    }
+
+    static void json_escape(const char *s, std::string &out)
+    {
+      for (; *s; ++s)
+        {
+          if (*s == '"' || *s == '\\')
+            {
+              out += '\\';
+              out += *s;
+            }
+          else if (static_cast<unsigned char>(*s) < 0x20)
+            {
+              char esc[8];
+              snprintf(esc, sizeof(esc), "\\u%04x", *s);
+              out += esc;
+            }
+          else
+            out += *s;
+        }
+    }
+
+    /*- AccessLog -*/
+
+    AccessLog::AccessLog(const std::shared_ptr<spdlog::logger> &logger,
+                         const Format &format, const std::string &file,
+                         const double &sample, const uint32_t &rate,
+                         const size_t &capacity)
+        : _logger(logger), _format(format),
+          _sample_threshold(static_cast<uint64_t>(
+              std::max(0.0, std::min(1.0, sample)) * (1ull << 32))),
+          _rate(rate), _queue(std::max<size_t>(capacity, 2))
+    {
+      if (!file.empty())
+        {
+          _file = fopen(file.c_str(), "a");
+          if (!_file)
+            _logger->error("cannot open access log file {}, logging to "
+                           "server log",
+                           file);
+          else
+            setvbuf(_file, nullptr, _IOFBF, 1 << 16);
+        }
+      _thread = std::thread([this]() { run(); });
+    }
+
+    AccessLog::~AccessLog()
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+      }
+      _cv.notify_all();
+      _thread.join();
+      if (_file)
+        fclose(_file);
+    }
+
+    AccessLog::Format AccessLog::format_from_string(const std::string &name)
+    {
+      if (name == "text")
+        return TEXT;
+      if (name == "json")
+        return JSON;
+      throw std::runtime_error("unknown access log format " + name);
+    }
+
+    void AccessLog::log(const AccessLogRecord &record)
+    {
+      bool success = record.status == 200 || record.status == 201;
+      if (success && _sample_threshold < (1ull << 32))
+        {
+          // xorshift, per thread
+          static thread_local uint64_t rnd
+              = reinterpret_cast<uintptr_t>(&rnd) | 1;
+          rnd ^= rnd << 13;
+          rnd ^= rnd >> 7;
+          rnd ^= rnd << 17;
+          if ((rnd >> 32) >= _sample_threshold)
+            return;
+        }
+      if (_rate > 0)
+        {
+          // approximate limit over one second windows
+          int64_t sec = record.time_us / 1000000;
+          if (_rate_sec.load(std::memory_order_relaxed) != sec)
+            {
+              _rate_sec.store(sec, std::memory_order_relaxed);
+              _rate_count.store(0, std::memory_order_relaxed);
+            }
+          if (_rate_count.fetch_add(1, std::memory_order_relaxed) >= _rate)
+            {
+              _dropped.fetch_add(1, std::memory_order_relaxed);
+              return;
+            }
+        }
+      if (!_queue.try_push(record))
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void AccessLog::format(const AccessLogRecord &record,
+                           std::string &out) const
+    {
+      out.clear();
+      char buf[64];
+      if (_format == TEXT)
+        {
+          out += record.protocol;
+          out += " \"";
+          out += record.method;
+          out += " ";
+          out += record.path;
+          out += "\" ";
+          out += record.service[0] ? record.service : "<n/a>";
+          snprintf(buf, sizeof(buf), " %d %ldms", record.status,
+                   static_cast<long>(std::max<int64_t>(record.duration_us, 0)
+                                     / 1000));
+          out += buf;
+          return;
+        }
+
+      time_t secs = record.time_us / 1000000;
+      struct tm tm;
+      gmtime_r(&secs, &tm);
+      strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+      out += "{\"time\":\"";
+      out += buf;
+      snprintf(buf, sizeof(buf), ".%06ldZ\",\"method\":\"",
+               static_cast<long>(record.time_us % 1000000));
+      out += buf;
+      json_escape(record.method, out);
+      out += "\",\"path\":\"";
+      json_escape(record.path, out);
+      out += "\"";
+      if (record.service[0])
+        {
+          out += ",\"service\":\"";
+          json_escape(record.service, out);
+          out += "\"";
+        }
+      snprintf(buf, sizeof(buf), ",\"status\":%d", record.status);
+      out += buf;
+      if (record.bytes >= 0)
+        {
+          snprintf(buf, sizeof(buf), ",\"bytes\":%ld",
+                   static_cast<long>(record.bytes));
+          out += buf;
+        }
+      if (record.duration_us >= 0)
+        {
+          snprintf(buf, sizeof(buf), ",\"duration_ms\":%.3f",
+                   record.duration_us / 1000.0);
+          out += buf;
+        }
+      if (record.queue_us >= 0)
+        {
+          snprintf(buf, sizeof(buf), ",\"queue_ms\":%.3f",
+                   record.queue_us / 1000.0);
+          out += buf;
+        }
+      if (record.time_ms >= 0.0)
+        {
+          snprintf(buf, sizeof(buf), ",\"time_ms\":%.3f", record.time_ms);
+          out += buf;
+        }
+      if (record.batch >= 0)
+        {
+          snprintf(buf, sizeof(buf), ",\"batch\":%d", record.batch);
+          out += buf;
+        }
+      out += "}";
+    }
+
+    void AccessLog::write(const AccessLogRecord &record, std::string &line)
+    {
+      format(record, line);
+      if (_file)
+        {
+          line += "\n";
+          fwrite(line.data(), 1, line.size(), _file);
+        }
+      else if (_format == TEXT && record.status != 200
+               && record.status != 201)
+        _logger->error(line);
+      else
+        _logger->info(line);
+    }
+
+    void AccessLog::report_dropped()
+    {
+      uint64_t dropped = _dropped.exchange(0);
+      if (dropped > 0)
+        _logger->warn("access log: {} records dropped by rate limit or full "
+                      "buffer",
+                      dropped);
+    }
+
+    void AccessLog::run()
+    {
+      std::string line;
+      AccessLogRecord record;
+      auto last_report = std::chrono::steady_clock::now();
+      while (true)
+        {
+          bool stop;
+          {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cv.wait_for(lock, std::chrono::milliseconds(20),
+                         [this]() { return _stop; });
+            stop = _stop;
+          }
+          bool written = false;
+          while (_queue.try_pop(record))
+            {
+              write(record, line);
+              written = true;
+            }
+          if (written && _file)
+            fflush(_file);
+          auto now = std::chrono::steady_clock::now();
+          if (stop || now - last_report > std::chrono::seconds(10))
+            {
+              report_dropped();
+              last_report = now;
+            }
+          if (stop)
+            break;
+        }
+    }
+
+    /*- interceptors -*/
+
+    std::shared_ptr<AccessLogResponseInterceptor::OutgoingResponse>
+    AccessLogResponseInterceptor::intercept(
+        const std::shared_ptr<IncomingRequest> &request,
+        const std::shared_ptr<OutgoingResponse> &response)
+    {
+      AccessLogRecord record;
+      record.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::system_clock::now().time_since_epoch())
+                           .count();
+      auto req = request->getStartingLine();
+      copy_label(record.protocol, req.protocol);
+      copy_label(record.method, req.method);
+      copy_label(record.path, req.path);
+      oatpp::String service_name
+          = bundle_data<oatpp::String>(response, "dd_service");
+      if (service_name)
+        copy_str(record.service, service_name->data(), service_name->size());
+      record.status = response->getStatus().code;
+      if (response->getBody())
+        record.bytes = response->getBody()->getKnownSize();
+
+      oatpp::Int64 req_start_time
+          = bundle_data<oatpp::Int64>(request, "dd_req_start");
+      if (req_start_time)
+        record.duration_us = steady_now_us() - *req_start_time;
+      oatpp::Int64 queue_us
+          = bundle_data<oatpp::Int64>(response, "dd_queue_us");
+      if (queue_us)
+        record.queue_us = *queue_us;
+      oatpp::Float64 time_ms
+          = bundle_data<oatpp::Float64>(response, "dd_time_ms");
+      if (time_ms)
+        record.time_ms = *time_ms;
+      oatpp::Int32 batch = bundle_data<oatpp::Int32>(response, "dd_batch");
+      if (batch)
+        record.batch = *batch;
+
+      _access_log->log(record);
+      return response;
+    }
+
+    std::shared_ptr<AccessLogRequestInterceptor::OutgoingResponse>
+    AccessLogRequestInterceptor::intercept(
+        const std::shared_ptr<IncomingRequest> &request)
+    {
+      request->putBundleData("dd_req_start", oatpp::Int64(steady_now_us()));
+      return nullptr;
+    }
   }
 }
@@ -28,73 +28,158 @@
 #include "oatpp/web/server/interceptor/RequestInterceptor.hpp"
 
 #include "dd_spdlog.h"
+#include "utils/bounded_queue.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
 
 namespace dd
 {
   namespace http
   {
-    /* For storing per request information, mainly to build a proper access
-       log */
-    class AccessLogContext
+    /* Per request information for building a proper access log is stored
+       in request and response bundles: with the async server, a request may
+       be served by several threads, and a thread may serve several requests
+       at once */
+
+    inline void setAccessLogServiceName(
+        const std::shared_ptr<
+            oatpp::web::protocol::http::outgoing::Response> &response,
+        const std::string &service_name)
     {
-    public:
-      std::string service_name = "<n/a>";
-      std::chrono::time_point<std::chrono::steady_clock> req_start_time;
-    };
-
-    thread_local extern AccessLogContext _context;
+      response->putBundleData("dd_service", oatpp::String(service_name));
+    }
 
-    inline void initAccessLogRequestStartTime()
+    /**
+     * \brief call timings and batch size from the API output head:
+     * time spent in the ML library and number of predictions
+     */
+    inline void setAccessLogCallStats(
+        const std::shared_ptr<
+            oatpp::web::protocol::http::outgoing::Response> &response,
+        const double &time_ms, const int &batch_size)
     {
-      _context.req_start_time = std::chrono::steady_clock::now();
+      response->putBundleData("dd_time_ms", oatpp::Float64(time_ms));
+      if (batch_size >= 0)
+        response->putBundleData("dd_batch", oatpp::Int32(batch_size));
     }
-    inline void setAccessLogServiceName(std::string service_name)
+
+    /**
+     * \brief time spent by the call waiting for an executor, async server
+     */
+    inline void setAccessLogQueueWait(
+        const std::shared_ptr<
+            oatpp::web::protocol::http::outgoing::Response> &response,
+        const int64_t &queue_us)
     {
-      _context.service_name = service_name;
+      response->putBundleData("dd_queue_us", oatpp::Int64(queue_us));
     }
 
+    /**
+     * \brief access log entry, fixed size so that logging a call does not
+     * allocate. Strings are truncated, unknown values are -1.
+     */
+    struct AccessLogRecord
+    {
+      int64_t time_us = 0; /**< wall clock, since epoch */
+      char protocol[12] = { 0 };
+      char method[8] = { 0 };
+      char path[128] = { 0 };
+      char service[64] = { 0 };
+      int status = 0;
+      int64_t bytes = -1;       /**< response body size */
+      int64_t duration_us = -1; /**< from request to response */
+      int64_t queue_us = -1;    /**< waiting for an executor */
+      double time_ms = -1.0;    /**< in the ML library */
+      int batch = -1;           /**< number of predictions */
+    };
+
+    /**
+     * \brief asynchronous access log: records are queued into a lock-free
+     * ring buffer, then formatted and written by a background thread, so
+     * that request threads never wait on the log sink. Successful calls
+     * may be sampled, errors are always kept, and records beyond the rate
+     * limit or the buffer capacity are dropped and counted.
+     */
+    class AccessLog
+    {
+    public:
+      enum Format
+      {
+        TEXT,
+        JSON
+      };
+
+      /**
+       * @param file file to append records to, empty for logger
+       * @param sample fraction of successful calls to log
+       * @param rate max records per second, 0 for no limit
+       * @param capacity max number of records waiting to be written
+       */
+      AccessLog(const std::shared_ptr<spdlog::logger> &logger,
+                const Format &format, const std::string &file,
+                const double &sample, const uint32_t &rate,
+                const size_t &capacity);
+
+      ~AccessLog();
+
+      /**
+       * \brief queues a record, never blocks
+       */
+      void log(const AccessLogRecord &record);
+
+      /**
+       * \brief format from name: text, json, throws otherwise
+       */
+      static Format format_from_string(const std::string &name);
+
+      /**
+       * \brief formats a record
+       */
+      void format(const AccessLogRecord &record, std::string &out) const;
+
+    private:
+      void run();
+      void write(const AccessLogRecord &record, std::string &line);
+      void report_dropped();
+
+      std::shared_ptr<spdlog::logger> _logger;
+      Format _format;
+      FILE *_file = nullptr;
+      uint64_t _sample_threshold; /**< sampling, on 2^32 */
+      uint32_t _rate;
+      dd_utils::BoundedQueue<AccessLogRecord> _queue;
+
+      std::atomic<int64_t> _rate_sec{ 0 };
+      std::atomic<uint32_t> _rate_count{ 0 };
+      std::atomic<uint64_t> _dropped{ 0 };
+
+      std::mutex _mutex; /**< stop signal only */
+      std::condition_variable _cv;
+      bool _stop = false;
+      std::thread _thread;
+    };
+
     class AccessLogResponseInterceptor
         : public oatpp::web::server::interceptor::ResponseInterceptor
     {
     private:
-      std::shared_ptr<spdlog::logger> _logger;
+      std::shared_ptr<AccessLog> _access_log;
 
     public:
       AccessLogResponseInterceptor(
-          const std::shared_ptr<spdlog::logger> &logger)
+          const std::shared_ptr<AccessLog> &access_log)
           : oatpp::web::server::interceptor::ResponseInterceptor(),
-            _logger(logger)
+            _access_log(access_log)
       {
       }
 
       std::shared_ptr<OutgoingResponse>
       intercept(const std::shared_ptr<IncomingRequest> &request,
-                const std::shared_ptr<OutgoingResponse> &response) override
-      {
-
-        auto req = request->getStartingLine();
-        std::string access_log = req.protocol.toString() + " \""
-                                 + req.method.toString() + " "
-                                 + req.path.toString() + "\"";
-        access_log += " " + _context.service_name;
-
-        auto outcode = response->getStatus().code;
-
-        access_log += " " + std::to_string(outcode);
-
-        auto req_stop_time = std::chrono::steady_clock::now();
-        auto req_duration_ms
-            = std::chrono::duration_cast<std::chrono::milliseconds>(
-                req_stop_time - _context.req_start_time);
-        access_log += " " + std::to_string(req_duration_ms.count()) + "ms";
-
-        if (outcode == 200 || outcode == 201)
-          _logger->info(access_log);
-        else
-          _logger->error(access_log);
-
-        return response;
-      }
+                const std::shared_ptr<OutgoingResponse> &response) override;
     };
 
     class AccessLogRequestInterceptor
@@ -102,12 +187,7 @@ namespace dd
     {
     public:
       std::shared_ptr<OutgoingResponse>
-      intercept(const std::shared_ptr<IncomingRequest> &request) override
-      {
-        (void)request;
-        initAccessLogRequestStartTime();
-        return nullptr;
-      }
+      intercept(const std::shared_ptr<IncomingRequest> &request) override;
     };
   }
 }
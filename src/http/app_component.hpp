@@ -23,12 +23,14 @@
 #define HTTP_APP_HPP
 
 #include "oatpp/web/protocol/http/incoming/SimpleBodyDecoder.hpp"
+#include "oatpp/web/server/AsyncHttpConnectionHandler.hpp"
 #include "oatpp/web/server/HttpConnectionHandler.hpp"
 #include "oatpp/web/server/HttpRouter.hpp"
 #include "oatpp/web/server/interceptor/AllowCorsGlobal.hpp"
 #include "oatpp/network/ConnectionHandler.hpp"
 #include "oatpp/network/tcp/server/ConnectionProvider.hpp"
 #include "oatpp/parser/json/mapping/ObjectMapper.hpp"
+#include "oatpp/core/async/Executor.hpp"
 #include "oatpp/core/macro/component.hpp"
 #include "oatpp-zlib/EncoderProvider.hpp"
 
@@ -45,15 +47,84 @@
 DECLARE_string(host);
 DECLARE_uint32(port);
 DECLARE_string(allow_origin);
+DECLARE_bool(async_server);
+DECLARE_uint32(io_threads);
+DECLARE_string(access_log_format);
+DECLARE_string(access_log_file);
+DECLARE_double(access_log_sample);
+DECLARE_uint32(access_log_rate);
+DECLARE_uint32(access_log_buffer);
 
 class AppComponent
 {
 private:
   std::shared_ptr<spdlog::logger> _logger;
+  std::shared_ptr<oatpp::async::Executor> _executor; /**< async server */
+  std::shared_ptr<dd::http::AccessLog> _access_log;   /**< nullptr if none */
+
+  /**
+   * Access log from server flags, created before the components below since
+   * the connection handler uses it
+   */
+  static std::shared_ptr<dd::http::AccessLog>
+  createAccessLog(const std::shared_ptr<spdlog::logger> &logger)
+  {
+    if (FLAGS_access_log_format == "none")
+      return nullptr;
+    return std::make_shared<dd::http::AccessLog>(
+        logger,
+        dd::http::AccessLog::format_from_string(FLAGS_access_log_format),
+        FLAGS_access_log_file, FLAGS_access_log_sample, FLAGS_access_log_rate,
+        FLAGS_access_log_buffer);
+  }
+
+  /**
+   * Add access log, CORS and error handling to the connection handler
+   */
+  template <typename THandler>
+  void setupConnectionHandler(
+      const std::shared_ptr<THandler> &connectionHandler,
+      const std::shared_ptr<oatpp::data::mapping::ObjectMapper> &objectMapper)
+  {
+    /* Add AccessLogResponseInterceptor */
+    if (_access_log)
+      {
+        connectionHandler->addRequestInterceptor(
+            std::make_shared<dd::http::AccessLogRequestInterceptor>());
+        connectionHandler->addResponseInterceptor(
+            std::make_shared<dd::http::AccessLogResponseInterceptor>(
+                _access_log));
+      }
+
+    /* Add CORS interceptors */
+    if (!FLAGS_allow_origin.empty())
+      {
+        connectionHandler->addRequestInterceptor(
+            std::make_shared<
+                oatpp::web::server::interceptor::AllowOptionsGlobal>());
+        connectionHandler->addResponseInterceptor(
+            std::make_shared<oatpp::web::server::interceptor::AllowCorsGlobal>(
+                FLAGS_allow_origin.c_str(),
+                "GET, POST, PUT, HEAD, DELETE, PATCH, OPTIONS"));
+      }
+
+    /* Add Error Handler */
+    connectionHandler->setErrorHandler(
+        std::make_shared<ErrorHandler>(objectMapper));
+  }
 
 public:
   AppComponent(const std::shared_ptr<spdlog::logger> &logger)
-      : _logger(logger){};
+      : _logger(logger), _access_log(createAccessLog(logger)){};
+
+  /**
+   * Executor of the async server coroutines, nullptr with the default
+   * server
+   */
+  std::shared_ptr<oatpp::async::Executor> executor() const
+  {
+    return _executor;
+  }
 
 #ifdef USE_OATPP_SWAGGER
   /**
@@ -95,11 +166,12 @@ public:
 
   /**
    *  Create ConnectionHandler component which uses Router component to route
-   * requests, and use oatpp-zlib to compress and decompress input/output
+   * requests, and use oatpp-zlib to compress and decompress input/output.
+   * The async server runs endpoint coroutines on io_threads threads.
    */
   OATPP_CREATE_COMPONENT(std::shared_ptr<oatpp::network::ConnectionHandler>,
                          serverConnectionHandler)
-  ([this] {
+  ([this]() -> std::shared_ptr<oatpp::network::ConnectionHandler> {
     OATPP_COMPONENT(std::shared_ptr<oatpp::web::server::HttpRouter>,
                     router); // get Router component
     OATPP_COMPONENT(std::shared_ptr<oatpp::data::mapping::ObjectMapper>,
@@ -131,32 +203,21 @@ public:
     components->bodyDecoder = std::make_shared<
         oatpp::web::protocol::http::incoming::SimpleBodyDecoder>(decoders);
 
-    auto connectionHandler
-        = std::make_shared<oatpp::web::server::HttpConnectionHandler>(
-            components);
-
-    /* Add AccessLogResponseInterceptor */
-    connectionHandler->addRequestInterceptor(
-        std::make_shared<dd::http::AccessLogRequestInterceptor>());
-    connectionHandler->addResponseInterceptor(
-        std::make_shared<dd::http::AccessLogResponseInterceptor>(_logger));
-
-    /* Add CORS interceptors */
-    if (!FLAGS_allow_origin.empty())
+    if (FLAGS_async_server)
       {
-        connectionHandler->addRequestInterceptor(
-            std::make_shared<
-                oatpp::web::server::interceptor::AllowOptionsGlobal>());
-        connectionHandler->addResponseInterceptor(
-            std::make_shared<oatpp::web::server::interceptor::AllowCorsGlobal>(
-                FLAGS_allow_origin.c_str(),
-                "GET, POST, PUT, HEAD, DELETE, PATCH, OPTIONS"));
+        _executor = std::make_shared<oatpp::async::Executor>(
+            static_cast<v_int32>(std::max(FLAGS_io_threads, 1u)), 1, 1);
+        auto connectionHandler = std::make_shared<
+            oatpp::web::server::AsyncHttpConnectionHandler>(components,
+                                                            _executor);
+        setupConnectionHandler(connectionHandler, objectMapper);
+        return connectionHandler;
       }
 
-    /* Add Error Handler */
-    connectionHandler->setErrorHandler(
-        std::make_shared<ErrorHandler>(objectMapper));
-
+    auto connectionHandler
+        = std::make_shared<oatpp::web::server::HttpConnectionHandler>(
+            components);
+    setupConnectionHandler(connectionHandler, objectMapper);
     return connectionHandler;
   }());
 };
@@ -0,0 +1,805 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTP_ASYNC_CONTROLLER_HPP
+#define HTTP_ASYNC_CONTROLLER_HPP
+
+#include <memory>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+#include <rapidjson/reader.h>
+
+#include "oatpp/web/server/api/ApiController.hpp"
+#include "oatpp/parser/json/mapping/ObjectMapper.hpp"
+#include "oatpp/core/macro/codegen.hpp"
+#include "oatpp/core/macro/component.hpp"
+
+#include "oatppjsonapi.h"
+#include "http/executor_pool.hpp"
+#include "dto/info.hpp"
+#include "dto/service_predict.hpp"
+#include "dto/service_create.hpp"
+#include "dto/stream.hpp"
+#include "dto/resource.hpp"
+
+#include OATPP_CODEGEN_BEGIN(ApiController)
+
+/**
+ * \brief API served by the async server. Endpoints are coroutines run by a
+ * few I/O threads: they read the request body, then hand over the blocking
+ * call to an executor pool, and resume once the response is ready.
+ * Predictions and trainings run on the pool of their service, chains on a
+ * pool of their own, and other calls on a shared pool.
+ */
+class DedeAsyncController : public oatpp::web::server::api::ApiController
+{
+public:
+  DedeAsyncController(dd::OatppJsonAPI *oja,
+                      const std::shared_ptr<ObjectMapper> &objectMapper,
+                      const std::shared_ptr<dd::http::ExecutorPools> &pools)
+      : oatpp::web::server::api::ApiController(objectMapper), _oja(oja),
+        _pools(pools)
+  {
+  }
+
+private:
+  dd::OatppJsonAPI *_oja = nullptr;
+  std::shared_ptr<dd::http::ExecutorPools> _pools;
+
+  typedef oatpp::async::CoroutineStarterForResult<
+      const std::shared_ptr<OutgoingResponse> &>
+      ResponseStarter;
+
+  typedef std::function<std::shared_ptr<OutgoingResponse>()> Call;
+  typedef std::function<std::shared_ptr<OutgoingResponse>(
+      const oatpp::String &)>
+      BodyCall;
+  typedef std::function<std::string(const oatpp::String &)> BodyKey;
+
+  /**
+   * \brief pool of calls that do not run a model, e.g. server info,
+   * service creation, status and deletion, or resources, so that they are
+   * not queued behind predictions
+   */
+  static std::string shared_pool()
+  {
+    return "";
+  }
+
+  /**
+   * \brief pool of all chains, chain names are not known in advance
+   */
+  static std::string chains_pool()
+  {
+    return "chain/";
+  }
+
+  /**
+   * \brief pool of calls to service, pools are only created for existing
+   * services, calls to unknown services fail from the shared pool
+   */
+  std::string service_pool(const std::string &service) const
+  {
+    if (!service.empty() && _oja->service_exists(service))
+      return service;
+    return shared_pool();
+  }
+
+  /**
+   * \brief runs call on the executor pool of key, a call that throws
+   * returns an internal error
+   */
+  ResponseStarter offload(const std::string &key, Call call)
+  {
+    dd::OatppJsonAPI *oja = _oja;
+    auto async_call
+        = _pools->submit(key, call, [oja](const std::string &what) {
+            return oja->jdoc_to_response(oja->dd_internal_error_500(what));
+          });
+    if (!async_call)
+      {
+        async_call = std::make_shared<dd::http::AsyncCall>();
+        async_call->set(
+            _oja->jdoc_to_response(_oja->dd_resource_exhausted_1016()));
+      }
+    return dd::http::AwaitCall::startForResult(async_call);
+  }
+
+  /**
+   * \brief reads the request body, then runs call on the executor pool
+   * of key(body)
+   */
+  class OffloadBody
+      : public oatpp::async::CoroutineWithResult<
+            OffloadBody, const std::shared_ptr<OutgoingResponse> &>
+  {
+  public:
+    OffloadBody(DedeAsyncController *controller,
+                const std::shared_ptr<IncomingRequest> &request,
+                const BodyKey &key, const BodyCall &call)
+        : _controller(controller), _request(request), _key(key), _call(call)
+    {
+    }
+
+    Action act() override
+    {
+      return _request->readBodyToStringAsync().callbackTo(
+          &OffloadBody::onBody);
+    }
+
+    Action onBody(const oatpp::String &body)
+    {
+      BodyCall call = _call;
+      return _controller
+          ->offload(_key(body), [call, body]() { return call(body); })
+          .callbackTo(&OffloadBody::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+
+  private:
+    DedeAsyncController *_controller;
+    std::shared_ptr<IncomingRequest> _request;
+    BodyKey _key;
+    BodyCall _call;
+  };
+
+  /**
+   * \brief reads the request body, then runs call on the pool of key
+   */
+  ResponseStarter offload_body(const std::shared_ptr<IncomingRequest> &request,
+                               const std::string &key, const BodyCall &call)
+  {
+    return OffloadBody::startForResult(
+        this, request, [key](const oatpp::String &) { return key; }, call);
+  }
+
+  /**
+   * \brief reads the request body, then runs call on the pool of the
+   * service named in the body
+   */
+  ResponseStarter offload_body(const std::shared_ptr<IncomingRequest> &request,
+                               const BodyCall &call)
+  {
+    DedeAsyncController *ctl = this;
+    return OffloadBody::startForResult(
+        this, request,
+        [ctl](const oatpp::String &body) {
+          return ctl->service_pool(body_service(body));
+        },
+        call);
+  }
+
+  /**
+   * \brief value of the top-level "service" key of a JSON body, the body is
+   * only scanned up to this key
+   */
+  static std::string body_service(const oatpp::String &body)
+  {
+    struct ServiceHandler
+        : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>,
+                                              ServiceHandler>
+    {
+      int _depth = 0;
+      bool _key = false;
+      std::string _service;
+
+      bool Default()
+      {
+        _key = false;
+        return true;
+      }
+      bool StartObject()
+      {
+        ++_depth;
+        return Default();
+      }
+      bool EndObject(rapidjson::SizeType)
+      {
+        --_depth;
+        return true;
+      }
+      bool StartArray()
+      {
+        ++_depth;
+        return Default();
+      }
+      bool EndArray(rapidjson::SizeType)
+      {
+        --_depth;
+        return true;
+      }
+      bool Key(const char *str, rapidjson::SizeType len, bool)
+      {
+        _key = _depth == 1 && std::string(str, len) == "service";
+        return true;
+      }
+      bool String(const char *str, rapidjson::SizeType len, bool)
+      {
+        if (!_key)
+          return true;
+        _service.assign(str, len);
+        return false; // stop parsing
+      }
+    };
+
+    if (!body)
+      return "";
+    ServiceHandler handler;
+    rapidjson::Reader reader;
+    rapidjson::StringStream ss(body->c_str());
+    reader.Parse(ss, handler);
+    return handler._service;
+  }
+
+public:
+  static std::shared_ptr<DedeAsyncController>
+  createShared(dd::OatppJsonAPI *oja,
+               const std::shared_ptr<dd::http::ExecutorPools> &pools,
+               OATPP_COMPONENT(std::shared_ptr<ObjectMapper>, objectMapper))
+  {
+    return std::make_shared<DedeAsyncController>(oja, objectMapper, pools);
+  }
+
+  ENDPOINT_INFO(get_info)
+  {
+    info->summary = "Retrieve server information";
+    info->addResponse<Object<dd::DTO::InfoResponse>>(Status::CODE_200,
+                                                     "application/json");
+  }
+  ENDPOINT_ASYNC("GET", "info", get_info)
+  {
+    ENDPOINT_ASYNC_INIT(get_info)
+
+    Action act() override
+    {
+      oatpp::String qs_status = request->getQueryParameter("status");
+      bool status = false;
+      if (qs_status)
+        status = boost::lexical_cast<bool>(std::string(qs_status));
+      DedeAsyncController *ctl = controller;
+      return controller
+          ->offload(shared_pool(),
+                    [ctl, status]() {
+                      return ctl->createDtoResponse(
+                          Status::CODE_200,
+                          ctl->_oja->create_info(
+                              status, ctl->getDefaultObjectMapper()));
+                    })
+          .callbackTo(&get_info::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(get_service)
+  {
+    info->summary = "Retrieve a service detail";
+  }
+  ENDPOINT_ASYNC("GET", "services/{service-name}", get_service)
+  {
+    ENDPOINT_ASYNC_INIT(get_service)
+
+    Action act() override
+    {
+      std::string service_name = request->getPathVariable("service-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload(shared_pool(),
+                    [oja, service_name]() {
+                      return oja->jdoc_to_response(
+                          oja->service_status(service_name));
+                    })
+          .callbackTo(&get_service::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(create_service)
+  {
+    info->summary = "Create a service";
+    info->addConsumes<Object<dd::DTO::ServiceCreate>>("application/json");
+  }
+  ENDPOINT_ASYNC("POST", "services/{service-name}", create_service)
+  {
+    ENDPOINT_ASYNC_INIT(create_service)
+
+    Action act() override
+    {
+      std::string service_name = request->getPathVariable("service-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload_body(request, shared_pool(),
+                         [oja, service_name](const oatpp::String &data) {
+                           return oja->jdoc_to_response(
+                               oja->service_create(service_name, data));
+                         })
+          .callbackTo(&create_service::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(update_service)
+  {
+    // Don't document PUT, it's a dup of POST, maybe deprecate it later
+    info->hide = true;
+  }
+  ENDPOINT_ASYNC("PUT", "services/{service-name}", update_service)
+  {
+    ENDPOINT_ASYNC_INIT(update_service)
+
+    Action act() override
+    {
+      std::string service_name = request->getPathVariable("service-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload_body(request, shared_pool(),
+                         [oja, service_name](const oatpp::String &data) {
+                           return oja->jdoc_to_response(
+                               oja->service_create(service_name, data));
+                         })
+          .callbackTo(&update_service::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(delete_service)
+  {
+    info->summary = "Delete a service";
+  }
+  ENDPOINT_ASYNC("DELETE", "services/{service-name}", delete_service)
+  {
+    ENDPOINT_ASYNC_INIT(delete_service)
+
+    Action act() override
+    {
+      std::string service_name = request->getPathVariable("service-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      std::string jsonstr
+          = oja->uri_query_to_json(request->getQueryParameters());
+      std::shared_ptr<dd::http::ExecutorPools> pools = controller->_pools;
+      return controller
+          ->offload(shared_pool(),
+                    [oja, pools, service_name, jsonstr]() {
+                      auto response = oja->jdoc_to_response(
+                          oja->service_delete(service_name, jsonstr));
+                      if (!oja->service_exists(service_name))
+                        pools->remove(service_name);
+                      return response;
+                    })
+          .callbackTo(&delete_service::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(predict)
+  {
+    info->summary = "Predict";
+    info->addConsumes<Object<dd::DTO::ServicePredict>>("application/json");
+  }
+  ENDPOINT_ASYNC("POST", "predict", predict)
+  {
+    ENDPOINT_ASYNC_INIT(predict)
+
+    Action act() override
+    {
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload_body(request,
+                         [oja](const oatpp::String &predict_data) {
+                           return oja->jdoc_to_response(
+                               oja->service_predict(predict_data));
+                         })
+          .callbackTo(&predict::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(get_train)
+  {
+    info->summary = "Retrieve a training status";
+  }
+  ENDPOINT_ASYNC("GET", "train", get_train)
+  {
+    ENDPOINT_ASYNC_INIT(get_train)
+
+    Action act() override
+    {
+      dd::OatppJsonAPI *oja = controller->_oja;
+      oatpp::String service_name = request->getQueryParameter("service");
+      std::string jsonstr
+          = oja->uri_query_to_json(request->getQueryParameters());
+      return controller
+          ->offload(controller->service_pool(
+                        service_name ? std::string(service_name) : ""),
+                    [oja, jsonstr]() {
+                      return oja->jdoc_to_response(
+                          oja->service_train_status(jsonstr));
+                    })
+          .callbackTo(&get_train::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(post_train)
+  {
+    info->summary = "Do a training";
+  }
+  ENDPOINT_ASYNC("POST", "train", post_train)
+  {
+    ENDPOINT_ASYNC_INIT(post_train)
+
+    Action act() override
+    {
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload_body(request,
+                         [oja](const oatpp::String &train_data) {
+                           return oja->jdoc_to_response(
+                               oja->service_train(train_data));
+                         })
+          .callbackTo(&post_train::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(put_train)
+  {
+    // Don't document PUT, it's a dup of POST, maybe deprecate it later
+    info->hide = true;
+  }
+  ENDPOINT_ASYNC("PUT", "train", put_train)
+  {
+    ENDPOINT_ASYNC_INIT(put_train)
+
+    Action act() override
+    {
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload_body(request,
+                         [oja](const oatpp::String &train_data) {
+                           return oja->jdoc_to_response(
+                               oja->service_train(train_data));
+                         })
+          .callbackTo(&put_train::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(delete_train)
+  {
+    info->summary = "Delete a training";
+  }
+  ENDPOINT_ASYNC("DELETE", "train", delete_train)
+  {
+    ENDPOINT_ASYNC_INIT(delete_train)
+
+    Action act() override
+    {
+      dd::OatppJsonAPI *oja = controller->_oja;
+      oatpp::String service_name = request->getQueryParameter("service");
+      std::string jsonstr
+          = oja->uri_query_to_json(request->getQueryParameters());
+      return controller
+          ->offload(controller->service_pool(
+                        service_name ? std::string(service_name) : ""),
+                    [oja, jsonstr]() {
+                      return oja->jdoc_to_response(
+                          oja->service_train_delete(jsonstr));
+                    })
+          .callbackTo(&delete_train::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(create_chain)
+  {
+    info->summary = "Run a chain";
+  }
+  ENDPOINT_ASYNC("POST", "chain/{chain-name}", create_chain)
+  {
+    ENDPOINT_ASYNC_INIT(create_chain)
+
+    Action act() override
+    {
+      std::string chain_name = request->getPathVariable("chain-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload_body(request, chains_pool(),
+                         [oja, chain_name](const oatpp::String &chain_data) {
+                           return oja->jdoc_to_response(
+                               oja->service_chain(chain_name, chain_data));
+                         })
+          .callbackTo(&create_chain::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(update_chain)
+  {
+    // Don't document PUT, it's a dup of POST, maybe deprecate it later
+    info->hide = true;
+  }
+  ENDPOINT_ASYNC("PUT", "chain/{chain-name}", update_chain)
+  {
+    ENDPOINT_ASYNC_INIT(update_chain)
+
+    Action act() override
+    {
+      std::string chain_name = request->getPathVariable("chain-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload_body(request, chains_pool(),
+                         [oja, chain_name](const oatpp::String &chain_data) {
+                           return oja->jdoc_to_response(
+                               oja->service_chain(chain_name, chain_data));
+                         })
+          .callbackTo(&update_chain::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(create_resource)
+  {
+    info->summary = "Create/Open a resource for multiple predict calls";
+    info->addResponse<Object<dd::DTO::ResourceResponse>>(Status::CODE_201,
+                                                         "application/json");
+  }
+  ENDPOINT_ASYNC("PUT", "resources/{resource-name}", create_resource)
+  {
+    ENDPOINT_ASYNC_INIT(create_resource)
+
+    Action act() override
+    {
+      return request
+          ->readBodyToDtoAsync<oatpp::Object<dd::DTO::Resource>>(
+              controller->getDefaultObjectMapper())
+          .callbackTo(&create_resource::onBody);
+    }
+
+    Action onBody(const oatpp::Object<dd::DTO::Resource> &resource_data)
+    {
+      std::string resource_name = request->getPathVariable("resource-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload(shared_pool(),
+                    [oja, resource_name, resource_data]() {
+                      return oja->create_resource_response(resource_name,
+                                                           resource_data);
+                    })
+          .callbackTo(&create_resource::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(get_resource)
+  {
+    info->summary = "Get resource information and status";
+    info->addResponse<Object<dd::DTO::ResourceResponse>>(Status::CODE_200,
+                                                         "application/json");
+  }
+  ENDPOINT_ASYNC("GET", "resources/{resource-name}", get_resource)
+  {
+    ENDPOINT_ASYNC_INIT(get_resource)
+
+    Action act() override
+    {
+      std::string resource_name = request->getPathVariable("resource-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload(shared_pool(),
+                    [oja, resource_name]() {
+                      return oja->get_resource_response(resource_name);
+                    })
+          .callbackTo(&get_resource::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(delete_resource)
+  {
+    info->summary = "Close and delete an opened resource";
+    info->addResponse<Object<dd::DTO::GenericResponse>>(Status::CODE_200,
+                                                        "application/json");
+  }
+  ENDPOINT_ASYNC("DELETE", "resources/{resource-name}", delete_resource)
+  {
+    ENDPOINT_ASYNC_INIT(delete_resource)
+
+    Action act() override
+    {
+      std::string resource_name = request->getPathVariable("resource-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload(shared_pool(),
+                    [oja, resource_name]() {
+                      return oja->delete_resource_response(resource_name);
+                    })
+          .callbackTo(&delete_resource::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(create_stream)
+  {
+    info->summary = "Create a streaming prediction, ie prediction on "
+                    "streaming resource with a streamed output.";
+    info->addResponse<Object<dd::DTO::StreamResponse>>(Status::CODE_201,
+                                                       "application/json");
+  }
+  ENDPOINT_ASYNC("PUT", "stream/{stream-name}", create_stream)
+  {
+    ENDPOINT_ASYNC_INIT(create_stream)
+
+    Action act() override
+    {
+      return request
+          ->readBodyToDtoAsync<oatpp::Object<dd::DTO::Stream>>(
+              controller->getDefaultObjectMapper())
+          .callbackTo(&create_stream::onBody);
+    }
+
+    Action onBody(const oatpp::Object<dd::DTO::Stream> &stream_data)
+    {
+      std::string stream_name = request->getPathVariable("stream-name");
+      DedeAsyncController *ctl = controller;
+      return controller
+          ->offload(shared_pool(),
+                    [ctl, stream_name, stream_data]() {
+                      return ctl->createDtoResponse(
+                          Status::CODE_201,
+                          ctl->_oja->create_stream(stream_name, stream_data));
+                    })
+          .callbackTo(&create_stream::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(get_stream_info)
+  {
+    info->summary = "Get information on running stream";
+    info->addResponse<Object<dd::DTO::StreamResponse>>(Status::CODE_200,
+                                                       "application/json");
+  }
+  ENDPOINT_ASYNC("GET", "stream/{stream-name}", get_stream_info)
+  {
+    ENDPOINT_ASYNC_INIT(get_stream_info)
+
+    Action act() override
+    {
+      std::string stream_name = request->getPathVariable("stream-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload(shared_pool(),
+                    [oja, stream_name]() {
+                      return oja->dto_to_response(
+                          oja->get_stream_info(stream_name), 200, "");
+                    })
+          .callbackTo(&get_stream_info::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+
+  ENDPOINT_INFO(delete_stream)
+  {
+    info->summary = "Stop and remove a running stream";
+    info->addResponse<Object<dd::DTO::GenericResponse>>(Status::CODE_200,
+                                                        "application/json");
+  }
+  ENDPOINT_ASYNC("DELETE", "stream/{stream-name}", delete_stream)
+  {
+    ENDPOINT_ASYNC_INIT(delete_stream)
+
+    Action act() override
+    {
+      std::string stream_name = request->getPathVariable("stream-name");
+      dd::OatppJsonAPI *oja = controller->_oja;
+      return controller
+          ->offload(shared_pool(),
+                    [oja, stream_name]() {
+                      int status = oja->delete_stream(stream_name);
+                      return oja->dto_to_response(
+                          dd::DTO::GenericResponse::createShared(), status,
+                          "");
+                    })
+          .callbackTo(&delete_stream::onResponse);
+    }
+
+    Action onResponse(const std::shared_ptr<OutgoingResponse> &response)
+    {
+      return _return(response);
+    }
+  };
+};
+
+#include OATPP_CODEGEN_END(ApiController)
+
+#endif // HTTP_ASYNC_CONTROLLER_HPP
@@ -71,32 +71,12 @@ public:
   }
   ENDPOINT("GET", "info", get_info, QUERIES(QueryParams, queryParams))
   {
-    auto info_resp = dd::DTO::InfoResponse::createShared();
-    info_resp->head = dd::DTO::InfoHead::createShared();
-    info_resp->head->services = {};
-
     oatpp::String qs_status = queryParams.get("status");
     bool status = false;
     if (qs_status)
       status = boost::lexical_cast<bool>(std::string(qs_status));
-
-    auto hit = _oja->_mlservices.begin();
-    while (hit != _oja->_mlservices.end())
-      {
-        // TODO(sileht): update visitor_info to return directly a Service()
-        JDoc jd;
-        jd.SetObject();
-        mapbox::util::apply_visitor(dd::visitor_info(status), (*hit).second)
-            .toJDoc(jd);
-        auto json_str = _oja->jrender(jd);
-        auto service_info
-            = getDefaultObjectMapper()
-                  ->readFromString<oatpp::Object<dd::DTO::Service>>(
-                      json_str.c_str());
-        info_resp->head->services->emplace_back(service_info);
-        ++hit;
-      }
-    return createDtoResponse(Status::CODE_200, info_resp);
+    return createDtoResponse(
+        Status::CODE_200, _oja->create_info(status, getDefaultObjectMapper()));
   }
 
   ENDPOINT_INFO(get_service)
@@ -237,25 +217,7 @@ public:
            PATH(oatpp::String, resource_name, "resource-name"),
            BODY_DTO(Object<dd::DTO::Resource>, resource_data))
   {
-    try
-      {
-        return _oja->dto_to_response(
-            _oja->create_resource(resource_name, resource_data), 201,
-            "Created");
-      }
-    catch (dd::ResourceBadParamException &e)
-      {
-        return _oja->response_bad_request_400(e.what());
-      }
-    catch (dd::ResourceForbiddenException &e)
-      {
-        return _oja->response_resource_already_exists_1015();
-      }
-    catch (std::exception &e)
-      {
-        return _oja->response_internal_error_500(e.what());
-      }
-    return _oja->response_internal_error_500();
+    return _oja->create_resource_response(resource_name, resource_data);
   }
 
   ENDPOINT_INFO(get_resource)
@@ -267,20 +229,7 @@ public:
   ENDPOINT("GET", "resources/{resource-name}", get_resource,
            PATH(oatpp::String, resource_name, "resource-name"))
   {
-    try
-      {
-        auto res_dto = _oja->get_resource(resource_name);
-        return _oja->dto_to_response(res_dto, 200, "OK");
-      }
-    catch (dd::ResourceNotFoundException &e)
-      {
-        return _oja->response_not_found_404();
-      }
-    catch (std::exception &e)
-      {
-        return _oja->response_internal_error_500(e.what());
-      }
-    return _oja->response_internal_error_500();
+    return _oja->get_resource_response(resource_name);
   }
 
   ENDPOINT_INFO(delete_resource)
@@ -292,21 +241,7 @@ public:
   ENDPOINT("DELETE", "resources/{resource-name}", delete_resource,
            PATH(oatpp::String, resource_name, "resource-name"))
   {
-    try
-      {
-        _oja->delete_resource(resource_name);
-        return _oja->dto_to_response(dd::DTO::GenericResponse::createShared(),
-                                     200, "OK");
-      }
-    catch (dd::ResourceNotFoundException &e)
-      {
-        return _oja->response_not_found_404();
-      }
-    catch (std::exception &e)
-      {
-        return _oja->response_internal_error_500(e.what());
-      }
-    return _oja->response_internal_error_500();
+    return _oja->delete_resource_response(resource_name);
   }
 
   ENDPOINT_INFO(create_stream)
@@ -0,0 +1,180 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "executor_pool.hpp"
+#include "access_log.hpp"
+#include "dd_spdlog.h"
+
+#include <thread>
+
+namespace dd
+{
+  namespace http
+  {
+    /** \brief idle time after which a pool thread exits */
+    static const std::chrono::seconds executor_idle_timeout(60);
+
+    static void log_call_error(const std::string &what)
+    {
+      auto logger = spdlog::get("api");
+      if (logger)
+        logger->error("executor call failed: {}", what);
+    }
+
+    bool ExecutorPool::submit(std::function<void()> job)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (_stop || (_max_queued > 0 && _jobs.size() >= _max_queued))
+        return false;
+      _jobs.push_back(std::move(job));
+      if (static_cast<int>(_jobs.size()) > _idle && _threads < _workers)
+        {
+          ++_threads;
+          std::thread(&ExecutorPool::work, shared_from_this()).detach();
+        }
+      else
+        _cv.notify_one();
+      return true;
+    }
+
+    void ExecutorPool::stop()
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _stop = true;
+      _cv.notify_all();
+    }
+
+    void ExecutorPool::work()
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      while (true)
+        {
+          if (_jobs.empty())
+            {
+              ++_idle;
+              bool woken = _cv.wait_for(lock, executor_idle_timeout, [this]() {
+                return _stop || !_jobs.empty();
+              });
+              --_idle;
+              if (!woken || _jobs.empty())
+                {
+                  --_threads;
+                  return;
+                }
+            }
+          std::function<void()> job = std::move(_jobs.front());
+          _jobs.pop_front();
+          lock.unlock();
+          try
+            {
+              job();
+            }
+          catch (std::exception &e)
+            {
+              log_call_error(e.what());
+            }
+          catch (...)
+            {
+              log_call_error("unknown exception");
+            }
+          job = nullptr;
+          lock.lock();
+        }
+    }
+
+    ExecutorPools::~ExecutorPools()
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (auto &p : _pools)
+        p.second->stop();
+    }
+
+    void ExecutorPools::remove(const std::string &key)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      auto p = _pools.find(key);
+      if (p == _pools.end())
+        return;
+      // queued calls still run, threads exit once the queue is empty
+      p->second->stop();
+      _pools.erase(p);
+    }
+
+    std::shared_ptr<AsyncCall> ExecutorPools::submit(
+        const std::string &key,
+        std::function<std::shared_ptr<OutgoingResponse>()> call,
+        std::function<std::shared_ptr<OutgoingResponse>(const std::string &)>
+            error_response)
+    {
+      std::shared_ptr<ExecutorPool> pool;
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto &p = _pools[key];
+        if (!p)
+          p = std::make_shared<ExecutorPool>(_workers, _max_queued);
+        pool = p;
+      }
+
+      auto async_call = std::make_shared<AsyncCall>();
+      auto submitted = std::chrono::steady_clock::now();
+      bool queued = pool->submit([async_call, call, error_response,
+                                  submitted]() {
+        int64_t queue_us
+            = std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - submitted)
+                  .count();
+        std::shared_ptr<OutgoingResponse> response;
+        std::string error;
+        try
+          {
+            response = call();
+          }
+        catch (std::exception &e)
+          {
+            error = e.what();
+          }
+        catch (...)
+          {
+            error = "unknown exception";
+          }
+        if (!response)
+          {
+            // the coroutine gets an error response rather than a failure
+            if (error.empty())
+              error = "no response";
+            log_call_error(error);
+            try
+              {
+                response = error_response(error);
+              }
+            catch (...)
+              {
+              }
+          }
+        if (response)
+          setAccessLogQueueWait(response, queue_us);
+        async_call->set(response);
+      });
+      if (!queued)
+        return nullptr;
+      return async_call;
+    }
+  }
+}
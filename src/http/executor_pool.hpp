@@ -0,0 +1,210 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTP_EXECUTOR_POOL_HPP
+#define HTTP_EXECUTOR_POOL_HPP
+
+#include "oatpp/core/async/Coroutine.hpp"
+#include "oatpp/core/async/CoroutineWaitList.hpp"
+#include "oatpp/web/protocol/http/outgoing/Response.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace dd
+{
+  namespace http
+  {
+    typedef oatpp::web::protocol::http::outgoing::Response OutgoingResponse;
+
+    /**
+     * \brief bounded pool of threads running blocking calls. Threads are
+     * started on demand, up to workers, and exit after being idle for a
+     * while, so that pools of unused services hold no thread.
+     */
+    class ExecutorPool : public std::enable_shared_from_this<ExecutorPool>
+    {
+    public:
+      /**
+       * @param workers max number of threads
+       * @param max_queued max number of calls waiting for a thread, 0 means
+       * unbounded
+       */
+      ExecutorPool(const int &workers, const size_t &max_queued)
+          : _workers(std::max(workers, 1)), _max_queued(max_queued)
+      {
+      }
+
+      /**
+       * \brief queues job, returns false if the queue is full
+       */
+      bool submit(std::function<void()> job);
+
+      /**
+       * \brief lets threads exit once the queue is empty
+       */
+      void stop();
+
+    private:
+      void work();
+
+      int _workers;
+      size_t _max_queued;
+      std::mutex _mutex;
+      std::condition_variable _cv;
+      std::deque<std::function<void()>> _jobs;
+      int _threads = 0; /**< running threads */
+      int _idle = 0;    /**< threads waiting for a job */
+      bool _stop = false;
+    };
+
+    /**
+     * \brief response of a call running on an executor pool. An endpoint
+     * coroutine waits for it on a wait list, without holding an I/O thread.
+     */
+    class AsyncCall : public oatpp::async::CoroutineWaitList::Listener
+    {
+    public:
+      AsyncCall()
+      {
+        _waitlist.setListener(this);
+      }
+
+      ~AsyncCall()
+      {
+        _waitlist.setListener(nullptr);
+      }
+
+      /**
+       * \brief sets response and wakes up the waiting coroutine, response
+       * is nullptr if the call failed
+       */
+      void set(const std::shared_ptr<OutgoingResponse> &response)
+      {
+        {
+          std::lock_guard<std::mutex> lock(_mutex);
+          _response = response;
+          _done = true;
+        }
+        _waitlist.notifyAll();
+      }
+
+      bool done(std::shared_ptr<OutgoingResponse> &response)
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        response = _response;
+        return _done;
+      }
+
+      /**
+       * \brief covers a call completed between the coroutine check and its
+       * insertion into the wait list
+       */
+      void onNewItem(oatpp::async::CoroutineWaitList &list) override
+      {
+        std::shared_ptr<OutgoingResponse> response;
+        if (done(response))
+          list.notifyAll();
+      }
+
+      oatpp::async::CoroutineWaitList _waitlist;
+
+    private:
+      std::mutex _mutex;
+      std::shared_ptr<OutgoingResponse> _response;
+      bool _done = false;
+    };
+
+    /**
+     * \brief coroutine returning the response of an AsyncCall
+     */
+    class AwaitCall
+        : public oatpp::async::CoroutineWithResult<
+              AwaitCall, const std::shared_ptr<OutgoingResponse> &>
+    {
+    public:
+      AwaitCall(const std::shared_ptr<AsyncCall> &call) : _call(call)
+      {
+      }
+
+      Action act() override
+      {
+        std::shared_ptr<OutgoingResponse> response;
+        if (!_call->done(response))
+          return Action::createWaitListAction(&_call->_waitlist);
+        if (!response)
+          return error<oatpp::async::Error>("call failed");
+        return _return(response);
+      }
+
+    private:
+      std::shared_ptr<AsyncCall> _call;
+    };
+
+    /**
+     * \brief one executor pool per key (existing service name, or shared
+     * key), created on first use, so that a slow service cannot starve the
+     * others
+     */
+    class ExecutorPools
+    {
+    public:
+      ExecutorPools(const int &workers, const size_t &max_queued)
+          : _workers(workers), _max_queued(max_queued)
+      {
+      }
+
+      ~ExecutorPools();
+
+      /**
+       * \brief runs call on the pool of key
+       * @param error_response builds the response of a call that threw or
+       * returned nothing, from the error message
+       * @return call to wait for, nullptr if the pool queue is full
+       */
+      std::shared_ptr<AsyncCall>
+      submit(const std::string &key,
+             std::function<std::shared_ptr<OutgoingResponse>()> call,
+             std::function<
+                 std::shared_ptr<OutgoingResponse>(const std::string &)>
+                 error_response);
+
+      /**
+       * \brief drops the pool of key, e.g. of a deleted service
+       */
+      void remove(const std::string &key);
+
+    private:
+      int _workers;
+      size_t _max_queued;
+      std::mutex _mutex;
+      std::unordered_map<std::string, std::shared_ptr<ExecutorPool>> _pools;
+    };
+  }
+}
+
+#endif
@@ -27,5 +27,34 @@
 DEFINE_string(host, "localhost", "host for running the server");
 DEFINE_uint32(port, 8080, "server port");
 DEFINE_string(allow_origin, "", "Access-Control-Allow-Origin for the server");
+DEFINE_bool(async_server, false,
+            "serve requests from a few I/O threads, predict, train and "
+            "chain calls running on per service executor pools");
+DEFINE_uint32(io_threads, 2, "number of I/O threads of the async server");
+DEFINE_uint32(service_workers, 2,
+              "async server: max number of calls running at once per service");
+DEFINE_uint32(service_queue, 64,
+              "async server: max number of calls waiting per service, "
+              "0 for no limit");
+DEFINE_string(unix_socket, "",
+              "also serve the API on this Unix domain socket path, for "
+              "clients on the same host");
+DEFINE_string(unix_socket_mode, "0660",
+              "permissions of the Unix domain socket file, in octal");
+DEFINE_bool(shm_data, false,
+            "accept shm:// data URIs, i.e. reading inputs from shared "
+            "memory segments of the server user, requires -unix_socket");
+DEFINE_string(access_log_format, "text",
+              "access log format: text, json (one object per line) or none");
+DEFINE_string(access_log_file, "",
+              "file to append access log records to, server log if empty");
+DEFINE_double(access_log_sample, 1.0,
+              "fraction of successful calls to log, errors are always "
+              "logged");
+DEFINE_uint32(access_log_rate, 0,
+              "max access log records per second, 0 for no limit");
+DEFINE_uint32(access_log_buffer, 8192,
+              "max access log records waiting to be written, beyond which "
+              "records are dropped");
 
 #endif // HTTP_FLAGS_H
@@ -0,0 +1,142 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unix_socket.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace dd
+{
+  namespace http
+  {
+    void UnixSocketConnectionProvider::ConnectionInvalidator::invalidate(
+        const std::shared_ptr<oatpp::data::stream::IOStream> &connection)
+    {
+      auto c = std::static_pointer_cast<oatpp::network::tcp::Connection>(
+          connection);
+      ::shutdown(c->getHandle(), SHUT_RDWR);
+    }
+
+    UnixSocketConnectionProvider::UnixSocketConnectionProvider(
+        const std::string &path, const mode_t &mode)
+        : _path(path), _invalidator(std::make_shared<ConnectionInvalidator>())
+    {
+      struct sockaddr_un addr;
+      std::memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("invalid unix socket path " + path);
+      std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+      // a socket file left by a previous server is replaced, unless a
+      // server still accepts connections on it
+      struct stat st;
+      if (::lstat(path.c_str(), &st) == 0)
+        {
+          bool stale = false;
+          if (S_ISSOCK(st.st_mode))
+            {
+              int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+              stale = probe >= 0
+                      && ::connect(probe,
+                                   reinterpret_cast<struct sockaddr *>(&addr),
+                                   sizeof(addr))
+                             != 0
+                      && errno == ECONNREFUSED;
+              if (probe >= 0)
+                ::close(probe);
+            }
+          if (!stale)
+            throw std::runtime_error("unix socket path " + path
+                                     + " already in use");
+          ::unlink(path.c_str());
+        }
+
+      int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd < 0)
+        throw std::runtime_error("cannot create unix socket: "
+                                 + std::string(std::strerror(errno)));
+
+      bool bound = ::bind(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                          sizeof(addr))
+                   == 0;
+      if (!bound || ::chmod(path.c_str(), mode) != 0
+          || ::listen(fd, SOMAXCONN) != 0)
+        {
+          std::string err = std::strerror(errno);
+          ::close(fd);
+          if (bound)
+            ::unlink(path.c_str());
+          throw std::runtime_error("cannot listen on unix socket " + path
+                                   + ": " + err);
+        }
+      _fd = fd;
+      setProperty(PROPERTY_HOST, path.c_str());
+      setProperty(PROPERTY_PORT, "0");
+    }
+
+    UnixSocketConnectionProvider::~UnixSocketConnectionProvider()
+    {
+      stop();
+      int fd = _fd.exchange(-1);
+      if (fd >= 0)
+        ::close(fd);
+    }
+
+    oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream>
+    UnixSocketConnectionProvider::get()
+    {
+      int fd = _fd.load();
+      if (fd < 0)
+        return nullptr;
+      struct pollfd pfd;
+      pfd.fd = fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      if (::poll(&pfd, 1, 500) <= 0 || !(pfd.revents & POLLIN))
+        return nullptr;
+      int handle = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (handle < 0)
+        return nullptr;
+      return oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream>(
+          std::make_shared<oatpp::network::tcp::Connection>(handle),
+          _invalidator);
+    }
+
+    void UnixSocketConnectionProvider::stop()
+    {
+      // wakes up a pending poll, the socket is closed on destruction
+      int fd = _fd.load();
+      if (fd >= 0 && !_path.empty())
+        {
+          ::shutdown(fd, SHUT_RDWR);
+          ::unlink(_path.c_str());
+          _path.clear();
+        }
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTP_UNIX_SOCKET_HPP
+#define HTTP_UNIX_SOCKET_HPP
+
+#include "oatpp/network/ConnectionProvider.hpp"
+#include "oatpp/network/tcp/Connection.hpp"
+
+#include <atomic>
+#include <string>
+
+namespace dd
+{
+  namespace http
+  {
+    /**
+     * \brief server connection provider listening on a Unix domain socket,
+     * for clients on the same host: same REST API as the TCP server,
+     * without the network stack. Accepted sockets are wrapped into oatpp
+     * tcp connections, that only rely on file descriptor I/O.
+     */
+    class UnixSocketConnectionProvider
+        : public oatpp::network::ServerConnectionProvider
+    {
+    private:
+      /**
+       * \brief shuts down a connection from the connection handler
+       */
+      class ConnectionInvalidator
+          : public oatpp::provider::Invalidator<
+                oatpp::data::stream::IOStream>
+      {
+      public:
+        void invalidate(
+            const std::shared_ptr<oatpp::data::stream::IOStream> &connection)
+            override;
+      };
+
+    public:
+      /**
+       * \brief binds and listens, throws on failure
+       * @param path socket path, replaced if it is a stale socket
+       * @param mode socket file permissions
+       */
+      UnixSocketConnectionProvider(const std::string &path,
+                                   const mode_t &mode);
+
+      ~UnixSocketConnectionProvider();
+
+      static std::shared_ptr<UnixSocketConnectionProvider>
+      createShared(const std::string &path, const mode_t &mode)
+      {
+        return std::make_shared<UnixSocketConnectionProvider>(path, mode);
+      }
+
+      /**
+       * \brief next connection, or an empty handle after a short timeout so
+       * that the server loop can check for stop
+       */
+      oatpp::provider::ResourceHandle<oatpp::data::stream::IOStream>
+      get() override;
+
+      oatpp::async::CoroutineStarterForResult<
+          const oatpp::provider::ResourceHandle<
+              oatpp::data::stream::IOStream> &>
+      getAsync() override
+      {
+        // connections are accepted by the server thread, also with the
+        // async connection handler
+        throw std::runtime_error(
+            "UnixSocketConnectionProvider::getAsync not implemented");
+      }
+
+      /**
+       * \brief stops listening and removes the socket file
+       */
+      void stop() override;
+
+    private:
+      std::string _path;
+      std::atomic<int> _fd{ -1 };
+      std::shared_ptr<ConnectionInvalidator> _invalidator;
+    };
+  }
+}
+
+#endif
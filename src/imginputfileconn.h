@@ -41,8 +41,9 @@
 #define CV_BGR2YCrCb cv::COLOR_BGR2YCrCb
 #define CV_INTER_CUBIC cv::INTER_CUBIC
 #endif
-#include "ext/base64/base64.h"
 #include "utils/apitools.h"
+#include "utils/base64.hpp"
+#include "utils/cv_utils.hpp"
 #include <random>
 
 #include "dto/input_connector.hpp"
@@ -60,38 +61,6 @@ namespace dd
     {
     }
 
-    // base64 detection
-    bool is_within_base64_range(char c) const
-    {
-      if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')
-          || (c >= '0' && c <= '9') || (c == '+' || c == '/' || c == '='))
-        return true;
-      else
-        return false;
-    }
-
-    bool possibly_base64(const std::string &s) const
-    {
-      bool ism = is_multiple_four(s);
-      if (!ism)
-        return false;
-      for (char c : s)
-        {
-          bool within_64 = is_within_base64_range(c);
-          if (!within_64)
-            return false;
-        }
-      return true;
-    }
-
-    bool is_multiple_four(const std::string &s) const
-    {
-      if (s.length() % 4 == 0)
-        return true;
-      else
-        return false;
-    }
-
     /** apply preprocessing to image */
     void prepare(const cv::Mat &src, cv::Mat &dst,
                  const std::string &img_name) const
@@ -367,30 +336,52 @@ namespace dd
     }
 #endif
 
-    // decode image
-    void decode(const std::string &str)
+    /** JPEG decoding reduction factor (2, 4 or 8), so that the decoded
+     * image remains larger than the target size, 1 for full decoding.
+     * orig_width and orig_height are those of the decoded image, after
+     * EXIF orientation */
+    int reduced_decode_factor(const unsigned char *data, const size_t &len,
+                              int &orig_width, int &orig_height) const
     {
-      std::vector<unsigned char> vdat(str.begin(), str.end());
-      cv::Mat img = cv::Mat(cv::imdecode(
-          cv::Mat(vdat, false),
-          _unchanged_data
-              ? CV_LOAD_IMAGE_UNCHANGED
-              : (_bw ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR)));
-      add_image(img, "base64 image");
+      int orientation = 1;
+      if (!_reduced_decode || _unchanged_data || _keep_orig || _scaled
+          || _width <= 0 || _height <= 0
+          || !cv_utils::jpeg_size(data, len, orig_width, orig_height,
+                                  orientation))
+        return 1;
+      if (orientation >= 5) // transposed when decoded
+        std::swap(orig_width, orig_height);
+      for (int factor : { 8, 4, 2 })
+        if (orig_width / factor >= _width && orig_height / factor >= _height)
+          return factor;
+      return 1;
     }
 
-    // deserialize image, independent of format
-    void deserialize(std::stringstream &input)
+    // decode image, independent of format, data is not copied
+    void decode(const unsigned char *data, const size_t &len)
     {
-      size_t size = 0;
-      input.seekg(0, input.end);
-      size = input.tellg();
-      input.seekg(0, input.beg);
-      char *data = new char[size];
-      input.read(data, size);
-      std::string str(data, data + size);
-      delete[] data;
-      decode(str);
+      int flags = _unchanged_data
+                      ? CV_LOAD_IMAGE_UNCHANGED
+                      : (_bw ? CV_LOAD_IMAGE_GRAYSCALE : CV_LOAD_IMAGE_COLOR);
+      int orig_width = 0, orig_height = 0;
+      int factor = reduced_decode_factor(data, len, orig_width, orig_height);
+      if (factor > 1)
+        {
+          // OpenCV reduced modes: IMREAD_REDUCED_{GRAYSCALE,COLOR}_{2,4,8}
+          static const int reduced_gray[] = { cv::IMREAD_REDUCED_GRAYSCALE_2,
+                                              cv::IMREAD_REDUCED_GRAYSCALE_4,
+                                              cv::IMREAD_REDUCED_GRAYSCALE_8 };
+          static const int reduced_color[] = { cv::IMREAD_REDUCED_COLOR_2,
+                                               cv::IMREAD_REDUCED_COLOR_4,
+                                               cv::IMREAD_REDUCED_COLOR_8 };
+          int i = factor == 2 ? 0 : (factor == 4 ? 1 : 2);
+          flags = _bw ? reduced_gray[i] : reduced_color[i];
+        }
+      cv::Mat buf(1, static_cast<int>(len), CV_8UC1,
+                  const_cast<unsigned char *>(data));
+      cv::Mat img = cv::imdecode(buf, flags);
+      if (add_image(img, _b64 ? "base64 image" : "image") == 0 && factor > 1)
+        _imgs_size.back() = std::pair<int, int>(orig_height, orig_width);
     }
 
     // data acquisition
@@ -413,21 +404,54 @@ namespace dd
     int read_mem(const std::string &content)
     {
       _in_mem = true;
-      cv::Mat timg;
-      _b64 = possibly_base64(content);
+      // base64 is decoded once, into a buffer reused across calls from the
+      // same thread
+      static thread_local std::vector<unsigned char> b64buf;
+      _b64 = dd_utils::base64_decode(content.data(), content.size(), b64buf);
       if (_b64)
-        {
-          std::string ccontent;
-          Base64::Decode(content, &ccontent);
-          std::stringstream sstr;
-          sstr << ccontent;
-          deserialize(sstr);
-        }
+        decode(b64buf.data(), b64buf.size());
+      else
+        decode(reinterpret_cast<const unsigned char *>(content.data()),
+               content.size());
+      if (b64buf.capacity() > (64 << 20)) // do not hold on to huge uploads
+        std::vector<unsigned char>().swap(b64buf);
+      if (_imgs.at(0).empty())
+        return -1;
+      return 0;
+    }
+
+    /**
+     * \brief image from shared memory, decoded or read in place: raw
+     * pixels are only copied when no resizing leaves a separate image
+     */
+    int read_shm(const dd_utils::ShmURI &shm,
+                 const dd_utils::SharedMemoryView &view)
+    {
+      _in_mem = true;
+      size_t nimgs = _imgs_size.size();
+      if (shm._width <= 0 && shm._height <= 0)
+        decode(view.data(), view.size());
       else
         {
-          decode(content);
+          int channels = shm._channels > 0 ? shm._channels : 3;
+          if (shm._width <= 0 || shm._height <= 0 || channels > 4
+              || view.size() < static_cast<size_t>(shm._width) * shm._height
+                                   * channels)
+            {
+              _logger->error("invalid raw image size in shared memory");
+              return -1;
+            }
+          cv::Mat img(shm._height, shm._width, CV_8UC(channels),
+                      const_cast<unsigned char *>(view.data()));
+          if (add_image(img, "shm image") != 0)
+            return -1;
+          // images without own buffer still point to the shared memory
+          if (!_imgs.empty() && !_imgs.back().u)
+            _imgs.back() = _imgs.back().clone();
+          if (_keep_orig && !_orig_imgs.empty() && !_orig_imgs.back().u)
+            _orig_imgs.back() = _orig_imgs.back().clone();
         }
-      if (_imgs.at(0).empty())
+      if (_imgs_size.size() == nimgs)
         return -1;
       return 0;
     }
@@ -535,6 +559,7 @@ namespace dd
     int _scale_max = 1000;
     bool _keep_orig = false;
     bool _b64 = false;
+    bool _reduced_decode = false;
     std::string _interp = "cubic";
 #ifdef USE_CUDA_CV
     bool _cuda = false;
@@ -560,7 +585,7 @@ namespace dd
           _has_mean_scalar(i._has_mean_scalar), _scale(i._scale),
           _scaled(i._scaled), _scale_min(i._scale_min),
           _scale_max(i._scale_max), _keep_orig(i._keep_orig),
-          _interp(i._interp)
+          _interp(i._interp), _reduced_decode(i._reduced_decode)
 #ifdef USE_CUDA_CV
           ,
           _cuda(i._cuda)
@@ -674,6 +699,10 @@ namespace dd
       if (params->interp)
         _interp = params->interp;
 
+      // JPEG decoding at reduced resolution
+      if (params->reduced_decode != nullptr)
+        _reduced_decode = params->reduced_decode;
+
       // timeout
       this->set_timeout(params);
 
@@ -699,6 +728,7 @@ namespace dd
       dimg._scale_max = _scale_max;
       dimg._keep_orig = _keep_orig;
       dimg._interp = _interp;
+      dimg._reduced_decode = _reduced_decode;
 #ifdef USE_CUDA_CV
       dimg._cuda = _cuda;
       dimg._cuda_stream = _cuda_stream;
@@ -903,12 +933,17 @@ namespace dd
       std::vector<std::string> meta_uris;
       std::vector<std::string> index_uris;
       std::vector<std::string> failed_uris;
-#pragma omp parallel for
+      // remote images are downloaded in the background while fetched ones
+      // are decoded, in uris order
+      std::shared_ptr<httpfetcher> fetcher = this->prefetch_uris();
+#pragma omp parallel for schedule(dynamic)
       for (size_t i = 0; i < _uris.size(); i++)
         {
           bool no_img = false;
           std::string u = _uris.at(i);
           DataEl<DDImg> dimg(this->_input_timeout);
+          if (fetcher)
+            dimg.set_fetcher(fetcher, i);
           copy_parameters_to(dimg._ctype);
 
           try
@@ -1107,6 +1142,7 @@ namespace dd
     int _scale_max = 1000;
     bool _keep_orig = false;
     std::string _interp = "cubic";
+    bool _reduced_decode = false; /**< JPEG decoding at reduced resolution. */
 #ifdef USE_CUDA_CV
     bool _cuda = false;
     cv::cuda::Stream *_cuda_stream = &cv::cuda::Stream::Null();
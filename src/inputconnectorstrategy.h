@@ -24,11 +24,13 @@
 
 #include "apidata.h"
 #include "utils/fileops.hpp"
+#include "utils/shm.hpp"
 #include "dto/service_predict.hpp"
 #ifndef WIN32
 #include "utils/httpclient.hpp"
 #endif
 #include "dd_spdlog.h"
+#include <algorithm>
 #include <exception>
 
 namespace dd
@@ -71,7 +73,11 @@ namespace dd
           int outcode = -1;
           try
             {
-              httpclient::get_call(uri, "GET", outcode, _content, _timeout);
+              if (_fetcher)
+                _fetcher->get(_fetch_id, outcode, _content);
+              else
+                httpclient::get_call(uri, "GET", outcode, _content,
+                                     _timeout);
             }
           catch (...)
             {
@@ -82,6 +88,27 @@ namespace dd
           return _ctype.read_mem(_content);
 #endif
         }
+      else if (dd_utils::ShmURI::is_shm(uri))
+        {
+          if (!dd_utils::ShmURI::enabled())
+            {
+              logger->error("cannot read {}: shared memory data is not "
+                            "enabled on this server",
+                            uri);
+              return -1;
+            }
+          try
+            {
+              dd_utils::ShmURI shm(uri);
+              dd_utils::SharedMemoryView view(shm);
+              return read_shm(_ctype, shm, view, 0);
+            }
+          catch (std::runtime_error &e)
+            {
+              logger->error("cannot read {}: {}", uri, e.what());
+              return -1;
+            }
+        }
       else if (fileops::file_exists(uri, dir))
         {
           if (fileops::is_db(uri))
@@ -97,9 +124,47 @@ namespace dd
       return 0;
     }
 
+    /**
+     * \brief reads data from shared memory with DDT::read_shm when defined,
+     * e.g. in place for images, from a copy with read_mem otherwise
+     */
+    template <typename T>
+    static auto read_shm(T &ctype, const dd_utils::ShmURI &shm,
+                         const dd_utils::SharedMemoryView &view, int)
+        -> decltype(ctype.read_shm(shm, view))
+    {
+      return ctype.read_shm(shm, view);
+    }
+
+    template <typename T>
+    static int read_shm(T &ctype, const dd_utils::ShmURI &shm,
+                        const dd_utils::SharedMemoryView &view, long)
+    {
+      (void)shm;
+      return ctype.read_mem(std::string(
+          reinterpret_cast<const char *>(view.data()), view.size()));
+    }
+
+#ifndef WIN32
+    /**
+     * \brief read remote uri from a background fetcher
+     * @param fetch_id index of uri in the fetcher
+     */
+    void set_fetcher(const std::shared_ptr<httpfetcher> &fetcher,
+                     const size_t &fetch_id)
+    {
+      _fetcher = fetcher;
+      _fetch_id = fetch_id;
+    }
+#endif
+
     std::string _content;
     int _timeout = 600; // 10 mins is default
     DDT _ctype;
+#ifndef WIN32
+    std::shared_ptr<httpfetcher> _fetcher;
+    size_t _fetch_id = 0;
+#endif
   };
 
   /**
@@ -155,7 +220,9 @@ namespace dd
     }
     InputConnectorStrategy(const InputConnectorStrategy &i)
         : _model_repo(i._model_repo), _logger(i._logger),
-          _input_timeout(i._input_timeout)
+          _input_timeout(i._input_timeout),
+          _input_max_fetches(i._input_max_fetches),
+          _input_max_fetch_size(i._input_max_fetch_size)
     {
     }
     virtual ~InputConnectorStrategy()
@@ -233,16 +300,42 @@ namespace dd
         }
     }
 
+    /**
+     * \brief remote data retrieval parameters
+     */
     void set_timeout(const APIData &ad)
     {
       if (ad.has("timeout"))
         _input_timeout = ad.get("timeout").get<int>();
+      if (ad.has("max_fetches"))
+        _input_max_fetches = ad.get("max_fetches").get<int>();
+      if (ad.has("max_fetch_size"))
+        _input_max_fetch_size = ad.get("max_fetch_size").get<int>();
     }
 
     void set_timeout(oatpp::Object<DTO::InputConnector> input_dto)
     {
       _input_timeout = input_dto->timeout;
+      _input_max_fetches = input_dto->max_fetches;
+      _input_max_fetch_size = input_dto->max_fetch_size;
+    }
+
+#ifndef WIN32
+    /**
+     * \brief starts fetching remote uris in the background, returns nullptr
+     * if there are none. Data elements read them with DataEl::set_fetcher,
+     * using the uri index in _uris.
+     */
+    std::shared_ptr<httpfetcher> prefetch_uris() const
+    {
+      if (std::none_of(_uris.begin(), _uris.end(), httpfetcher::is_remote))
+        return nullptr;
+      int timeout = _input_timeout == -1 ? 600 : _input_timeout;
+      return std::make_shared<httpfetcher>(
+          _uris, timeout, _input_max_fetches,
+          static_cast<size_t>(_input_max_fetch_size) * 1024 * 1024);
     }
+#endif
 
     /**
      * \brief input parameters to return to user through API,
@@ -291,6 +384,10 @@ namespace dd
     int _input_timeout
         = -1; /**< timeout on input data retrieval: -1 means using default
                  (600sec), otherwise set via input parameters. */
+    int _input_max_fetches
+        = 16; /**< max number of concurrent remote data retrievals. */
+    int _input_max_fetch_size
+        = 0; /**< max size of remote data in MB, 0 means no limit. */
   };
 
 }
@@ -32,6 +32,9 @@ DEFINE_string(service_start_list, "",
               "list of JSON calls to be executed at startup");
 DEFINE_bool(service_start_list_no_exit_on_failure, false,
             "do not exit on failure for any JSON calls executed at startup");
+DEFINE_int32(lazy_mem_budget, 0,
+             "memory budget in MB of lazy services, least recently used idle "
+             "ones are unloaded above it (0: never unload)");
 
 namespace dd
 {
@@ -49,6 +52,7 @@ namespace dd
   int JsonAPI::boot(int argc, char *argv[])
   {
     google::ParseCommandLineFlags(&argc, &argv, true);
+    _lazy_mem_budget = FLAGS_lazy_mem_budget;
     if (!FLAGS_service_start_list.empty())
       {
         JDoc response
@@ -429,17 +433,18 @@ namespace dd
                     JVal().SetString(DEPS_VERSION, jinfo.GetAllocator()),
                     jinfo.GetAllocator());
     JVal jservs(rapidjson::kArrayType);
-    auto hit = _mlservices.begin();
-    while (hit != _mlservices.end())
+    for (auto &s : get_services())
       {
         APIData ad
-            = mapbox::util::apply_visitor(visitor_info(status), (*hit).second);
+            = mapbox::util::apply_visitor(visitor_info(status), *s.second);
         JVal jserv(rapidjson::kObjectType);
         ad.toJVal(jinfo, jserv);
         jservs.PushBack(jserv, jinfo.GetAllocator());
-        ++hit;
       }
     jhead.AddMember("services", jservs, jinfo.GetAllocator());
+    JVal jcpu(rapidjson::kObjectType);
+    CpuScheduler::instance().info().toJVal(jinfo, jcpu);
+    jhead.AddMember("cpu_placement", jcpu, jinfo.GetAllocator());
     jinfo.AddMember("head", jhead, jinfo.GetAllocator());
     return jinfo;
   }
@@ -954,6 +959,10 @@ namespace dd
       {
         return dd_service_bad_request_1006(e.what());
       }
+    catch (OutputConnectorBadParamException &e)
+      {
+        return dd_service_bad_request_1006(e.what());
+      }
     catch (InputConnectorInternalException &e)
       {
         return dd_internal_error_500(e.what());
@@ -977,10 +986,10 @@ namespace dd
 
     if (sname.empty())
       return dd_service_not_found_1002(sname);
-    if (!this->service_exists(sname))
+    auto mls = this->get_service(sname);
+    if (!mls)
       return dd_service_not_found_1002(sname);
-    auto hit = this->get_service_it(sname);
-    APIData ad = mapbox::util::apply_visitor(visitor_status(), (*hit).second);
+    APIData ad = mapbox::util::apply_visitor(visitor_status(), *mls);
     JDoc jst = dd_ok_200();
     JVal jbody(rapidjson::kObjectType);
     ad.toJVal(jst, jbody);
@@ -1097,6 +1106,10 @@ namespace dd
       {
         return dd_service_bad_request_1006(e.what());
       }
+    catch (OutputConnectorBadParamException &e)
+      {
+        return dd_service_bad_request_1006(e.what());
+      }
     catch (InputConnectorInternalException &e)
       {
         return dd_internal_error_500(e.what());
@@ -1244,6 +1257,10 @@ namespace dd
       {
         return dd_service_bad_request_1006(e.what());
       }
+    catch (OutputConnectorBadParamException &e)
+      {
+        return dd_service_bad_request_1006(e.what());
+      }
     catch (InputConnectorInternalException &e)
       {
         return dd_internal_error_500(e.what());
@@ -1522,6 +1539,10 @@ namespace dd
       {
         return dd_service_bad_request_1006(e.what());
       }
+    catch (OutputConnectorBadParamException &e)
+      {
+        return dd_service_bad_request_1006(e.what());
+      }
     catch (InputConnectorInternalException &e)
       {
         return dd_internal_error_500(e.what());
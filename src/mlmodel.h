@@ -75,6 +75,15 @@ namespace dd
 #endif
     }
 
+    /**
+     * \brief files the mllib loads the model from, to estimate the model
+     * memory, see backend models
+     */
+    std::vector<std::string> weights_files() const
+    {
+      return {};
+    }
+
     void read_corresp_file()
     {
       if (!_corresp.empty())
@@ -133,6 +142,8 @@ namespace dd
             _se->_tse->_ondisk = output_params->ondisk;
           if (output_params->nprobe != nullptr)
             _se->_tse->_nprobe = output_params->nprobe;
+          if (output_params->index_metadata_memory != nullptr)
+            _se->_tse->_mem_metadata = output_params->index_metadata_memory;
 #ifdef USE_GPU_FAISS
           _se->_tse->_gpu = output_params->index_gpu;
           if (output_params->index_gpuid != nullptr)
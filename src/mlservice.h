@@ -29,6 +29,7 @@
 #include "mllibstrategy.h"
 #include "mlmodel.h"
 #include "outputconnectorstrategy.h"
+#include "cpu_placement.h"
 #include <string>
 #include <future>
 #include <mutex>
@@ -37,6 +38,8 @@
 #include <boost/thread/shared_mutex.hpp>
 #include <boost/thread/lock_types.hpp>
 #include <unordered_map>
+#include <unordered_set>
+#include <atomic>
 #include <chrono>
 #include <iostream>
 
@@ -112,7 +115,10 @@ namespace dd
             mlmodel),
           _sname(sname), _description(description), _tjobs_counter(0)
     {
-      this->_logger = DD_SPDLOG_LOGGER(_sname);
+      // an evicted service hands its logger over to its replacement
+      this->_logger = spdlog::get(_sname);
+      if (!this->_logger)
+        this->_logger = DD_SPDLOG_LOGGER(_sname);
     }
 
     /**
@@ -126,7 +132,12 @@ namespace dd
           _description(std::move(mls._description)),
           _init_parameters(std::move(mls._init_parameters)),
           _tjobs_counter(mls._tjobs_counter.load()),
-          _training_jobs(std::move(mls._training_jobs))
+          _training_jobs(std::move(mls._training_jobs)), _lazy(mls._lazy),
+          _lazy_ad(std::move(mls._lazy_ad)),
+          _loaded(mls._loaded.load()), _loads(mls._loads.load()),
+          _evictions(mls._evictions), _last_used(mls._last_used.load()),
+          _mem_estimate(mls._mem_estimate),
+          _cpu_placement(std::move(mls._cpu_placement))
     {
     }
 
@@ -136,7 +147,8 @@ namespace dd
     ~MLService()
     {
       kill_jobs();
-      spdlog::drop(_sname);
+      if (!_evicted && spdlog::get(_sname) == this->_logger)
+        spdlog::drop(_sname);
     }
 
     /**
@@ -144,9 +156,78 @@ namespace dd
      *        - init of input connector
      *        - init of output conector
      *        - init of ML library
+     * With model.lazy, only parameters are recorded, and initialization
+     * happens on first use, see lazy_load.
+     * With model.cores, cpus or numa_node, cpus are assigned to the service,
+     * see CpuScheduler, unless the service already holds a placement, i.e.
+     * when it replaces an evicted service.
      * @param ad root data object
      */
     void init(const APIData &ad)
+    {
+      APIData ad_model = ad.getobj("model");
+      if (!_cpu_placement)
+        _cpu_placement
+            = CpuScheduler::instance().reserve(_sname, ad_model);
+      if (_cpu_placement)
+        this->_logger->info(
+            "running on cpus {}",
+            CpuScheduler::to_cpu_list(
+                CpuScheduler::instance().cpus(_cpu_placement.get())));
+      if (ad_model.has("lazy") && ad_model.get("lazy").get<bool>())
+        {
+          this->_inputc._model_repo
+              = ad_model.get("repository").get<std::string>();
+          if (this->_inputc._model_repo.empty())
+            throw MLLibBadParamException("empty repository");
+          _lazy = true;
+          _loaded.store(false);
+          _lazy_ad = ad;
+          this->_logger->info("lazy service, model is loaded on first use");
+          return;
+        }
+      load(ad);
+    }
+
+    /**
+     * \brief initializes a lazy service if not done yet. Concurrent first
+     * calls wait for a single initialization.
+     */
+    void lazy_load()
+    {
+      _last_used.store(std::chrono::duration_cast<std::chrono::milliseconds>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count());
+      if (_loaded.load())
+        return;
+      std::lock_guard<std::mutex> lock(_load_mutex);
+      if (_loaded.load())
+        return;
+      this->_logger->info("loading lazy service model");
+      load(_lazy_ad);
+      _mem_estimate = weights_size();
+      ++_loads;
+      _loaded.store(true);
+    }
+
+    /**
+     * \brief whether the service can be evicted: lazy, loaded and without
+     * training jobs
+     */
+    bool evictable() const
+    {
+      std::lock_guard<std::mutex> lock(_tjobs_mutex);
+      return _lazy && _loaded.load() && _training_jobs.empty();
+    }
+
+    /**
+     * \brief machine learning service initialization:
+     *        - init of input connector
+     *        - init of output conector
+     *        - init of ML library
+     * @param ad root data object
+     */
+    void load(const APIData &ad)
     {
       this->_inputc._model_repo
           = ad.getobj("model").get("repository").get<std::string>();
@@ -155,13 +236,28 @@ namespace dd
 
       this->_inputc._logger = this->_logger;
       this->_outputc._logger = this->_logger;
+      // model memory is allocated from the service node
+      apply_cpu_placement();
       _init_parameters = ad.getobj("parameters");
       this->_inputc.init(_init_parameters.getobj("input"));
       this->_outputc.init(_init_parameters.getobj("output"));
-      this->init_mllib(_init_parameters.getobj("mllib"));
+      APIData ad_mllib = _init_parameters.getobj("mllib");
+      if (_cpu_placement && !ad_mllib.has("threads"))
+        ad_mllib.add("threads", _cpu_placement->size());
+      this->init_mllib(ad_mllib);
       this->fillup_measures_history(ad);
     }
 
+    /**
+     * \brief pins the calling thread and its OpenMP team to the service cpus,
+     * or to the cpus no service holds
+     */
+    void apply_cpu_placement()
+    {
+      if (!CpuScheduler::instance().apply(_cpu_placement.get()))
+        this->_logger->warn("could not pin thread to service cpus");
+    }
+
     /**
      * \brief terminates all service's jobs
      */
@@ -204,6 +300,17 @@ namespace dd
           else
             ad.add("training", true);
           ad.add("mltype", this->_mltype);
+          if (_lazy)
+            {
+              APIData lad;
+              lad.add("loaded", _loaded.load());
+              lad.add("loads", _loads.load());
+              lad.add("evictions", _evictions);
+              lad.add("mem_estimate", _mem_estimate);
+              ad.add("lazy", lad);
+            }
+          if (_cpu_placement)
+            ad.add("cpu_placement", _cpu_placement->info());
         }
       else
         {
@@ -308,6 +415,8 @@ namespace dd
      */
     int train_job(const APIData &ad, APIData &out)
     {
+      apply_cpu_placement();
+      lazy_load();
       APIData jmrepo;
       jmrepo.add("repository", this->_mlmodel._repo);
       out.add("model", jmrepo);
@@ -328,6 +437,7 @@ namespace dd
                                // start in requested order
                                boost::unique_lock<boost::shared_mutex> lock(
                                    _train_mutex);
+                               apply_cpu_placement();
                                APIData out;
                                int run_code = this->train(ad, out);
                                std::pair<int, APIData> p(local_tcounter,
@@ -501,6 +611,8 @@ namespace dd
      */
     int predict_job(const APIData &ad, APIData &out, const bool &chain = false)
     {
+      apply_cpu_placement();
+      lazy_load();
       if (!_train_mutex.try_lock_shared())
         throw MLServiceLockException(
             "Predict call while training with an offline learning algorithm");
@@ -537,6 +649,38 @@ namespace dd
                         // terminated
     std::unordered_map<int, APIData> _training_out;
     boost::shared_mutex _train_mutex;
+
+    // lazy loading, see Services::evict_lazy
+    bool _lazy = false;       /**< whether model is loaded on first use. */
+    APIData _lazy_ad;         /**< service creation parameters. */
+    std::atomic<bool> _loaded = { true };   /**< whether model is loaded. */
+    std::atomic<int> _loads = { 0 };        /**< number of lazy loads. */
+    int _evictions = 0;                      /**< number of evictions. */
+    bool _evicted = false; /**< whether replaced by its unloaded version. */
+    std::atomic<long int> _last_used
+        = { 0 }; /**< last predict or train call, steady clock ms. */
+    long int _mem_estimate
+        = 0; /**< model memory, estimated from loaded weights size. */
+    std::mutex _load_mutex; /**< single lazy load among concurrent calls. */
+
+    std::shared_ptr<CpuPlacement>
+        _cpu_placement; /**< cpus of the service, nullptr if not placed. */
+
+  private:
+    long int weights_size() const
+    {
+      long int size = 0;
+      for (const std::string &f : this->_mlmodel.weights_files())
+        {
+          if (f.empty())
+            continue;
+          boost::system::error_code ec;
+          auto fsize = boost::filesystem::file_size(f, ec);
+          if (!ec)
+            size += fsize;
+        }
+      return size;
+    }
   };
 
 }
@@ -20,6 +20,8 @@
  */
 
 #include <csignal>
+#include <cstdlib>
+#include <thread>
 #if USE_BOOST_BACKTRACE
 #include <boost/stacktrace.hpp>
 #endif
@@ -27,7 +29,9 @@
 #include "oatppjsonapi.h"
 #include "http/app_component.hpp"
 #include "http/controller.hpp"
+#include "http/async_controller.hpp"
 #include "http/access_log.hpp"
+#include "http/unix_socket.hpp"
 
 #include "oatpp/network/Server.hpp"
 #include "oatpp/web/protocol/http/Http.hpp"
@@ -39,14 +43,23 @@
 #include "oatpp/parser/json/mapping/ObjectMapper.hpp"
 #include "oatpp/core/macro/component.hpp"
 #ifdef USE_OATPP_SWAGGER
+#include "oatpp-swagger/AsyncController.hpp"
 #include "oatpp-swagger/Controller.hpp"
 #endif
 
 #include "utils/oatpp.hpp"
+#include "utils/shm.hpp"
+
+DECLARE_uint32(service_workers);
+DECLARE_uint32(service_queue);
+DECLARE_string(unix_socket);
+DECLARE_string(unix_socket_mode);
+DECLARE_bool(shm_data);
 
 namespace dd
 {
   oatpp::network::Server *_server = nullptr;
+  oatpp::network::Server *_unix_server = nullptr;
 
   OatppJsonAPI::OatppJsonAPI() : JsonAPI()
   {
@@ -171,15 +184,6 @@ namespace dd
   std::shared_ptr<oatpp::web::protocol::http::outgoing::Response>
   OatppJsonAPI::jdoc_to_response(const JDoc &janswer) const
   {
-    // NOTE(sileht): Maybe not the best place to do this, but we need DTO in
-    // all calls before doing it otherwise
-    if (janswer.HasMember("head") && janswer["head"].HasMember("service"))
-      {
-        std::string service = janswer["head"]["service"].GetString();
-        if (!service.empty())
-          dd::http::setAccessLogServiceName(service);
-      }
-
     int outcode = janswer["status"]["code"].GetInt();
     std::string stranswer;
     // if output template, fillup with rendered template.
@@ -237,6 +241,26 @@ namespace dd
     response->putHeader(oatpp::web::protocol::http::Header::CONTENT_TYPE,
                         "application/json");
 
+    // NOTE(sileht): Maybe not the best place to do this, but we need DTO in
+    // all calls before doing it otherwise
+    if (janswer.HasMember("head") && janswer["head"].HasMember("service"))
+      {
+        std::string service = janswer["head"]["service"].GetString();
+        if (!service.empty())
+          dd::http::setAccessLogServiceName(response, service);
+      }
+    if (janswer.HasMember("head") && janswer["head"].HasMember("time")
+        && janswer["head"]["time"].IsNumber())
+      {
+        int batch_size = -1;
+        if (janswer.HasMember("body")
+            && janswer["body"].HasMember("predictions")
+            && janswer["body"]["predictions"].IsArray())
+          batch_size = janswer["body"]["predictions"].Size();
+        dd::http::setAccessLogCallStats(
+            response, janswer["head"]["time"].GetDouble(), batch_size);
+      }
+
     return response;
   }
 
@@ -266,11 +290,9 @@ namespace dd
         = oatpp_utils::staticCast<oatpp::Object<DTO::GenericResponse>>(dto);
     generic_dto->status = create_status_dto(code, msg, dd_code, dd_msg);
 
-    auto json_mapper = dd::oatpp_utils::createDDMapper();
-    json_mapper->getSerializer()->getConfig()->includeNullFields = false;
     auto response = oatpp::web::protocol::http::outgoing::ResponseFactory::
         createResponse(oatpp::web::protocol::http::Status(code, ""), dto,
-                       json_mapper);
+                       dd::oatpp_utils::getDDMapper());
     response->putHeader(oatpp::web::protocol::http::Header::CONTENT_TYPE,
                         "application/json");
     return response;
@@ -311,6 +333,100 @@ namespace dd
                            "Conflict", 1015, "Resource already exists!");
   }
 
+  oatpp::Object<DTO::InfoResponse> OatppJsonAPI::create_info(
+      const bool &status,
+      const std::shared_ptr<oatpp::data::mapping::ObjectMapper> &mapper)
+  {
+    auto info_resp = DTO::InfoResponse::createShared();
+    info_resp->head = DTO::InfoHead::createShared();
+    info_resp->head->services = {};
+
+    for (auto &s : get_services())
+      {
+        // TODO(sileht): update visitor_info to return directly a Service()
+        JDoc jd;
+        jd.SetObject();
+        mapbox::util::apply_visitor(visitor_info(status), *s.second)
+            .toJDoc(jd);
+        auto json_str = jrender(jd);
+        auto service_info
+            = mapper->readFromString<oatpp::Object<DTO::Service>>(
+                json_str.c_str());
+        info_resp->head->services->emplace_back(service_info);
+      }
+
+    JDoc jcpu;
+    jcpu.SetObject();
+    CpuScheduler::instance().info().toJDoc(jcpu);
+    info_resp->head->cpu_placement
+        = mapper->readFromString<oatpp::Object<DTO::CpuPlacementInfo>>(
+            jrender(jcpu).c_str());
+    return info_resp;
+  }
+
+  OatppJsonAPI::Response_ptr OatppJsonAPI::create_resource_response(
+      const std::string &resource_name,
+      const oatpp::Object<DTO::Resource> &resource_data)
+  {
+    try
+      {
+        return dto_to_response(create_resource(resource_name, resource_data),
+                               201, "Created");
+      }
+    catch (ResourceBadParamException &e)
+      {
+        return response_bad_request_400(e.what());
+      }
+    catch (ResourceForbiddenException &e)
+      {
+        return response_resource_already_exists_1015();
+      }
+    catch (std::exception &e)
+      {
+        return response_internal_error_500(e.what());
+      }
+    return response_internal_error_500();
+  }
+
+  OatppJsonAPI::Response_ptr
+  OatppJsonAPI::get_resource_response(const std::string &resource_name)
+  {
+    try
+      {
+        auto res_dto = get_resource(resource_name);
+        return dto_to_response(res_dto, 200, "OK");
+      }
+    catch (ResourceNotFoundException &e)
+      {
+        return response_not_found_404();
+      }
+    catch (std::exception &e)
+      {
+        return response_internal_error_500(e.what());
+      }
+    return response_internal_error_500();
+  }
+
+  OatppJsonAPI::Response_ptr
+  OatppJsonAPI::delete_resource_response(const std::string &resource_name)
+  {
+    try
+      {
+        delete_resource(resource_name);
+        return dto_to_response(DTO::GenericResponse::createShared(), 200,
+                               "OK");
+      }
+    catch (ResourceNotFoundException &e)
+      {
+        return response_not_found_404();
+      }
+    catch (std::exception &e)
+      {
+        return response_internal_error_500(e.what());
+      }
+    return response_internal_error_500();
+  }
+
   void OatppJsonAPI::terminate(int signal)
   {
     (void)signal;
@@ -319,6 +435,8 @@ namespace dd
         _server->stop();
         _server = nullptr;
       }
+    if (_unix_server != nullptr)
+      _unix_server->stop();
   }
 
 #if USE_BOOST_BACKTRACE
@@ -341,8 +459,15 @@ namespace dd
 
     std::shared_ptr<oatpp::data::mapping::ObjectMapper> defaultObjectMapper
         = dd::oatpp_utils::createDDMapper();
-    auto dedeController
-        = DedeController::createShared(this, defaultObjectMapper);
+    std::shared_ptr<oatpp::web::server::api::ApiController> dedeController;
+    if (FLAGS_async_server)
+      dedeController = DedeAsyncController::createShared(
+          this,
+          std::make_shared<dd::http::ExecutorPools>(FLAGS_service_workers,
+                                                    FLAGS_service_queue),
+          defaultObjectMapper);
+    else
+      dedeController = DedeController::createShared(this, defaultObjectMapper);
     router->addController(dedeController);
 
 #ifdef USE_OATPP_SWAGGER
@@ -372,8 +497,13 @@ namespace dd
     auto swaggerMapper = dd::oatpp_utils::createDDMapper();
     swaggerMapper->getSerializer()->getConfig()->includeNullFields = false;
     swaggerMapper->getDeserializer()->getConfig()->allowUnknownFields = false;
-    auto swaggerController = std::make_shared<oatpp::swagger::Controller>(
-        swaggerMapper, document, resources);
+    std::shared_ptr<oatpp::web::server::api::ApiController> swaggerController;
+    if (FLAGS_async_server)
+      swaggerController = std::make_shared<oatpp::swagger::AsyncController>(
+          swaggerMapper, document, resources);
+    else
+      swaggerController = std::make_shared<oatpp::swagger::Controller>(
+          swaggerMapper, document, resources);
     router->addController(swaggerController);
 #endif
 
@@ -386,8 +516,37 @@ namespace dd
                   scp->getProperty("host").toString()->c_str(),
                   scp->getProperty("port").toString()->c_str());
 
+    // same handler on a Unix domain socket, for colocated clients
+    std::shared_ptr<dd::http::UnixSocketConnectionProvider> usp;
+    std::thread unix_thread;
+    if (!FLAGS_unix_socket.empty())
+      {
+        char *end = nullptr;
+        mode_t mode = std::strtoul(FLAGS_unix_socket_mode.c_str(), &end, 8);
+        if (FLAGS_unix_socket_mode.empty() || *end != '\0')
+          throw std::runtime_error("invalid unix_socket_mode "
+                                   + FLAGS_unix_socket_mode);
+        usp = dd::http::UnixSocketConnectionProvider::createShared(
+            FLAGS_unix_socket, mode);
+        _unix_server = new oatpp::network::Server(usp, sch);
+        unix_thread = std::thread([]() { _unix_server->run(); });
+        _logger->info("DeepDetect HTTP server listening on unix socket {}",
+                      FLAGS_unix_socket);
+      }
+
+    // shared memory data URIs are an explicit opt-in for colocated clients
+    if (FLAGS_shm_data && FLAGS_unix_socket.empty())
+      _logger->warn("-shm_data requires -unix_socket, shared memory data "
+                    "URIs are disabled");
+    dd_utils::ShmURI::enabled() = FLAGS_shm_data && !FLAGS_unix_socket.empty();
+    if (dd_utils::ShmURI::enabled())
+      _logger->info("Accepting shared memory data URIs");
+
     if (!FLAGS_allow_origin.empty())
       _logger->info("Allowing origin from {}", FLAGS_allow_origin);
+    if (FLAGS_async_server)
+      _logger->info("Async server with {} I/O threads, {} workers per service",
+                    FLAGS_io_threads, FLAGS_service_workers);
 
     std::signal(SIGINT, terminate);
 #if USE_BOOST_BACKTRACE
@@ -395,6 +554,22 @@ namespace dd
     std::signal(SIGABRT, abort);
 #endif
     _server->run();
+
+    if (unix_thread.joinable())
+      {
+        _unix_server->stop();
+        unix_thread.join();
+        usp->stop();
+        _unix_server = nullptr;
+      }
+
+    auto executor = components.executor();
+    if (executor)
+      {
+        executor->waitTasksFinished();
+        executor->stop();
+        executor->join();
+      }
     _logger->info("DeepDetect HTTP server stopped");
   }
 
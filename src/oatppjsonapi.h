@@ -28,6 +28,8 @@
 #include "oatpp/web/protocol/http/outgoing/Response.hpp"
 #include "oatpp/web/server/api/ApiController.hpp"
 #include "dto/common.hpp"
+#include "dto/info.hpp"
+#include "dto/resource.hpp"
 
 namespace dd
 {
@@ -48,6 +50,16 @@ namespace dd
     uri_query_to_json(oatpp::web::protocol::http::QueryParams queryParams);
     Response_ptr jdoc_to_response(const JDoc &janswer) const;
 
+    oatpp::Object<DTO::InfoResponse> create_info(
+        const bool &status,
+        const std::shared_ptr<oatpp::data::mapping::ObjectMapper> &mapper);
+
+    Response_ptr create_resource_response(
+        const std::string &resource_name,
+        const oatpp::Object<DTO::Resource> &resource_data);
+    Response_ptr get_resource_response(const std::string &resource_name);
+    Response_ptr delete_resource_response(const std::string &resource_name);
+
     oatpp::Object<DTO::Status>
     create_status_dto(const uint32_t &code, const std::string &msg,
                       const uint32_t &dd_code = 0,
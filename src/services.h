@@ -74,6 +74,8 @@
 #include "dd_spdlog.h"
 #include <vector>
 #include <mutex>
+#include <functional>
+#include <limits>
 #include <chrono>
 #include <iostream>
 
@@ -357,6 +359,67 @@ namespace dd
       return mapbox::util::apply_visitor(v, mllib);
     }
 
+    /**
+     * \brief lazy service state, for eviction
+     */
+    struct LazyState
+    {
+      bool loaded = false; /**< lazy and loaded */
+      bool evictable = false;
+      long int last_used = 0;
+      long int mem = 0;
+    };
+
+    class v_lazy_state
+    {
+    public:
+      template <typename T> LazyState operator()(T &mls)
+      {
+        LazyState st;
+        st.loaded = mls._lazy && mls._loaded.load();
+        st.evictable = mls.evictable();
+        st.last_used = mls._last_used.load();
+        st.mem = mls._mem_estimate;
+        return st;
+      }
+    };
+
+    template <typename T> static LazyState lazy_state(T &mls)
+    {
+      visitor_mllib::v_lazy_state v;
+      return mapbox::util::apply_visitor(v, mls);
+    }
+
+    /**
+     * \brief returns the unloaded version of a lazy service, built from its
+     * current model, since training may have updated it, and holding the
+     * same cpus
+     */
+    class v_lazy_evict
+    {
+    public:
+      template <typename T> mls_variant_type operator()(T &mls)
+      {
+        auto mlmodel = mls._mlmodel;
+#ifdef USE_SIMSEARCH
+        mlmodel._se = nullptr; // owned by the evicted service
+#endif
+        T unloaded(mls._sname, mlmodel, mls._description);
+        unloaded._cpu_placement = mls._cpu_placement;
+        unloaded.init(mls._lazy_ad);
+        unloaded._loads.store(mls._loads.load());
+        unloaded._evictions = mls._evictions + 1;
+        mls._evicted = true; // the replacement now owns the logger
+        return mls_variant_type(std::move(unloaded));
+      }
+    };
+
+    template <typename T> static mls_variant_type lazy_evict(T &mls)
+    {
+      visitor_mllib::v_lazy_evict v;
+      return mapbox::util::apply_visitor(v, mls);
+    }
+
   };
 
   /**
@@ -382,6 +445,7 @@ namespace dd
      */
     size_t services_size() const
     {
+      std::lock_guard<std::mutex> lock(_mlservices_mtx);
       return _mlservices.size();
     }
 
@@ -394,8 +458,7 @@ namespace dd
     void add_service(const std::string &sname, mls_variant_type &&mls,
                      const APIData &ad = APIData())
     {
-      std::unordered_map<std::string, mls_variant_type>::const_iterator hit;
-      if ((hit = _mlservices.find(sname)) != _mlservices.end())
+      if (service_exists(sname))
         {
           throw ServiceForbiddenException("Service already exists");
         }
@@ -405,8 +468,8 @@ namespace dd
         {
           visitor_mllib::init(mls, ad);
           std::lock_guard<std::mutex> lock(_mlservices_mtx);
-          _mlservices.insert(
-              std::pair<std::string, mls_variant_type>(sname, std::move(mls)));
+          _mlservices.insert(std::make_pair(
+              sname, std::make_shared<mls_variant_type>(std::move(mls))));
         }
       catch (InputConnectorBadParamException &e)
         {
@@ -450,7 +513,7 @@ namespace dd
             {
               try
                 {
-                  auto &mls = (*hit).second;
+                  auto &mls = *(*hit).second;
                   visitor_mllib::clear(mls, ad);
                 }
               catch (MLLibBadParamException &e)
@@ -471,6 +534,9 @@ namespace dd
                   throw;
                 }
             }
+          // a service with the same name may be created while calls still
+          // run on this one, it gets its own logger
+          spdlog::drop(sname);
           _mlservices.erase(hit);
           return true;
         }
@@ -480,17 +546,44 @@ namespace dd
     }
 
     /**
-     * \brief get a service position as iterator
+     * \brief get a service. The service object is kept alive by the returned
+     * pointer, even if the service is deleted or evicted meanwhile.
      * @param sname service name
-     * @return service position, end of container if not found
+     * @return service, nullptr if not found
      */
-    std::unordered_map<std::string, mls_variant_type>::iterator
-    get_service_it(const std::string &sname)
+    std::shared_ptr<mls_variant_type>
+    get_service(const std::string &sname) const
     {
-      std::unordered_map<std::string, mls_variant_type>::iterator hit;
-      if ((hit = _mlservices.find(sname)) != _mlservices.end())
-        return hit;
-      return _mlservices.end();
+      std::lock_guard<std::mutex> lock(_mlservices_mtx);
+      auto hit = _mlservices.find(sname);
+      if (hit == _mlservices.end())
+        return nullptr;
+      return (*hit).second;
+    }
+
+    /**
+     * \brief get a service, throws ServiceNotFoundException if not found
+     */
+    std::shared_ptr<mls_variant_type>
+    get_service_or_throw(const std::string &sname) const
+    {
+      auto mls = get_service(sname);
+      if (!mls)
+        throw ServiceNotFoundException("Service " + sname
+                                       + " does not exist");
+      return mls;
+    }
+
+    /**
+     * \brief all services, kept alive by the returned pointers
+     */
+    std::vector<std::pair<std::string, std::shared_ptr<mls_variant_type>>>
+    get_services() const
+    {
+      std::lock_guard<std::mutex> lock(_mlservices_mtx);
+      std::vector<std::pair<std::string, std::shared_ptr<mls_variant_type>>>
+          services(_mlservices.begin(), _mlservices.end());
+      return services;
     }
 
     /**
@@ -498,12 +591,9 @@ namespace dd
      * @param sname service name
      * return true if service exists, false otherwise
      */
-    bool service_exists(const std::string &sname)
+    bool service_exists(const std::string &sname) const
     {
-      auto hit = get_service_it(sname);
-      if (hit == _mlservices.end())
-        return false;
-      return true;
+      return get_service(sname) != nullptr;
     }
 
     /**
@@ -520,9 +610,8 @@ namespace dd
       int status = 0;
       try
         {
-          auto hit = get_service_it(sname);
-          auto &mls = (*hit).second;
-          status = visitor_mllib::train_job(mls, ad, out);
+          auto mls = get_service_or_throw(sname);
+          status = visitor_mllib::train_job(*mls, ad, out);
         }
       catch (InputConnectorBadParamException &e)
         {
@@ -574,9 +663,8 @@ namespace dd
     {
       try
         {
-          auto hit = get_service_it(sname);
-          auto &mls = (*hit).second;
-          return visitor_mllib::training_job_status(mls, ad, out);
+          auto mls = get_service_or_throw(sname);
+          return visitor_mllib::training_job_status(*mls, ad, out);
         }
       catch (...)
         {
@@ -597,9 +685,8 @@ namespace dd
     {
       try
         {
-          auto hit = get_service_it(sname);
-          auto &mls = (*hit).second;
-          return visitor_mllib::training_job_delete(mls, ad, out);
+          auto mls = get_service_or_throw(sname);
+          return visitor_mllib::training_job_delete(*mls, ad, out);
         }
       catch (...)
         {
@@ -624,10 +711,12 @@ namespace dd
 
       int status = 0;
       auto llog = spdlog::get(sname);
+      bool lazy_loaded = false;
       try
         {
-          auto hit = get_service_it(sname);
-          auto &mllib = (*hit).second;
+          auto mls = get_service_or_throw(sname);
+          auto &mllib = *mls;
+          lazy_loaded = visitor_mllib::lazy_state(mllib).loaded;
 
           // check for resource in data field
           std::vector<std::string> data_vec;
@@ -666,6 +755,8 @@ namespace dd
 
           // predict call
           status = visitor_mllib::predict_job(mllib, ad_in, ad_out, chain);
+          lazy_loaded
+              = !lazy_loaded && visitor_mllib::lazy_state(mllib).loaded;
 
           // update result with resource info
           if (!res_infos.empty())
@@ -718,9 +809,68 @@ namespace dd
         }
       else
         ad_out.add("time", elapsed);
+      if (lazy_loaded)
+        evict_lazy(sname);
       return status;
     }
 
+    /**
+     * \brief unloads least recently used idle lazy services until loaded
+     * lazy services fit within _lazy_mem_budget
+     * @param keep service not to evict, i.e. the one just loaded
+     */
+    void evict_lazy(const std::string &keep)
+    {
+      if (_lazy_mem_budget <= 0)
+        return;
+      long int budget = _lazy_mem_budget * 1024 * 1024;
+      std::lock_guard<std::mutex> lock(_mlservices_mtx);
+      std::unordered_set<std::string> failed;
+      while (true)
+        {
+          long int total = 0;
+          long int lru_used = std::numeric_limits<long int>::max();
+          std::string lru;
+          for (auto &hit : _mlservices)
+            {
+              visitor_mllib::LazyState st
+                  = visitor_mllib::lazy_state(*hit.second);
+              if (!st.loaded)
+                continue;
+              total += st.mem;
+              if (st.evictable && hit.first != keep && !failed.count(hit.first)
+                  && st.last_used < lru_used)
+                {
+                  lru = hit.first;
+                  lru_used = st.last_used;
+                }
+            }
+          if (total <= budget || lru.empty())
+            return;
+
+          // the replacement is built first, so that the loaded service stays
+          // in place if it fails. The loaded service is released once calls
+          // still running on it return.
+          auto hit = _mlservices.find(lru);
+          auto logger = spdlog::get(lru);
+          try
+            {
+              hit->second = std::make_shared<mls_variant_type>(
+                  visitor_mllib::lazy_evict(*hit->second));
+            }
+          catch (...)
+            {
+              spdlog::get("api")->error(
+                  "service {} could not be evicted: {}", lru,
+                  boost::current_exception_diagnostic_information());
+              failed.insert(lru);
+              continue;
+            }
+          logger->info("idle model evicted, lazy memory {}MB above budget",
+                       (total - budget) / (1024 * 1024));
+        }
+    }
+
     int chain_service(const std::string &cname,
                       const std::shared_ptr<spdlog::logger> &chain_logger,
                       APIData &adc, ChainData &cdata,
@@ -1558,14 +1708,18 @@ namespace dd
       return 200;
     }
 
-    std::unordered_map<std::string, mls_variant_type>
+    std::unordered_map<std::string, std::shared_ptr<mls_variant_type>>
         _mlservices; /**< container of instanciated services. */
 
     std::unordered_map<std::string, res_variant_type>
         _resources; /**< container of instanciated resources */
 
+    int _lazy_mem_budget = 0; /**< memory budget in MB of lazy services, 0
+                                 means no eviction. */
+
   protected:
-    std::mutex _mlservices_mtx; /**< mutex around adding/removing services. */
+    mutable std::mutex
+        _mlservices_mtx; /**< mutex around services container. */
     std::mutex _resources_mtx;  /**< mutex around adding/removing resources. */
   };
 }
@@ -22,6 +22,13 @@
 #include "simsearch.h"
 #include "utils/fileops.hpp"
 #include "utils/utils.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #ifdef USE_FAISS
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
@@ -67,6 +74,258 @@ namespace dd
     _cat = tok.at(6);
   }
 
+  /*-- URIDataStore --*/
+  const uint32_t URIDataStore::_none;
+
+  void URIDataStore::add(const long int &idx, const URIData &fmap)
+  {
+    if (_map)
+      materialize();
+    size_t id = static_cast<size_t>(idx);
+    if (id >= _uri_ids.size())
+      {
+        _uri_ids.resize(id + 1, _none);
+        _cat_ids.resize(id + 1, _none);
+        _probs.resize(id + 1, 0.0);
+        _bboxes.resize(4 * (id + 1), 0.0);
+      }
+    _uri_ids[id] = intern(fmap._uri, _uri_index, _uris);
+    if (fmap._bbox.size() == 4)
+      {
+        _cat_ids[id] = intern(fmap._cat, _cat_index, _cats);
+        _probs[id] = fmap._prob;
+        for (size_t b = 0; b < 4; ++b)
+          _bboxes[4 * id + b] = fmap._bbox[b];
+      }
+    else
+      _cat_ids[id] = _none;
+  }
+
+  bool URIDataStore::get(const long int &idx, URIData &fmap) const
+  {
+    size_t id = static_cast<size_t>(idx);
+    if (idx < 0 || id >= size())
+      return false;
+    fmap._bbox.clear();
+    if (!_map)
+      {
+        if (_uri_ids[id] == _none)
+          return false;
+        fmap._uri = _uris[_uri_ids[id]];
+        if (_cat_ids[id] != _none)
+          {
+            fmap._bbox.assign(_bboxes.begin() + 4 * id,
+                              _bboxes.begin() + 4 * (id + 1));
+            fmap._prob = _probs[id];
+            fmap._cat = _cats[_cat_ids[id]];
+          }
+        return true;
+      }
+
+    uint32_t uri_id = _map_uri_ids[id];
+    if (uri_id >= _map_nuris)
+      return false;
+    const uint64_t *off = _map_str_offs + uri_id;
+    fmap._uri.assign(_map_strs + off[0], off[1] - off[0]);
+    uint32_t cat_id = _map_cat_ids[id];
+    if (cat_id < _map_ncats)
+      {
+        fmap._bbox.assign(_map_bboxes + 4 * id, _map_bboxes + 4 * (id + 1));
+        fmap._prob = _map_probs[id];
+        off = _map_str_offs + _map_nuris + cat_id;
+        fmap._cat.assign(_map_strs + off[0], off[1] - off[0]);
+      }
+    return true;
+  }
+
+  void URIDataStore::clear()
+  {
+    unmap();
+    _stamp = 0;
+    _uri_ids.clear();
+    _cat_ids.clear();
+    _probs.clear();
+    _bboxes.clear();
+    _uris.clear();
+    _cats.clear();
+    _uri_index.clear();
+    _cat_index.clear();
+  }
+
+  uint32_t
+  URIDataStore::intern(const std::string &str,
+                       std::unordered_map<std::string, uint32_t> &index,
+                       std::vector<std::string> &strs)
+  {
+    auto hit = index.find(str);
+    if (hit != index.end())
+      return (*hit).second;
+    uint32_t id = strs.size();
+    index.insert(std::pair<std::string, uint32_t>(str, id));
+    strs.push_back(str);
+    return id;
+  }
+
+  void URIDataStore::materialize()
+  {
+    size_t n = _map_count;
+    _uri_ids.assign(_map_uri_ids, _map_uri_ids + n);
+    _cat_ids.assign(_map_cat_ids, _map_cat_ids + n);
+    _probs.assign(_map_probs, _map_probs + n);
+    _bboxes.assign(_map_bboxes, _map_bboxes + 4 * n);
+    _uris.resize(_map_nuris);
+    _cats.resize(_map_ncats);
+    size_t s = 0;
+    for (std::vector<std::string> *strs : { &_uris, &_cats })
+      for (std::string &str : *strs)
+        {
+          str.assign(_map_strs + _map_str_offs[s],
+                     _map_str_offs[s + 1] - _map_str_offs[s]);
+          ++s;
+        }
+    for (uint32_t &c : _cat_ids)
+      if (c >= _cats.size())
+        c = _none;
+    for (uint32_t &u : _uri_ids)
+      if (u >= _uris.size())
+        u = _none;
+    for (uint32_t i = 0; i < _uris.size(); ++i)
+      _uri_index.insert(std::pair<std::string, uint32_t>(_uris[i], i));
+    for (uint32_t i = 0; i < _cats.size(); ++i)
+      _cat_index.insert(std::pair<std::string, uint32_t>(_cats[i], i));
+    unmap();
+  }
+
+  void URIDataStore::unmap()
+  {
+    if (!_map)
+      return;
+    munmap(_map, _map_size);
+    _map = nullptr;
+    _map_size = _map_count = _map_nuris = _map_ncats = 0;
+    _map_uri_ids = _map_cat_ids = nullptr;
+    _map_probs = _map_bboxes = nullptr;
+    _map_str_offs = nullptr;
+    _map_strs = nullptr;
+  }
+
+  // file layout: header (magic, stamp, count, nuris, ncats), uri ids,
+  // cat ids, probs, bboxes, padding to 8 bytes, offsets of uris then
+  // categories into the string block (nuris + ncats + 1), string block
+  static const uint64_t uri_data_store_magic = 0x44444d32; // "DDM2"
+  static const size_t uri_data_store_header = 5;
+
+  static size_t uri_data_store_align(const size_t &off)
+  {
+    return (off + 7) & ~static_cast<size_t>(7);
+  }
+
+  void URIDataStore::save(const std::string &filename, const uint64_t &stamp)
+  {
+    if (_map)
+      materialize();
+    _stamp = stamp;
+    std::string tmp_filename = filename + ".tmp";
+    std::ofstream out(tmp_filename, std::ios::out | std::ios::binary);
+    if (!out.is_open())
+      throw SimIndexException("could not write metadata table "
+                              + tmp_filename);
+    uint64_t header[uri_data_store_header]
+        = { uri_data_store_magic, _stamp, _uri_ids.size(), _uris.size(),
+            _cats.size() };
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(_uri_ids.data()),
+              _uri_ids.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char *>(_cat_ids.data()),
+              _cat_ids.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char *>(_probs.data()),
+              _probs.size() * sizeof(float));
+    out.write(reinterpret_cast<const char *>(_bboxes.data()),
+              _bboxes.size() * sizeof(float));
+    size_t pos = sizeof(header) + 7 * _uri_ids.size() * sizeof(uint32_t);
+    static const char pad[8] = { 0 };
+    out.write(pad, uri_data_store_align(pos) - pos);
+
+    std::vector<uint64_t> offs(1, 0);
+    for (const std::vector<std::string> *strs : { &_uris, &_cats })
+      for (const std::string &str : *strs)
+        offs.push_back(offs.back() + str.size());
+    out.write(reinterpret_cast<const char *>(offs.data()),
+              offs.size() * sizeof(uint64_t));
+    for (const std::vector<std::string> *strs : { &_uris, &_cats })
+      for (const std::string &str : *strs)
+        out.write(str.data(), str.size());
+    out.close();
+    if (!out || std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+      {
+        std::remove(tmp_filename.c_str());
+        throw SimIndexException("could not write metadata table " + filename);
+      }
+  }
+
+  bool URIDataStore::load(const std::string &filename)
+  {
+    clear();
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    size_t hsize = uri_data_store_header * sizeof(uint64_t);
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(hsize))
+      {
+        close(fd);
+        return false;
+      }
+    size_t fsize = st.st_size;
+    void *addr = mmap(nullptr, fsize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+      return false;
+
+    // check the layout fits the file before serving lookups from it
+    const char *data = static_cast<const char *>(addr);
+    const uint64_t *header = reinterpret_cast<const uint64_t *>(data);
+    uint64_t n = header[2], nuris = header[3], ncats = header[4];
+    bool ok = header[0] == uri_data_store_magic
+              && n <= (fsize - hsize) / (7 * sizeof(uint32_t))
+              && nuris < fsize && ncats < fsize;
+    size_t offs_pos = 0, strs_pos = 0;
+    if (ok)
+      {
+        offs_pos = uri_data_store_align(hsize + 7 * n * sizeof(uint32_t));
+        ok = offs_pos <= fsize
+             && nuris + ncats < (fsize - offs_pos) / sizeof(uint64_t);
+      }
+    if (ok)
+      {
+        strs_pos = offs_pos + (nuris + ncats + 1) * sizeof(uint64_t);
+        const uint64_t *offs
+            = reinterpret_cast<const uint64_t *>(data + offs_pos);
+        ok = offs[0] == 0 && offs[nuris + ncats] == fsize - strs_pos;
+        for (size_t s = 0; ok && s < nuris + ncats; ++s)
+          ok = offs[s] <= offs[s + 1];
+      }
+    if (!ok)
+      {
+        munmap(addr, fsize);
+        return false;
+      }
+
+    _map = addr;
+    _map_size = fsize;
+    _stamp = header[1];
+    _map_count = n;
+    _map_nuris = nuris;
+    _map_ncats = ncats;
+    _map_uri_ids = reinterpret_cast<const uint32_t *>(data + hsize);
+    _map_cat_ids = _map_uri_ids + n;
+    _map_probs = reinterpret_cast<const float *>(_map_cat_ids + n);
+    _map_bboxes = _map_probs + n;
+    _map_str_offs = reinterpret_cast<const uint64_t *>(data + offs_pos);
+    _map_strs = data + strs_pos;
+    return true;
+  }
+
   /*-- SearchEngine --*/
   template <class TSE>
   SearchEngine<TSE>::SearchEngine(const int &dim,
@@ -121,6 +380,24 @@ namespace dd
     _tse->search(data, nn, uris, distances);
   }
 
+  template <class TSE>
+  void SearchEngine<TSE>::search(const std::vector<std::vector<double>> &datas,
+                                 const int &nn,
+                                 std::vector<std::vector<URIData>> &uris,
+                                 std::vector<std::vector<double>> &distances)
+  {
+    _tse->search(datas, nn, uris, distances);
+  }
+
+  template <class TSE>
+  void SearchEngine<TSE>::search(const float *datas, const int &ndatas,
+                                 const int &nn,
+                                 std::vector<std::vector<URIData>> &uris,
+                                 std::vector<std::vector<double>> &distances)
+  {
+    _tse->search(datas, ndatas, nn, uris, distances);
+  }
+
 #ifdef USE_ANNOY
   /*- AnnoySE -*/
 
@@ -227,6 +504,11 @@ namespace dd
     if (!_built_index)
       throw SimSearchException(
           "Cannot search before the Annoy tree has been built");
+    if (static_cast<int>(vec.size()) != _f)
+      throw SimSearchException("search vector size "
+                               + std::to_string(vec.size())
+                               + " does not match index dimension "
+                               + std::to_string(_f));
     std::vector<int> result;
     _aindex->get_nns_by_vector(&vec[0], nn, -1, &result, &distances);
     for (auto i : result)
@@ -237,6 +519,33 @@ namespace dd
       }
   }
 
+  void AnnoySE::search(const std::vector<std::vector<double>> &vecs,
+                       const int &nn, std::vector<std::vector<URIData>> &uris,
+                       std::vector<std::vector<double>> &distances)
+  {
+    uris.resize(vecs.size());
+    distances.resize(vecs.size());
+    for (size_t i = 0; i < vecs.size(); ++i)
+      search(vecs[i], nn, uris[i], distances[i]);
+  }
+
+  void AnnoySE::search(const float *vecs, const int &nvecs, const int &nn,
+                       std::vector<std::vector<URIData>> &uris,
+                       std::vector<std::vector<double>> &distances)
+  {
+    // annoy trees are built on doubles
+    uris.clear();
+    distances.clear();
+    uris.resize(nvecs);
+    distances.resize(nvecs);
+    for (int i = 0; i < nvecs; ++i)
+      {
+        std::vector<double> vec(vecs + static_cast<size_t>(i) * _f,
+                                vecs + static_cast<size_t>(i + 1) * _f);
+        search(vec, nn, uris[i], distances[i]);
+      }
+  }
+
   void AnnoySE::add_to_db(const int &idx, const URIData &fmap)
   {
     if (_count_put == 0)
@@ -371,6 +680,50 @@ namespace dd
         std::cerr << "create index db\n";
         _db->Open(db_filename, db::NEW);
       }
+    if (_mem_metadata)
+      load_metadata();
+  }
+
+  void FaissSE::load_metadata()
+  {
+    std::string mem_db_filename = _model_repo + "/" + _mem_db_name;
+    uint64_t stamp = db_stamp();
+    if (_mem_db.load(mem_db_filename) && _mem_db.stamp() == stamp)
+      return;
+
+    // missing table, or db written since the table was saved: rebuild
+    std::cerr << "building in-memory index metadata from db\n";
+    _mem_db.clear();
+    std::unique_ptr<db::Cursor> cursor(_db->NewCursor());
+    while (cursor->valid())
+      {
+        URIData fmap;
+        fmap.decode(cursor->value());
+        _mem_db.add(std::stol(cursor->key()), fmap);
+        cursor->Next();
+      }
+    try
+      {
+        _mem_db.save(mem_db_filename, stamp);
+      }
+    catch (SimIndexException &e)
+      {
+        // the table is still served from memory, only persisting failed
+        std::cerr << e.what() << std::endl;
+      }
+  }
+
+  uint64_t FaissSE::db_stamp() const
+  {
+    // lmdb dbs are directories, stamp their data file
+    std::string db_filename = _model_repo + "/" + _db_name;
+    struct stat st;
+    if (stat((db_filename + "/data.mdb").c_str(), &st) != 0
+        && stat(db_filename.c_str(), &st) != 0)
+      return 0;
+    uint64_t mtime_ns = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000
+                        + st.st_mtim.tv_nsec;
+    return mtime_ns ^ (static_cast<uint64_t>(st.st_size) << 32);
   }
 
   void FaissSE::train()
@@ -414,12 +767,16 @@ namespace dd
 #endif
     _txn->Commit();
     _txn = std::unique_ptr<db::Transaction>(_db->NewTransaction());
+    if (_mem_metadata)
+      _mem_db.save(_model_repo + "/" + _mem_db_name, db_stamp());
   }
 
   void FaissSE::remove_index()
   {
     fileops::remove_file(_model_repo, _index_name);
     fileops::remove_file(_model_repo, _il_name);
+    fileops::remove_file(_model_repo, _mem_db_name);
+    _mem_db.clear();
     std::string db_filename = _model_repo + "/" + _db_name;
     fileops::clear_directory(db_filename);
     rmdir(db_filename.c_str());
@@ -467,15 +824,8 @@ namespace dd
       add_to_db(idx + i, uris[i]);
   }
 
-  void FaissSE::search(const std::vector<double> &vec, const int &nn,
-                       std::vector<URIData> &uris,
-                       std::vector<double> &distances)
+  void FaissSE::set_nprobe()
   {
-    if (!_findex->is_trained)
-      train();
-    std::vector<long int> labels(nn, -1);
-    std::vector<float> d(nn, -1.0);
-    std::vector<float> v(vec.begin(), vec.end());
     faiss::IndexIVF *iivf = dynamic_cast<faiss::IndexIVF *>(_findex);
     if (iivf)
       {
@@ -490,23 +840,82 @@ namespace dd
         else
           iivf->nprobe = _nprobe;
       }
+  }
+
+  void FaissSE::search(const std::vector<double> &vec, const int &nn,
+                       std::vector<URIData> &uris,
+                       std::vector<double> &distances)
+  {
+    if (static_cast<int>(vec.size()) != _f)
+      throw SimSearchException("search vector size "
+                               + std::to_string(vec.size())
+                               + " does not match index dimension "
+                               + std::to_string(_f));
+    std::vector<float> v(vec.begin(), vec.end());
+    std::vector<std::vector<URIData>> buris;
+    std::vector<std::vector<double>> bdistances;
+    search(v.data(), 1, nn, buris, bdistances);
+    uris.insert(uris.end(), buris[0].begin(), buris[0].end());
+    distances.insert(distances.end(), bdistances[0].begin(),
+                     bdistances[0].end());
+  }
+
+  void FaissSE::search(const std::vector<std::vector<double>> &vecs,
+                       const int &nn, std::vector<std::vector<URIData>> &uris,
+                       std::vector<std::vector<double>> &distances)
+  {
+    std::vector<float> v;
+    v.reserve(vecs.size() * _f);
+    for (const std::vector<double> &vec : vecs)
+      {
+        if (static_cast<int>(vec.size()) != _f)
+          throw SimSearchException(
+              "search vector size " + std::to_string(vec.size())
+              + " does not match index dimension " + std::to_string(_f));
+        v.insert(v.end(), vec.begin(), vec.end());
+      }
+    search(v.data(), vecs.size(), nn, uris, distances);
+  }
 
-    _findex->search(1, v.data(), nn, d.data(), labels.data());
-    for (int i = 0; i < nn; ++i)
+  void FaissSE::search(const float *vecs, const int &nvecs, const int &nn,
+                       std::vector<std::vector<URIData>> &uris,
+                       std::vector<std::vector<double>> &distances)
+  {
+    uris.clear();
+    distances.clear();
+    uris.resize(nvecs);
+    distances.resize(nvecs);
+    if (nvecs == 0)
+      return;
+    if (!_findex->is_trained)
+      train();
+    set_nprobe();
+
+    // all queries at once, faiss parallelizes over queries
+    std::vector<long int> labels(static_cast<size_t>(nvecs) * nn, -1);
+    std::vector<float> d(static_cast<size_t>(nvecs) * nn, -1.0);
+    _findex->search(nvecs, vecs, nn, d.data(), labels.data());
+
+    std::vector<URIData> fmaps;
+    get_from_db(labels, fmaps);
+    for (int q = 0; q < nvecs; ++q)
       {
-        long int label = labels[i];
-        if (label != -1)
+        for (int i = 0; i < nn; ++i)
           {
-            URIData uri;
-            get_from_db(label, uri);
-            uris.push_back(uri);
-            distances.push_back(d[i] / ((double)vec.size()));
+            size_t k = static_cast<size_t>(q) * nn + i;
+            if (labels[k] != -1)
+              {
+                uris[q].push_back(fmaps[k]);
+                distances[q].push_back(d[k] / static_cast<double>(_f));
+              }
           }
       }
   }
 
   void FaissSE::add_to_db(const int &idx, const URIData &fmap)
   {
+    if (_mem_metadata)
+      _mem_db.add(idx, fmap);
     if (_count_put == 0)
       _txn = std::unique_ptr<db::Transaction>(_db->NewTransaction());
     _txn->Put(std::to_string(idx), fmap.encode());
@@ -520,11 +929,49 @@ namespace dd
 
   void FaissSE::get_from_db(const int &idx, URIData &fmap)
   {
+    if (_mem_metadata && _mem_db.get(idx, fmap))
+      return;
     std::string tmp;
     _db->Get(std::to_string(idx), tmp);
     fmap.decode(tmp);
   }
 
+  void FaissSE::get_from_db(const std::vector<long int> &idxs,
+                            std::vector<URIData> &fmaps)
+  {
+    if (_mem_metadata)
+      {
+        fmaps.clear();
+        fmaps.resize(idxs.size());
+        bool missing = false;
+        for (size_t i = 0; i < idxs.size(); ++i)
+          if (idxs[i] != -1 && !_mem_db.get(idxs[i], fmaps[i]))
+            missing = true;
+        if (!missing)
+          return;
+      }
+
+    // neighbors are often shared among queries, e.g. ROIs of an image
+    std::unordered_map<long int, size_t> key_pos;
+    std::vector<std::string> keys;
+    for (long int idx : idxs)
+      if (idx != -1 && key_pos.emplace(idx, keys.size()).second)
+        keys.push_back(std::to_string(idx));
+
+    std::vector<std::string> vals;
+    _db->Get(keys, vals);
+    std::vector<URIData> decoded(keys.size());
+    for (size_t k = 0; k < keys.size(); ++k)
+      if (!vals[k].empty())
+        decoded[k].decode(vals[k]);
+
+    fmaps.clear();
+    fmaps.resize(idxs.size());
+    for (size_t i = 0; i < idxs.size(); ++i)
+      if (idxs[i] != -1)
+        fmaps[i] = decoded[key_pos[idxs[i]]];
+  }
+
   template class SearchEngine<FaissSE>;
 
 #endif
@@ -42,6 +42,7 @@
 #include "utils/db.hpp"
 #pragma GCC diagnostic pop
 #include <mutex>
+#include <unordered_map>
 
 namespace dd
 {
@@ -115,6 +116,103 @@ namespace dd
     static char _enc_char;
   };
 
+  /**
+   * \brief in-memory columnar table of indexed URIData, by index id.
+   * URIs and categories are interned and bboxes packed as floats, so that
+   * hydrating a search hit is a lookup. Persisted to a single binary file
+   * that is mmaped when loading, lookups are then served from the mapping
+   * until the table is modified.
+   */
+  class URIDataStore
+  {
+  public:
+    URIDataStore()
+    {
+    }
+    ~URIDataStore()
+    {
+      unmap();
+    }
+    URIDataStore(const URIDataStore &) = delete;
+    URIDataStore &operator=(const URIDataStore &) = delete;
+
+    /**
+     * \brief set metadata of index id idx, ids are expected to be dense
+     */
+    void add(const long int &idx, const URIData &fmap);
+
+    /**
+     * \brief hydrate metadata of index id idx
+     * @return false if idx is unknown
+     */
+    bool get(const long int &idx, URIData &fmap) const;
+
+    size_t size() const
+    {
+      return _map ? _map_count : _uri_ids.size();
+    }
+
+    /**
+     * \brief stamp of the db state the table was saved with
+     */
+    uint64_t stamp() const
+    {
+      return _stamp;
+    }
+
+    void clear();
+
+    /**
+     * \brief write the table to file, through a temporary file
+     * @param stamp db state the table matches, checked when loading
+     */
+    void save(const std::string &filename, const uint64_t &stamp);
+
+    /**
+     * \brief map the table from file
+     * @return false if the file is missing or invalid
+     */
+    bool load(const std::string &filename);
+
+  private:
+    uint32_t intern(const std::string &str,
+                    std::unordered_map<std::string, uint32_t> &index,
+                    std::vector<std::string> &strs);
+
+    /**
+     * \brief copy the mapped table to memory before modifying it
+     */
+    void materialize();
+
+    void unmap();
+
+    static const uint32_t _none = static_cast<uint32_t>(-1);
+
+    uint64_t _stamp = 0;
+
+    // mapped table, when loaded and not modified since
+    void *_map = nullptr;
+    size_t _map_size = 0;
+    size_t _map_count = 0;
+    size_t _map_nuris = 0;
+    size_t _map_ncats = 0;
+    const uint32_t *_map_uri_ids = nullptr;
+    const uint32_t *_map_cat_ids = nullptr;
+    const float *_map_probs = nullptr;
+    const float *_map_bboxes = nullptr;
+    const uint64_t *_map_str_offs = nullptr; /**< uris then cats offsets */
+    const char *_map_strs = nullptr;
+
+    std::vector<uint32_t> _uri_ids; /**< per id uri, _none if unset */
+    std::vector<uint32_t> _cat_ids; /**< per id category, _none if no bbox */
+    std::vector<float> _probs;      /**< per id prob */
+    std::vector<float> _bboxes;     /**< per id packed 4 floats bbox */
+    std::vector<std::string> _uris; /**< interned uris */
+    std::vector<std::string> _cats; /**< interned categories */
+    std::unordered_map<std::string, uint32_t> _uri_index;
+    std::unordered_map<std::string, uint32_t> _cat_index;
+  };
+
   template <class TSE> class SearchEngine
   {
   public:
@@ -136,6 +234,16 @@ namespace dd
     void search(const std::vector<double> &data, const int &nn,
                 std::vector<URIData> &uris, std::vector<double> &distances);
 
+    // batch search, one list of results per query
+    void search(const std::vector<std::vector<double>> &datas, const int &nn,
+                std::vector<std::vector<URIData>> &uris,
+                std::vector<std::vector<double>> &distances);
+
+    // batch search from ndatas x _dim contiguous float32 vectors
+    void search(const float *datas, const int &ndatas, const int &nn,
+                std::vector<std::vector<URIData>> &uris,
+                std::vector<std::vector<double>> &distances);
+
     const int _dim = 128; /**< indexed vector length. */
     TSE *_tse = nullptr;
     std::mutex _index_mutex; /**< mutex around indexing calls. */
@@ -163,6 +271,14 @@ namespace dd
     void search(const std::vector<double> &vec, const int &nn,
                 std::vector<URIData> &uris, std::vector<double> &distances);
 
+    void search(const std::vector<std::vector<double>> &vecs, const int &nn,
+                std::vector<std::vector<URIData>> &uris,
+                std::vector<std::vector<double>> &distances);
+
+    void search(const float *vecs, const int &nvecs, const int &nn,
+                std::vector<std::vector<URIData>> &uris,
+                std::vector<std::vector<double>> &distances);
+
     // internal functions
     void build_tree();
 
@@ -222,10 +338,42 @@ namespace dd
     void search(const std::vector<double> &vec, const int &nn,
                 std::vector<URIData> &uris, std::vector<double> &distances);
 
+    void search(const std::vector<std::vector<double>> &vecs, const int &nn,
+                std::vector<std::vector<URIData>> &uris,
+                std::vector<std::vector<double>> &distances);
+
+    /**
+     * \brief batch search from contiguous float vectors, all queries are
+     * sent to faiss at once
+     * @param vecs nvecs x _f query vectors
+     */
+    void search(const float *vecs, const int &nvecs, const int &nn,
+                std::vector<std::vector<URIData>> &uris,
+                std::vector<std::vector<double>> &distances);
+
     void train();
+    void set_nprobe();
     void add_to_db(const int &idx, const URIData &fmap);
     void get_from_db(const int &idx, URIData &fmap);
 
+    /**
+     * \brief fetch metadata of several indexed vectors in a single db read,
+     * each distinct label is read and decoded once
+     */
+    void get_from_db(const std::vector<long int> &idxs,
+                     std::vector<URIData> &fmaps);
+
+    /**
+     * \brief load in-memory metadata table, or rebuild it from the db
+     */
+    void load_metadata();
+
+    /**
+     * \brief stamp of the current db state, from the db file modification
+     * time and size
+     */
+    uint64_t db_stamp() const;
+
     faiss::Index *_findex = nullptr;
     std::string _index_key;
 
@@ -236,6 +384,7 @@ namespace dd
     const std::string _db_backend = "lmdb";
     const std::string _index_name = "index.faiss";
     const std::string _il_name = "index_mmap.faiss";
+    const std::string _mem_db_name = "names.mem";
     db::DB *_db = nullptr;
     std::unique_ptr<db::Transaction> _txn;
     int _count_put = 0;
@@ -244,6 +393,10 @@ namespace dd
     bool _ondisk = true;
     int _nprobe = -1;
     std::vector<float> _train_samples;
+    bool _mem_metadata = false; /**< whether to serve search hits metadata
+                                   from memory, the db remains the durable
+                                   copy */
+    URIDataStore _mem_db;       /**< in-memory metadata table */
 
 #ifdef USE_GPU_FAISS
     bool _gpu = false;
@@ -175,7 +175,7 @@ namespace dd
     inline void add_results(const std::vector<APIData> &vrad)
     {
       std::unordered_map<std::string, int>::iterator hit;
-      for (APIData ad : vrad)
+      for (const APIData &ad : vrad)
         {
           std::string uri = ad.get("uri").get<std::string>();
           std::string index_uri;
@@ -254,7 +254,7 @@ namespace dd
         {
           for (size_t i = 0; i < _vvcats.size(); i++)
             {
-              sup_result sresult = _vvcats.at(i);
+              const sup_result &sresult = _vvcats.at(i);
               sup_result bsresult(sresult._label, sresult._loss);
 #ifdef USE_SIMSEARCH
               bsresult._index_uri = sresult._index_uri;
@@ -288,7 +288,7 @@ namespace dd
         {
           for (size_t i = 0; i < _vvcats.size(); i++)
             {
-              sup_result sresult = _vvcats.at(i);
+              const sup_result &sresult = _vvcats.at(i);
               sup_result bsresult(sresult._label, sresult._loss);
 #ifdef USE_SIMSEARCH
               bsresult._index_uri = sresult._index_uri;
@@ -603,20 +603,63 @@ namespace dd
           if (output_params->nprobe)
             mlm->_se->_tse->_nprobe = output_params->nprobe;
 #endif
+          // all queries of the batch, including every roi, are packed as
+          // float32 and searched at once
+          std::vector<float> queries;
+          int nqueries = 0;
+          auto check_query_dim = [&](const size_t &dim) {
+            if (static_cast<int>(dim) != mlm->_se->_dim)
+              throw OutputConnectorBadParamException(
+                  "search vector size " + std::to_string(dim)
+                  + " does not match index dimension "
+                  + std::to_string(mlm->_se->_dim));
+            ++nqueries;
+          };
           if (!has_roi)
             {
               for (size_t i = 0; i < bcats._vvcats.size(); i++)
                 {
-                  std::vector<double> probs;
+                  check_query_dim(bcats._vvcats.at(i)._cats.size());
                   auto mit = bcats._vvcats.at(i)._cats.begin();
                   while (mit != bcats._vvcats.at(i)._cats.end())
                     {
-                      probs.push_back((*mit).first);
+                      queries.push_back((*mit).first);
+                      ++mit;
+                    }
+                }
+            }
+          else
+            {
+              for (size_t i = 0; i < bcats._vvcats.size(); i++)
+                {
+                  auto vit = bcats._vvcats.at(i)._vals.begin();
+                  auto mit = bcats._vvcats.at(i)._cats.begin();
+                  while (mit != bcats._vvcats.at(i)._cats.end())
+                    {
+                      std::vector<double> vals
+                          = (*vit).second.get("vals")
+                                .get<std::vector<double>>();
+                      check_query_dim(vals.size());
+                      queries.insert(queries.end(), vals.begin(), vals.end());
                       ++mit;
+                      ++vit;
                     }
-                  std::vector<URIData> nn_uris;
-                  std::vector<double> nn_distances;
-                  mlm->_se->search(probs, search_nn, nn_uris, nn_distances);
+                }
+            }
+          std::vector<std::vector<URIData>> batch_uris;
+          std::vector<std::vector<double>> batch_distances;
+          mlm->_se->search(queries.data(), nqueries, search_nn, batch_uris,
+                           batch_distances);
+          size_t q = 0;
+
+          if (!has_roi)
+            {
+              for (size_t i = 0; i < bcats._vvcats.size(); i++)
+                {
+                  const std::vector<URIData> &nn_uris = batch_uris.at(q);
+                  const std::vector<double> &nn_distances
+                      = batch_distances.at(q);
+                  ++q;
                   for (size_t j = 0; j < nn_uris.size(); j++)
                     {
                       bcats._vvcats.at(i).add_nn(nn_distances.at(j),
@@ -639,11 +682,10 @@ namespace dd
                                 ._cats
                                 .end()) // equivalent to iterating the bboxes
                     {
-                      std::vector<URIData> nn_uris;
-                      std::vector<double> nn_distances;
-                      mlm->_se->search(
-                          (*vit).second.get("vals").get<std::vector<double>>(),
-                          search_nn, nn_uris, nn_distances);
+                      const std::vector<URIData> &nn_uris = batch_uris.at(q);
+                      const std::vector<double> &nn_distances
+                          = batch_distances.at(q);
+                      ++q;
                       for (size_t j = 0; j < nn_uris.size(); j++)
                         {
                           if ((hit = multibox_nn.find(nn_uris.at(j)._uri))
@@ -696,11 +738,10 @@ namespace dd
                                 ._cats
                                 .end()) // equivalent to iterating the bboxes
                     {
-                      std::vector<URIData> nn_uris;
-                      std::vector<double> nn_distances;
-                      mlm->_se->search(
-                          (*vit).second.get("vals").get<std::vector<double>>(),
-                          search_nn, nn_uris, nn_distances);
+                      const std::vector<URIData> &nn_uris = batch_uris.at(q);
+                      const std::vector<double> &nn_distances
+                          = batch_distances.at(q);
+                      ++q;
                       ++mit;
                       ++vit;
                       for (size_t j = 0; j < nn_uris.size(); j++)
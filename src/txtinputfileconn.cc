@@ -21,58 +21,172 @@
 
 #include "txtinputfileconn.h"
 #include "utils/fileops.hpp"
+#include "utils/ordered_parallel.hpp"
 #include "utils/utils.hpp"
 #include <boost/tokenizer.hpp>
 #include <iostream>
 
 namespace dd
 {
+  /**
+   * \brief calls f(start, len) on each non empty token of str, tokens being
+   * separated by any of the bytes in seps
+   */
+  template <typename F>
+  static void split_tokens(const std::string &str, const char *seps, F f)
+  {
+    bool sep[256] = { false };
+    for (const char *c = seps; *c; ++c)
+      sep[static_cast<uint8_t>(*c)] = true;
+    size_t start = 0;
+    for (size_t i = 0; i <= str.size(); ++i)
+      {
+        if (i == str.size() || sep[static_cast<uint8_t>(str[i])])
+          {
+            if (i > start)
+              f(str.data() + start, i - start);
+            start = i + 1;
+          }
+      }
+  }
 
-  void WordPieceTokenizer::append_input(const std::string &word)
+
+  /*- VocabTrie -*/
+  VocabTrie::VocabTrie(const std::unordered_map<std::string, Word> &vocab,
+                       const uint64_t &vocab_gen, const std::string &prefix)
+      : _vocab_gen(vocab_gen), _vocab_size(vocab.size()), _prefix(prefix)
   {
-    int start = 0;
-    std::vector<std::string> subtokens;
-    bool is_bad = false;
+    std::vector<std::pair<std::string, int>> entries;
+    for (auto const &p : vocab)
+      if (p.first.size() > prefix.size()
+          && p.first.compare(0, prefix.size(), prefix) == 0)
+        entries.emplace_back(p.first.substr(prefix.size()), p.second._pos);
+    std::sort(entries.begin(), entries.end());
 
-    while (start < static_cast<int>(word.size()))
+    // breadth-first layout: the children of a node are the distinct next
+    // bytes over its range of sorted entries
+    struct Range
+    {
+      size_t _node, _begin, _end, _depth;
+    };
+    _nodes.emplace_back();
+    _bytes.push_back(0);
+    std::vector<Range> level = { { 0, 0, entries.size(), 0 } };
+    while (!level.empty())
       {
-        int end = word.size();
-        std::string cur_substr = "";
-        while (start < end)
+        std::vector<Range> next;
+        for (const Range &r : level)
           {
-            std::string substr = word.substr(start, end - start);
-            if (start > 0)
+            size_t b = r._begin;
+            if (b < r._end && entries[b].first.size() == r._depth)
+              _nodes[r._node]._id = entries[b++].second;
+            _nodes[r._node]._children = _nodes.size();
+            while (b < r._end)
               {
-                substr = _suffix_start + substr;
+                uint8_t byte = entries[b].first[r._depth];
+                size_t e = b + 1;
+                while (e < r._end
+                       && static_cast<uint8_t>(entries[e].first[r._depth])
+                              == byte)
+                  ++e;
+                next.push_back({ _nodes.size(), b, e, r._depth + 1 });
+                _nodes.emplace_back();
+                _bytes.push_back(byte);
+                ++_nodes[r._node]._nchildren;
+                b = e;
               }
-            else
-              {
-                substr = _word_start + substr;
-              }
-            if (in_vocab(substr))
-              {
-                cur_substr = substr;
-                break;
-              }
-            --end;
           }
-        if (cur_substr == "")
+        level = std::move(next);
+      }
+  }
+
+  size_t VocabTrie::longest_match(const char *s, const size_t &len,
+                                  int &id) const
+  {
+    size_t match = 0;
+    uint32_t node = 0;
+    for (size_t i = 0; i < len; ++i)
+      {
+        const Node &n = _nodes[node];
+        auto first = _bytes.begin() + n._children;
+        auto last = first + n._nchildren;
+        auto child = std::lower_bound(first, last, static_cast<uint8_t>(s[i]));
+        if (child == last || *child != static_cast<uint8_t>(s[i]))
+          break;
+        node = child - _bytes.begin();
+        if (_nodes[node]._id >= 0)
           {
-            is_bad = true;
-            break;
+            match = i + 1;
+            id = _nodes[node]._id;
           }
-        subtokens.push_back(cur_substr);
-        start = end;
       }
+    return match;
+  }
+
+  /*- WordPieceTokenizer -*/
+  void WordPieceTokenizer::compile()
+  {
+    const std::unordered_map<std::string, Word> &vocab = _ctfc->_vocab;
+    uint64_t gen = _ctfc->_vocab_gen;
+    // the size catches entries added straight into the vocabulary
+    if (!_word_trie || _word_trie->_vocab_gen != gen
+        || _word_trie->_vocab_size != vocab.size()
+        || _word_trie->_prefix != _word_start)
+      {
+        _word_trie = std::make_shared<VocabTrie>(vocab, gen, _word_start);
+        auto vhit = vocab.find(_unk_token);
+        _unk_id = vhit != vocab.end() ? (*vhit).second._pos : -1;
+      }
+    if (!_suffix_trie || _suffix_trie->_vocab_gen != gen
+        || _suffix_trie->_vocab_size != vocab.size()
+        || _suffix_trie->_prefix != _suffix_start)
+      _suffix_trie = std::make_shared<VocabTrie>(vocab, gen, _suffix_start);
+  }
 
-    if (is_bad)
+  bool WordPieceTokenizer::match_pieces(const char *word, const size_t &len)
+  {
+    compile();
+    _pieces.clear();
+    size_t start = 0;
+    while (start < len)
+      {
+        int id = -1;
+        const VocabTrie &trie = start > 0 ? *_suffix_trie : *_word_trie;
+        size_t match = trie.longest_match(word + start, len - start, id);
+        if (match == 0)
+          return false;
+        _pieces.emplace_back(id, match);
+        start += match;
+      }
+    return true;
+  }
+
+  void WordPieceTokenizer::append_input(const char *word, const size_t &len)
+  {
+    if (!match_pieces(word, len))
       {
         _tokens.push_back(_unk_token);
+        return;
       }
-    else
+    size_t start = 0;
+    for (auto const &p : _pieces)
+      {
+        const std::string &prefix = start > 0 ? _suffix_start : _word_start;
+        _tokens.push_back(prefix + std::string(word + start, p.second));
+        start += p.second;
+      }
+  }
+
+  void WordPieceTokenizer::append_ids(const char *word, const size_t &len,
+                                      std::vector<int> &ids)
+  {
+    if (!match_pieces(word, len))
       {
-        _tokens.insert(_tokens.end(), subtokens.begin(), subtokens.end());
+        ids.push_back(_unk_id);
+        return;
       }
+    for (auto const &p : _pieces)
+      ids.push_back(p.first);
   }
 
   bool WordPieceTokenizer::in_vocab(const std::string &tok)
@@ -215,18 +329,35 @@ namespace dd
           }
       }
 
-    // parse content
-    // XXX: parallelize with openmp -> requires thread safe parse_content
-    for (std::pair<std::string, int> &p : lfiles)
-      {
-        std::ifstream txt_file(p.first);
-        if (!txt_file.is_open())
-          throw InputConnectorBadParamException("cannot open file " + p.first);
-        std::stringstream buffer;
-        buffer << txt_file.rdbuf();
-        std::string ct = buffer.str();
-        _ctfc->parse_content(ct, p.second, test_id);
-      }
+    // parse content, files are read and tokenized by workers, entries are
+    // added in files order
+    if (_ctfc->_wordpiece_tokens)
+      _ctfc->_wordpiece_tokenizer.compile();
+    int nworkers = std::min(dd_utils::num_workers(_ctfc->_read_workers),
+                            std::max(1, static_cast<int>(lfiles.size())));
+    std::vector<TxtParser> parsers(
+        nworkers, TxtParser(_ctfc->_wordpiece_tokenizer));
+    std::vector<std::vector<uint32_t>> parsers_terms(nworkers);
+    dd_utils::ordered_parallel_for<TxtDoc>(
+        0, lfiles.size(),
+        [&](const size_t &i, const int &worker_id, TxtDoc &doc) {
+          const std::pair<std::string, int> &p = lfiles[i];
+          std::ifstream txt_file(p.first);
+          if (!txt_file.is_open())
+            throw InputConnectorBadParamException("cannot open file "
+                                                  + p.first);
+          std::stringstream buffer;
+          buffer << txt_file.rdbuf();
+          doc._parser = worker_id;
+          _ctfc->parse_document(parsers[worker_id], buffer.str(),
+                                p.second, i, doc);
+          return true;
+        },
+        [&](const size_t &, TxtDoc &doc) {
+          _ctfc->add_document(doc, parsers_terms[doc._parser], test_id);
+        },
+        nworkers);
+    _ctfc->merge_vocab(parsers);
 
     // post-processing
     size_t initial_vocab_size = _ctfc->_vocab.size();
@@ -236,7 +367,10 @@ namespace dd
         while (vhit != _ctfc->_vocab.end())
           {
             if ((*vhit).second._total_count < _ctfc->_min_count)
-              vhit = _ctfc->_vocab.erase(vhit);
+              {
+                vhit = _ctfc->_vocab.erase(vhit);
+                ++_ctfc->_vocab_gen;
+              }
             else
               ++vhit;
           }
@@ -245,6 +379,7 @@ namespace dd
         && initial_vocab_size != _ctfc->_vocab.size())
       {
         // update pos
+        ++_ctfc->_vocab_gen;
         int pos = 0;
         auto vhit = _ctfc->_vocab.begin();
         while (vhit != _ctfc->_vocab.end())
@@ -255,45 +390,41 @@ namespace dd
           }
       }
 
-    if (_ctfc->_generate_vocab && !_ctfc->_characters && !test_dir
+    if (_ctfc->_generate_vocab && !_ctfc->_characters && !_ctfc->_ordered_words
+        && !test_dir
         && (initial_vocab_size != _ctfc->_vocab.size() || _ctfc->_tfidf))
       {
         // clearing up the corpus + tfidf
-        std::unordered_map<std::string, Word>::iterator whit;
+        std::shared_ptr<TxtBowRows> bow_rows = _ctfc->_bow_rows;
+        std::vector<bool> rows_mask(bow_rows->_rows.size() - 1, false);
         for (TxtEntry<double> *te : _ctfc->_txt)
           {
             TxtBowEntry *tbe = static_cast<TxtBowEntry *>(te);
-            auto hit = tbe->_v.begin();
-            while (hit != tbe->_v.end())
-              {
-                if ((whit = _ctfc->_vocab.find((*hit).first))
-                    != _ctfc->_vocab.end())
-                  {
-                    if (_ctfc->_tfidf)
-                      {
-                        Word w = (*whit).second;
-                        (*hit).second
-                            = (std::log(
-                                  1.0
-                                  + (*hit).second
-                                        / static_cast<double>(w._total_count)))
-                              * std::log(
-                                  _ctfc->_txt.size()
-                                      / static_cast<double>(w._total_docs)
-                                  + 1.0);
-                        // std::cerr << "tfidf feature w=" << (*hit).first << "
-                        // / val=" << (*hit).second << std::endl;
-                      }
-                    ++hit;
-                  }
-                else
-                  {
-                    // std::cerr << "removing ws=" << (*hit).first <<
-                    // std::endl;
-                    hit = tbe->_v.erase(hit);
-                  }
-              }
+            if (tbe->_rows == bow_rows)
+              rows_mask[tbe->_row] = true;
           }
+        // vocabulary lookup once per term
+        std::vector<const Word *> words(bow_rows->_terms.size(), nullptr);
+        for (size_t t = 0; t < words.size(); ++t)
+          {
+            auto whit = _ctfc->_vocab.find(bow_rows->_terms[t]);
+            if (whit != _ctfc->_vocab.end())
+              words[t] = &(*whit).second;
+          }
+        const double ndocs = _ctfc->_txt.size();
+        const bool tfidf = _ctfc->_tfidf;
+        bow_rows->filter(rows_mask, [&](const uint32_t &t, double &val) {
+          const Word *w = words[t];
+          if (!w)
+            return false;
+          if (tfidf)
+            val = std::log(1.0 + val / static_cast<double>(w->_total_count))
+                  * std::log(ndocs / static_cast<double>(w->_total_docs)
+                             + 1.0);
+          return true;
+        });
+        for (TxtEntry<double> *te : _ctfc->_txt)
+          static_cast<TxtBowEntry *>(te)->reset();
       }
 
     // write corresp file
@@ -315,19 +446,78 @@ namespace dd
     return 0;
   }
 
+  /*- TxtBowRows -*/
+  uint32_t TxtBowRows::term_id(const std::string &term)
+  {
+    auto hit = _term_ids.find(term);
+    if (hit != _term_ids.end())
+      return (*hit).second;
+    uint32_t id = _terms.size();
+    _term_ids.emplace(term, id);
+    _terms.push_back(term);
+    return id;
+  }
+
+  size_t
+  TxtBowRows::add_row(const std::vector<std::pair<uint32_t, double>> &row)
+  {
+    for (auto const &w : row)
+      {
+        _words.push_back(w.first);
+        _vals.push_back(w.second);
+      }
+    _rows.push_back(_words.size());
+    return _rows.size() - 2;
+  }
+
+  /*- TxtParser -*/
+  uint32_t TxtParser::term_id(const std::string &term)
+  {
+    auto hit = _term_ids.find(term);
+    if (hit != _term_ids.end())
+      return (*hit).second;
+    uint32_t id = _terms.size();
+    _term_ids.emplace(term, id);
+    _terms.push_back(term);
+    _total_count.push_back(0);
+    _total_docs.push_back(0);
+    _first_seen.push_back(std::numeric_limits<uint64_t>::max());
+    _last_entry.push_back(0);
+    _entry_val.push_back(0.0);
+    return id;
+  }
+
   /*- TxtInputFileConn -*/
   void TxtInputFileConn::parse_content(const std::string &content,
                                        const float &target, int test_id)
+  {
+    if (_wordpiece_tokens)
+      _wordpiece_tokenizer.compile();
+    std::vector<TxtParser> parsers(1, TxtParser(_wordpiece_tokenizer));
+    TxtDoc doc;
+    parse_document(parsers[0], content, target, 0, doc);
+    std::vector<uint32_t> terms;
+    add_document(doc, terms, test_id);
+    merge_vocab(parsers);
+  }
+
+  void TxtInputFileConn::parse_document(TxtParser &parser,
+                                        const std::string &content,
+                                        const float &target,
+                                        const size_t &doc_id,
+                                        TxtDoc &doc) const
   {
     if (!_train && content.empty())
       throw InputConnectorBadParamException("no text data found");
+    doc._target = target;
+    size_t nterms = parser._terms.size();
+    uint64_t ntokens = 0;
     std::vector<std::string> cts;
     if (_sentences)
       {
-        boost::char_separator<char> sep("\n");
-        boost::tokenizer<boost::char_separator<char>> tokens(content, sep);
-        for (std::string s : tokens)
-          cts.push_back(s);
+        split_tokens(content, "\n", [&cts](const char *s, const size_t &len) {
+          cts.emplace_back(s, len);
+        });
       }
     else
       {
@@ -339,102 +529,110 @@ namespace dd
           std::transform(ct.begin(), ct.end(), ct.begin(), ::tolower);
         if (!_characters)
           {
-            std::unordered_map<std::string, Word>::iterator vhit;
-            std::vector<std::string> tokens;
+            // tokens are views of ct
+            std::vector<std::pair<const char *, size_t>> tokens;
+            auto add_token = [&tokens](const char *s, const size_t &len) {
+              tokens.emplace_back(s, len);
+            };
             if (_punctuation_tokens)
               {
-                boost::char_separator<char> sep("\n\t\f\r ");
-                boost::tokenizer<boost::char_separator<char>> tokenizer(ct,
-                                                                        sep);
-
                 // Split punctuation
                 auto is_punct = [](char i) {
                   return (i >= 33 && i <= 47) || (i >= 58 && i <= 64)
                          || (i >= 91 && i <= 96) || (i >= 123 && i <= 126);
                 };
-                for (std::string token : tokenizer)
-                  {
-                    int start = 0;
-                    for (int i = 0; i < static_cast<int>(token.size()); ++i)
-                      {
-                        if (is_punct(token[i]))
-                          {
-                            if (i != start)
-                              tokens.push_back(token.substr(start, i - start));
-                            tokens.push_back(token.substr(i, 1));
-                            start = i + 1;
-                          }
-                      }
-                    if (start != static_cast<int>(token.size()))
-                      tokens.push_back(token.substr(start));
-                  }
+                split_tokens(
+                    ct, "\n\t\f\r ", [&](const char *s, const size_t &len) {
+                      size_t start = 0;
+                      for (size_t i = 0; i < len; ++i)
+                        {
+                          if (is_punct(s[i]))
+                            {
+                              if (i != start)
+                                add_token(s + start, i - start);
+                              add_token(s + i, 1);
+                              start = i + 1;
+                            }
+                        }
+                      if (start != len)
+                        add_token(s + start, len - start);
+                    });
               }
             else
               {
-                boost::char_separator<char> sep(
-                    "\n\t\f\r ,.;:`'!?)(-|><^·&\"\\/{}#$–=+");
-                boost::tokenizer<boost::char_separator<char>> tokenizer(ct,
-                                                                        sep);
-                tokens.insert(tokens.end(), tokenizer.begin(),
-                              tokenizer.end());
-              }
-            if (_wordpiece_tokens)
-              {
-                _wordpiece_tokenizer.reset();
-                for (const std::string &token : tokens)
-                  {
-                    _wordpiece_tokenizer.append_input(token);
-                  }
-                tokens = std::move(_wordpiece_tokenizer._tokens);
-                _wordpiece_tokenizer._tokens = std::vector<std::string>();
+                split_tokens(ct, "\n\t\f\r ,.;:`'!?)(-|><^·&\"\\/{}#$–=+",
+                             add_token);
               }
 
             if (_ordered_words)
               {
                 TxtOrderedWordsEntry *towe = new TxtOrderedWordsEntry(target);
-                for (std::string w : tokens)
+                std::unordered_map<std::string, Word>::const_iterator vhit;
+                for (auto const &t : tokens)
                   {
-                    towe->add_word(w);
+                    if (_wordpiece_tokens)
+                      parser._wordpiece_tokenizer.append_ids(
+                          t.first, t.second, towe->_v);
+                    else if ((vhit = _vocab.find(
+                                  std::string(t.first, t.second)))
+                             != _vocab.end())
+                      towe->add_word((*vhit).second._pos);
+                    else
+                      towe->add_word(-1);
                   }
-
-                if (test_id < 0)
-                  _txt.push_back(towe);
-                else
-                  _tests_txt[static_cast<size_t>(test_id)].push_back(towe);
+                doc._entries.push_back(towe);
               }
             else
               {
-                TxtBowEntry *tbe = new TxtBowEntry(target);
-                for (std::string w : tokens)
+                WordPieceTokenizer &wpt = parser._wordpiece_tokenizer;
+                std::vector<std::string> words;
+                if (_wordpiece_tokens)
+                  {
+                    wpt.reset();
+                    for (auto const &t : tokens)
+                      wpt.append_input(t.first, t.second);
+                    words = std::move(wpt._tokens);
+                    wpt._tokens = std::vector<std::string>();
+                  }
+                else
+                  {
+                    words.reserve(tokens.size());
+                    for (auto const &t : tokens)
+                      words.emplace_back(t.first, t.second);
+                  }
+
+                // bag of words row, vocabulary counts are kept by the
+                // parser until merged
+                size_t entry = ++parser._nentries;
+                std::vector<std::pair<uint32_t, double>> row;
+                for (const std::string &w : words)
                   {
                     if (static_cast<int>(w.length()) < _min_word_length)
                       continue;
-
-                    // check and fillup vocab.
-                    int pos = -1;
-                    if ((vhit = _vocab.find(w)) == _vocab.end())
+                    uint32_t id = parser.term_id(w);
+                    if (_train)
                       {
-                        if (_train)
-                          {
-                            pos = _vocab.size();
-                            _vocab.emplace(std::make_pair(w, Word(pos)));
-                          }
+                        if (parser._total_count[id] == 0)
+                          parser._touched.push_back(id);
+                        parser._total_count[id]++;
+                        parser._first_seen[id] = std::min(
+                            parser._first_seen[id], (doc_id << 32) | ntokens);
                       }
-                    else
+                    ++ntokens;
+                    if (parser._last_entry[id] != entry)
                       {
+                        parser._last_entry[id] = entry;
                         if (_train)
-                          {
-                            (*vhit).second._total_count++;
-                            if (!tbe->has_word(w))
-                              (*vhit).second._total_docs++;
-                          }
+                          parser._total_docs[id]++;
+                        parser._entry_val[id] = 1.0;
+                        row.emplace_back(id, 0.0);
                       }
-                    tbe->add_word(w, 1.0, _count);
+                    else if (_count)
+                      parser._entry_val[id] += 1.0;
                   }
-                if (test_id < 0)
-                  _txt.push_back(tbe);
-                else
-                  _tests_txt[static_cast<size_t>(test_id)].push_back(tbe);
+                for (auto &w : row)
+                  w.second = parser._entry_val[w.first];
+                doc._bows.push_back(std::move(row));
               }
           }
         else // character-level features
@@ -485,13 +683,95 @@ namespace dd
                   }
                 while (str_i < end && seq < _sequence);
               }
-            if (test_id < 0)
-              _txt.push_back(tce);
+            doc._entries.push_back(tce);
+          }
+      }
+    doc._new_terms.assign(parser._terms.begin() + nterms,
+                          parser._terms.end());
+  }
+
+  void TxtInputFileConn::add_document(TxtDoc &doc,
+                                      std::vector<uint32_t> &terms,
+                                      int test_id)
+  {
+    std::vector<TxtEntry<double> *> &entries
+        = test_id < 0 ? _txt : _tests_txt[static_cast<size_t>(test_id)];
+    for (const std::string &t : doc._new_terms)
+      terms.push_back(_bow_rows->term_id(t));
+    for (auto &row : doc._bows)
+      {
+        for (auto &w : row)
+          w.first = terms[w.first];
+        size_t r = _bow_rows->add_row(row);
+        entries.push_back(new TxtBowEntry(doc._target, _bow_rows, r));
+      }
+    entries.insert(entries.end(), doc._entries.begin(), doc._entries.end());
+    doc._entries.clear();
+    if (_characters)
+      std::cerr << "\rloaded text samples=" << _txt.size();
+  }
+
+  void TxtInputFileConn::merge_vocab(std::vector<TxtParser> &parsers)
+  {
+    // new words are positioned in order of first occurrence, as if
+    // documents had been parsed sequentially
+    struct NewWord
+    {
+      uint64_t _first_seen;
+      std::string _term;
+      int _total_count;
+      int _total_docs;
+    };
+    std::vector<NewWord> new_words;
+    std::unordered_map<std::string, size_t> new_words_ids;
+    for (TxtParser &parser : parsers)
+      {
+        for (uint32_t id : parser._touched)
+          {
+            const std::string &term = parser._terms[id];
+            auto vhit = _vocab.find(term);
+            if (vhit != _vocab.end())
+              {
+                (*vhit).second._total_count += parser._total_count[id];
+                (*vhit).second._total_docs += parser._total_docs[id];
+              }
             else
-              _tests_txt[static_cast<size_t>(test_id)].push_back(tce);
-            std::cerr << "\rloaded text samples=" << _txt.size();
+              {
+                auto nhit = new_words_ids.find(term);
+                if (nhit == new_words_ids.end())
+                  {
+                    new_words_ids.emplace(term, new_words.size());
+                    new_words.push_back({ parser._first_seen[id], term,
+                                          parser._total_count[id],
+                                          parser._total_docs[id] });
+                  }
+                else
+                  {
+                    NewWord &nw = new_words[(*nhit).second];
+                    nw._first_seen
+                        = std::min(nw._first_seen, parser._first_seen[id]);
+                    nw._total_count += parser._total_count[id];
+                    nw._total_docs += parser._total_docs[id];
+                  }
+              }
+            parser._total_count[id] = 0;
+            parser._total_docs[id] = 0;
+            parser._first_seen[id] = std::numeric_limits<uint64_t>::max();
           }
+        parser._touched.clear();
+      }
+    std::sort(new_words.begin(), new_words.end(),
+              [](const NewWord &a, const NewWord &b) {
+                return a._first_seen < b._first_seen;
+              });
+    for (const NewWord &nw : new_words)
+      {
+        int pos = _vocab.size();
+        _vocab.emplace(nw._term,
+                       Word(pos, nw._total_count, nw._total_docs));
       }
+    if (!new_words.empty())
+      ++_vocab_gen;
   }
 
   void TxtInputFileConn::serialize_vocab()
@@ -541,7 +821,10 @@ namespace dd
         int pos = std::atoi(tokens.at(1).c_str());
         _vocab.emplace(std::make_pair(key, Word(pos)));
       }
+    ++_vocab_gen;
     _logger->info("loaded vocabulary of size={}", _vocab.size());
+    if (_wordpiece_tokens)
+      _wordpiece_tokenizer.compile(); // shared by connector copies
   }
 
   void TxtInputFileConn::build_alphabet()
@@ -25,6 +25,7 @@
 #include "inputconnectorstrategy.h"
 #include <algorithm>
 #include <cmath>
+#include <memory>
 #include <random>
 #include "utf8.h"
 
@@ -107,61 +108,111 @@ namespace dd
     std::string _uri;
   };
 
-  class TxtBowEntry : public TxtEntry<double>
+  /**
+   * \brief bag of words rows of a corpus, stored contiguously: row r holds
+   * the words _words[_rows[r]] to _words[_rows[r + 1] - 1], as indices in
+   * _terms, with their values
+   */
+  class TxtBowRows
   {
   public:
-    TxtBowEntry() : TxtEntry<double>(){};
-    TxtBowEntry(const float &target) : TxtEntry<double>(target)
-    {
-    }
-    virtual ~TxtBowEntry()
+    TxtBowRows() : _rows(1, 0)
     {
     }
 
-    void add_word(const std::string &str, const double &v, const bool &count)
+    /**
+     * \brief index of term in _terms, added if needed
+     */
+    uint32_t term_id(const std::string &term);
+
+    /**
+     * \brief appends a row of (term id, value)
+     * @return row index
+     */
+    size_t add_row(const std::vector<std::pair<uint32_t, double>> &row);
+
+    /**
+     * \brief filters the words of the selected rows in place
+     * @param rows_mask rows to filter
+     * @param keep called as keep(term_id, value), returns false to remove
+     * the word, may update its value
+     */
+    template <typename TKeep>
+    void filter(const std::vector<bool> &rows_mask, TKeep keep)
     {
-      std::unordered_map<std::string, double>::iterator hit;
-      if ((hit = _v.find(str)) != _v.end())
+      size_t w = 0;
+      size_t begin = _rows[0];
+      for (size_t r = 0; r + 1 < _rows.size(); ++r)
         {
-          if (count)
-            (*hit).second += v;
+          size_t end = _rows[r + 1];
+          for (size_t i = begin; i < end; ++i)
+            {
+              double val = _vals[i];
+              if (r < rows_mask.size() && rows_mask[r]
+                  && !keep(_words[i], val))
+                continue;
+              _words[w] = _words[i];
+              _vals[w] = val;
+              ++w;
+            }
+          begin = end;
+          _rows[r + 1] = w;
         }
-      else
-        _v.insert(std::pair<std::string, double>(str, v));
+      _words.resize(w);
+      _vals.resize(w);
     }
 
-    bool has_word(const std::string &str)
+    std::vector<size_t> _rows;     /**< rows start, plus end of last row */
+    std::vector<uint32_t> _words;  /**< term ids */
+    std::vector<double> _vals;     /**< word values */
+    std::vector<std::string> _terms; /**< terms */
+    std::unordered_map<std::string, uint32_t> _term_ids; /**< term to id */
+  };
+
+  /**
+   * \brief bag of words entry, a row of a TxtBowRows corpus
+   */
+  class TxtBowEntry : public TxtEntry<double>
+  {
+  public:
+    TxtBowEntry(const float &target, const std::shared_ptr<TxtBowRows> &rows,
+                const size_t &row)
+        : TxtEntry<double>(target), _rows(rows), _row(row)
+    {
+      reset();
+    }
+    virtual ~TxtBowEntry()
     {
-      return _v.count(str);
     }
 
     void reset()
     {
-      _vit = _v.begin();
+      _pos = _rows->_rows[_row];
     }
 
     void get_next_elt(std::string &key, double &val)
     {
-      if (_vit != _v.end())
+      if (has_elt())
         {
-          key = (*_vit).first;
-          val = (*_vit).second;
-          ++_vit;
+          key = _rows->_terms[_rows->_words[_pos]];
+          val = _rows->_vals[_pos];
+          ++_pos;
         }
     }
 
     bool has_elt() const
     {
-      return _vit != _v.end();
+      return _pos < _rows->_rows[_row + 1];
     }
 
     size_t size() const
     {
-      return _v.size();
+      return _rows->_rows[_row + 1] - _rows->_rows[_row];
     }
 
-    std::unordered_map<std::string, double> _v; /**< words as (<pos,val>). */
-    std::unordered_map<std::string, double>::iterator _vit;
+    std::shared_ptr<TxtBowRows> _rows; /**< corpus rows */
+    size_t _row;                       /**< row index in corpus */
+    size_t _pos = 0;                   /**< current word */
   };
 
   class TxtCharEntry : public TxtEntry<double>
@@ -224,9 +275,12 @@ namespace dd
     {
     }
 
-    void add_word(const std::string &word)
+    /**
+     * \brief adds a word by its vocabulary position, -1 if not in vocabulary
+     */
+    void add_word(const int &id)
     {
-      _v.push_back(word);
+      _v.push_back(id);
     }
 
     void reset()
@@ -234,12 +288,11 @@ namespace dd
       _vit = _v.begin();
     }
 
-    void get_next_elt(std::string &key, double &val)
+    void get_next_elt(int &id)
     {
       if (_vit != _v.end())
         {
-          key = *_vit;
-          val = 1;
+          id = *_vit;
           ++_vit;
         }
     }
@@ -254,8 +307,46 @@ namespace dd
       return _v.size();
     }
 
-    std::vector<std::string> _v;
-    std::vector<std::string>::iterator _vit;
+    std::vector<int> _v; /**< words vocabulary positions, in order. */
+    std::vector<int>::iterator _vit;
+  };
+
+  /**
+   * \brief vocabulary compiled into a trie, for matching tokens against the
+   * vocabulary straight from the input text, without building strings.
+   * Children of a node are contiguous and sorted by byte.
+   */
+  class VocabTrie
+  {
+  public:
+    /**
+     * \brief builds the trie from the vocabulary entries starting with
+     * prefix, prefix removed
+     */
+    VocabTrie(const std::unordered_map<std::string, Word> &vocab,
+              const uint64_t &vocab_gen, const std::string &prefix);
+
+    /**
+     * \brief longest vocabulary entry that is a prefix of [s, s + len)
+     * @param id vocabulary position of the entry
+     * @return entry length, 0 if none
+     */
+    size_t longest_match(const char *s, const size_t &len, int &id) const;
+
+    uint64_t _vocab_gen = 0; /**< generation of the vocabulary it was built
+                                from. */
+    size_t _vocab_size = 0;  /**< size of the vocabulary it was built from. */
+    std::string _prefix;     /**< prefix of the vocabulary entries. */
+
+  private:
+    struct Node
+    {
+      uint32_t _children = 0; /**< index of first child */
+      uint32_t _nchildren = 0;
+      int _id = -1; /**< vocabulary position if an entry ends here */
+    };
+    std::vector<Node> _nodes;    /**< breadth-first, root first */
+    std::vector<uint8_t> _bytes; /**< byte leading to each node */
   };
 
   /** Tokenizer that uses greedy longest-match-first search to cut words
@@ -275,11 +366,46 @@ namespace dd
       _tokens.clear();
     }
 
-    void append_input(const std::string &word);
+    /**
+     * \brief cuts word in pieces, appended to _tokens
+     */
+    void append_input(const char *word, const size_t &len);
+
+    void append_input(const std::string &word)
+    {
+      append_input(word.data(), word.size());
+    }
+
+    /**
+     * \brief cuts word in pieces, appended to ids as vocabulary positions,
+     * -1 for an unknown word when the vocabulary has no unknown token
+     */
+    void append_ids(const char *word, const size_t &len,
+                    std::vector<int> &ids);
+
+    /**
+     * \brief compiles the vocabulary into tries, if not done yet or if the
+     * vocabulary or prefixes have changed
+     */
+    void compile();
 
   public:
     bool in_vocab(const std::string &tok);
 
+    /**
+     * \brief greedy longest match of word pieces, into _pieces
+     * @return false if some part of the word cannot be matched
+     */
+    bool match_pieces(const char *word, const size_t &len);
+
+    std::shared_ptr<const VocabTrie>
+        _word_trie; /**< vocabulary entries starting with _word_start */
+    std::shared_ptr<const VocabTrie>
+        _suffix_trie; /**< vocabulary entries starting with _suffix_start */
+    int _unk_id = -1; /**< vocabulary position of _unk_token */
+    std::vector<std::pair<int, size_t>>
+        _pieces; /**< (vocabulary position, length) of last matched pieces */
+
     std::string _suffix_start
         = "##"; /**< Suffix tokens in vocabulary are prefixed by this */
     std::string _word_start
@@ -288,10 +414,57 @@ namespace dd
     std::string _unk_token = "[UNK]";
   };
 
+  /**
+   * \brief tokenization state of a text ingestion worker. Terms are
+   * interned per worker, and vocabulary counts are kept per worker until
+   * merged into the connector vocabulary.
+   */
+  class TxtParser
+  {
+  public:
+    TxtParser(const WordPieceTokenizer &wpt) : _wordpiece_tokenizer(wpt)
+    {
+    }
+
+    /**
+     * \brief worker local id of term, added if needed
+     */
+    uint32_t term_id(const std::string &term);
+
+    WordPieceTokenizer _wordpiece_tokenizer;
+    std::unordered_map<std::string, uint32_t> _term_ids;
+    std::vector<std::string> _terms;
+    std::vector<int> _total_count; /**< term occurrences */
+    std::vector<int> _total_docs;  /**< number of entries holding term */
+    std::vector<uint64_t>
+        _first_seen; /**< (document << 32 | token) of first occurrence */
+    std::vector<size_t> _last_entry; /**< last entry holding term, from 1 */
+    std::vector<double> _entry_val;  /**< term value in current entry */
+    std::vector<uint32_t> _touched;  /**< terms counted since last merge */
+    size_t _nentries = 0;            /**< number of parsed bow entries */
+  };
+
+  /**
+   * \brief entries parsed from a document
+   */
+  class TxtDoc
+  {
+  public:
+    int _parser = 0; /**< index of the parser that parsed the document */
+    std::vector<TxtEntry<double> *>
+        _entries; /**< ordered words and characters entries */
+    std::vector<std::vector<std::pair<uint32_t, double>>>
+        _bows; /**< bag of words rows, with parser term ids */
+    std::vector<std::string>
+        _new_terms; /**< terms first seen by the parser in this document */
+    float _target = -1;
+  };
+
   class TxtInputFileConn : public InputConnectorStrategy
   {
   public:
-    TxtInputFileConn() : InputConnectorStrategy()
+    TxtInputFileConn()
+        : InputConnectorStrategy(), _bow_rows(std::make_shared<TxtBowRows>())
     {
       _wordpiece_tokenizer._ctfc = this;
     }
@@ -305,9 +478,11 @@ namespace dd
           _punctuation_tokens(i._punctuation_tokens),
           _alphabet_str(i._alphabet_str), _alphabet(i._alphabet),
           _sequence(i._sequence), _seq_forward(i._seq_forward),
-          _generate_vocab(i._generate_vocab), _vocab(i._vocab),
+          _read_workers(i._read_workers), _generate_vocab(i._generate_vocab),
+          _vocab(i._vocab), _vocab_gen(i._vocab_gen),
           _vocab_sep(i._vocab_sep),
-          _wordpiece_tokenizer(i._wordpiece_tokenizer), _ndbed(i._ndbed)
+          _wordpiece_tokenizer(i._wordpiece_tokenizer),
+          _bow_rows(std::make_shared<TxtBowRows>()), _ndbed(i._ndbed)
     {
       _wordpiece_tokenizer._ctfc = this;
     }
@@ -368,6 +543,8 @@ namespace dd
         _sequence = ad_input.get("sequence").get<int>();
       if (ad_input.has("read_forward"))
         _seq_forward = ad_input.get("read_forward").get<bool>();
+      if (ad_input.has("read_workers"))
+        _read_workers = ad_input.get("read_workers").get<int>();
 
       // timeout
       this->set_timeout(ad_input);
@@ -379,6 +556,26 @@ namespace dd
       return _vocab.size();
     }
 
+    /**
+     * \brief adds or replaces a vocabulary entry, and invalidates the
+     * tokenizer tries built from the previous vocabulary
+     */
+    void set_word(const std::string &term, const Word &word)
+    {
+      _vocab[term] = word;
+      ++_vocab_gen;
+    }
+
+    /**
+     * \brief removes a vocabulary entry, and invalidates the tokenizer tries
+     * built from the previous vocabulary
+     */
+    void erase_word(const std::string &term)
+    {
+      if (_vocab.erase(term) > 0)
+        ++_vocab_gen;
+    }
+
     int batch_size() const
     {
       return _txt.size();
@@ -406,10 +603,17 @@ namespace dd
       if (_alphabet.empty() && _characters)
         build_alphabet();
 
+      if (_txt.empty() && _tests_txt.empty())
+        _bow_rows = std::make_shared<TxtBowRows>();
+
       if (!_characters && (!_train || _ordered_words) && _vocab.empty())
         deserialize_vocab();
 
+      // remote uris are downloaded while previous ones are parsed
+      std::shared_ptr<httpfetcher> fetcher = this->prefetch_uris();
       DataEl<DDTxt> dtxt(this->_input_timeout);
+      if (fetcher)
+        dtxt.set_fetcher(fetcher, 0);
       dtxt._ctype._ctfc = this;
       if (dtxt.read_element(_uris[0], this->_logger, -1)
           || (_txt.empty() && _db_fname.empty() && _ndbed == 0))
@@ -429,6 +633,8 @@ namespace dd
       for (size_t i = 1; i < _uris.size(); ++i)
         {
           DataEl<DDTxt> dtxt(this->_input_timeout);
+          if (fetcher)
+            dtxt.set_fetcher(fetcher, i);
           dtxt._ctype._ctfc = this;
           _tests_txt.resize(i);
           if (dtxt.read_element(_uris[i], this->_logger, i - 1)
@@ -503,6 +709,30 @@ namespace dd
                                const float &target = -1, int test_id = -1);
     // test -1 for train, 0 ,1  ... for test_id
 
+    /**
+     * \brief tokenizes a document into entries, thread safe as long as
+     * every thread has its own parser. Vocabulary counts are accumulated in
+     * the parser until merge_vocab.
+     * @param doc_id document rank, orders first occurrences of new words
+     */
+    void parse_document(TxtParser &parser, const std::string &content,
+                        const float &target, const size_t &doc_id,
+                        TxtDoc &doc) const;
+
+    /**
+     * \brief adds document entries to the training or test set
+     * @param terms parser term ids to _bow_rows term ids, updated with the
+     * document new terms
+     */
+    virtual void add_document(TxtDoc &doc, std::vector<uint32_t> &terms,
+                              int test_id);
+
+    /**
+     * \brief merges parsers vocabulary counts into _vocab, new words are
+     * positioned in order of first occurrence
+     */
+    void merge_vocab(std::vector<TxtParser> &parsers);
+
     // serialization of vocabulary
     void serialize_vocab();
     void deserialize_vocab(const bool &required = true);
@@ -541,11 +771,16 @@ namespace dd
         = 60; /**< sequence size when using character-level features. */
     bool _seq_forward
         = false; /**< whether to read character-based sequences forward. */
+    int _read_workers
+        = 0; /**< number of threads parsing files, 0 means all cores. */
 
     // internals
     bool _generate_vocab = true;
     std::unordered_map<std::string, Word>
         _vocab; /**< string to word stats, including word */
+    uint64_t _vocab_gen
+        = 0; /**< incremented whenever _vocab entries or positions change,
+                use set_word() and erase_word() to edit _vocab */
     std::string _vocabfname = "vocab.dat";
     std::string _correspname = "corresp.txt";
     char _vocab_sep = ','; /**< vocabulary separator */
@@ -553,6 +788,7 @@ namespace dd
     WordPieceTokenizer _wordpiece_tokenizer;
 
     // data
+    std::shared_ptr<TxtBowRows> _bow_rows; /**< bag of words corpus */
     std::vector<TxtEntry<double> *> _txt;
     std::vector<std::vector<TxtEntry<double> *>> _tests_txt;
     std::string _db_fname;
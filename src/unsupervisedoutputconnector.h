@@ -23,6 +23,7 @@
 #define UNSUPERVISEDOUTPUTCONNECTOR_H
 
 #include "dto/predict_out.hpp"
+#include "utils/vals_encoding.hpp"
 
 namespace dd
 {
@@ -202,6 +203,11 @@ namespace dd
       _binarized = output_params->binarized;
       _bool_binarized = output_params->bool_binarized;
       _string_binarized = output_params->string_binarized;
+      if (output_params->vals_encoding
+          && !dd_utils::vals_encoding_from_string(
+              output_params->vals_encoding, _vals_encoding))
+        throw OutputConnectorBadParamException(
+            "unknown vals_encoding " + *output_params->vals_encoding);
 
       if (_binarized)
         {
@@ -290,12 +296,27 @@ namespace dd
           if (output_params->nprobe != nullptr)
             mlm->_se->_tse->_nprobe = output_params->nprobe;
 #endif
+          // queries are packed as float32 and searched at once
+          std::vector<float> queries;
+          queries.reserve(_vvres.size() * mlm->_se->_dim);
           for (size_t i = 0; i < _vvres.size(); i++)
             {
-              std::vector<URIData> nn_uris;
-              std::vector<double> nn_distances;
-              mlm->_se->search(_vvres.at(i)._vals, search_nn, nn_uris,
-                               nn_distances);
+              const std::vector<double> &vals = _vvres.at(i)._vals;
+              if (static_cast<int>(vals.size()) != mlm->_se->_dim)
+                throw OutputConnectorBadParamException(
+                    "search vector size " + std::to_string(vals.size())
+                    + " does not match index dimension "
+                    + std::to_string(mlm->_se->_dim));
+              queries.insert(queries.end(), vals.begin(), vals.end());
+            }
+          std::vector<std::vector<URIData>> batch_uris;
+          std::vector<std::vector<double>> batch_distances;
+          mlm->_se->search(queries.data(), _vvres.size(), search_nn,
+                           batch_uris, batch_distances);
+          for (size_t i = 0; i < _vvres.size(); i++)
+            {
+              const std::vector<URIData> &nn_uris = batch_uris.at(i);
+              const std::vector<double> &nn_distances = batch_distances.at(i);
               for (size_t j = 0; j < nn_uris.size(); j++)
                 {
                   _vvres.at(i).add_nn(nn_distances.at(j), nn_uris.at(j)._uri);
@@ -327,6 +348,18 @@ namespace dd
                 = DTO::DTOVector<bool>(std::move(_vvres.at(i)._bvals));
           else if (_string_binarized)
             pred_dto->vals = oatpp::String(_vvres.at(i)._str.c_str());
+          else if (_vals_encoding != dd_utils::ValsEncoding::JSON)
+            {
+              std::string encoded;
+              float scale = 0.0;
+              dd_utils::encode_vals(_vvres.at(i)._vals, _vals_encoding,
+                                    encoded, scale);
+              pred_dto->vals = oatpp::String(std::move(encoded));
+              pred_dto->vals_encoding
+                  = dd_utils::vals_encoding_to_string(_vals_encoding);
+              if (_vals_encoding == dd_utils::ValsEncoding::INT8)
+                pred_dto->vals_scale = scale;
+            }
           else
             pred_dto->vals
                 = DTO::DTOVector<double>(std::move(_vvres.at(i)._vals));
@@ -368,6 +401,8 @@ namespace dd
         = false; /**< boolean binary representation of output values. */
     bool _string_binarized = false; /**< boolean string as binary
                                        representation of output values. */
+    dd_utils::ValsEncoding _vals_encoding
+        = dd_utils::ValsEncoding::JSON; /**< compact encoding of values. */
 #ifdef USE_SIMSEARCH
     int _search_nn = 10; /**< default nearest neighbors per search. */
 #endif
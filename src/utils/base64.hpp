@@ -0,0 +1,145 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DD_UTILS_BASE64_HPP
+#define DD_UTILS_BASE64_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace dd
+{
+  namespace dd_utils
+  {
+    namespace detail
+    {
+      /**
+       * \brief base64 character values, 0x80 for characters outside of the
+       * alphabet
+       */
+      struct Base64Table
+      {
+        uint8_t values[256];
+        Base64Table()
+        {
+          const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                  "abcdefghijklmnopqrstuvwxyz0123456789+/";
+          for (int c = 0; c < 256; ++c)
+            values[c] = 0x80;
+          for (int v = 0; v < 64; ++v)
+            values[static_cast<uint8_t>(alphabet[v])] = v;
+        }
+      };
+
+      inline const uint8_t *base64_values()
+      {
+        static const Base64Table table;
+        return table.values;
+      }
+    }
+
+    /**
+     * \brief encodes len bytes of data as padded base64, appended to out
+     */
+    inline void base64_encode(const void *data, const size_t &len,
+                              std::string &out)
+    {
+      static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                     "abcdefghijklmnopqrstuvwxyz0123456789+/";
+      const uint8_t *src = static_cast<const uint8_t *>(data);
+      size_t pos = out.size();
+      out.resize(pos + (len + 2) / 3 * 4);
+      char *dst = &out[pos];
+
+      size_t nblocks = len / 3;
+      for (size_t b = 0; b < nblocks; ++b, src += 3, dst += 4)
+        {
+          uint32_t triple = (src[0] << 16) | (src[1] << 8) | src[2];
+          dst[0] = alphabet[triple >> 18];
+          dst[1] = alphabet[(triple >> 12) & 0x3f];
+          dst[2] = alphabet[(triple >> 6) & 0x3f];
+          dst[3] = alphabet[triple & 0x3f];
+        }
+
+      size_t rem = len % 3;
+      if (rem)
+        {
+          uint32_t triple = (src[0] << 16) | (rem == 2 ? src[1] << 8 : 0);
+          dst[0] = alphabet[triple >> 18];
+          dst[1] = alphabet[(triple >> 12) & 0x3f];
+          dst[2] = rem == 2 ? alphabet[(triple >> 6) & 0x3f] : '=';
+          dst[3] = '=';
+        }
+    }
+
+    /**
+     * \brief decodes base64 data into out, resized to the decoded size.
+     * Validates while decoding, so that it can be tried on data that is
+     * possibly not base64.
+     * @return false if in is not padded base64, out content is then
+     * unspecified
+     */
+    inline bool base64_decode(const char *in, const size_t &len,
+                              std::vector<unsigned char> &out)
+    {
+      if (len == 0 || len % 4 != 0)
+        return false;
+      size_t pad = 0;
+      if (in[len - 1] == '=')
+        pad = in[len - 2] == '=' ? 2 : 1;
+      out.resize(len / 4 * 3 - pad);
+
+      const uint8_t *values = detail::base64_values();
+      const uint8_t *src = reinterpret_cast<const uint8_t *>(in);
+      unsigned char *dst = out.data();
+
+      // full blocks, validity is checked once per block
+      size_t nblocks = len / 4 - (pad ? 1 : 0);
+      for (size_t b = 0; b < nblocks; ++b, src += 4, dst += 3)
+        {
+          uint8_t v0 = values[src[0]], v1 = values[src[1]],
+                  v2 = values[src[2]], v3 = values[src[3]];
+          if ((v0 | v1 | v2 | v3) & 0x80)
+            return false;
+          uint32_t triple = (v0 << 18) | (v1 << 12) | (v2 << 6) | v3;
+          dst[0] = triple >> 16;
+          dst[1] = triple >> 8;
+          dst[2] = triple;
+        }
+
+      // padded last block
+      if (pad)
+        {
+          uint8_t v0 = values[src[0]], v1 = values[src[1]];
+          uint8_t v2 = pad == 1 ? values[src[2]] : 0;
+          if ((v0 | v1 | v2) & 0x80)
+            return false;
+          uint32_t triple = (v0 << 18) | (v1 << 12) | (v2 << 6);
+          dst[0] = triple >> 16;
+          if (pad == 1)
+            dst[1] = triple >> 8;
+        }
+      return true;
+    }
+  }
+}
+
+#endif
@@ -22,6 +22,7 @@
 #ifndef DD_UTILS_BBOX_HPP
 #define DD_UTILS_BBOX_HPP
 
+#include <algorithm>
 #include <vector>
 
 namespace dd
@@ -62,57 +63,103 @@ namespace dd
       return ainter / (a1 + a2 - ainter);
     }
 
-    /** bboxes: list of bboxes in the format { xmin, ymin, xmax, ymax } sorted
-     * by decreasing confidence
+    /** boxes: n bboxes in the format { xmin, ymin, xmax, ymax }, stored
+     * contiguously, sorted by decreasing confidence
      *
      * picked: vector used as output containing indices of bboxes kept by nms.
+     * max_picked: stop after this number of bboxes is kept, 0 for no limit.
+     *
+     * Each kept bbox suppresses the following ones in a single pass over
+     * coordinates stored per component, which the compiler vectorizes.
      */
     template <typename T>
-    inline void nms_sorted_bboxes(const std::vector<std::vector<T>> &bboxes,
-                                  std::vector<size_t> &picked, T nms_threshold)
+    inline void nms_sorted_boxes(const T *boxes, const size_t &n,
+                                 std::vector<size_t> &picked, T nms_threshold,
+                                 const size_t &max_picked = 0)
     {
       picked.clear();
-      const size_t n = bboxes.size();
+      std::vector<T> x1(n), y1(n), x2(n), y2(n), areas(n);
+      for (size_t i = 0; i < n; ++i)
+        {
+          x1[i] = boxes[4 * i];
+          y1[i] = boxes[4 * i + 1];
+          x2[i] = boxes[4 * i + 2];
+          y2[i] = boxes[4 * i + 3];
+          areas[i] = (x2[i] - x1[i]) * (y2[i] - y1[i]);
+        }
+      // same width as coordinates, for vectorization
+      std::vector<T> suppressed(n, T(0));
 
       for (size_t i = 0; i < n; i++)
         {
-          const std::vector<T> &bbox_a = bboxes[i];
-
-          bool keep = true;
-          for (size_t j = 0; j < picked.size(); j++)
-            {
-              const std::vector<T> &bbox_b = bboxes[picked[j]];
-
-              // intersection over union
-              auto iou = bbox_utils::iou(bbox_a, bbox_b);
-              if (iou > nms_threshold)
-                keep = false;
-            }
+          if (suppressed[i] != T(0))
+            continue;
+          picked.push_back(i);
+          if (max_picked > 0 && picked.size() >= max_picked)
+            break;
 
-          if (keep)
-            picked.push_back(i);
+          const T ax1 = x1[i], ay1 = y1[i], ax2 = x2[i], ay2 = y2[i];
+          const T aarea = areas[i];
+          auto suppress = [&](const size_t &j) {
+            // min/max on values, branchless
+            const T bx1 = x1[j], by1 = y1[j], bx2 = x2[j], by2 = y2[j];
+            T w = (ax2 < bx2 ? ax2 : bx2) - (ax1 > bx1 ? ax1 : bx1);
+            T h = (ay2 < by2 ? ay2 : by2) - (ay1 > by1 ? ay1 : by1);
+            w = w > T(0) ? w : T(0);
+            h = h > T(0) ? h : T(0);
+            T inter = w * h;
+            // intersection over union
+            T overlap = inter / (aarea + areas[j] - inter);
+            suppressed[j] = overlap > nms_threshold ? T(1) : suppressed[j];
+          };
+          // fixed size blocks are vectorized at -O2
+          const size_t block = 8;
+          size_t j = i + 1;
+          for (; j + block <= n; j += block)
+            for (size_t k = 0; k < block; ++k)
+              suppress(j + k);
+          for (; j < n; ++j)
+            suppress(j);
         }
     }
 
+    /** bboxes: list of bboxes in the format { xmin, ymin, xmax, ymax } sorted
+     * by decreasing confidence
+     *
+     * picked: vector used as output containing indices of bboxes kept by nms.
+     */
+    template <typename T>
+    inline void nms_sorted_bboxes(const std::vector<std::vector<T>> &bboxes,
+                                  std::vector<size_t> &picked, T nms_threshold)
+    {
+      std::vector<T> boxes;
+      boxes.reserve(4 * bboxes.size());
+      for (const std::vector<T> &bbox : bboxes)
+        boxes.insert(boxes.end(), bbox.begin(), bbox.begin() + 4);
+      nms_sorted_boxes(boxes.data(), bboxes.size(), picked, nms_threshold);
+    }
+
     inline void nms_sorted_bboxes(std::vector<APIData> &bboxes,
                                   std::vector<double> &probs,
                                   std::vector<std::string> &cats,
                                   double nms_threshold, int best_bbox)
     {
-      std::vector<std::vector<double>> sorted_boxes;
+      std::vector<double> boxes;
       std::vector<size_t> picked;
 
+      boxes.reserve(4 * bboxes.size());
       for (size_t l = 0; l < bboxes.size(); ++l)
         {
-          std::vector<double> bbox_vec{ bboxes[l].get("xmin").get<double>(),
-                                        bboxes[l].get("ymin").get<double>(),
-                                        bboxes[l].get("xmax").get<double>(),
-                                        bboxes[l].get("ymax").get<double>() };
-          sorted_boxes.push_back(bbox_vec);
+          boxes.push_back(bboxes[l].get("xmin").get<double>());
+          boxes.push_back(bboxes[l].get("ymin").get<double>());
+          boxes.push_back(bboxes[l].get("xmax").get<double>());
+          boxes.push_back(bboxes[l].get("ymax").get<double>());
         }
       // We assume that bboxes are already sorted in model output
 
-      bbox_utils::nms_sorted_bboxes(sorted_boxes, picked, nms_threshold);
+      bbox_utils::nms_sorted_boxes(boxes.data(), bboxes.size(), picked,
+                                   nms_threshold,
+                                   best_bbox > 0 ? best_bbox : 0);
       std::vector<APIData> nbboxes;
       std::vector<double> nprobs;
       std::vector<std::string> ncats;
@@ -122,10 +169,6 @@ namespace dd
           nbboxes.push_back(bboxes.at(pick));
           nprobs.push_back(probs.at(pick));
           ncats.push_back(cats.at(pick));
-
-          if (best_bbox > 0
-              && nbboxes.size() >= static_cast<size_t>(best_bbox))
-            break;
         }
 
       bboxes = nbboxes;
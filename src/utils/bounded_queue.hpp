@@ -0,0 +1,145 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DD_BOUNDED_QUEUE_H
+#define DD_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace dd
+{
+  namespace dd_utils
+  {
+    /**
+     * \brief lock-free bounded queue, for any number of producers and
+     * consumers. Push fails instead of waiting when the queue is full, so
+     * that producers never block. Slots are allocated once, capacity is
+     * rounded up to a power of two.
+     */
+    template <typename T> class BoundedQueue
+    {
+    public:
+      BoundedQueue(size_t capacity)
+      {
+        size_t size = 2;
+        while (size < capacity)
+          size <<= 1;
+        _mask = size - 1;
+        _cells = std::vector<Cell>(size);
+        for (size_t i = 0; i < size; ++i)
+          _cells[i]._seq.store(i, std::memory_order_relaxed);
+      }
+
+      size_t capacity() const
+      {
+        return _mask + 1;
+      }
+
+      /**
+       * \brief appends value, returns false if the queue is full
+       */
+      bool try_push(const T &value)
+      {
+        Cell *cell;
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        while (true)
+          {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->_seq.load(std::memory_order_acquire);
+            ptrdiff_t diff = static_cast<ptrdiff_t>(seq)
+                             - static_cast<ptrdiff_t>(pos);
+            if (diff == 0)
+              {
+                if (_tail.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed))
+                  break;
+              }
+            else if (diff < 0)
+              return false;
+            else
+              pos = _tail.load(std::memory_order_relaxed);
+          }
+        cell->_value = value;
+        cell->_seq.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+
+      /**
+       * \brief removes the oldest value, returns false if the queue is
+       * empty
+       */
+      bool try_pop(T &value)
+      {
+        Cell *cell;
+        size_t pos = _head.load(std::memory_order_relaxed);
+        while (true)
+          {
+            cell = &_cells[pos & _mask];
+            size_t seq = cell->_seq.load(std::memory_order_acquire);
+            ptrdiff_t diff = static_cast<ptrdiff_t>(seq)
+                             - static_cast<ptrdiff_t>(pos + 1);
+            if (diff == 0)
+              {
+                if (_head.compare_exchange_weak(pos, pos + 1,
+                                                std::memory_order_relaxed))
+                  break;
+              }
+            else if (diff < 0)
+              return false;
+            else
+              pos = _head.load(std::memory_order_relaxed);
+          }
+        value = std::move(cell->_value);
+        cell->_seq.store(pos + _mask + 1, std::memory_order_release);
+        return true;
+      }
+
+    private:
+      struct Cell
+      {
+        Cell()
+        {
+        }
+        Cell(Cell &&c) : _value(std::move(c._value))
+        {
+          _seq.store(c._seq.load());
+        }
+        Cell &operator=(Cell &&c)
+        {
+          _value = std::move(c._value);
+          _seq.store(c._seq.load());
+          return *this;
+        }
+        std::atomic<size_t> _seq;
+        T _value;
+      };
+
+      std::vector<Cell> _cells;
+      size_t _mask = 0;
+      // producers and consumers on separate cache lines
+      alignas(64) std::atomic<size_t> _tail{ 0 };
+      alignas(64) std::atomic<size_t> _head{ 0 };
+    };
+  }
+}
+
+#endif
@@ -22,6 +22,8 @@
 #ifndef DD_UTILS_CVUTILS_HPP
 #define DD_UTILS_CVUTILS_HPP
 
+#include <cstddef>
+#include <cstring>
 #include <vector>
 
 namespace dd
@@ -29,7 +31,7 @@ namespace dd
   namespace cv_utils
   {
     /** Convert an int fourcc (from a video) to string format */
-    std::string fourcc_to_string(int fourcc)
+    inline std::string fourcc_to_string(int fourcc)
     {
       union
       {
@@ -44,6 +46,102 @@ namespace dd
           (i32_c.c[2] >= ' ' && i32_c.c[2] < 128) ? i32_c.c[2] : '?',
           (i32_c.c[3] >= ' ' && i32_c.c[3] < 128) ? i32_c.c[3] : '?');
     }
+
+    /** Read the orientation tag (1 to 8) from an EXIF APP1 payload.
+     * Returns 1 if the payload has no valid orientation */
+    inline int exif_orientation(const unsigned char *data, size_t len)
+    {
+      static const unsigned char exif_header[] = { 'E', 'x', 'i', 'f', 0, 0 };
+      if (len < 14 || memcmp(data, exif_header, 6) != 0)
+        return 1;
+      // TIFF header, little or big endian
+      const unsigned char *tiff = data + 6;
+      size_t tlen = len - 6;
+      bool le = tiff[0] == 'I' && tiff[1] == 'I';
+      if (!le && !(tiff[0] == 'M' && tiff[1] == 'M'))
+        return 1;
+      auto u16 = [&](size_t off) {
+        return le ? tiff[off] | (tiff[off + 1] << 8)
+                  : (tiff[off] << 8) | tiff[off + 1];
+      };
+      auto u32 = [&](size_t off) {
+        return le ? static_cast<size_t>(u16(off))
+                        | (static_cast<size_t>(u16(off + 2)) << 16)
+                  : (static_cast<size_t>(u16(off)) << 16)
+                        | static_cast<size_t>(u16(off + 2));
+      };
+      if (u16(2) != 42)
+        return 1;
+      size_t ifd = u32(4);
+      if (ifd > tlen || tlen - ifd < 2)
+        return 1;
+      size_t nentries = u16(ifd);
+      for (size_t e = 0; e < nentries; ++e)
+        {
+          size_t entry = ifd + 2 + 12 * e;
+          if (entry > tlen || tlen - entry < 12)
+            return 1;
+          if (u16(entry) == 0x0112) // orientation, a SHORT
+            {
+              int orientation = u16(entry + 8);
+              return orientation >= 1 && orientation <= 8 ? orientation : 1;
+            }
+        }
+      return 1;
+    }
+
+    /** Read width, height and EXIF orientation (1 to 8, 1 if absent) from a
+     * JPEG header, without decoding. Width and height are the stored ones,
+     * orientations 5 to 8 swap them once decoded.
+     * Returns false if data is not a JPEG or the header is truncated */
+    inline bool jpeg_size(const unsigned char *data, size_t len, int &width,
+                          int &height, int &orientation)
+    {
+      orientation = 1;
+      if (len < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+      size_t pos = 2;
+      while (pos + 4 <= len)
+        {
+          if (data[pos] != 0xFF)
+            return false;
+          unsigned char marker = data[pos + 1];
+          if (marker == 0xFF) // fill byte
+            {
+              ++pos;
+              continue;
+            }
+          if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD9))
+            {
+              pos += 2; // no payload
+              continue;
+            }
+          size_t seglen = (data[pos + 2] << 8) | data[pos + 3];
+          // start of frame, except DHT, JPG and DAC markers
+          if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4
+              && marker != 0xC8 && marker != 0xCC)
+            {
+              if (pos + 9 > len)
+                return false;
+              height = (data[pos + 5] << 8) | data[pos + 6];
+              width = (data[pos + 7] << 8) | data[pos + 8];
+              return width > 0 && height > 0;
+            }
+          if (marker == 0xE1 && seglen >= 2 && pos + 2 + seglen <= len)
+            orientation = exif_orientation(data + pos + 4, seglen - 2);
+          pos += 2 + seglen;
+        }
+      return false;
+    }
+
+    /** Read width and height from a JPEG header, without decoding.
+     * Returns false if data is not a JPEG or the header is truncated */
+    inline bool jpeg_size(const unsigned char *data, size_t len, int &width,
+                          int &height)
+    {
+      int orientation = 1;
+      return jpeg_size(data, len, width, height, orientation);
+    }
   }
 }
 
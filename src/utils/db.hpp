@@ -10,6 +10,7 @@ private:                                                                      \
 #endif
 
 #include <string>
+#include <vector>
 #include "backends/torch/llogging.h"
 
 namespace dd
@@ -72,6 +73,11 @@ namespace dd
       virtual Transaction *NewTransaction() = 0;
       virtual int Count() = 0;
       virtual void Get(const std::string &key, std::string &data_val) = 0;
+      // multiple keys read within a single transaction, missing keys yield
+      // empty values
+      virtual void Get(const std::vector<std::string> &keys,
+                       std::vector<std::string> &data_vals)
+          = 0;
       virtual void Remove(const std::string &key) = 0;
 
       DISABLE_COPY_AND_ASSIGN(DB);
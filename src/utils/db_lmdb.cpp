@@ -96,6 +96,30 @@ namespace dd
       mdb_dbi_close(mdb_env_, mdb_dbi);
     }
 
+    void LMDB::Get(const std::vector<std::string> &keys,
+                   std::vector<std::string> &data_vals)
+    {
+      data_vals.clear();
+      data_vals.reserve(keys.size());
+      MDB_txn *mdb_txn;
+      MDB_CHECK(mdb_txn_begin(mdb_env_, NULL, MDB_RDONLY, &mdb_txn));
+      MDB_dbi mdb_dbi;
+      MDB_CHECK(mdb_dbi_open(mdb_txn, NULL, 0, &mdb_dbi));
+      for (const std::string &key : keys)
+        {
+          MDB_val mdb_key, data;
+          mdb_key.mv_size = key.size();
+          mdb_key.mv_data = const_cast<char *>(key.data());
+          if (mdb_get(mdb_txn, mdb_dbi, &mdb_key, &data) == MDB_SUCCESS)
+            data_vals.emplace_back(static_cast<const char *>(data.mv_data),
+                                   data.mv_size);
+          else
+            data_vals.emplace_back();
+        }
+      mdb_txn_abort(mdb_txn);
+      mdb_dbi_close(mdb_env_, mdb_dbi);
+    }
+
     void LMDB::Remove(const std::string &key)
     {
       MDB_txn *mdb_txn;
@@ -118,6 +118,8 @@ namespace dd
       virtual LMDBTransaction *NewTransaction();
       virtual int Count();
       virtual void Get(const std::string &keym, std::string &data_val);
+      virtual void Get(const std::vector<std::string> &keys,
+                       std::vector<std::string> &data_vals);
       virtual void Remove(const std::string &key);
 
     private:
@@ -23,6 +23,12 @@
 #include <curlpp/Easy.hpp>
 #include <curlpp/Options.hpp>
 #include <curlpp/Infos.hpp>
+#include <curl/curl.h>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #ifndef DD_HTTPCLIENT_H
 #define DD_HTTPCLIENT_H
@@ -87,6 +93,269 @@ namespace dd
     }
   };
 
+  /**
+   * \brief fetches a list of URLs in the background, with a bounded number
+   * of concurrent transfers sharing a pool of connections. Results are
+   * collected in URLs order with get, so that decoding of already
+   * fetched data overlaps with the remaining downloads. Transfers are only
+   * started while fewer than twice max_fetches contents are fetched or in
+   * flight and not yet collected, so that memory stays bounded when
+   * decoding is slower than downloads.
+   */
+  class httpfetcher
+  {
+  public:
+    /**
+     * \brief starts fetching the remote URLs among urls
+     * @param timeout per URL timeout in seconds
+     * @param max_fetches max number of concurrent transfers
+     * @param max_size max size of a fetched content in bytes, 0 for none
+     */
+    httpfetcher(const std::vector<std::string> &urls, const int &timeout,
+                const int &max_fetches, const size_t &max_size)
+        : _timeout(timeout),
+          _max_fetches(
+              std::min(std::max(1, max_fetches), max_fetches_limit())),
+          _max_pending(2 * _max_fetches), _max_size(max_size),
+          _slots(urls.size())
+    {
+      // local URIs and inline data are not kept
+      _urls.reserve(urls.size());
+      for (const std::string &u : urls)
+        _urls.push_back(is_remote(u) ? u : std::string());
+      _worker = std::thread([this]() { run(); });
+    }
+
+    ~httpfetcher()
+    {
+      {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _abort = true;
+        _cv.notify_all();
+      }
+      _worker.join();
+    }
+
+    static bool is_remote(const std::string &uri)
+    {
+      return uri.rfind("https://", 0) == 0 || uri.rfind("http://", 0) == 0
+             || uri.rfind("file://", 0) == 0;
+    }
+
+    /**
+     * \brief waits for URL i, throws on transfer error, e.g. a timeout
+     * above the max, so that only this element fails
+     */
+    void get(const size_t &i, int &outcode, std::string &outstr)
+    {
+      Slot &slot = _slots.at(i);
+      std::unique_lock<std::mutex> lock(_mutex);
+      _cv.wait(lock, [&slot]() { return slot.done; });
+      if (slot.started && !slot.collected)
+        {
+          slot.collected = true;
+          --_pending;
+          _cv.notify_all();
+        }
+      if (!slot.error.empty())
+        {
+          outcode = 400;
+          throw std::runtime_error(_urls.at(i) + ": " + slot.error);
+        }
+      outcode = slot.code;
+      outstr = std::move(slot.content);
+    }
+
+    /**
+     * \brief number of transfers started and not yet collected
+     */
+    size_t pending()
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      return _pending;
+    }
+
+    /**
+     * \brief max number of concurrent transfers, whatever max_fetches
+     */
+    static int max_fetches_limit()
+    {
+      return 256;
+    }
+
+  private:
+    struct Slot
+    {
+      std::string content;
+      std::string error;
+      int code = -1;
+      bool done = false;
+      bool started = false;   /**< counted as pending */
+      bool collected = false; /**< returned by get */
+      size_t max_size = 0;
+    };
+
+    static size_t write_cb(char *data, size_t size, size_t nmemb, void *ud)
+    {
+      Slot *slot = static_cast<Slot *>(ud);
+      size_t len = size * nmemb;
+      if (slot->max_size > 0 && slot->content.size() + len > slot->max_size)
+        return 0; // aborts transfer
+      slot->content.append(data, len);
+      return len;
+    }
+
+    void finish(const size_t &i, const std::string &error, const long &code)
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      Slot &slot = _slots[i];
+      slot.error = error;
+      slot.code = static_cast<int>(code);
+      slot.done = true;
+      _cv.notify_all();
+    }
+
+    void run()
+    {
+      CURLM *multi = curl_multi_init();
+      curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                        static_cast<long>(_max_fetches));
+      curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS,
+                        static_cast<long>(_max_fetches));
+      std::vector<CURL *> handles;
+      std::vector<CURL *> idle;
+      size_t next = 0;
+      int active = 0;
+      std::string timeout_error;
+      if (_timeout > _max_timeout)
+        timeout_error = "timeout value is above max default timeout ("
+                        + std::to_string(_max_timeout) + ")";
+
+      while (true)
+        {
+          {
+            // waits for contents to be collected when too many are pending
+            std::unique_lock<std::mutex> lock(_mutex);
+            if (active == 0)
+              _cv.wait(lock, [this]() {
+                return _abort || _pending < _max_pending;
+              });
+            if (_abort)
+              break;
+          }
+          while (active < _max_fetches && next < _urls.size())
+            {
+              {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_pending >= _max_pending)
+                  break;
+              }
+              size_t i = next++;
+              if (_urls[i].empty())
+                continue;
+              {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _slots[i].started = true;
+                ++_pending;
+              }
+              if (!timeout_error.empty())
+                {
+                  finish(i, timeout_error, 400);
+                  continue;
+                }
+              CURL *h;
+              if (idle.empty())
+                {
+                  h = curl_easy_init();
+                  handles.push_back(h);
+                }
+              else
+                {
+                  h = idle.back();
+                  idle.pop_back();
+                  curl_easy_reset(h);
+                }
+              _slots[i].max_size = _max_size;
+              curl_easy_setopt(h, CURLOPT_URL, _urls[i].c_str());
+              curl_easy_setopt(h, CURLOPT_FOLLOWLOCATION, 1L);
+              curl_easy_setopt(h, CURLOPT_NOSIGNAL, 1L);
+              curl_easy_setopt(h, CURLOPT_TIMEOUT,
+                               static_cast<long>(_timeout));
+              if (_max_size > 0)
+                curl_easy_setopt(h, CURLOPT_MAXFILESIZE_LARGE,
+                                 static_cast<curl_off_t>(_max_size));
+              curl_easy_setopt(h, CURLOPT_WRITEFUNCTION, write_cb);
+              curl_easy_setopt(h, CURLOPT_WRITEDATA, &_slots[i]);
+              curl_easy_setopt(h, CURLOPT_PRIVATE, &_slots[i]);
+              curl_multi_add_handle(multi, h);
+              ++active;
+            }
+          if (active == 0 && next >= _urls.size())
+            break;
+          if (active == 0)
+            continue;
+
+          int running = 0;
+          curl_multi_perform(multi, &running);
+          CURLMsg *msg;
+          int queued = 0;
+          while ((msg = curl_multi_info_read(multi, &queued)))
+            {
+              if (msg->msg != CURLMSG_DONE)
+                continue;
+              CURL *h = msg->easy_handle;
+              Slot *slot = nullptr;
+              curl_easy_getinfo(h, CURLINFO_PRIVATE, &slot);
+              long code = -1;
+              curl_easy_getinfo(h, CURLINFO_RESPONSE_CODE, &code);
+              std::string error;
+              if (msg->data.result == CURLE_WRITE_ERROR
+                  || msg->data.result == CURLE_FILESIZE_EXCEEDED)
+                error = "content is larger than max_fetch_size";
+              else if (msg->data.result != CURLE_OK)
+                error = curl_easy_strerror(msg->data.result);
+              else if (code == 0)
+                code = 200; // file:// transfers have no response code
+              curl_multi_remove_handle(multi, h);
+              idle.push_back(h);
+              --active;
+              finish(slot - _slots.data(), error, code);
+            }
+          if (running > 0)
+            curl_multi_wait(multi, nullptr, 0, 100, nullptr);
+        }
+
+      for (CURL *h : handles)
+        {
+          curl_multi_remove_handle(multi, h);
+          curl_easy_cleanup(h);
+        }
+      curl_multi_cleanup(multi);
+
+      // unblock readers of URLs that were not fetched
+      std::lock_guard<std::mutex> lock(_mutex);
+      for (Slot &slot : _slots)
+        if (!slot.done)
+          {
+            slot.error = "fetch aborted";
+            slot.done = true;
+          }
+      _cv.notify_all();
+    }
+
+    std::vector<std::string> _urls;
+    int _timeout;
+    int _max_fetches;
+    size_t _max_pending; /**< max transfers started and not collected */
+    size_t _pending = 0;
+    size_t _max_size;
+    std::vector<Slot> _slots;
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    bool _abort = false;
+    std::thread _worker;
+  };
+
 }
 
 #endif
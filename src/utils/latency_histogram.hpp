@@ -0,0 +1,164 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DD_LATENCY_HISTOGRAM_H
+#define DD_LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace dd
+{
+  namespace dd_utils
+  {
+    /**
+     * \brief histogram of latencies, with log-linear buckets: values below
+     * 128 have their own bucket, and every power of two above is split
+     * into 64 buckets, for a relative error below 1.6% whatever the
+     * magnitude. Units are up to the caller, e.g. microseconds.
+     */
+    class LatencyHistogram
+    {
+    public:
+      LatencyHistogram() : _counts(bucket_index(max_value()) + 1, 0)
+      {
+      }
+
+      void record(const uint64_t &value)
+      {
+        ++_counts[bucket_index(value)];
+        ++_count;
+        _sum += value;
+        _min = std::min(_min, value);
+        _max = std::max(_max, value);
+      }
+
+      void merge(const LatencyHistogram &h)
+      {
+        for (size_t b = 0; b < _counts.size(); ++b)
+          _counts[b] += h._counts[b];
+        _count += h._count;
+        _sum += h._sum;
+        _min = std::min(_min, h._min);
+        _max = std::max(_max, h._max);
+      }
+
+      uint64_t count() const
+      {
+        return _count;
+      }
+
+      uint64_t min() const
+      {
+        return _count ? _min : 0;
+      }
+
+      uint64_t max() const
+      {
+        return _max;
+      }
+
+      double mean() const
+      {
+        return _count ? static_cast<double>(_sum) / _count : 0.0;
+      }
+
+      /**
+       * \brief smallest value v such that at least p percent of the
+       * recorded values are in v's bucket or below, reported as the bucket
+       * upper bound
+       * @param p percentile in [0,100]
+       */
+      uint64_t percentile(const double &p) const
+      {
+        if (_count == 0)
+          return 0;
+        uint64_t rank = std::max<uint64_t>(
+            1, static_cast<uint64_t>(p / 100.0 * _count + 0.5));
+        rank = std::min(rank, _count);
+        uint64_t cumul = 0;
+        for (size_t b = 0; b < _counts.size(); ++b)
+          {
+            cumul += _counts[b];
+            if (cumul >= rank)
+              return std::max(_min, std::min(bucket_upper(b), _max));
+          }
+        return _max;
+      }
+
+      /**
+       * \brief calls f(lower, upper, count) for every non empty bucket, in
+       * increasing order, values in the bucket being in [lower, upper]
+       */
+      template <typename TFunc> void for_each_bucket(TFunc f) const
+      {
+        for (size_t b = 0; b < _counts.size(); ++b)
+          if (_counts[b] > 0)
+            f(bucket_lower(b), bucket_upper(b), _counts[b]);
+      }
+
+      static size_t bucket_index(const uint64_t &value)
+      {
+        if (value < _linear)
+          return value;
+        int msb = 63 - __builtin_clzll(value);
+        uint64_t sub = value >> (msb - _sub_bits); // in [64, 128)
+        return _linear + (msb - _sub_bits - 1) * (_linear / 2)
+               + (sub - _linear / 2);
+      }
+
+      static uint64_t bucket_lower(const size_t &b)
+      {
+        if (b < _linear)
+          return b;
+        size_t octave = (b - _linear) / (_linear / 2);
+        uint64_t sub = (b - _linear) % (_linear / 2) + _linear / 2;
+        return sub << (octave + 1);
+      }
+
+      static uint64_t bucket_upper(const size_t &b)
+      {
+        if (b < _linear)
+          return b;
+        size_t octave = (b - _linear) / (_linear / 2);
+        return bucket_lower(b) + (uint64_t(1) << (octave + 1)) - 1;
+      }
+
+    private:
+      static uint64_t max_value()
+      {
+        return std::numeric_limits<uint64_t>::max();
+      }
+
+      static const int _sub_bits = 6;
+      static const uint64_t _linear = 1 << (_sub_bits + 1); // 128
+
+      std::vector<uint64_t> _counts;
+      uint64_t _count = 0;
+      uint64_t _sum = 0;
+      uint64_t _min = std::numeric_limits<uint64_t>::max();
+      uint64_t _max = 0;
+    };
+  }
+}
+
+#endif
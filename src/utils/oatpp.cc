@@ -56,6 +56,15 @@ namespace dd
       return object_mapper;
     }
 
+    const std::shared_ptr<oatpp::parser::json::mapping::ObjectMapper> &
+    getDDMapper()
+    {
+      static const std::shared_ptr<
+          oatpp::parser::json::mapping::ObjectMapper>
+          object_mapper = createDDMapper();
+      return object_mapper;
+    }
+
     oatpp::UnorderedFields<oatpp::Any>
     dtoToUFields(const oatpp::Void &polymorph)
     {
@@ -142,6 +151,19 @@ namespace dd
           bool b = polymorph.cast<oatpp::Boolean>();
           jval = JVal(b);
         }
+      else if (polymorph.getValueType() == DTO::GpuIds::Class::getType())
+        {
+          // same rendering as gpuIdsSerialize
+          auto gpuid = polymorph.cast<DTO::GpuIds>();
+          if (gpuid->_ids.size() == 1)
+            jval.SetInt(gpuid->_ids[0]);
+          else
+            {
+              jval = JVal(rapidjson::kArrayType);
+              for (int i : gpuid->_ids)
+                jval.PushBack(i, jdoc.GetAllocator());
+            }
+        }
       else if (polymorph.getValueType()
                == DTO::DTOVector<double>::Class::getType())
         {
@@ -35,6 +35,12 @@ namespace dd
     std::shared_ptr<oatpp::parser::json::mapping::ObjectMapper>
     createDDMapper();
 
+    /** Shared Oat++ ObjectMapper, created once with createDDMapper. Mapping
+     * is thread-safe, but its configuration must not be modified: use
+     * createDDMapper for a differently configured mapper. */
+    const std::shared_ptr<oatpp::parser::json::mapping::ObjectMapper> &
+    getDDMapper();
+
     /** Convert a DTO into dynamic structure */
     oatpp::UnorderedFields<oatpp::Any>
     dtoToUFields(const oatpp::Void &polymorph);
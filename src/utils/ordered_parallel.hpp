@@ -0,0 +1,174 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DD_ORDERED_PARALLEL_H
+#define DD_ORDERED_PARALLEL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dd
+{
+  namespace dd_utils
+  {
+    /**
+     * \brief number of workers to use, 0 or less means all cores
+     */
+    inline int num_workers(const int &workers)
+    {
+      if (workers > 0)
+        return workers;
+      return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /**
+     * \brief processes items [begin, end) with a pool of workers, and hands
+     * over the results to consumer in the calling thread, in items order.
+     * This allows parallel decoding / encoding while writing to a single db
+     * in a deterministic order. At most window results are held in memory.
+     *
+     * @param process called from workers as process(i, worker_id, result),
+     * returns false if item i is to be skipped
+     * @param consume called from the calling thread as consume(i, result),
+     * in increasing i order
+     * @param workers number of workers, 0 means all cores
+     * @param window max number of results waiting to be consumed, 0 means
+     * 4 times the number of workers
+     *
+     * An exception from process or consume stops the workers and is
+     * rethrown from the calling thread.
+     */
+    template <typename TResult, typename TProcess, typename TConsume>
+    void ordered_parallel_for(const size_t &begin, const size_t &end,
+                              TProcess process, TConsume consume,
+                              const int &workers = 0, size_t window = 0)
+    {
+      if (begin >= end)
+        return;
+      int nworkers = std::min(static_cast<size_t>(num_workers(workers)),
+                              end - begin);
+      if (window == 0)
+        window = 4 * nworkers;
+      window = std::max(window, static_cast<size_t>(nworkers));
+
+      enum SlotState
+      {
+        EMPTY,
+        READY,
+        SKIPPED
+      };
+      std::vector<TResult> results(window);
+      std::vector<SlotState> states(window, EMPTY);
+      std::mutex mutex;
+      std::condition_variable cv;
+      size_t next = begin;     // next item to process
+      size_t consumed = begin; // next item to consume
+      bool abort = false;
+      std::exception_ptr error;
+
+      auto work = [&](int worker_id) {
+        while (true)
+          {
+            size_t i;
+            {
+              std::unique_lock<std::mutex> lock(mutex);
+              if (abort || next >= end)
+                return;
+              i = next++;
+              // wait for a free slot
+              cv.wait(lock, [&]() { return abort || i < consumed + window; });
+              if (abort)
+                return;
+            }
+            TResult result;
+            bool keep = false;
+            try
+              {
+                keep = process(i, worker_id, result);
+              }
+            catch (...)
+              {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                  error = std::current_exception();
+                abort = true;
+                cv.notify_all();
+                return;
+              }
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t s = i % window;
+            if (keep)
+              results[s] = std::move(result);
+            states[s] = keep ? READY : SKIPPED;
+            cv.notify_all();
+          }
+      };
+
+      std::vector<std::thread> threads;
+      for (int w = 0; w < nworkers; ++w)
+        threads.emplace_back(work, w);
+
+      try
+        {
+          while (consumed < end)
+            {
+              size_t s = consumed % window;
+              TResult result;
+              bool keep;
+              {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&]() { return abort || states[s] != EMPTY; });
+                if (abort)
+                  break;
+                keep = states[s] == READY;
+                if (keep)
+                  result = std::move(results[s]);
+                results[s] = TResult();
+              }
+              if (keep)
+                consume(consumed, result);
+              std::lock_guard<std::mutex> lock(mutex);
+              states[s] = EMPTY;
+              ++consumed;
+              cv.notify_all();
+            }
+        }
+      catch (...)
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (!error)
+            error = std::current_exception();
+          abort = true;
+          cv.notify_all();
+        }
+
+      for (std::thread &t : threads)
+        t.join();
+      if (error)
+        std::rethrow_exception(error);
+    }
+  }
+}
+
+#endif
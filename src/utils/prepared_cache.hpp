@@ -0,0 +1,139 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DD_PREPARED_CACHE_H
+#define DD_PREPARED_CACHE_H
+
+#include "utils/fileops.hpp"
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_set>
+
+namespace dd
+{
+  namespace dd_utils
+  {
+    /**
+     * \brief cache of a model prepared for inference (frozen, fused,
+     * packed...), stored in the model repository as prefix_<key>ext.
+     * The key hashes the content of the source model files and every setting
+     * the preparation depends on (library version, device, datatype), so
+     * that a stale entry is never reused.
+     */
+    class PreparedModelCache
+    {
+    public:
+      PreparedModelCache(const std::string &repo, const std::string &prefix,
+                         const std::string &ext)
+          : _repo(repo), _prefix(prefix), _ext(ext)
+      {
+      }
+
+      /**
+       * \brief adds the content of a source model file to the key
+       */
+      void add_file(const std::string &path)
+      {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open())
+          throw std::runtime_error("cannot read " + path);
+        char buf[1 << 16];
+        while (in)
+          {
+            in.read(buf, sizeof(buf));
+            add_bytes(buf, in.gcount());
+          }
+        add_bytes("\0", 1);
+      }
+
+      /**
+       * \brief adds a preparation setting to the key
+       */
+      void add_tag(const std::string &tag)
+      {
+        add_bytes(tag.data(), tag.size());
+        add_bytes("\0", 1);
+      }
+
+      /**
+       * \brief path of the cache entry for the current key
+       */
+      std::string path() const
+      {
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx",
+                 static_cast<unsigned long long>(_hash));
+        return _repo + "/" + _prefix + "_" + key + _ext;
+      }
+
+      bool exists() const
+      {
+        bool dir = false;
+        return fileops::file_exists(path(), dir) && !dir;
+      }
+
+      /**
+       * \brief writes the cache entry through a temporary file, then removes
+       * entries with other keys
+       * @param write called as write(tmp_path)
+       */
+      template <typename TWrite> void store(TWrite write)
+      {
+        std::string entry = path();
+        std::string tmp = entry + ".tmp";
+        write(tmp);
+        if (std::rename(tmp.c_str(), entry.c_str()) != 0)
+          {
+            std::remove(tmp.c_str());
+            throw std::runtime_error("cannot write " + entry);
+          }
+
+        std::unordered_set<std::string> files;
+        fileops::list_directory(_repo, true, false, false, files);
+        std::string stale_prefix = _repo + "/" + _prefix + "_";
+        for (const std::string &f : files)
+          if (f != entry && f.compare(0, stale_prefix.size(), stale_prefix) == 0
+              && f.size() > _ext.size()
+              && f.compare(f.size() - _ext.size(), _ext.size(), _ext) == 0)
+            std::remove(f.c_str());
+      }
+
+    private:
+      void add_bytes(const char *data, const size_t &len)
+      {
+        // FNV-1a
+        for (size_t i = 0; i < len; ++i)
+          {
+            _hash ^= static_cast<unsigned char>(data[i]);
+            _hash *= 0x100000001b3ULL;
+          }
+      }
+
+      std::string _repo;
+      std::string _prefix;
+      std::string _ext;
+      uint64_t _hash = 0xcbf29ce484222325ULL;
+    };
+  }
+}
+
+#endif
@@ -0,0 +1,184 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DD_SHM_HPP
+#define DD_SHM_HPP
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dd
+{
+  namespace dd_utils
+  {
+    /**
+     * \brief reference to data in a POSIX shared memory segment, as
+     * shm://name[?offset=N&size=N&width=N&height=N&channels=N]
+     * A client can use a segment as a ring of slots, writing each input in
+     * a slot and passing its offset and size. width, height and channels
+     * describe raw 8 bits pixels, encoded data otherwise.
+     */
+    class ShmURI
+    {
+    public:
+      ShmURI(const std::string &uri)
+      {
+        if (!is_shm(uri))
+          throw std::runtime_error("not a shm uri");
+        size_t q = uri.find('?');
+        _name = uri.substr(6, q == std::string::npos ? q : q - 6);
+        if (_name.empty() || _name.find('/') != std::string::npos
+            || _name == "." || _name == "..")
+          throw std::runtime_error("invalid shm segment name " + _name);
+        while (q != std::string::npos)
+          {
+            size_t next = uri.find('&', q + 1);
+            std::string param = uri.substr(
+                q + 1, next == std::string::npos ? next : next - q - 1);
+            q = next;
+            size_t eq = param.find('=');
+            if (eq == std::string::npos)
+              throw std::runtime_error("invalid shm parameter " + param);
+            std::string key = param.substr(0, eq);
+            const char *val = param.c_str() + eq + 1;
+            char *end = nullptr;
+            unsigned long long v = std::strtoull(val, &end, 10);
+            if (*val == '\0' || *end != '\0')
+              throw std::runtime_error("invalid shm parameter " + param);
+            if (key == "offset")
+              _offset = v;
+            else if (key == "size")
+              _size = v;
+            else if (key == "width")
+              _width = static_cast<int>(v);
+            else if (key == "height")
+              _height = static_cast<int>(v);
+            else if (key == "channels")
+              _channels = static_cast<int>(v);
+            else
+              throw std::runtime_error("unknown shm parameter " + key);
+          }
+      }
+
+      static bool is_shm(const std::string &uri)
+      {
+        return uri.rfind("shm://", 0) == 0;
+      }
+
+      /**
+       * \brief whether shm data URIs are accepted, off by default as any
+       * caller could then read the shared memory segments of the server
+       * user, see the -shm_data server option
+       */
+      static std::atomic<bool> &enabled()
+      {
+        static std::atomic<bool> enabled(false);
+        return enabled;
+      }
+
+      std::string _name;
+      size_t _offset = 0;
+      size_t _size = 0; /**< 0 for the rest of the segment */
+      int _width = 0;
+      int _height = 0;
+      int _channels = 0;
+    };
+
+    /**
+     * \brief read-only mapping of a range of a shared memory segment, data
+     * is read in place
+     */
+    class SharedMemoryView
+    {
+    public:
+      SharedMemoryView(const ShmURI &shm)
+      {
+        // POSIX shared memory objects live in /dev/shm on Linux, opened
+        // directly so that there is no need for librt, symlinks are not
+        // followed out of /dev/shm
+        std::string path = "/dev/shm/" + shm._name;
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if (fd < 0)
+          throw std::runtime_error("cannot open shm segment " + shm._name
+                                   + ": " + std::strerror(errno));
+        struct stat st;
+        if (::fstat(fd, &st) != 0)
+          {
+            ::close(fd);
+            throw std::runtime_error("cannot stat shm segment " + shm._name);
+          }
+        size_t segment_size = st.st_size;
+        _size = shm._size;
+        if (_size == 0 && shm._offset < segment_size)
+          _size = segment_size - shm._offset;
+        if (shm._offset >= segment_size || _size == 0
+            || _size > segment_size - shm._offset)
+          {
+            ::close(fd);
+            throw std::runtime_error("out of bounds range of shm segment "
+                                     + shm._name);
+          }
+        size_t page = ::sysconf(_SC_PAGESIZE);
+        size_t start = shm._offset / page * page;
+        _map_size = _size + shm._offset - start;
+        _map = ::mmap(nullptr, _map_size, PROT_READ, MAP_SHARED, fd, start);
+        ::close(fd);
+        if (_map == MAP_FAILED)
+          throw std::runtime_error("cannot map shm segment " + shm._name);
+        _data = static_cast<const unsigned char *>(_map) + shm._offset
+                - start;
+      }
+
+      ~SharedMemoryView()
+      {
+        ::munmap(_map, _map_size);
+      }
+
+      SharedMemoryView(const SharedMemoryView &) = delete;
+      SharedMemoryView &operator=(const SharedMemoryView &) = delete;
+
+      const unsigned char *data() const
+      {
+        return _data;
+      }
+
+      size_t size() const
+      {
+        return _size;
+      }
+
+    private:
+      void *_map = nullptr;
+      size_t _map_size = 0;
+      const unsigned char *_data = nullptr;
+      size_t _size = 0;
+    };
+  }
+}
+
+#endif
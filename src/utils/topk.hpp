@@ -0,0 +1,98 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DD_TOPK_HPP
+#define DD_TOPK_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace dd
+{
+  namespace dd_utils
+  {
+    /**
+     * \brief indices of the k largest values, by decreasing value, ties by
+     * increasing index, i.e. the first k values of a stable sort.
+     * Values are scanned by fixed size blocks: the test of a whole block
+     * against the current k-th value is branchless and vectorized by the
+     * compiler, so that for k much smaller than n most blocks are skipped
+     * without touching the selection.
+     * @param min_value values below are ignored
+     * @param idx output indices, at most k
+     */
+    template <typename T>
+    inline void top_k(const T *values, const size_t &n, const size_t &k,
+                      const T &min_value, std::vector<size_t> &idx)
+    {
+      idx.clear();
+      if (k == 0 || n == 0)
+        return;
+
+      // better goes first
+      auto better = [values](const size_t &a, const size_t &b) {
+        return values[a] > values[b] || (values[a] == values[b] && a < b);
+      };
+
+      // heap of the current selection, worst on top
+      idx.reserve(std::min(k, n) + 1);
+      T threshold = min_value;
+      const size_t block = 16;
+      for (size_t start = 0; start < n; start += block)
+        {
+          const size_t end = std::min(start + block, n);
+          if (end - start == block)
+            {
+              // fixed trip count, vectorized at -O2
+              const T *b = values + start;
+              int candidates = 0;
+              for (size_t i = 0; i < block; ++i)
+                candidates |= b[i] >= threshold;
+              if (!candidates)
+                continue;
+            }
+          for (size_t i = start; i < end; ++i)
+            {
+              if (!(values[i] >= threshold))
+                continue;
+              if (idx.size() < k)
+                {
+                  idx.push_back(i);
+                  std::push_heap(idx.begin(), idx.end(), better);
+                }
+              else if (better(i, idx.front()))
+                {
+                  std::pop_heap(idx.begin(), idx.end(), better);
+                  idx.back() = i;
+                  std::push_heap(idx.begin(), idx.end(), better);
+                }
+              else
+                continue;
+              if (idx.size() == k)
+                threshold = values[idx.front()];
+            }
+        }
+      std::sort_heap(idx.begin(), idx.end(), better);
+    }
+  }
+}
+
+#endif
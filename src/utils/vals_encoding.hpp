@@ -0,0 +1,231 @@
+/**
+ * DeepDetect
+ * Copyright (c) 2022 Jolibrain
+ *
+ * This file is part of deepdetect.
+ *
+ * deepdetect is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * deepdetect is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with deepdetect.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DD_VALS_ENCODING_HPP
+#define DD_VALS_ENCODING_HPP
+
+#include "utils/base64.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace dd
+{
+  namespace dd_utils
+  {
+    /**
+     * \brief compact encodings of output value vectors (embeddings,
+     * extracted features), as base64 of little-endian values:
+     * - float32: IEEE single precision
+     * - float16: IEEE half precision, round to nearest even
+     * - int8: signed bytes q, with values ~ q * scale, scale being
+     *   max(|v|) / 127
+     */
+    enum class ValsEncoding
+    {
+      JSON,
+      FLOAT32,
+      FLOAT16,
+      INT8
+    };
+
+    /**
+     * \brief parses an encoding name, returns false if unknown
+     */
+    inline bool vals_encoding_from_string(const std::string &name,
+                                          ValsEncoding &encoding)
+    {
+      if (name.empty() || name == "json")
+        encoding = ValsEncoding::JSON;
+      else if (name == "float32")
+        encoding = ValsEncoding::FLOAT32;
+      else if (name == "float16")
+        encoding = ValsEncoding::FLOAT16;
+      else if (name == "int8")
+        encoding = ValsEncoding::INT8;
+      else
+        return false;
+      return true;
+    }
+
+    inline std::string vals_encoding_to_string(const ValsEncoding &encoding)
+    {
+      switch (encoding)
+        {
+        case ValsEncoding::FLOAT32:
+          return "float32";
+        case ValsEncoding::FLOAT16:
+          return "float16";
+        case ValsEncoding::INT8:
+          return "int8";
+        case ValsEncoding::JSON:
+          break;
+        }
+      return "json";
+    }
+
+    inline uint32_t float_bits(const float &f)
+    {
+      uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      return bits;
+    }
+
+    inline float bits_float(const uint32_t &bits)
+    {
+      float f;
+      std::memcpy(&f, &bits, sizeof(f));
+      return f;
+    }
+
+    /**
+     * \brief IEEE half precision bits of f, rounded to nearest even
+     */
+    inline uint16_t float_to_half(const float &f)
+    {
+      uint32_t x = float_bits(f);
+      uint16_t sign = (x >> 16) & 0x8000;
+      uint32_t abs = x & 0x7fffffff;
+      if (abs >= 0x7f800000) // inf, nan
+        return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0);
+      if (abs >= 0x477ff000) // rounds to more than max half
+        return sign | 0x7c00;
+      if (abs < 0x38800000) // subnormal half
+        {
+          // adding 0.5 aligns the mantissa on half subnormal steps
+          float sub = bits_float(abs) + 0.5f;
+          return sign | static_cast<uint16_t>(float_bits(sub) - 0x3f000000);
+        }
+      uint32_t odd = (abs >> 13) & 1;
+      abs += 0xc8000fff + odd; // rebias exponent, round to nearest even
+      return sign | static_cast<uint16_t>(abs >> 13);
+    }
+
+    inline float half_to_float(const uint16_t &h)
+    {
+      uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+      uint32_t exp = (h >> 10) & 0x1f;
+      uint32_t mant = h & 0x3ff;
+      if (exp == 0) // zero, subnormal
+        {
+          float sub = std::ldexp(static_cast<float>(mant), -24);
+          return sign ? -sub : sub;
+        }
+      if (exp == 31)
+        return bits_float(sign | 0x7f800000 | (mant << 13));
+      return bits_float(sign | ((exp + 112) << 23) | (mant << 13));
+    }
+
+    /**
+     * \brief encodes vals as base64 into out
+     * @param scale set to the int8 quantization step, 0 for other encodings
+     */
+    inline void encode_vals(const std::vector<double> &vals,
+                            const ValsEncoding &encoding, std::string &out,
+                            float &scale)
+    {
+      scale = 0.0;
+      std::vector<uint8_t> bytes;
+      switch (encoding)
+        {
+        case ValsEncoding::FLOAT32:
+          bytes.resize(vals.size() * 4);
+          for (size_t i = 0; i < vals.size(); ++i)
+            {
+              uint32_t b = float_bits(static_cast<float>(vals[i]));
+              bytes[4 * i] = b;
+              bytes[4 * i + 1] = b >> 8;
+              bytes[4 * i + 2] = b >> 16;
+              bytes[4 * i + 3] = b >> 24;
+            }
+          break;
+        case ValsEncoding::FLOAT16:
+          bytes.resize(vals.size() * 2);
+          for (size_t i = 0; i < vals.size(); ++i)
+            {
+              uint16_t b = float_to_half(static_cast<float>(vals[i]));
+              bytes[2 * i] = b;
+              bytes[2 * i + 1] = b >> 8;
+            }
+          break;
+        case ValsEncoding::INT8:
+          {
+            double vmax = 0.0;
+            for (double v : vals)
+              vmax = std::max(vmax, std::fabs(v));
+            scale = vmax / 127.0;
+            bytes.resize(vals.size());
+            for (size_t i = 0; i < vals.size(); ++i)
+              {
+                double q = scale > 0 ? std::round(vals[i] / scale) : 0.0;
+                q = std::min(127.0, std::max(-127.0, q));
+                bytes[i] = static_cast<uint8_t>(static_cast<int8_t>(q));
+              }
+            break;
+          }
+        case ValsEncoding::JSON:
+          break;
+        }
+      out.clear();
+      base64_encode(bytes.data(), bytes.size(), out);
+    }
+
+    /**
+     * \brief decodes base64 vals, returns false on invalid input
+     */
+    inline bool decode_vals(const std::string &in,
+                            const ValsEncoding &encoding, const float &scale,
+                            std::vector<double> &vals)
+    {
+      std::vector<unsigned char> bytes;
+      if (!in.empty() && !base64_decode(in.data(), in.size(), bytes))
+        return false;
+      vals.clear();
+      switch (encoding)
+        {
+        case ValsEncoding::FLOAT32:
+          if (bytes.size() % 4)
+            return false;
+          for (size_t i = 0; i < bytes.size(); i += 4)
+            vals.push_back(bits_float(
+                bytes[i] | (bytes[i + 1] << 8) | (bytes[i + 2] << 16)
+                | (static_cast<uint32_t>(bytes[i + 3]) << 24)));
+          return true;
+        case ValsEncoding::FLOAT16:
+          if (bytes.size() % 2)
+            return false;
+          for (size_t i = 0; i < bytes.size(); i += 2)
+            vals.push_back(half_to_float(bytes[i] | (bytes[i + 1] << 8)));
+          return true;
+        case ValsEncoding::INT8:
+          for (unsigned char b : bytes)
+            vals.push_back(static_cast<int8_t>(b) * scale);
+          return true;
+        case ValsEncoding::JSON:
+          break;
+        }
+      return false;
+    }
+  }
+}
+
+#endif
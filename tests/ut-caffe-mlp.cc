@@ -22,6 +22,7 @@
 #include "caffelib.h"
 #include "caffeinputconns.h"
 #include "outputconnectorstrategy.h"
+#include "caffe/data_transformer.hpp"
 #include <gtest/gtest.h>
 #include <iostream>
 
@@ -811,3 +812,161 @@ TEST(caffelib, configure_unet_diceloss)
     }
   ASSERT_TRUE(found);
 }
+
+class ImgCaffeInputFileConnDb : public ImgCaffeInputFileConn
+{
+public:
+  using ImgCaffeInputFileConn::compute_images_mean;
+  using ImgCaffeInputFileConn::images_list_hash;
+  using ImgCaffeInputFileConn::write_db_progress;
+  using ImgCaffeInputFileConn::write_image_to_db;
+};
+
+static std::vector<std::pair<std::string, std::string>>
+read_db_entries(const std::string &dbname)
+{
+  std::vector<std::pair<std::string, std::string>> entries;
+  std::unique_ptr<caffe::db::DB> db(caffe::db::GetDB("lmdb"));
+  db->Open(dbname, caffe::db::READ);
+  std::unique_ptr<caffe::db::Cursor> cursor(db->NewCursor());
+  for (; cursor->valid(); cursor->Next())
+    entries.push_back(std::make_pair(cursor->key(), cursor->value()));
+  return entries;
+}
+
+TEST(caffeinputconn, write_image_to_db_resume)
+{
+  // a small list of images of a single size
+  std::string imgdir = "resume_imgs";
+  mkdir(imgdir.c_str(), 0777);
+  std::vector<std::pair<std::string, int>> lfiles;
+  for (int i = 0; i < 12; ++i)
+    {
+      cv::Mat img(8, 8, CV_8UC3, cv::Scalar(i * 20, 255 - i * 20, i * 7));
+      cv::rectangle(img, cv::Point(i % 4, 0), cv::Point(7, i % 8),
+                    cv::Scalar(0, 0, 0));
+      std::string fname = imgdir + "/img" + std::to_string(i) + ".png";
+      cv::imwrite(fname, img);
+      lfiles.push_back(std::make_pair(fname, i % 3));
+    }
+
+  ImgCaffeInputFileConnDb conn;
+  conn._logger = spdlog::stdout_logger_mt("UT-db-resume");
+  conn._width = 8;
+  conn._height = 8;
+  conn._db_workers = 3;
+
+  // full creation in one pass, along with the mean image
+  std::string fulldb = "resume_full.lmdb";
+  conn.write_image_to_db(fulldb, lfiles, "lmdb", true, "png",
+                         "resume_mean.binaryproto");
+  std::vector<std::pair<std::string, std::string>> full
+      = read_db_entries(fulldb);
+  ASSERT_EQ(lfiles.size(), full.size());
+  ASSERT_FALSE(fileops::file_exists(fulldb + ".progress"));
+
+  // the mean from the decoded images matches the mean read back from db
+  remove("resume_dbmean.binaryproto");
+  conn.compute_images_mean("resume_full", "resume_dbmean.binaryproto");
+  caffe::BlobProto mean, dbmean;
+  ASSERT_TRUE(
+      caffe::ReadProtoFromBinaryFile("resume_mean.binaryproto", &mean));
+  ASSERT_TRUE(
+      caffe::ReadProtoFromBinaryFile("resume_dbmean.binaryproto", &dbmean));
+  ASSERT_EQ(dbmean.data_size(), mean.data_size());
+  ASSERT_EQ(3 * 8 * 8, mean.data_size());
+  for (int i = 0; i < mean.data_size(); ++i)
+    ASSERT_NEAR(dbmean.data(i), mean.data(i), 1e-4);
+
+  // interrupted creation: first images committed, progress recorded
+  std::string resumedb = "resume_part.lmdb";
+  std::vector<std::pair<std::string, int>> first(lfiles.begin(),
+                                                 lfiles.begin() + 5);
+  conn.write_image_to_db(resumedb, first, "lmdb", true, "png");
+  ASSERT_EQ(5, read_db_entries(resumedb).size());
+  conn.write_db_progress(resumedb, conn.images_list_hash(lfiles), 5);
+
+  // resuming only writes the remaining images, in order
+  conn.write_image_to_db(resumedb, lfiles, "lmdb", true, "png");
+  ASSERT_FALSE(fileops::file_exists(resumedb + ".progress"));
+  ASSERT_EQ(full, read_db_entries(resumedb));
+
+  // a different list of images rebuilds the db
+  conn.write_db_progress(resumedb, conn.images_list_hash(first), 5);
+  conn.write_image_to_db(resumedb, lfiles, "lmdb", true, "png");
+  ASSERT_EQ(full, read_db_entries(resumedb));
+
+  fileops::remove_dir(fulldb);
+  fileops::remove_dir(resumedb);
+  fileops::remove_dir(imgdir);
+  remove("resume_mean.binaryproto");
+  remove("resume_dbmean.binaryproto");
+}
+
+TEST(caffeinputconn, direct_blob_matches_datum)
+{
+  // a small image set, of the net input size
+  std::vector<std::string> uris;
+  for (int i = 0; i < 5; ++i)
+    {
+      cv::Mat img(16, 12, CV_8UC3);
+      cv::randu(img, cv::Scalar::all(0), cv::Scalar::all(255));
+      std::string fname = "direct_blob_" + std::to_string(i) + ".png";
+      cv::imwrite(fname, img);
+      uris.push_back(fname);
+    }
+  APIData ad;
+  ad.add("data", uris);
+
+  // input layer transform, applied by the data transformer on the Datum
+  // path, fused with the connector mean on the direct path
+  const float scale = 0.5;
+  const std::vector<float> mean_values = { 1.0, 2.0, 3.0 };
+  caffe::TransformationParameter tparam;
+  tparam.set_scale(scale);
+  for (float m : mean_values)
+    tparam.add_mean_value(m);
+
+  auto setup_conn = [](ImgCaffeInputFileConn &conn, const bool &direct_blob) {
+    conn._logger = spdlog::get("UT-direct-blob");
+    if (!conn._logger)
+      conn._logger = spdlog::stdout_logger_mt("UT-direct-blob");
+    conn._train = false;
+    conn._width = 12;
+    conn._height = 16;
+    conn._mean = { 10.0, 20.0, 30.0 };
+    conn._has_mean_scalar = true;
+    conn._direct_blob = direct_blob;
+  };
+
+  // Datum path
+  ImgCaffeInputFileConn datum_conn;
+  setup_conn(datum_conn, false);
+  datum_conn.transform(ad);
+  std::vector<caffe::Datum> dv = datum_conn.get_dv_test(5, false);
+  ASSERT_EQ(5, dv.size());
+  caffe::DataTransformer<float> transformer(tparam, caffe::TEST);
+  caffe::Blob<float> expected(5, 3, 16, 12);
+  transformer.Transform(dv, &expected);
+
+  // direct path, in two batches
+  ImgCaffeInputFileConn blob_conn;
+  setup_conn(blob_conn, true);
+  blob_conn.transform(ad);
+  ASSERT_EQ(5, blob_conn.test_batch_size());
+  std::vector<float> data;
+  std::vector<float> batches;
+  ASSERT_EQ(2, blob_conn.get_blob_test(2, data, scale, mean_values));
+  batches.insert(batches.end(), data.begin(), data.end());
+  ASSERT_EQ(3, blob_conn.get_blob_test(5, data, scale, mean_values));
+  batches.insert(batches.end(), data.begin(), data.end());
+  ASSERT_EQ(0, blob_conn.get_blob_test(5, data, scale, mean_values));
+
+  ASSERT_EQ(expected.count(), batches.size());
+  const float *expected_data = expected.cpu_data();
+  for (size_t i = 0; i < batches.size(); ++i)
+    ASSERT_NEAR(expected_data[i], batches[i], 1e-4) << "at " << i;
+
+  for (const std::string &fname : uris)
+    remove(fname.c_str());
+}
@@ -23,6 +23,22 @@
 #include <gtest/gtest.h>
 
 #include "utils/utils.hpp"
+#include "utils/latency_histogram.hpp"
+#include "utils/bounded_queue.hpp"
+#include "utils/ordered_parallel.hpp"
+#include "utils/topk.hpp"
+#include "utils/shm.hpp"
+#include "utils/httpclient.hpp"
+#include "apidata.h"
+#include "utils/bbox.hpp"
+#include "cpu_placement.h"
+#include "mllibstrategy.h"
+
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <thread>
+#include <unistd.h>
 
 using namespace dd;
 
@@ -36,3 +52,411 @@ TEST(common, trim_spaces)
             dd_utils::trim_spaces("  test_name test_name\t"));
   ASSERT_EQ("", dd_utils::trim_spaces("   \n  "));
 }
+
+TEST(common, latency_histogram)
+{
+  dd_utils::LatencyHistogram h;
+  for (uint64_t v = 1; v <= 1000; ++v)
+    h.record(v);
+  ASSERT_EQ(1000, h.count());
+  ASSERT_EQ(1, h.min());
+  ASSERT_EQ(1000, h.max());
+  ASSERT_EQ(500.5, h.mean());
+  // buckets are exact below 128, within 1.6% above
+  ASSERT_EQ(100, h.percentile(10));
+  ASSERT_NEAR(500, h.percentile(50), 8);
+  ASSERT_NEAR(990, h.percentile(99), 16);
+  ASSERT_EQ(1000, h.percentile(100));
+
+  dd_utils::LatencyHistogram h2;
+  h2.record(1000000);
+  h.merge(h2);
+  ASSERT_EQ(1001, h.count());
+  ASSERT_EQ(1000000, h.max());
+  ASSERT_EQ(1000000, h.percentile(100));
+
+  uint64_t total = 0;
+  uint64_t prev_upper = 0;
+  h.for_each_bucket([&](uint64_t lower, uint64_t upper, uint64_t count) {
+    ASSERT_LE(lower, upper);
+    ASSERT_LE(prev_upper, lower);
+    prev_upper = upper;
+    total += count;
+  });
+  ASSERT_EQ(1001, total);
+}
+
+TEST(common, bounded_queue)
+{
+  dd_utils::BoundedQueue<int> q(5);
+  ASSERT_EQ(8, q.capacity());
+  int v = 0;
+  ASSERT_FALSE(q.try_pop(v));
+  for (int i = 0; i < 8; ++i)
+    ASSERT_TRUE(q.try_push(i));
+  ASSERT_FALSE(q.try_push(8));
+  for (int i = 0; i < 8; ++i)
+    {
+      ASSERT_TRUE(q.try_pop(v));
+      ASSERT_EQ(i, v);
+    }
+  ASSERT_FALSE(q.try_pop(v));
+
+  // concurrent producers, values from each producer stay in order
+  const int nproducers = 4;
+  const int nvalues = 20000;
+  dd_utils::BoundedQueue<int> mq(64);
+  std::vector<std::thread> producers;
+  for (int p = 0; p < nproducers; ++p)
+    producers.emplace_back([&mq, p]() {
+      for (int i = 0; i < nvalues; ++i)
+        while (!mq.try_push(p * nvalues + i))
+          std::this_thread::yield();
+    });
+  // results are collected and checked once producers are joined, an
+  // assertion failure must not leave joinable threads behind
+  std::vector<std::vector<int>> popped(nproducers);
+  for (int n = 0; n < nproducers * nvalues;)
+    {
+      if (!mq.try_pop(v))
+        continue;
+      popped[v / nvalues].push_back(v % nvalues);
+      ++n;
+    }
+  for (auto &t : producers)
+    t.join();
+  ASSERT_FALSE(mq.try_pop(v));
+  for (int p = 0; p < nproducers; ++p)
+    {
+      ASSERT_EQ(nvalues, popped[p].size());
+      for (int i = 0; i < nvalues; ++i)
+        ASSERT_EQ(i, popped[p][i]);
+    }
+}
+
+TEST(common, ordered_parallel_for)
+{
+  // results are consumed in order, skipped items are not consumed
+  std::vector<size_t> consumed;
+  dd_utils::ordered_parallel_for<size_t>(
+      0, 1000,
+      [](size_t i, int, size_t &out) {
+        if (i % 7 == 0)
+          return false;
+        if (i % 3 == 0)
+          std::this_thread::sleep_for(std::chrono::microseconds(50));
+        out = i * 2;
+        return true;
+      },
+      [&consumed](size_t i, size_t &out) {
+        consumed.push_back(i);
+        consumed.push_back(out);
+      },
+      4, 8);
+  std::vector<size_t> expected;
+  for (size_t i = 0; i < 1000; ++i)
+    if (i % 7 != 0)
+      {
+        expected.push_back(i);
+        expected.push_back(i * 2);
+      }
+  ASSERT_EQ(expected, consumed);
+
+  // start offset, as when resuming, and empty range
+  consumed.clear();
+  dd_utils::ordered_parallel_for<size_t>(
+      995, 1000,
+      [](size_t i, int, size_t &out) {
+        out = i;
+        return true;
+      },
+      [&consumed](size_t, size_t &out) { consumed.push_back(out); }, 8);
+  ASSERT_EQ(std::vector<size_t>({ 995, 996, 997, 998, 999 }), consumed);
+  dd_utils::ordered_parallel_for<size_t>(
+      10, 10, [](size_t, int, size_t &) { return true; },
+      [&consumed](size_t, size_t &) { consumed.clear(); });
+  ASSERT_EQ(5, consumed.size());
+
+  // exceptions from workers and from the consumer reach the caller
+  ASSERT_THROW(dd_utils::ordered_parallel_for<size_t>(
+                   0, 1000,
+                   [](size_t i, int, size_t &out) {
+                     if (i == 500)
+                       throw std::runtime_error("process");
+                     out = i;
+                     return true;
+                   },
+                   [](size_t, size_t &) {}, 4),
+               std::runtime_error);
+  size_t last = 0;
+  ASSERT_THROW(dd_utils::ordered_parallel_for<size_t>(
+                   0, 1000,
+                   [](size_t i, int, size_t &out) {
+                     out = i;
+                     return true;
+                   },
+                   [&last](size_t i, size_t &) {
+                     last = i;
+                     if (i == 100)
+                       throw std::runtime_error("consume");
+                   },
+                   4),
+               std::runtime_error);
+  ASSERT_EQ(100, last);
+}
+
+TEST(common, top_k)
+{
+  std::vector<float> values = { 0.1, 0.5, 0.2, 0.5, 0.9, 0.0, 0.3 };
+  // values beyond a block
+  for (int i = 0; i < 40; ++i)
+    values.push_back(0.05);
+  values.push_back(0.7);
+  std::vector<size_t> idx;
+  dd_utils::top_k(values.data(), values.size(), 4, 0.0f, idx);
+  ASSERT_EQ(std::vector<size_t>({ 4, 47, 1, 3 }), idx);
+  dd_utils::top_k(values.data(), values.size(), 10, 0.4f, idx);
+  ASSERT_EQ(std::vector<size_t>({ 4, 47, 1, 3 }), idx);
+  dd_utils::top_k(values.data(), values.size(), 0, 0.0f, idx);
+  ASSERT_TRUE(idx.empty());
+  dd_utils::top_k(values.data(), 3, 5, 0.0f, idx);
+  ASSERT_EQ(std::vector<size_t>({ 1, 2, 0 }), idx);
+}
+
+TEST(common, nms_sorted_boxes)
+{
+  std::vector<double> boxes = {
+    0,  0,  10, 10,  // kept
+    1,  1,  11, 11,  // overlaps first
+    20, 20, 30, 30,  // kept
+    0,  0,  10, 9.5, // overlaps first
+    21, 0,  31, 10,  // kept
+  };
+  std::vector<size_t> picked;
+  bbox_utils::nms_sorted_boxes(boxes.data(), 5, picked, 0.5);
+  ASSERT_EQ(std::vector<size_t>({ 0, 2, 4 }), picked);
+  bbox_utils::nms_sorted_boxes(boxes.data(), 5, picked, 0.5, 2);
+  ASSERT_EQ(std::vector<size_t>({ 0, 2 }), picked);
+
+  std::vector<std::vector<double>> vboxes;
+  for (size_t i = 0; i < 5; ++i)
+    vboxes.push_back(std::vector<double>(boxes.begin() + 4 * i,
+                                         boxes.begin() + 4 * i + 4));
+  bbox_utils::nms_sorted_bboxes(vboxes, picked, 0.9);
+  ASSERT_EQ(std::vector<size_t>({ 0, 1, 2, 4 }), picked);
+}
+
+TEST(common, shared_memory)
+{
+  std::string data(10000, '\0');
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = 'a' + i % 26;
+  std::ofstream seg("/dev/shm/dd_ut_common", std::ios::binary);
+  seg.write(data.data(), data.size());
+  seg.close();
+
+  dd_utils::ShmURI shm("shm://dd_ut_common?offset=5000&size=100&width=10"
+                       "&height=10&channels=1");
+  ASSERT_EQ("dd_ut_common", shm._name);
+  ASSERT_EQ(5000, shm._offset);
+  ASSERT_EQ(100, shm._size);
+  ASSERT_EQ(10, shm._width);
+  ASSERT_EQ(10, shm._height);
+  ASSERT_EQ(1, shm._channels);
+  {
+    dd_utils::SharedMemoryView view(shm);
+    ASSERT_EQ(100, view.size());
+    ASSERT_EQ(0, memcmp(view.data(), data.data() + 5000, 100));
+  }
+  {
+    dd_utils::SharedMemoryView view(dd_utils::ShmURI("shm://dd_ut_common"));
+    ASSERT_EQ(data.size(), view.size());
+  }
+
+  ASSERT_THROW(dd_utils::ShmURI("shm://a/b"), std::runtime_error);
+  ASSERT_THROW(dd_utils::ShmURI("shm://a?offset=x"), std::runtime_error);
+  ASSERT_THROW(dd_utils::ShmURI("shm://a?unknown=1"), std::runtime_error);
+  dd_utils::ShmURI out_of_bounds("shm://dd_ut_common?offset=9000&size=1001");
+  ASSERT_THROW(dd_utils::SharedMemoryView view(out_of_bounds),
+               std::runtime_error);
+  dd_utils::ShmURI missing("shm://dd_ut_none");
+  ASSERT_THROW(dd_utils::SharedMemoryView view(missing), std::runtime_error);
+
+  // symlinks out of /dev/shm are not followed
+  remove("/dev/shm/dd_ut_link");
+  ASSERT_EQ(0, symlink("/dev/shm/dd_ut_common", "/dev/shm/dd_ut_link"));
+  dd_utils::ShmURI link("shm://dd_ut_link");
+  ASSERT_THROW(dd_utils::SharedMemoryView view(link), std::runtime_error);
+  remove("/dev/shm/dd_ut_link");
+  remove("/dev/shm/dd_ut_common");
+
+  // shm data URIs are disabled unless the server opts in
+  ASSERT_FALSE(dd_utils::ShmURI::enabled());
+}
+
+TEST(common, httpfetcher)
+{
+  // file:// urls are fetched like remote ones
+  char cwd[4096];
+  ASSERT_TRUE(getcwd(cwd, sizeof(cwd)) != nullptr);
+  std::vector<std::string> urls;
+  std::vector<std::string> contents;
+  for (int i = 0; i < 12; ++i)
+    {
+      std::string fname = "dd_ut_fetch_" + std::to_string(i) + ".txt";
+      std::string content(1000 * (i + 1), 'a' + i);
+      std::ofstream(fname) << content;
+      urls.push_back("file://" + std::string(cwd) + "/" + fname);
+      contents.push_back(content);
+    }
+  urls.push_back("inline data"); // not fetched
+  int code = 0;
+  std::string out;
+
+  {
+    // transfers stop once twice max_fetches contents are not collected
+    httpfetcher fetcher(urls, 10, 2, 0);
+    for (int t = 0; t < 500 && fetcher.pending() < 4; ++t)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_EQ(4, fetcher.pending());
+    for (size_t i = 0; i < contents.size(); ++i)
+      {
+        fetcher.get(i, code, out);
+        ASSERT_EQ(200, code);
+        ASSERT_EQ(contents[i], out);
+        ASSERT_LE(fetcher.pending(), 4);
+      }
+    ASSERT_EQ(0, fetcher.pending());
+  }
+
+  {
+    // only the elements above max_size or missing fail
+    std::vector<std::string> some
+        = { urls[1], urls[2], "file:///dd_ut_fetch_missing", urls[12] };
+    httpfetcher fetcher(some, 10, 4, 2500);
+    fetcher.get(0, code, out);
+    ASSERT_EQ(contents[1], out);
+    ASSERT_THROW(fetcher.get(1, code, out), std::runtime_error);
+    ASSERT_THROW(fetcher.get(2, code, out), std::runtime_error);
+  }
+
+  {
+    // a timeout above the max fails each element, not the fetcher
+    httpfetcher fetcher(urls, _max_timeout + 1, 2, 0);
+    for (size_t i = 0; i < contents.size(); ++i)
+      ASSERT_THROW(fetcher.get(i, code, out), std::runtime_error);
+    ASSERT_EQ(0, fetcher.pending());
+  }
+
+  // an unfinished fetcher can be destroyed
+  {
+    httpfetcher fetcher(urls, 10, 1, 0);
+  }
+
+  for (int i = 0; i < 12; ++i)
+    remove(("dd_ut_fetch_" + std::to_string(i) + ".txt").c_str());
+}
+
+TEST(common, cpu_placement)
+{
+  ASSERT_EQ(std::vector<int>({ 0, 1, 2, 3, 8, 10, 11 }),
+            CpuScheduler::parse_cpu_list("0-3,8,10-11\n"));
+  ASSERT_EQ("0-3,8,10-11", CpuScheduler::to_cpu_list(
+                               { 0, 1, 2, 3, 8, 10, 11 }));
+  ASSERT_THROW(CpuScheduler::parse_cpu_list("3-1"), std::invalid_argument);
+  ASSERT_THROW(CpuScheduler::parse_cpu_list("0,,1"), std::invalid_argument);
+
+  // two nodes of four cores with two hyperthreads each
+  CpuTopology topology;
+  for (int c = 0; c < 16; ++c)
+    {
+      CpuTopology::Cpu cpu;
+      cpu.cpu = c;
+      cpu.node = (c % 8) / 4;
+      cpu.core = c % 8;
+      topology._cpus.push_back(cpu);
+    }
+  CpuScheduler scheduler(topology);
+
+  APIData ad_none;
+  ASSERT_EQ(nullptr, scheduler.reserve("none", ad_none));
+
+  APIData ad_cores;
+  ad_cores.add("cores", 2);
+  auto p1 = scheduler.reserve("s1", ad_cores);
+  ASSERT_TRUE(p1->_exclusive);
+  ASSERT_EQ("0-1,8-9", CpuScheduler::to_cpu_list(scheduler.cpus(p1.get())));
+
+  // node with most free cores
+  auto p2 = scheduler.reserve("s2", ad_cores);
+  ASSERT_EQ("4-5,12-13", CpuScheduler::to_cpu_list(scheduler.cpus(p2.get())));
+
+  APIData ad_cpus;
+  ad_cpus.add("cpus", std::string("2"));
+  auto p3 = scheduler.reserve("s3", ad_cpus);
+  ASSERT_EQ(1, p3->size());
+  ASSERT_THROW(scheduler.reserve("s4", ad_cpus), MLLibBadParamException);
+
+  // core 2 is partly held, only core 3 is free on node 0
+  APIData ad_node_cores;
+  ad_node_cores.add("cores", 2);
+  ad_node_cores.add("numa_node", 0);
+  ASSERT_THROW(scheduler.reserve("s4", ad_node_cores),
+               MLLibBadParamException);
+  APIData ad_node;
+  ad_node.add("numa_node", 0);
+  auto p4 = scheduler.reserve("s4", ad_node);
+  ASSERT_FALSE(p4->_exclusive);
+  ASSERT_EQ("3,10-11", CpuScheduler::to_cpu_list(scheduler.cpus(p4.get())));
+  ASSERT_EQ("3,6-7,10-11,14-15",
+            CpuScheduler::to_cpu_list(scheduler.cpus(nullptr)));
+
+  // spread over both nodes
+  APIData ad_three;
+  ad_three.add("cores", 3);
+  auto p5 = scheduler.reserve("s5", ad_three);
+  ASSERT_EQ("3,6-7,11,14-15",
+            CpuScheduler::to_cpu_list(scheduler.cpus(p5.get())));
+  ASSERT_THROW(scheduler.reserve("s6", ad_cores), MLLibBadParamException);
+
+  p1.reset();
+  p5.reset();
+  APIData info = scheduler.info();
+  ASSERT_EQ("0-15", info.get("cpus").get<std::string>());
+  ASSERT_EQ("0-1,3,6-11,14-15", info.get("free").get<std::string>());
+  auto nodes = info.getv("nodes");
+  ASSERT_EQ(2u, nodes.size());
+  ASSERT_EQ("0-1,3,8-11", nodes[0].get("free").get<std::string>());
+  ASSERT_EQ(7, p4->size());
+
+  // pins the calling thread to a cpu it may run on, applied from a
+  // dedicated thread so that the affinity, OpenMP thread count and team
+  // of the test thread are left untouched
+  CpuScheduler local(CpuTopology::detect());
+  cpu_set_t mask;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(mask), &mask));
+  int first = 0;
+  while (!CPU_ISSET(first, &mask))
+    ++first;
+  APIData ad_first;
+  ad_first.add("cpus", std::to_string(first));
+  auto pfirst = local.reserve("first", ad_first);
+  bool applied = false;
+  int getaffinity = -1;
+  cpu_set_t pinned;
+  CPU_ZERO(&pinned);
+  std::thread placed([&]() {
+    applied = local.apply(pfirst.get());
+    getaffinity = pthread_getaffinity_np(pthread_self(), sizeof(pinned),
+                                         &pinned);
+  });
+  placed.join();
+  ASSERT_TRUE(applied);
+  ASSERT_EQ(0, getaffinity);
+  ASSERT_EQ(1, CPU_COUNT(&pinned));
+  ASSERT_TRUE(CPU_ISSET(first, &pinned));
+  cpu_set_t unchanged;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(unchanged), &unchanged));
+  ASSERT_TRUE(CPU_EQUAL(&mask, &unchanged));
+}
@@ -26,8 +26,10 @@
 #include "txtinputfileconn.h"
 #include "outputconnectorstrategy.h"
 #include "jsonapi.h"
+#include "ext/base64/base64.h"
 #include <gtest/gtest.h>
 #include <iostream>
+#include <unistd.h>
 
 using namespace dd;
 
@@ -448,6 +450,136 @@ TEST(inputconn, img)
                 == 0); // the two images must be identical
 }
 
+TEST(inputconn, img_prefetch)
+{
+  // local images and file:// images, the latter fetched in the background
+  char cwd[4096];
+  ASSERT_TRUE(getcwd(cwd, sizeof(cwd)) != nullptr);
+  std::vector<std::string> uris;
+  for (int i = 0; i < 6; ++i)
+    {
+      cv::Mat img(20 + i, 30, CV_8UC3, cv::Scalar(i * 40, 0, 0));
+      std::string fname = "prefetch_" + std::to_string(i) + ".png";
+      cv::imwrite(fname, img);
+      uris.push_back(i % 2 ? "file://" + std::string(cwd) + "/" + fname
+                           : fname);
+    }
+  APIData ad;
+  ad.add("data", uris);
+
+  ImgInputFileConn iifc;
+  iifc._logger = spdlog::stdout_logger_mt("iifc_prefetch");
+  iifc._input_max_fetches = 1;
+  iifc.transform(ad);
+  ASSERT_EQ(6, iifc._images.size());
+
+  // a timeout above the max fails the remote images with a bad parameter
+  ImgInputFileConn iifc_timeout;
+  iifc_timeout._logger = spdlog::stdout_logger_mt("iifc_prefetch_timeout");
+  iifc_timeout._input_timeout = _max_timeout + 1;
+  ASSERT_THROW(iifc_timeout.transform(ad), InputConnectorBadParamException);
+
+  for (int i = 0; i < 6; ++i)
+    remove(("prefetch_" + std::to_string(i) + ".png").c_str());
+}
+
+TEST(inputconn, img_base64_reduced)
+{
+  // synthetic 800x600 jpeg, sent as base64
+  cv::Mat src(600, 800, CV_8UC3);
+  cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::GaussianBlur(src, src, cv::Size(31, 31), 0);
+  std::vector<unsigned char> jpg;
+  cv::imencode(".jpg", src, jpg);
+  std::string b64;
+  Base64::Encode(std::string(jpg.begin(), jpg.end()), &b64);
+
+  int width = 0, height = 0;
+  ASSERT_TRUE(cv_utils::jpeg_size(jpg.data(), jpg.size(), width, height));
+  ASSERT_EQ(800, width);
+  ASSERT_EQ(600, height);
+  std::vector<unsigned char> decoded;
+  ASSERT_TRUE(dd_utils::base64_decode(b64.data(), b64.size(), decoded));
+  ASSERT_TRUE(decoded == jpg);
+
+  std::vector<cv::Mat> images;
+  for (bool reduced : { false, true })
+    {
+      APIData ad, pad, pinp;
+      ad.add("data", std::vector<std::string>{ b64 });
+      pinp.add("width", 100);
+      pinp.add("height", 100);
+      pinp.add("reduced_decode", reduced);
+      pad.add("input", std::vector<APIData>{ pinp });
+      ad.add("parameters", std::vector<APIData>{ pad });
+      ImgInputFileConn iifc;
+      iifc._logger = spdlog::stdout_logger_mt(reduced ? "iifc_b64_reduced"
+                                                      : "iifc_b64");
+      iifc.transform(ad);
+      ASSERT_EQ(1, iifc._images.size());
+      ASSERT_EQ(100, iifc._images.at(0).cols);
+      ASSERT_EQ(100, iifc._images.at(0).rows);
+      // original size is reported, whatever the decoding resolution
+      ASSERT_EQ(600, iifc._images_size.at(0).first);
+      ASSERT_EQ(800, iifc._images_size.at(0).second);
+      images.push_back(iifc._images.at(0));
+    }
+  cv::Mat diff;
+  cv::absdiff(images.at(0), images.at(1), diff);
+  ASSERT_LT(cv::mean(diff)[0], 4.0);
+}
+
+TEST(inputconn, img_base64_reduced_exif)
+{
+  // synthetic 800x600 jpeg with an EXIF orientation of 6 (rotated 90 CW),
+  // decoded as a 600x800 image
+  cv::Mat src(600, 800, CV_8UC3);
+  cv::randu(src, cv::Scalar::all(0), cv::Scalar::all(255));
+  cv::GaussianBlur(src, src, cv::Size(31, 31), 0);
+  std::vector<unsigned char> jpg;
+  cv::imencode(".jpg", src, jpg);
+  std::vector<unsigned char> app1
+      = { 0xFF, 0xE1, 0,    34,   'E', 'x', 'i', 'f', 0, 0, 'I', 'I',
+          42,   0,    8,    0,    0,   0,   1,   0,   0x12, 0x01, 3, 0,
+          1,    0,    0,    0,    6,   0,   0,   0,   0, 0, 0, 0 };
+  jpg.insert(jpg.begin() + 2, app1.begin(), app1.end());
+
+  int width = 0, height = 0, orientation = 0;
+  ASSERT_TRUE(cv_utils::jpeg_size(jpg.data(), jpg.size(), width, height,
+                                  orientation));
+  ASSERT_EQ(800, width);
+  ASSERT_EQ(600, height);
+  ASSERT_EQ(6, orientation);
+  std::string b64;
+  Base64::Encode(std::string(jpg.begin(), jpg.end()), &b64);
+
+  std::vector<cv::Mat> images;
+  for (bool reduced : { false, true })
+    {
+      APIData ad, pad, pinp;
+      ad.add("data", std::vector<std::string>{ b64 });
+      pinp.add("width", 200);
+      pinp.add("height", 100);
+      pinp.add("reduced_decode", reduced);
+      pad.add("input", std::vector<APIData>{ pinp });
+      ad.add("parameters", std::vector<APIData>{ pad });
+      ImgInputFileConn iifc;
+      iifc._logger = spdlog::stdout_logger_mt(
+          reduced ? "iifc_b64_exif_reduced" : "iifc_b64_exif");
+      iifc.transform(ad);
+      ASSERT_EQ(1, iifc._images.size());
+      ASSERT_EQ(200, iifc._images.at(0).cols);
+      ASSERT_EQ(100, iifc._images.at(0).rows);
+      // size of the oriented image is reported
+      ASSERT_EQ(800, iifc._images_size.at(0).first);
+      ASSERT_EQ(600, iifc._images_size.at(0).second);
+      images.push_back(iifc._images.at(0));
+    }
+  cv::Mat diff;
+  cv::absdiff(images.at(0), images.at(1), diff);
+  ASSERT_LT(cv::mean(diff)[0], 4.0);
+}
+
 // TODO: test csv scale, separator, categorical, ...
 TEST(inputconn, csv_mem1)
 {
@@ -818,6 +950,87 @@ TEST(inputconn, csvts_error)
   fileops::remove_dir("csvts");
 }
 
+TEST(inputconn, txt_wordpiece)
+{
+  TxtInputFileConn tifc;
+  tifc.set_word("un", Word(0));
+  tifc.set_word("unaff", Word(1));
+  tifc.set_word("##aff", Word(2));
+  tifc.set_word("##able", Word(3));
+  tifc.set_word("##ord", Word(4));
+  tifc.set_word("##or", Word(5));
+  tifc.set_word("[UNK]", Word(6));
+
+  WordPieceTokenizer &wpt = tifc._wordpiece_tokenizer;
+  wpt.append_input("unaffordable");
+  wpt.append_input("unable");
+  wpt.append_input("unx");
+  std::vector<std::string> tokens{ "unaff", "##ord", "##able", "un",
+                                   "##able", "[UNK]" };
+  ASSERT_EQ(tokens, wpt._tokens);
+
+  std::vector<int> ids;
+  std::string word = "unaffordable";
+  wpt.append_ids(word.data(), word.size(), ids);
+  ASSERT_EQ(std::vector<int>({ 1, 4, 3 }), ids);
+
+  // vocabulary changes are picked up
+  tifc.set_word("unx", Word(7));
+  ids.clear();
+  wpt.append_ids("unx", 3, ids);
+  ASSERT_EQ(std::vector<int>({ 7 }), ids);
+
+  // including changes that keep the vocabulary size
+  tifc.erase_word("unx");
+  tifc.set_word("unz", Word(7));
+  ids.clear();
+  wpt.append_ids("unx", 3, ids);
+  wpt.append_ids("unz", 3, ids);
+  ASSERT_EQ(std::vector<int>({ 6, 7 }), ids);
+}
+
+TEST(inputconn, txt_bow_parsers)
+{
+  TxtInputFileConn tifc;
+  tifc._train = true;
+  tifc._min_word_length = 1;
+  tifc._sentences = true;
+
+  // documents parsed by two parsers, vocabulary follows documents order
+  std::vector<TxtParser> parsers(2, TxtParser(tifc._wordpiece_tokenizer));
+  std::vector<std::vector<uint32_t>> parsers_terms(2);
+  std::vector<std::string> contents{ "runs fine\nfine fine", "all right",
+                                     "everything runs fine" };
+  std::vector<TxtDoc> docs(contents.size());
+  for (int d : { 1, 0, 2 })
+    {
+      docs[d]._parser = d % 2;
+      tifc.parse_document(parsers[d % 2], contents[d], d, d, docs[d]);
+    }
+  for (TxtDoc &doc : docs)
+    tifc.add_document(doc, parsers_terms[doc._parser], -1);
+  tifc.merge_vocab(parsers);
+
+  ASSERT_EQ(5, tifc._vocab.size());
+  ASSERT_EQ(0, tifc._vocab["runs"]._pos);
+  ASSERT_EQ(1, tifc._vocab["fine"]._pos);
+  ASSERT_EQ(2, tifc._vocab["all"]._pos);
+  ASSERT_EQ(4, tifc._vocab["everything"]._pos);
+  ASSERT_EQ(4, tifc._vocab["fine"]._total_count);
+  ASSERT_EQ(3, tifc._vocab["fine"]._total_docs);
+
+  ASSERT_EQ(4, tifc._txt.size());
+  TxtBowEntry *tbe = static_cast<TxtBowEntry *>(tifc._txt.at(1));
+  ASSERT_EQ(1, tbe->size());
+  std::string key;
+  double val = 0.0;
+  tbe->get_next_elt(key, val);
+  ASSERT_EQ("fine", key);
+  ASSERT_EQ(2.0, val);
+  ASSERT_FALSE(tbe->has_elt());
+  ASSERT_EQ(2, tifc._txt.at(3)->_target);
+}
+
 /*TEST(inputconn,txt_parse_content)
 {
   std::string str = "everything runs fine, right?";
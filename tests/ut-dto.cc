@@ -25,6 +25,7 @@
 #include "oatpp/core/Types.hpp"
 #include "oatpp/core/macro/codegen.hpp"
 
+#include "apidata.h"
 #include "dto/ddtypes.hpp"
 #include "utils/oatpp.hpp"
 
@@ -56,6 +57,14 @@ class CompleteDTOTest : public oatpp::DTO
   DTO_FIELD(oatpp::Fields<Any>, fields) = Fields<Any>::createShared();
 };
 
+class GpuDTOTest : public oatpp::DTO
+{
+  DTO_INIT(GpuDTOTest, DTO);
+  DTO_FIELD(dd::DTO::GpuIds, gpuid) = dd::DTO::VGpuIds();
+  DTO_FIELD(String, s);
+  DTO_FIELD(Float64, f64) = 0.5;
+};
+
 #include OATPP_CODEGEN_END(DTO) ///< End DTO codegen section
 
 TEST(dto, vector_dto)
@@ -115,3 +124,29 @@ TEST(dto, dto_to_json)
   ASSERT_EQ(jdoc["ufields"]["a"].GetBool(), false);
   ASSERT_EQ(jdoc["fields"]["b"].GetBool(), true);
 }
+
+TEST(dto, apidata_dto)
+{
+  ASSERT_EQ(dd::oatpp_utils::getDDMapper().get(),
+            dd::oatpp_utils::getDDMapper().get());
+
+  auto dto = GpuDTOTest::createShared();
+  dto->gpuid = dd::DTO::VGpuIds(oatpp::Vector<oatpp::Int32>({ 1, 2 }));
+  dd::APIData ad = dd::APIData::fromDTO<GpuDTOTest>(dto);
+  ASSERT_FALSE(ad.has("s"));
+  ASSERT_EQ(ad.get("f64").get<double>(), 0.5);
+  std::vector<int> gpuid = ad.get("gpuid").get<std::vector<int>>();
+  ASSERT_EQ(gpuid.size(), 2);
+  ASSERT_EQ(gpuid[1], 2);
+
+  ad.add("s", std::string("string"));
+  ad.add("gpuid", 3);
+  for (int i = 0; i < 2; ++i)
+    {
+      auto dto2 = ad.createSharedDTO<GpuDTOTest>();
+      ASSERT_EQ(dto2->s, "string");
+      ASSERT_EQ(dto2->f64, 0.5);
+      ASSERT_EQ(dto2->gpuid->_ids.size(), 1);
+      ASSERT_EQ(dto2->gpuid->_ids[0], 3);
+    }
+}
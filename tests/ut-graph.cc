@@ -61,6 +61,30 @@ TEST(graphapi, compute_lstm)
   ASSERT_EQ(output.size(2), 3);
 }
 
+TEST(graphapi, compute_lstm_extract)
+{
+  CaffeToTorch ctt("../../examples/graph/recurrent.prototxt");
+  ctt.eval();
+  torch::Tensor input = torch::randn({ 2, 10, 9 });
+  torch::Tensor output = ctt.forward(input);
+
+  // extracting the output is the same as forwarding
+  torch::Tensor extracted = ctt.extract(input, "rnn_pred");
+  ASSERT_TRUE(torch::allclose(output, extracted));
+
+  // intermediate blobs are still extractible
+  torch::Tensor hidden = ctt.extract(input, "LSTM_1");
+  ASSERT_EQ(hidden.size(0), 2);
+  ASSERT_EQ(hidden.size(1), 10);
+  ASSERT_EQ(hidden.size(2), 50);
+  ASSERT_THROW(ctt.extract(input, "unknown"), TorchGraphException);
+
+  // repeated forward keeps working once plan is compiled
+  output = ctt.forward(torch::randn({ 1, 5, 9 }));
+  ASSERT_EQ(output.size(1), 5);
+  ASSERT_EQ(output.size(2), 3);
+}
+
 TEST(graphapi, simple_cuda)
 {
   CaffeToTorch ctt("../../examples/graph/recurrent.prototxt");
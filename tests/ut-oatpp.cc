@@ -580,7 +580,19 @@ void test_predict(std::shared_ptr<DedeApiTestClient> client)
     oatpp::base::Environment::destroy();                                      \
   }
 
+#define OATPP_DEDE_ASYNC_TEST(FUNC)                                           \
+  TEST(oatpp_jsonapi, FUNC##_async)                                           \
+  {                                                                           \
+    oatpp::base::Environment::init();                                         \
+    DedeControllerTest *test                                                  \
+        = new DedeControllerTest(#FUNC "_async", FUNC, true);                 \
+    test->run(1);                                                             \
+    delete test;                                                              \
+    oatpp::base::Environment::destroy();                                      \
+  }
+
 OATPP_DEDE_TEST(test_info);
+OATPP_DEDE_ASYNC_TEST(test_info);
 
 #ifdef USE_CAFFE
 
@@ -589,5 +601,7 @@ OATPP_DEDE_TEST(test_train);
 OATPP_DEDE_TEST(test_multiservices);
 OATPP_DEDE_TEST(test_concurrency);
 OATPP_DEDE_TEST(test_predict);
+OATPP_DEDE_ASYNC_TEST(test_concurrency);
+OATPP_DEDE_ASYNC_TEST(test_predict);
 
 #endif
@@ -29,6 +29,7 @@
 #include "oatpp/core/macro/codegen.hpp"
 #include "oatpp/core/macro/component.hpp"
 #include "oatpp/web/client/ApiClient.hpp"
+#include "oatpp/web/server/AsyncHttpConnectionHandler.hpp"
 #include "oatpp/web/server/HttpConnectionHandler.hpp"
 #include "oatpp/web/client/HttpRequestExecutor.hpp"
 #include "oatpp/network/virtual_/client/ConnectionProvider.hpp"
@@ -39,10 +40,18 @@
 
 #include "oatppjsonapi.h"
 #include "http/controller.hpp"
+#include "http/async_controller.hpp"
 
 class TestComponent
 {
+private:
+  bool _async;
+
 public:
+  TestComponent(const bool &async = false) : _async(async)
+  {
+  }
+
   OATPP_CREATE_COMPONENT(std::shared_ptr<oatpp::network::virtual_::Interface>,
                          virtualInterface)
   ([] {
@@ -75,9 +84,12 @@ public:
 
   OATPP_CREATE_COMPONENT(std::shared_ptr<oatpp::network::ConnectionHandler>,
                          serverConnectionHandler)
-  ([] {
+  ([this]() -> std::shared_ptr<oatpp::network::ConnectionHandler> {
     OATPP_COMPONENT(std::shared_ptr<oatpp::web::server::HttpRouter>,
                     router); // get Router component
+    if (_async)
+      return oatpp::web::server::AsyncHttpConnectionHandler::createShared(
+          router);
     return oatpp::web::server::HttpConnectionHandler::createShared(router);
   }());
 
@@ -128,22 +140,30 @@ class DedeControllerTest : public oatpp::test::UnitTest
 
 public:
   OatppUnitTestFunc oatpp_unit_test_func;
+  bool async;
 
   DedeControllerTest(const char *testTAG,
-                     const OatppUnitTestFunc oatpp_unit_test_func)
-      : UnitTest(testTAG), oatpp_unit_test_func(oatpp_unit_test_func)
+                     const OatppUnitTestFunc oatpp_unit_test_func,
+                     const bool &async = false)
+      : UnitTest(testTAG), oatpp_unit_test_func(oatpp_unit_test_func),
+        async(async)
   {
   }
 
   void onRun()
   {
     dd::OatppJsonAPI oja;
-    TestComponent component;
+    TestComponent component(async);
     oatpp::test::web::ClientServerTestRunner runner;
     std::shared_ptr<oatpp::data::mapping::ObjectMapper> defaultObjectMapper
         = oatpp::parser::json::mapping::ObjectMapper::createShared();
-    runner.addController(
-        std::make_shared<DedeController>(&oja, defaultObjectMapper));
+    if (async)
+      runner.addController(std::make_shared<DedeAsyncController>(
+          &oja, defaultObjectMapper,
+          std::make_shared<dd::http::ExecutorPools>(2, 64)));
+    else
+      runner.addController(
+          std::make_shared<DedeController>(&oja, defaultObjectMapper));
     runner.run(
         [this, &runner] {
           OATPP_COMPONENT(
@@ -102,6 +102,136 @@ TEST(faissse, index_search_incr)
   rmdir(model_repo.c_str());
 }
 
+TEST(faissse, index_search_batch)
+{
+  std::vector<double> vec1 = { 1.0, 0.0, 0.0, 0.0 };
+  std::vector<double> vec2 = { 0.0, 1.0, 0.0, 0.0 };
+  std::vector<double> vec3 = { 1.0, 0.0, 1.0, 0.0 };
+
+  int t = 4;
+  std::string model_repo = "simsearch";
+  mkdir(model_repo.c_str(), 0770);
+  FaissSE fse(t, model_repo);
+  fse.create_index();
+  fse.index({ URIData("test1"), URIData("test2"), URIData("test3") },
+            { vec1, vec2, vec3 });
+  fse.update_index();
+
+  // batch results match single query results
+  std::vector<std::vector<URIData>> buris;
+  std::vector<std::vector<double>> bdistances;
+  fse.search({ vec1, vec2, vec3 }, 2, buris, bdistances);
+  ASSERT_EQ(3, buris.size());
+  ASSERT_EQ(3, bdistances.size());
+  std::vector<std::vector<double>> vecs = { vec1, vec2, vec3 };
+  for (size_t q = 0; q < vecs.size(); ++q)
+    {
+      std::vector<URIData> uris;
+      std::vector<double> distances;
+      fse.search(vecs[q], 2, uris, distances);
+      ASSERT_EQ(uris.size(), buris[q].size());
+      for (size_t i = 0; i < uris.size(); ++i)
+        {
+          ASSERT_EQ(uris[i]._uri, buris[q][i]._uri);
+          ASSERT_NEAR(distances[i], bdistances[q][i], 1e-6);
+        }
+    }
+  ASSERT_EQ("test1", buris[0][0]._uri);
+  ASSERT_EQ("test2", buris[1][0]._uri);
+  ASSERT_EQ("test3", buris[2][0]._uri);
+
+  // packed float32 queries give the same results
+  std::vector<float> fvecs;
+  for (const std::vector<double> &vec : vecs)
+    fvecs.insert(fvecs.end(), vec.begin(), vec.end());
+  std::vector<std::vector<URIData>> furis;
+  std::vector<std::vector<double>> fdistances;
+  fse.search(fvecs.data(), vecs.size(), 2, furis, fdistances);
+  ASSERT_EQ(3, furis.size());
+  for (size_t q = 0; q < vecs.size(); ++q)
+    {
+      ASSERT_EQ(buris[q].size(), furis[q].size());
+      for (size_t i = 0; i < furis[q].size(); ++i)
+        {
+          ASSERT_EQ(buris[q][i]._uri, furis[q][i]._uri);
+          ASSERT_NEAR(bdistances[q][i], fdistances[q][i], 1e-6);
+        }
+    }
+
+  // queries of the wrong dimension are rejected
+  std::vector<URIData> uris;
+  std::vector<double> distances;
+  ASSERT_THROW(fse.search(std::vector<double>(3, 0.0), 2, uris, distances),
+               SimSearchException);
+  ASSERT_THROW(fse.search({ vec1, std::vector<double>(5, 0.0) }, 2, buris,
+                          bdistances),
+               SimSearchException);
+
+  fse.remove_index();
+  rmdir(model_repo.c_str());
+}
+
+TEST(faissse, index_search_mem_metadata)
+{
+  std::vector<double> vec1 = { 1.0, 0.0, 0.0, 0.0 };
+  std::vector<double> vec2 = { 0.0, 1.0, 0.0, 0.0 };
+  std::vector<double> vec3 = { 1.0, 0.0, 1.0, 0.0 };
+
+  int t = 4;
+  std::string model_repo = "simsearch";
+  mkdir(model_repo.c_str(), 0770);
+  {
+    FaissSE fse(t, model_repo);
+    fse._mem_metadata = true;
+    fse.create_index();
+    fse.index(URIData("test1", { 1.0, 2.0, 3.0, 4.0 }, 0.5, "cat1"), vec1);
+    fse.index(URIData("test2"), vec2);
+    fse.index(URIData("test1", { 5.0, 6.0, 7.0, 8.0 }, 0.25, "cat2"), vec3);
+    fse.update_index();
+  }
+  ASSERT_TRUE(fileops::file_exists(model_repo + "/names.mem"));
+
+  // db written without the table, the stale table is rebuilt
+  std::vector<double> vec4 = { 0.0, 0.0, 0.0, 1.0 };
+  {
+    FaissSE fse(t, model_repo);
+    fse.create_index();
+    fse.index(URIData("test4"), vec4);
+    fse.update_index();
+  }
+
+  // metadata rebuilt from the db, from the persisted table, then rebuilt
+  // from the db again
+  for (int rebuild = 0; rebuild < 3; ++rebuild)
+    {
+      if (rebuild == 2)
+        fileops::remove_file(model_repo, "names.mem");
+      FaissSE fse(t, model_repo);
+      fse._mem_metadata = true;
+      fse.create_index();
+      ASSERT_EQ(4, fse._mem_db.size());
+      URIData fmap;
+      ASSERT_TRUE(fse._mem_db.get(3, fmap));
+      ASSERT_EQ("test4", fmap._uri);
+      std::vector<std::vector<URIData>> uris;
+      std::vector<std::vector<double>> distances;
+      fse.search({ vec3, vec2 }, 1, uris, distances);
+      ASSERT_EQ("test1", uris[0][0]._uri);
+      ASSERT_EQ(4, uris[0][0]._bbox.size());
+      ASSERT_NEAR(7.0, uris[0][0]._bbox[2], 1e-6);
+      ASSERT_NEAR(0.25, uris[0][0]._prob, 1e-6);
+      ASSERT_EQ("cat2", uris[0][0]._cat);
+      ASSERT_EQ("test2", uris[1][0]._uri);
+      ASSERT_TRUE(uris[1][0]._bbox.empty());
+    }
+
+  FaissSE fse(t, model_repo);
+  fse.create_index();
+  fse.remove_index();
+  ASSERT_FALSE(fileops::file_exists(model_repo + "/names.mem"));
+  rmdir(model_repo.c_str());
+}
+
 TEST(simsearch, predict_simsearch_unsup)
 {
   // create service
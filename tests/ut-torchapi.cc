@@ -26,9 +26,12 @@
 #include "txtinputfileconn.h"
 #include <gtest/gtest.h>
 #include <stdio.h>
+#include <utime.h>
 #include <iostream>
 #include <numeric>
+#include <set>
 #include "backends/torch/native/templates/nbeats.h"
+#include "utils/vals_encoding.hpp"
 #include <torch/torch.h>
 #include <rapidjson/istreamwrapper.h>
 
@@ -202,6 +205,145 @@ TEST(torchapi, service_predict)
   ASSERT_EQ(cl_dog, "n02096051 Airedale, Airedale terrier");
 }
 
+TEST(torchapi, service_predict_lazy)
+{
+  JsonAPI japi;
+  std::vector<std::string> snames = { "imgserv_lazy1", "imgserv_lazy2" };
+  for (const std::string &sname : snames)
+    {
+      std::string jstr
+          = "{\"mllib\":\"torch\",\"description\":\"resnet-50\",\"type\":"
+            "\"supervised\",\"model\":{\"lazy\":true,\"repository\":\""
+            + incept_repo
+            + "\"},\"parameters\":{\"input\":{\"connector\":\"image\","
+              "\"height\":224,\"width\":224,\"rgb\":true,\"scale\":0.0039},"
+              "\"mllib\":{\"nclasses\":1000}}}";
+      std::string joutstr = japi.jrender(japi.service_create(sname, jstr));
+      ASSERT_EQ(created_str, joutstr);
+
+      JDoc jd;
+      joutstr = japi.jrender(japi.service_status(sname));
+      jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+      ASSERT_FALSE(jd["body"]["lazy"]["loaded"].GetBool());
+    }
+
+  auto predict = [&](const std::string &sname) {
+    std::string jpredictstr
+        = "{\"service\":\"" + sname
+          + "\",\"parameters\":{\"output\":{\"best\":1}},\"data\":[\""
+          + incept_repo + "cat.jpg\"]}";
+    std::string joutstr = japi.jrender(japi.service_predict(jpredictstr));
+    JDoc jd;
+    jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+    ASSERT_EQ(200, jd["status"]["code"]);
+    ASSERT_EQ(jd["body"]["predictions"][0]["classes"][0]["cat"].GetString(),
+              std::string("n02123045 tabby, tabby cat"));
+  };
+
+  // without budget, the first service loads and gives its memory estimate
+  predict(snames[0]);
+  JDoc jd;
+  std::string joutstr = japi.jrender(japi.service_status(snames[0]));
+  jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+  ASSERT_TRUE(jd["body"]["lazy"]["loaded"].GetBool());
+  int mem_mb = static_cast<int>(
+      jd["body"]["lazy"]["mem_estimate"].GetInt64() / (1024 * 1024));
+  ASSERT_GT(mem_mb, 2);
+
+  // a budget that fits a single model but not two
+  japi._lazy_mem_budget = mem_mb * 3 / 2; // MB
+  predict(snames[0]);
+  jd = JDoc();
+  joutstr = japi.jrender(japi.service_status(snames[0]));
+  jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+  ASSERT_TRUE(jd["body"]["lazy"]["loaded"].GetBool());
+  ASSERT_EQ(jd["body"]["lazy"]["evictions"].GetInt(), 0);
+  predict(snames[1]);
+
+  // loading the second service evicted the first one
+  jd = JDoc();
+  joutstr = japi.jrender(japi.service_status(snames[0]));
+  jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+  ASSERT_FALSE(jd["body"]["lazy"]["loaded"].GetBool());
+  ASSERT_EQ(jd["body"]["lazy"]["loads"].GetInt(), 1);
+  ASSERT_EQ(jd["body"]["lazy"]["evictions"].GetInt(), 1);
+  jd = JDoc();
+  joutstr = japi.jrender(japi.service_status(snames[1]));
+  jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+  ASSERT_TRUE(jd["body"]["lazy"]["loaded"].GetBool());
+  ASSERT_TRUE(jd["body"]["lazy"]["mem_estimate"].GetInt64() > 0);
+}
+
+TEST(torchapi, service_predict_vals_encoding)
+{
+  JsonAPI japi;
+  std::string sname = "imgserv";
+  std::string jstr
+      = "{\"mllib\":\"torch\",\"description\":\"resnet-50\",\"type\":"
+        "\"supervised\",\"model\":{\"repository\":\""
+        + incept_repo
+        + "\"},\"parameters\":{\"input\":{\"connector\":\"image\","
+          "\"height\":224,\"width\":224,\"rgb\":true,\"scale\":0.0039},"
+          "\"mllib\":{\"nclasses\":1000}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname, jstr));
+  ASSERT_EQ(created_str, joutstr);
+
+  auto predict = [&](const std::string &encoding, JDoc &jd) {
+    std::string jpredictstr
+        = "{\"service\":\"" + sname
+          + "\",\"parameters\":{\"mllib\":{\"extract_layer\":\"last\"},"
+            "\"output\":{\"vals_encoding\":\""
+          + encoding + "\"}},\"data\":[\"" + incept_repo + "cat.jpg\"]}";
+    joutstr = japi.jrender(japi.service_predict(jpredictstr));
+    jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+    ASSERT_EQ(200, jd["status"]["code"]);
+  };
+
+  JDoc jd;
+  predict("json", jd);
+  std::vector<double> vals;
+  auto &jvals = jd["body"]["predictions"][0]["vals"];
+  ASSERT_TRUE(jvals.IsArray());
+  for (size_t i = 0; i < jvals.Size(); i++)
+    vals.push_back(jvals[i].GetDouble());
+  ASSERT_EQ(vals.size(), 1000);
+  double vmax = 0.0;
+  for (double v : vals)
+    vmax = std::max(vmax, std::fabs(v));
+
+  for (std::string encoding : { "float32", "float16", "int8" })
+    {
+      JDoc jde;
+      predict(encoding, jde);
+      auto &jpred = jde["body"]["predictions"][0];
+      ASSERT_EQ(jpred["vals_encoding"].GetString(), encoding);
+      std::string encoded = jpred["vals"].GetString();
+      dd_utils::ValsEncoding enc;
+      ASSERT_TRUE(dd_utils::vals_encoding_from_string(encoding, enc));
+      float scale = jpred.HasMember("vals_scale")
+                        ? jpred["vals_scale"].GetFloat()
+                        : 0.0;
+      std::vector<double> decoded;
+      ASSERT_TRUE(dd_utils::decode_vals(encoded, enc, scale, decoded));
+      ASSERT_EQ(decoded.size(), vals.size());
+      double tol = encoding == "float32"   ? 1e-5 * vmax
+                   : encoding == "float16" ? 1e-3 * vmax
+                                           : scale;
+      for (size_t i = 0; i < vals.size(); ++i)
+        ASSERT_NEAR(decoded[i], vals[i], tol);
+    }
+
+  JDoc jdu;
+  std::string jpredictstr
+      = "{\"service\":\"" + sname
+        + "\",\"parameters\":{\"mllib\":{\"extract_layer\":\"last\"},"
+          "\"output\":{\"vals_encoding\":\"float8\"}},\"data\":[\""
+        + incept_repo + "cat.jpg\"]}";
+  joutstr = japi.jrender(japi.service_predict(jpredictstr));
+  jdu.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+  ASSERT_EQ(400, jdu["status"]["code"]);
+}
+
 TEST(torchapi, service_predict_native_bw)
 {
   // Predict greyscale image with native model should work
@@ -333,6 +475,88 @@ TEST(torchapi, service_predict_fp16)
 }
 #endif
 
+static std::vector<std::string> prepared_entries(const std::string &repo)
+{
+  std::unordered_set<std::string> lfiles;
+  fileops::list_directory(repo, true, false, false, lfiles);
+  std::vector<std::string> entries;
+  for (const std::string &f : lfiles)
+    if (f.find("/prepared_") != std::string::npos && f.size() > 4
+        && f.compare(f.size() - 4, 4, ".ptp") == 0)
+      entries.push_back(f);
+  return entries;
+}
+
+TEST(torchapi, service_predict_prepared_cache)
+{
+  for (const std::string &f : prepared_entries(incept_repo))
+    remove(f.c_str());
+
+  // create service, the prepared model is built and cached
+  JsonAPI japi;
+  std::string sname = "imgserv";
+  std::string jstr
+      = "{\"mllib\":\"torch\",\"description\":\"resnet-50\",\"type\":"
+        "\"supervised\",\"model\":{\"repository\":\""
+        + incept_repo
+        + "\"},\"parameters\":{\"input\":{\"connector\":\"image\",\"height\":"
+          "224,\"width\":224,\"rgb\":true,\"scale\":0.0039},\"mllib\":{"
+          "\"prepared_cache\":true}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname, jstr));
+  ASSERT_EQ(created_str, joutstr);
+  std::vector<std::string> entries = prepared_entries(incept_repo);
+  ASSERT_EQ(1, entries.size());
+  std::string entry = entries.at(0);
+
+  // backdate the entry, it would be rewritten on a cache miss
+  struct utimbuf old_times;
+  old_times.actime = old_times.modtime = 1000000000;
+  ASSERT_EQ(0, utime(entry.c_str(), &old_times));
+  joutstr = japi.jrender(japi.service_delete(sname, "{}"));
+  ASSERT_EQ(ok_str, joutstr);
+
+  // recreate service, the prepared model is loaded from the cache
+  joutstr = japi.jrender(japi.service_create(sname, jstr));
+  ASSERT_EQ(created_str, joutstr);
+  entries = prepared_entries(incept_repo);
+  ASSERT_EQ(1, entries.size());
+  ASSERT_EQ(entry, entries.at(0));
+  ASSERT_EQ(1000000000, fileops::file_last_modif(entry));
+
+  // predict with the datatype the model was prepared with
+  std::string jpredictstr
+      = "{\"service\":\"imgserv\",\"parameters\":{\"input\":{\"height\":224,"
+        "\"width\":224},\"output\":{\"best\":1}},\"data\":[\""
+        + incept_repo + "cat.jpg\"]}";
+  joutstr = japi.jrender(japi.service_predict(jpredictstr));
+  JDoc jd;
+  std::cout << "joutstr=" << joutstr << std::endl;
+  jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(200, jd["status"]["code"]);
+  ASSERT_TRUE(jd["body"]["predictions"].IsArray());
+  std::string cl1
+      = jd["body"]["predictions"][0]["classes"][0]["cat"].GetString();
+  ASSERT_TRUE(cl1 == "n02123045 tabby, tabby cat");
+  ASSERT_TRUE(jd["body"]["predictions"][0]["classes"][0]["prob"].GetDouble()
+              > 0.3);
+
+  // another datatype is rejected
+  jpredictstr
+      = "{\"service\":\"imgserv\",\"parameters\":{\"input\":{\"height\":224,"
+        "\"width\":224},\"output\":{\"best\":1},\"mllib\":{\"datatype\":"
+        "\"fp64\"}},\"data\":[\""
+        + incept_repo + "cat.jpg\"]}";
+  joutstr = japi.jrender(japi.service_predict(jpredictstr));
+  jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(400, jd["status"]["code"]);
+
+  joutstr = japi.jrender(japi.service_delete(sname, "{}"));
+  ASSERT_EQ(ok_str, joutstr);
+  remove(entry.c_str());
+}
+
 TEST(torchapi, service_predict_object_detection)
 {
   JsonAPI japi;
@@ -472,20 +696,28 @@ TEST(inputconn, txt_tokenize_ordered_words)
   tifc._wordpiece_tokens = true;
   tifc._punctuation_tokens = true;
 
-  tifc._vocab["every"] = Word();
-  tifc._vocab["##ing"] = Word();
-  tifc._vocab["##thing"] = Word();
-  tifc._vocab["fine"] = Word();
-  tifc._vocab[","] = Word();
-  tifc._vocab["?"] = Word();
-  tifc._vocab["right"] = Word();
+  tifc.set_word("every", Word(0));
+  tifc.set_word("##ing", Word(1));
+  tifc.set_word("##thing", Word(2));
+  tifc.set_word("fine", Word(3));
+  tifc.set_word(",", Word(4));
+  tifc.set_word("?", Word(5));
+  tifc.set_word("right", Word(6));
 
   tifc.parse_content(str, 1);
   TxtOrderedWordsEntry &towe
       = *dynamic_cast<TxtOrderedWordsEntry *>(tifc._txt.at(0));
-  std::vector<std::string> tokens{ "every", "##thing", "[UNK]", "fine",
-                                   ",",     "right",   "?" };
-  ASSERT_EQ(tokens, towe._v);
+  // every ##thing [UNK] fine , right ?
+  std::vector<int> ids{ 0, 2, -1, 3, 4, 6, 5 };
+  ASSERT_EQ(ids, towe._v);
+
+  // unknown words map to [UNK] when in vocabulary
+  tifc.set_word("[UNK]", Word(7));
+  tifc.parse_content(str, 1);
+  TxtOrderedWordsEntry &towe_unk
+      = *dynamic_cast<TxtOrderedWordsEntry *>(tifc._txt.at(1));
+  ids[2] = 7;
+  ASSERT_EQ(ids, towe_unk._v);
 }
 
 TEST(torchapi, load_weights_native_model)
@@ -726,6 +958,71 @@ TEST(torchapi, service_train_images_split)
   fileops::remove_dir(resnet50_train_repo + "test_0.lmdb");
 }
 
+TEST(torchapi, service_train_images_shards)
+{
+  setenv("CUBLAS_WORKSPACE_CONFIG", ":4096:8", true);
+  torch::manual_seed(torch_seed);
+  at::globalContext().setDeterministicCuDNN(true);
+
+  // Create service
+  JsonAPI japi;
+  std::string sname = "imgserv";
+  std::string jstr
+      = "{\"mllib\":\"torch\",\"description\":\"image\",\"type\":"
+        "\"supervised\",\"model\":{\"repository\":\""
+        + resnet50_train_repo
+        + "\"},\"parameters\":{\"input\":{\"connector\":\"image\","
+          "\"width\":224,\"height\":224,\"db\":true,\"db_format\":"
+          "\"shards\"},\"mllib\":{\"nclasses\":2,\"finetuning\":true,"
+          "\"gpu\":true}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname, jstr));
+  ASSERT_EQ(created_str, joutstr);
+
+  // Train
+  std::string jtrainstr
+      = "{\"service\":\"imgserv\",\"async\":false,\"parameters\":{"
+        "\"mllib\":{\"solver\":{\"iterations\":"
+        + iterations_resnet50 + ",\"base_lr\":" + torch_lr
+        + ",\"iter_size\":4,\"solver_type\":\"ADAM\",\"test_"
+          "interval\":200},\"net\":{\"batch_size\":4},\"nclasses\":2,"
+          "\"resume\":false,\"dataloader_threads\":4},"
+          "\"input\":{\"seed\":12345,\"db\":true,\"db_format\":"
+          "\"shards\",\"shuffle\":true},"
+          "\"output\":{\"measure\":[\"f1\",\"acc\"]}},\"data\":[\""
+        + resnet50_train_data + "\",\"" + resnet50_test_data + "\"]}";
+  joutstr = japi.jrender(japi.service_train(jtrainstr));
+  JDoc jd;
+  std::cout << "joutstr=" << joutstr << std::endl;
+  jd.Parse<rapidjson::kParseNanAndInfFlag>(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(201, jd["status"]["code"]);
+
+  ASSERT_TRUE(jd["body"]["measure"]["iteration"] == 200) << "iterations";
+  ASSERT_TRUE(jd["body"]["measure"]["acc"].GetDouble() <= 1) << "accuracy";
+
+  ASSERT_TRUE(
+      fileops::file_exists(resnet50_train_repo + "train.shards/index.bin"));
+  ASSERT_TRUE(fileops::file_exists(resnet50_train_repo
+                                   + "train.shards/shard_00000.bin"));
+  ASSERT_TRUE(
+      fileops::file_exists(resnet50_train_repo + "test_0.shards/index.bin"));
+  // dbs are complete and moved to their final name
+  ASSERT_FALSE(fileops::dir_exists(resnet50_train_repo + "train.shards.tmp"));
+
+  std::unordered_set<std::string> lfiles;
+  fileops::list_directory(resnet50_train_repo, true, false, false, lfiles);
+  for (std::string ff : lfiles)
+    {
+      if (ff.find("checkpoint") != std::string::npos
+          || ff.find("solver") != std::string::npos)
+        remove(ff.c_str());
+    }
+  fileops::clear_directory(resnet50_train_repo + "train.shards");
+  fileops::clear_directory(resnet50_train_repo + "test_0.shards");
+  fileops::remove_dir(resnet50_train_repo + "train.shards");
+  fileops::remove_dir(resnet50_train_repo + "test_0.shards");
+}
+
 TEST(torchapi, service_train_images)
 {
   setenv("CUBLAS_WORKSPACE_CONFIG", ":4096:8", true);
@@ -2558,6 +2855,156 @@ TEST(torchapi, service_train_csvts_nbeats)
   rmdir(csvts_nbeats_repo.c_str());
 }
 
+// creates the sinus nbeats service in repo and trains it on cpu, with
+// extra mllib and solver parameters
+static void train_csvts_nbeats(JsonAPI &japi, const std::string &sname,
+                               const std::string &repo,
+                               const std::string &mllib_params,
+                               const std::string &solver_params, JDoc &jd)
+{
+  std::string csvts_data = sinus + "train";
+  std::string csvts_test = sinus + "test";
+  mkdir(repo.c_str(), 0777);
+
+  std::string jstr
+      = "{\"mllib\":\"torch\",\"description\":\"nbeats\",\"type\":"
+        "\"supervised\",\"model\":{\"repository\":\""
+        + repo
+        + "\"},\"parameters\":{\"input\":{\"connector\":\"csvts\",\"ignore\":["
+          "\"output\"],\"backcast_timesteps\":50,\"forecast_timesteps\":50},"
+          "\"mllib\":{\"template\":\"nbeats\","
+          "\"template_params\":{\"stackdef\":[\"t2\",\"s\",\"g3\",\"b3\"]},"
+          "\"loss\":\"L1\"}}}";
+  std::string joutstr = japi.jrender(japi.service_create(sname, jstr));
+  ASSERT_EQ(created_str, joutstr);
+
+  std::string jtrainstr
+      = "{\"service\":\"" + sname
+        + "\",\"async\":false,\"parameters\":{\"input\":{\"seed\":12345,"
+          "\"shuffle\":true,"
+          "\"separator\":\",\",\"scale\":true,\"backcast_timesteps\":50,"
+          "\"forecast_timesteps\":50,\"ignore\":["
+          "\"output\"]},\"mllib\":{\"gpu\":false,"
+        + mllib_params + "\"solver\":{\"iterations\":" + iterations_nbeats_cpu
+        + "," + solver_params
+        + "\"base_lr\":0.1,\"test_initialization\":false,\"solver_type\":"
+          "\"ADAM\"},\"net\":{\"batch_size\":2,\"test_batch_size\":10}},"
+          "\"output\":{\"measure\":[\"L1_all\",\"L2\"]}},\"data\":[\""
+        + csvts_data + "\",\"" + csvts_test + "\"]}";
+  joutstr = japi.jrender(japi.service_train(jtrainstr));
+  std::cout << "joutstr=" << joutstr << std::endl;
+  jd.Parse(joutstr.c_str());
+  ASSERT_TRUE(!jd.HasParseError());
+  ASSERT_EQ(201, jd["status"]["code"].GetInt());
+}
+
+// iteration recorded in best_model.txt, -1 if none
+static int64_t best_model_iteration(const std::string &repo)
+{
+  std::ifstream bestfile(repo + "/best_model.txt");
+  std::string line;
+  if (!std::getline(bestfile, line) || line.find("iteration:") != 0)
+    return -1;
+  return std::stoll(line.substr(10));
+}
+
+TEST(torchapi, service_train_csvts_nbeats_test_async)
+{
+  std::string sname = "nbeats";
+  std::string csvts_nbeats_repo = "csvts_nbeats";
+
+  // same checks whether the model is tested synchronously or
+  // asynchronously every 10 iterations
+  for (bool test_async : { false, true })
+    {
+      torch::manual_seed(torch_seed);
+      JsonAPI japi;
+      JDoc jd;
+      train_csvts_nbeats(japi, sname, csvts_nbeats_repo,
+                         std::string("\"test_async\":")
+                             + (test_async ? "true," : "false,"),
+                         "\"test_interval\":10,\"snapshot\":500,", jd);
+      ASSERT_TRUE(jd["body"]["measure"].HasMember("L1_mean_error"));
+      ASSERT_EQ(jd["body"]["measure"]["iteration"].GetDouble(),
+                std::stod(iterations_nbeats_cpu));
+
+      // best model weights and solver state of the same iteration
+      int64_t best_it = best_model_iteration(csvts_nbeats_repo);
+      ASSERT_GT(best_it, 0);
+      std::string best = std::to_string(best_it);
+      ASSERT_TRUE(fileops::file_exists(csvts_nbeats_repo + "/checkpoint-"
+                                       + best + ".npt"));
+      ASSERT_TRUE(fileops::file_exists(csvts_nbeats_repo + "/solver-" + best
+                                       + ".pt"));
+
+      //  remove service
+      std::string jstr = "{\"clear\":\"full\"}";
+      std::string joutstr = japi.jrender(japi.service_delete(sname, jstr));
+      ASSERT_EQ(ok_str, joutstr);
+      rmdir(csvts_nbeats_repo.c_str());
+    }
+}
+
+TEST(torchapi, service_train_csvts_nbeats_snapshot_async)
+{
+  torch::manual_seed(torch_seed);
+  JsonAPI japi;
+  std::string sname = "nbeats";
+  std::string csvts_nbeats_repo = "csvts_nbeats";
+
+  // train, writing snapshots in the background and keeping the last two
+  JDoc jd;
+  train_csvts_nbeats(japi, sname, csvts_nbeats_repo, "",
+                     "\"test_interval\":50,\"snapshot\":10,"
+                     "\"snapshot_async\":true,\"snapshot_max_pending\":1,"
+                     "\"snapshot_retain\":2,",
+                     jd);
+
+  // snapshots are written when train returns: exactly the last two
+  // regular snapshots plus the best model, whether or not the best model is
+  // also a regular snapshot, and no temporary file left
+  std::unordered_set<std::string> lfiles;
+  fileops::list_directory(csvts_nbeats_repo, true, false, false, lfiles);
+  std::vector<std::string> solvers;
+  std::set<std::string> solver_names;
+  for (const std::string &f : lfiles)
+    {
+      ASSERT_EQ(f.find(".tmp"), std::string::npos);
+      if (f.find("solver-") != std::string::npos)
+        {
+          solvers.push_back(f);
+          solver_names.insert(f.substr(f.rfind('/') + 1));
+        }
+    }
+  int64_t last_it = std::stoll(iterations_nbeats_cpu);
+  int64_t best_it = best_model_iteration(csvts_nbeats_repo);
+  ASSERT_GT(best_it, 0);
+  std::set<std::string> expected_names;
+  for (int64_t snap_it : { last_it, last_it - 10, best_it })
+    expected_names.insert("solver-" + std::to_string(snap_it) + ".pt");
+  ASSERT_EQ(expected_names, solver_names);
+
+  // each snapshot has its weights, and both files are complete archives
+  for (const std::string &solver : solvers)
+    {
+      std::string checkpoint = solver;
+      checkpoint.replace(checkpoint.find("solver-"), 7, "checkpoint-");
+      checkpoint.replace(checkpoint.size() - 3, 3, ".npt");
+      ASSERT_TRUE(fileops::file_exists(checkpoint));
+      for (const std::string &f : { solver, checkpoint })
+        {
+          torch::serialize::InputArchive archive;
+          ASSERT_NO_THROW(archive.load_from(f));
+        }
+    }
+
+  //  remove service
+  std::string jstr = "{\"clear\":\"full\"}";
+  std::string joutstr = japi.jrender(japi.service_delete(sname, jstr));
+  ASSERT_EQ(ok_str, joutstr);
+  rmdir(csvts_nbeats_repo.c_str());
+}
+
 TEST(torchapi, service_train_csvts_nbeats_db)
 {
   setenv("CUBLAS_WORKSPACE_CONFIG", ":4096:8", true);